@@ -5157,6 +5157,40 @@ compile_test() {
             compile_check_conftest "$CODE" "NV_IOASID_GET_PRESENT" "" "functions"
         ;;
 
+        shrinker_alloc)
+            #
+            # Determine if the shrinker_alloc() function is present.
+            #
+            # shrinker_alloc(), shrinker_register() and shrinker_free() were
+            # added by commit c42d50aefd17 ("mm: shrinker: add infrastructure
+            # for dynamically allocating shrinker") in v6.7 (2023-09-11).
+            # register_shrinker() was removed in the same release.
+            #
+            CODE="
+            #include <linux/mm.h>
+            struct shrinker *conftest_shrinker_alloc(void) {
+                return shrinker_alloc(0, \"%s\", \"conftest\");
+            }"
+
+            compile_check_conftest "$CODE" "NV_SHRINKER_ALLOC_PRESENT" "" "types"
+        ;;
+
+        register_shrinker_has_format_arg)
+            #
+            # Determine if register_shrinker() takes a name format argument.
+            #
+            # Shrinker names were added by commit e33c267ab70d ("mm: shrinkers:
+            # provide shrinkers with names") in v6.0 (2022-05-31).
+            #
+            CODE="
+            #include <linux/mm.h>
+            int conftest_register_shrinker_has_format_arg(struct shrinker *s) {
+                return register_shrinker(s, \"%s\", \"conftest\");
+            }"
+
+            compile_check_conftest "$CODE" "NV_REGISTER_SHRINKER_HAS_FORMAT_ARG" "" "types"
+        ;;
+
         drm_crtc_state_has_no_vblank)
             #
             # Determine if the 'drm_crtc_state' structure has 'no_vblank'.
@@ -79,12 +79,17 @@ void uvm_service_block_context_exit(void)
     INIT_LIST_HEAD(&g_cpu_service_block_context_list);
 }
 
-// Get a fault service context from the global list or allocate a new one if there are no
+// Get a fault service context from the VA block context arena of the current
+// thread, or else from the global list or allocate a new one if there are no
 // available entries
 static uvm_service_block_context_t *uvm_service_block_context_cpu_alloc(void)
 {
     uvm_service_block_context_t *service_context;
 
+    service_context = uvm_va_block_service_context_get();
+    if (service_context)
+        return service_context;
+
     uvm_spin_lock(&g_cpu_service_block_context_list_lock);
 
     service_context = list_first_entry_or_null(&g_cpu_service_block_context_list, uvm_service_block_context_t,
@@ -101,9 +106,13 @@ static uvm_service_block_context_t *uvm_service_block_context_cpu_alloc(void)
     return service_context;
 }
 
-// Put a fault service context in the global list
+// Put a fault service context back in the arena it came from, or else in the
+// global list
 static void uvm_service_block_context_cpu_free(uvm_service_block_context_t *service_context)
 {
+    if (uvm_va_block_service_context_put(service_context))
+        return;
+
     uvm_spin_lock(&g_cpu_service_block_context_list_lock);
 
     list_add(&service_context->cpu_fault.service_context_list, &g_cpu_service_block_context_list);
@@ -686,3 +686,177 @@ done:
 
     return status;
 }
+
+// Copy size bytes from src to dst in chunk_size pieces, each in its own push,
+// and return the aggregate bandwidth. If striped is set, the pushes are begun
+// like the copies of large migrations and the mask of the CEs used is
+// returned in ce_mask.
+static NV_STATUS ce_stripe_copy(uvm_gpu_t *gpu,
+                                uvm_rm_mem_t *dst,
+                                uvm_rm_mem_t *src,
+                                NvU64 size,
+                                NvU64 chunk_size,
+                                bool striped,
+                                unsigned long *ce_mask,
+                                NvU64 *bytes_per_us)
+{
+    NV_STATUS status = NV_OK;
+    uvm_tracker_t tracker = UVM_TRACKER_INIT();
+    NvU64 offset;
+    NvU64 start_time;
+    NvU64 elapsed_us;
+
+    start_time = NV_GETTIME();
+
+    for (offset = 0; offset < size; offset += chunk_size) {
+        uvm_push_t push;
+        NvU64 copy_size = min(chunk_size, size - offset);
+
+        if (striped) {
+            status = uvm_push_begin_acquire_striped(gpu->channel_manager,
+                                                    UVM_CHANNEL_TYPE_CPU_TO_GPU,
+                                                    NULL,
+                                                    copy_size,
+                                                    NULL,
+                                                    &push,
+                                                    "Striped copy at offset %llu",
+                                                    offset);
+        }
+        else {
+            status = uvm_push_begin(gpu->channel_manager,
+                                    UVM_CHANNEL_TYPE_CPU_TO_GPU,
+                                    &push,
+                                    "Single CE copy at offset %llu",
+                                    offset);
+        }
+
+        if (status != NV_OK)
+            break;
+
+        if (ce_mask)
+            __set_bit(push.channel->pool->ce_index, ce_mask);
+
+        gpu->parent->ce_hal->memcopy_v_to_v(&push,
+                                            uvm_rm_mem_get_gpu_va(dst, gpu, uvm_channel_is_proxy(push.channel)) + offset,
+                                            uvm_rm_mem_get_gpu_va(src, gpu, uvm_channel_is_proxy(push.channel)) + offset,
+                                            copy_size);
+        uvm_push_end(&push);
+
+        status = uvm_tracker_add_push_safe(&tracker, &push);
+        if (status != NV_OK)
+            break;
+    }
+
+    if (status == NV_OK)
+        status = uvm_tracker_wait_deinit(&tracker);
+    else
+        uvm_tracker_wait_deinit(&tracker);
+
+    elapsed_us = max((NV_GETTIME() - start_time) / 1000, 1ULL);
+    *bytes_per_us = size / elapsed_us;
+
+    return status;
+}
+
+static NV_STATUS test_ce_stripe_bandwidth(uvm_gpu_t *gpu, UVM_TEST_CE_STRIPE_BANDWIDTH_PARAMS *params)
+{
+    NV_STATUS status;
+    uvm_rm_mem_t *sys_mem = NULL;
+    uvm_rm_mem_t *sys_verif_mem = NULL;
+    uvm_rm_mem_t *vid_mem = NULL;
+    NvU32 *sys_ptr;
+    NvU32 *sys_verif_ptr;
+    uvm_push_t push;
+    NvU64 i;
+    DECLARE_BITMAP(ce_mask, UVM_COPY_ENGINE_COUNT_MAX);
+
+    bitmap_zero(ce_mask, UVM_COPY_ENGINE_COUNT_MAX);
+
+    status = uvm_rm_mem_alloc_and_map_cpu(gpu, UVM_RM_MEM_TYPE_SYS, params->size, &sys_mem);
+    TEST_CHECK_GOTO(status == NV_OK, done);
+    status = uvm_rm_mem_alloc_and_map_cpu(gpu, UVM_RM_MEM_TYPE_SYS, params->size, &sys_verif_mem);
+    TEST_CHECK_GOTO(status == NV_OK, done);
+    status = uvm_rm_mem_alloc(gpu, UVM_RM_MEM_TYPE_GPU, params->size, &vid_mem);
+    TEST_CHECK_GOTO(status == NV_OK, done);
+
+    sys_ptr = (NvU32 *)uvm_rm_mem_get_cpu_va(sys_mem);
+    sys_verif_ptr = (NvU32 *)uvm_rm_mem_get_cpu_va(sys_verif_mem);
+    for (i = 0; i < params->size / sizeof(*sys_ptr); ++i)
+        sys_ptr[i] = (NvU32)i;
+    memset(sys_verif_ptr, 0, params->size);
+
+    status = ce_stripe_copy(gpu,
+                            vid_mem,
+                            sys_mem,
+                            params->size,
+                            params->chunk_size,
+                            false,
+                            NULL,
+                            &params->single_ce_bytes_per_us);
+    TEST_CHECK_GOTO(status == NV_OK, done);
+
+    status = ce_stripe_copy(gpu,
+                            vid_mem,
+                            sys_mem,
+                            params->size,
+                            params->chunk_size,
+                            true,
+                            ce_mask,
+                            &params->striped_bytes_per_us);
+    TEST_CHECK_GOTO(status == NV_OK, done);
+
+    params->num_ces = bitmap_weight(ce_mask, UVM_COPY_ENGINE_COUNT_MAX);
+
+    // Check that the striped copies landed where expected
+    status = uvm_push_begin(gpu->channel_manager, UVM_CHANNEL_TYPE_GPU_TO_CPU, &push, "Stripe verification copy");
+    TEST_CHECK_GOTO(status == NV_OK, done);
+    gpu->parent->ce_hal->memcopy_v_to_v(&push,
+                                        uvm_rm_mem_get_gpu_va(sys_verif_mem, gpu, uvm_channel_is_proxy(push.channel)),
+                                        uvm_rm_mem_get_gpu_va(vid_mem, gpu, uvm_channel_is_proxy(push.channel)),
+                                        params->size);
+    status = uvm_push_end_and_wait(&push);
+    TEST_CHECK_GOTO(status == NV_OK, done);
+
+    for (i = 0; i < params->size / sizeof(*sys_ptr); ++i) {
+        if (sys_verif_ptr[i] != (NvU32)i) {
+            UVM_TEST_PRINT("Bad value at index %llu: 0x%x instead of 0x%x\n", i, sys_verif_ptr[i], (NvU32)i);
+            status = NV_ERR_INVALID_STATE;
+            goto done;
+        }
+    }
+
+done:
+    uvm_rm_mem_free(vid_mem);
+    uvm_rm_mem_free(sys_verif_mem);
+    uvm_rm_mem_free(sys_mem);
+
+    return status;
+}
+
+NV_STATUS uvm_test_ce_stripe_bandwidth(UVM_TEST_CE_STRIPE_BANDWIDTH_PARAMS *params, struct file *filp)
+{
+    NV_STATUS status;
+    uvm_gpu_t *gpu;
+    uvm_va_space_t *va_space = uvm_va_space_get(filp);
+
+    if (params->size == 0 || params->size > UVM_TEST_CE_STRIPE_BANDWIDTH_MAX_SIZE)
+        return NV_ERR_INVALID_ARGUMENT;
+
+    if (params->chunk_size == 0 || params->chunk_size > params->size)
+        return NV_ERR_INVALID_ARGUMENT;
+
+    uvm_va_space_down_read_rm(va_space);
+
+    gpu = uvm_va_space_get_gpu_by_uuid(va_space, &params->gpu_uuid);
+    if (!gpu) {
+        status = NV_ERR_INVALID_DEVICE;
+        goto done;
+    }
+
+    status = test_ce_stripe_bandwidth(gpu, params);
+
+done:
+    uvm_va_space_up_read_rm(va_space);
+
+    return status;
+}
@@ -58,6 +58,49 @@ module_param(uvm_channel_gpfifo_loc, charp, S_IRUGO);
 module_param(uvm_channel_gpput_loc, charp, S_IRUGO);
 module_param(uvm_channel_pushbuffer_loc, charp, S_IRUGO);
 
+// Time to busy wait for GPU work before starting to sleep between checks, see
+// uvm_channel_wait_t.
+static unsigned uvm_channel_wait_spin_us = 20;
+module_param(uvm_channel_wait_spin_us, uint, S_IRUGO|S_IWUSR);
+MODULE_PARM_DESC(uvm_channel_wait_spin_us,
+                 "Time in microseconds to spin waiting for GPU work before sleeping");
+
+// Upper bound of a single sleep while waiting for GPU work. Channel errors are
+// checked at least this often.
+static unsigned uvm_channel_wait_max_sleep_us = 500;
+module_param(uvm_channel_wait_max_sleep_us, uint, S_IRUGO|S_IWUSR);
+MODULE_PARM_DESC(uvm_channel_wait_max_sleep_us,
+                 "Maximum time in microseconds to sleep at once while waiting for GPU work");
+
+// Number of completed pushes to keep a record of in each channel, see
+// uvm_channel_push_trace_record_t. Tracing is disabled if 0.
+#define UVM_CHANNEL_PUSH_TRACE_ENTRIES_MAX (64 * 1024)
+
+static unsigned uvm_channel_push_trace_entries = 0;
+module_param(uvm_channel_push_trace_entries, uint, S_IRUGO);
+MODULE_PARM_DESC(uvm_channel_push_trace_entries,
+                 "Number of completed pushes to record per channel for profiling, 0 to disable");
+
+// Transfers at least this large are striped across CEs, see
+// uvm_channel_reserve_striped()
+static unsigned uvm_channel_stripe_min_size = 1024 * 1024;
+module_param(uvm_channel_stripe_min_size, uint, S_IRUGO|S_IWUSR);
+MODULE_PARM_DESC(uvm_channel_stripe_min_size,
+                 "Size in bytes of the smallest transfer spread across multiple copy engines");
+
+// Shortest sleep worth doing while waiting for GPU work. Shorter sleeps are
+// dominated by the timer slack and scheduling overhead.
+#define UVM_CHANNEL_WAIT_MIN_SLEEP_NS (10 * 1000ULL)
+
+// Smallest push used as a sample of the CE throughput. The execution time of
+// smaller pushes is dominated by fixed overheads.
+#define UVM_CHANNEL_CE_SAMPLE_MIN_BYTES (1024 * 1024)
+
+// CE throughput assumed until it is measured. It is on the optimistic side as
+// underestimating the duration of the work only causes extra wake ups, while
+// overestimating it makes the waiter oversleep.
+#define UVM_CHANNEL_CE_BYTES_PER_US_DEFAULT (16 * 1024)
+
 static NV_STATUS manager_create_procfs_dirs(uvm_channel_manager_t *manager);
 static NV_STATUS manager_create_procfs(uvm_channel_manager_t *manager);
 static NV_STATUS channel_create_procfs(uvm_channel_t *channel);
@@ -72,6 +115,62 @@ typedef enum
     UVM_CHANNEL_UPDATE_MODE_FORCE_ALL
 } uvm_channel_update_mode_t;
 
+// Update the CE throughput estimate of the channel's pool with a large push
+// that was found to be completed at time now. The GPU could not have started
+// the push before it was submitted nor before the previous entry on the
+// channel was seen completed, which bounds the execution time from above. The
+// completion itself is only noticed when polled for, so the sample is a lower
+// bound of the throughput.
+static void channel_pool_sample_ce_throughput(uvm_channel_t *channel, uvm_gpfifo_entry_t *entry, NvU64 now)
+{
+    uvm_channel_pool_t *pool = channel->pool;
+    NvU64 start = max(entry->submit_time_ns, channel->last_completion_time_ns);
+    NvU64 elapsed_us;
+    NvU64 bytes_per_us;
+
+    uvm_assert_spinlock_locked(&pool->lock);
+
+    elapsed_us = max((now - min(start, now)) / 1000, 1ULL);
+    bytes_per_us = max(entry->ce_bytes / elapsed_us, 1ULL);
+
+    if (pool->ce_bytes_per_us == 0)
+        WRITE_ONCE(pool->ce_bytes_per_us, bytes_per_us);
+    else
+        WRITE_ONCE(pool->ce_bytes_per_us, (pool->ce_bytes_per_us * 7 + bytes_per_us) / 8);
+}
+
+// Add a record of a completed push to the push trace ring of the channel. The
+// GPU timestamps are only read if the push is known to be completed, as they
+// are not valid otherwise.
+static void channel_push_trace_record(uvm_channel_t *channel, uvm_gpfifo_entry_t *entry, NvU64 now, bool completed)
+{
+    uvm_channel_push_trace_record_t *record;
+    uvm_push_info_t *push_info = entry->push_info;
+
+    uvm_assert_spinlock_locked(&channel->pool->lock);
+
+    record = &channel->push_trace.records[channel->push_trace.count % channel->push_trace.num_records];
+    ++channel->push_trace.count;
+
+    snprintf(record->description, sizeof(record->description), "%s", push_info->description);
+    record->filename = push_info->filename;
+    record->function = push_info->function;
+    record->line = push_info->line;
+    record->ce_bytes = entry->ce_bytes;
+    record->pushbuffer_size = entry->pushbuffer_size;
+    record->begin_time_ns = entry->trace.begin_time_ns;
+    record->submit_time_ns = entry->trace.submit_time_ns;
+    record->complete_time_ns = now;
+    record->gpu_submit_time_ns = entry->trace.gpu_submit_time_ns;
+    record->gpu_begin_time_ns = 0;
+    record->gpu_end_time_ns = 0;
+
+    if (completed && entry->trace.gpu_begin_timestamp && entry->trace.gpu_end_timestamp) {
+        record->gpu_begin_time_ns = READ_ONCE(*entry->trace.gpu_begin_timestamp);
+        record->gpu_end_time_ns = READ_ONCE(*entry->trace.gpu_end_timestamp);
+    }
+}
+
 // Update channel progress, completing up to max_to_complete entries
 static NvU32 uvm_channel_update_progress_with_max(uvm_channel_t *channel,
                                                   NvU32 max_to_complete,
@@ -81,6 +180,7 @@ static NvU32 uvm_channel_update_progress_with_max(uvm_channel_t *channel,
     NvU32 cpu_put;
     NvU32 completed_count = 0;
     NvU32 pending_gpfifos;
+    NvU64 now = 0;
 
     NvU64 completed_value = uvm_channel_update_completed_value(channel);
 
@@ -95,7 +195,24 @@ static NvU32 uvm_channel_update_progress_with_max(uvm_channel_t *channel,
         if (mode == UVM_CHANNEL_UPDATE_MODE_COMPLETED && entry->tracking_semaphore_value > completed_value)
             break;
 
+        if (now == 0)
+            now = NV_GETTIME();
+
+        // The GPU timestamps live in the pushbuffer, so they need to be read
+        // before the pushbuffer space is released.
+        if (uvm_channel_push_trace_enabled(channel))
+            channel_push_trace_record(channel, entry, now, mode == UVM_CHANNEL_UPDATE_MODE_COMPLETED);
+
         uvm_pushbuffer_mark_completed(channel->pool->manager->pushbuffer, entry);
+        UVM_ASSERT(channel->pending_pushbuffer_bytes >= entry->pushbuffer_size);
+        channel->pending_pushbuffer_bytes -= entry->pushbuffer_size;
+        channel->completed_ce_bytes += entry->ce_bytes;
+        UVM_ASSERT(channel->completed_ce_bytes <= channel->queued_ce_bytes);
+
+        if (mode == UVM_CHANNEL_UPDATE_MODE_COMPLETED && entry->submit_time_ns != 0)
+            channel_pool_sample_ce_throughput(channel, entry, now);
+
+        channel->last_completion_time_ns = now;
         list_add_tail(&entry->push_info->available_list_node, &channel->available_push_infos);
         gpu_get = (gpu_get + 1) % channel->num_gpfifo_entries;
         ++completed_count;
@@ -175,38 +292,163 @@ static bool try_claim_channel(uvm_channel_t *channel)
     return claimed;
 }
 
+// Number of GPFIFO entries that are either submitted and pending completion,
+// or claimed by an on-going push. The value is read without holding the pool
+// lock so it is only an estimate used to rank the channels in a pool.
+static NvU32 channel_get_load(uvm_channel_t *channel)
+{
+    NvU32 cpu_put = READ_ONCE(channel->cpu_put);
+    NvU32 gpu_get = READ_ONCE(channel->gpu_get);
+    NvU32 pending_gpfifos;
+
+    if (cpu_put >= gpu_get)
+        pending_gpfifos = cpu_put - gpu_get;
+    else
+        pending_gpfifos = channel->num_gpfifo_entries - gpu_get + cpu_put;
+
+    return pending_gpfifos + READ_ONCE(channel->current_pushes_count);
+}
+
+// Pick the channel in the pool that is the least loaded, using the number of
+// GPFIFO entries in use and then the pending pushbuffer bytes to break ties.
+//
+// The search starts at a channel derived from the current CPU so that threads
+// running on different CPUs spread across the pool when the channels are
+// equally loaded, rather than all of them contending on the first channel.
+// Ties are resolved in favor of the channel preferred by the current CPU.
+//
+// Returns NULL if all the channels in the pool appear to be full.
+static uvm_channel_t *channel_pool_select_least_loaded(uvm_channel_pool_t *pool)
+{
+    uvm_channel_t *best = NULL;
+    NvU32 best_load = 0;
+    NvU64 best_bytes = 0;
+    NvU32 first = raw_smp_processor_id() % pool->num_channels;
+    NvU32 i;
+
+    for (i = 0; i < pool->num_channels; i++) {
+        uvm_channel_t *channel = pool->channels + (first + i) % pool->num_channels;
+        NvU32 load = channel_get_load(channel);
+        NvU64 bytes;
+
+        // One GPFIFO entry is always kept unused, see channel_is_available()
+        if (load + 1 >= channel->num_gpfifo_entries)
+            continue;
+
+        // An idle channel cannot be beaten
+        if (load == 0)
+            return channel;
+
+        bytes = READ_ONCE(channel->pending_pushbuffer_bytes);
+        if (!best || load < best_load || (load == best_load && bytes < best_bytes)) {
+            best = channel;
+            best_load = load;
+            best_bytes = bytes;
+        }
+    }
+
+    return best;
+}
+
+// Try to claim the least loaded channel in the pool. The selection is done
+// without the pool lock, so the chosen channel may have been claimed by
+// someone else in the meantime, in which case the selection is retried.
+static uvm_channel_t *channel_pool_try_claim_least_loaded(uvm_channel_pool_t *pool)
+{
+    uvm_channel_t *channel;
+
+    while ((channel = channel_pool_select_least_loaded(pool)) != NULL) {
+        if (try_claim_channel(channel))
+            return channel;
+    }
+
+    return NULL;
+}
+
+// Wait for the oldest pending GPFIFO entry in the given channel to complete,
+// which frees at least one entry in the channel once its progress is updated.
+static NV_STATUS channel_wait_for_free_entry(uvm_channel_t *channel, uvm_spin_loop_t *spin)
+{
+    NV_STATUS status = NV_OK;
+    uvm_channel_wait_t wait;
+    NvU64 wait_value;
+
+    uvm_spin_lock(&channel->pool->lock);
+
+    // If nothing is pending completion, the channel is full of on-going pushes
+    // that have to end first, which bumps the queued value.
+    if (channel->gpu_get != channel->cpu_put)
+        wait_value = channel->gpfifo_entries[channel->gpu_get].tracking_semaphore_value;
+    else
+        wait_value = channel->tracking_sem.queued_value + 1;
+
+    uvm_spin_unlock(&channel->pool->lock);
+
+    uvm_channel_wait_begin(&wait, channel, wait_value, spin);
+
+    while (!uvm_gpu_tracking_semaphore_is_value_completed(&channel->tracking_sem, wait_value)) {
+        status = uvm_channel_check_errors(channel);
+        if (status != NV_OK)
+            break;
+
+        // The pushes holding the channel may have ended, making room
+        if (channel_get_load(channel) + 1 < channel->num_gpfifo_entries)
+            break;
+
+        uvm_channel_wait_iter(&wait);
+    }
+
+    uvm_channel_wait_end(&wait);
+
+    return status;
+}
+
 // Reserve a channel in the specified pool
 static NV_STATUS channel_reserve_in_pool(uvm_channel_pool_t *pool, uvm_channel_t **channel_out)
 {
     uvm_channel_t *channel;
     uvm_spin_loop_t spin;
 
-    uvm_for_each_channel_in_pool(channel, pool) {
-        // TODO: Bug 1764953: Prefer idle/less busy channels
-        if (try_claim_channel(channel)) {
-            *channel_out = channel;
-            return NV_OK;
-        }
+    channel = channel_pool_try_claim_least_loaded(pool);
+    if (channel) {
+        *channel_out = channel;
+        return NV_OK;
     }
 
     uvm_spin_loop_init(&spin);
     while (1) {
-        uvm_for_each_channel_in_pool(channel, pool) {
-            NV_STATUS status;
+        uvm_channel_t *wait_channel = NULL;
+        NvU64 wait_bytes = 0;
+        NV_STATUS status;
 
+        uvm_for_each_channel_in_pool(channel, pool) {
             uvm_channel_update_progress(channel);
 
-            if (try_claim_channel(channel)) {
-                *channel_out = channel;
-                return NV_OK;
-            }
-
             status = uvm_channel_check_errors(channel);
             if (status != NV_OK)
                 return status;
+        }
 
-            UVM_SPIN_LOOP(&spin);
+        channel = channel_pool_try_claim_least_loaded(pool);
+        if (channel) {
+            *channel_out = channel;
+            return NV_OK;
         }
+
+        // All the channels are full. Instead of polling all of them, wait for
+        // the channel with the least pending work to complete its oldest entry.
+        uvm_for_each_channel_in_pool(channel, pool) {
+            NvU64 bytes = READ_ONCE(channel->pending_pushbuffer_bytes);
+
+            if (!wait_channel || bytes < wait_bytes) {
+                wait_channel = channel;
+                wait_bytes = bytes;
+            }
+        }
+
+        status = channel_wait_for_free_entry(wait_channel, &spin);
+        if (status != NV_OK)
+            return status;
     }
 
     UVM_ASSERT_MSG(0, "Cannot get here?!\n");
@@ -218,9 +460,7 @@ NV_STATUS uvm_channel_reserve_type(uvm_channel_manager_t *manager, uvm_channel_t
     return channel_reserve_in_pool(manager->pool_to_use.default_for_type[type], channel_out);
 }
 
-NV_STATUS uvm_channel_reserve_gpu_to_gpu(uvm_channel_manager_t *manager,
-                                         uvm_gpu_t *dst_gpu,
-                                         uvm_channel_t **channel_out)
+static uvm_channel_pool_t *channel_manager_gpu_to_gpu_pool(uvm_channel_manager_t *manager, uvm_gpu_t *dst_gpu)
 {
     const NvU32 dst_gpu_index = uvm_id_gpu_index(dst_gpu->id);
     uvm_channel_pool_t *pool = manager->pool_to_use.gpu_to_gpu[dst_gpu_index];
@@ -229,6 +469,71 @@ NV_STATUS uvm_channel_reserve_gpu_to_gpu(uvm_channel_manager_t *manager,
     if (pool == NULL)
         pool = manager->pool_to_use.default_for_type[UVM_CHANNEL_TYPE_GPU_TO_GPU];
 
+    return pool;
+}
+
+NV_STATUS uvm_channel_reserve_gpu_to_gpu(uvm_channel_manager_t *manager,
+                                         uvm_gpu_t *dst_gpu,
+                                         uvm_channel_t **channel_out)
+{
+    return channel_reserve_in_pool(channel_manager_gpu_to_gpu_pool(manager, dst_gpu), channel_out);
+}
+
+// Estimate how long the CE of the pool will take to execute the work already
+// submitted to it. The channels of a pool share the CE, so their estimates
+// add up.
+static NvU64 channel_pool_estimate_pending_ns(uvm_channel_pool_t *pool)
+{
+    uvm_channel_t *channel;
+    NvU64 pending_ns = 0;
+
+    uvm_for_each_channel_in_pool(channel, pool)
+        pending_ns += uvm_channel_estimate_pending_ns(channel);
+
+    return pending_ns;
+}
+
+NV_STATUS uvm_channel_reserve_striped(uvm_channel_manager_t *manager,
+                                      uvm_channel_type_t type,
+                                      uvm_gpu_t *dst_gpu,
+                                      NvU64 size,
+                                      uvm_channel_t **channel_out)
+{
+    uvm_channel_pool_t *pool;
+    unsigned i;
+
+    UVM_ASSERT(type < UVM_CHANNEL_TYPE_COUNT);
+    UVM_ASSERT(dst_gpu == NULL || type == UVM_CHANNEL_TYPE_GPU_TO_GPU);
+
+    // GPU_TO_GPU transfers are never striped, so they stay on the optimal pool
+    // for their peer
+    UVM_ASSERT(type != UVM_CHANNEL_TYPE_GPU_TO_GPU || manager->pool_to_use.num_stripe[type] == 1);
+
+    if (dst_gpu)
+        pool = channel_manager_gpu_to_gpu_pool(manager, dst_gpu);
+    else
+        pool = manager->pool_to_use.default_for_type[type];
+
+    // The preferred pool wins ties, so an idle GPU keeps using it until it has
+    // work queued.
+    if (size >= uvm_channel_stripe_min_size && manager->pool_to_use.num_stripe[type] > 1) {
+        NvU64 best_ns = channel_pool_estimate_pending_ns(pool);
+
+        for (i = 0; i < manager->pool_to_use.num_stripe[type] && best_ns != 0; ++i) {
+            uvm_channel_pool_t *candidate = manager->pool_to_use.stripe[type][i];
+            NvU64 pending_ns;
+
+            if (candidate == pool)
+                continue;
+
+            pending_ns = channel_pool_estimate_pending_ns(candidate);
+            if (pending_ns < best_ns) {
+                pool = candidate;
+                best_ns = pending_ns;
+            }
+        }
+    }
+
     return channel_reserve_in_pool(pool, channel_out);
 }
 
@@ -237,6 +542,8 @@ NV_STATUS uvm_channel_manager_wait(uvm_channel_manager_t *manager)
     NV_STATUS status = NV_OK;
     uvm_spin_loop_t spin;
 
+    uvm_push_coalesce_flush_current_thread();
+
     if (uvm_channel_manager_update_progress(manager) == 0)
         return uvm_channel_manager_check_errors(manager);
 
@@ -283,9 +590,41 @@ NV_STATUS uvm_channel_begin_push(uvm_channel_t *channel, uvm_push_t *push)
     push->channel_tracking_value = 0;
     push->push_info_index = channel_get_available_push_info_index(channel);
 
+    // Whether the push is traced is decided once here, as tests can enable
+    // tracing on a channel at any time.
+    if (uvm_channel_push_trace_enabled(channel)) {
+        push->trace.begin_time_ns = NV_GETTIME();
+        push->trace.reserved_size = UVM_CHANNEL_PUSH_TRACE_TIMESTAMP_SIZE;
+    }
+
     return NV_OK;
 }
 
+// Release a GPU timestamp for the push trace, padded to exactly
+// UVM_CHANNEL_PUSH_TRACE_TIMESTAMP_SIZE so that a traced push filled up to
+// uvm_push_has_space() ends up exactly UVM_MAX_PUSH_SIZE long.
+static NvU64 *push_trace_timestamp(uvm_push_t *push)
+{
+    uvm_gpu_t *gpu = uvm_push_get_gpu(push);
+    NvU32 size = uvm_push_get_size(push);
+    NvU64 *timestamp;
+
+    timestamp = uvm_push_timestamp(push);
+
+    UVM_ASSERT(uvm_push_get_size(push) - size <= UVM_CHANNEL_PUSH_TRACE_TIMESTAMP_SIZE);
+    gpu->parent->host_hal->noop(push, UVM_CHANNEL_PUSH_TRACE_TIMESTAMP_SIZE - (uvm_push_get_size(push) - size));
+
+    return timestamp;
+}
+
+void uvm_channel_push_trace_begin(uvm_push_t *push)
+{
+    if (push->trace.reserved_size == 0)
+        return;
+
+    push->trace.gpu_begin_timestamp = push_trace_timestamp(push);
+}
+
 static void internal_channel_submit_work(uvm_push_t *push, NvU32 push_size, NvU32 new_gpu_put)
 {
     NvU64 *gpfifo_entry;
@@ -356,6 +695,15 @@ void uvm_channel_end_push(uvm_push_t *push)
     NvU32 push_size;
     NvU32 cpu_put;
     NvU32 new_cpu_put;
+    NvU64 *gpu_end_timestamp = NULL;
+
+    // Traced pushes release a GPU timestamp at the end, in the space reserved
+    // for it when the push began, so that the execution time of the push can
+    // be told apart from the time it spent queued behind other work.
+    if (push->trace.reserved_size != 0) {
+        push->trace.reserved_size = 0;
+        gpu_end_timestamp = push_trace_timestamp(push);
+    }
 
     uvm_spin_lock(&channel->pool->lock);
 
@@ -376,8 +724,25 @@ void uvm_channel_end_push(uvm_push_t *push)
     entry->pushbuffer_offset = uvm_pushbuffer_get_offset_for_push(pushbuffer, push);
     entry->pushbuffer_size = push_size;
     entry->push_info = &channel->push_infos[push->push_info_index];
+    channel->pending_pushbuffer_bytes += push_size;
+    entry->ce_bytes = push->ce_bytes;
+    entry->submit_time_ns = push->ce_bytes >= UVM_CHANNEL_CE_SAMPLE_MIN_BYTES ? NV_GETTIME() : 0;
+    channel->queued_ce_bytes += push->ce_bytes;
+    entry->queued_ce_bytes = channel->queued_ce_bytes;
     push->push_info_index = -1;
 
+    if (gpu_end_timestamp != NULL) {
+        entry->trace.begin_time_ns = push->trace.begin_time_ns;
+        entry->trace.submit_time_ns = NV_GETTIME();
+        entry->trace.gpu_submit_time_ns = gpu->parent->host_hal->get_time(gpu);
+        entry->trace.gpu_begin_timestamp = push->trace.gpu_begin_timestamp;
+        entry->trace.gpu_end_timestamp = gpu_end_timestamp;
+    }
+    else if (uvm_channel_push_trace_enabled(channel)) {
+        // The push began before tracing was enabled on the channel
+        memset(&entry->trace, 0, sizeof(entry->trace));
+    }
+
     UVM_ASSERT(channel->current_pushes_count > 0);
     --channel->current_pushes_count;
 
@@ -417,8 +782,7 @@ NV_STATUS uvm_channel_reserve(uvm_channel_t *channel)
 
     uvm_spin_loop_init(&spin);
     while (!try_claim_channel(channel) && status == NV_OK) {
-        UVM_SPIN_LOOP(&spin);
-        status = uvm_channel_check_errors(channel);
+        status = channel_wait_for_free_entry(channel, &spin);
         uvm_channel_update_progress(channel);
     }
 
@@ -532,6 +896,130 @@ NvU64 uvm_channel_update_completed_value(uvm_channel_t *channel)
     return uvm_gpu_tracking_semaphore_update_completed_value(&channel->tracking_sem);
 }
 
+static NvU64 channel_estimate_ce_ns(uvm_channel_t *channel, NvU64 bytes)
+{
+    NvU64 bytes_per_us = READ_ONCE(channel->pool->ce_bytes_per_us);
+
+    if (bytes_per_us == 0)
+        bytes_per_us = UVM_CHANNEL_CE_BYTES_PER_US_DEFAULT;
+
+    return div64_u64(bytes * 1000, bytes_per_us);
+}
+
+NvU64 uvm_channel_estimate_pending_ns(uvm_channel_t *channel)
+{
+    // Both counters only grow, and the completed one is read first, so the
+    // difference cannot underflow.
+    NvU64 completed_bytes = READ_ONCE(channel->completed_ce_bytes);
+    NvU64 queued_bytes;
+
+    smp_rmb();
+    queued_bytes = READ_ONCE(channel->queued_ce_bytes);
+
+    return channel_estimate_ce_ns(channel, queued_bytes - completed_bytes);
+}
+
+NvU64 uvm_channel_estimate_pending_ns_until(uvm_channel_t *channel, NvU64 value)
+{
+    uvm_gpfifo_entry_t *entry = &channel->gpfifo_entries[(value - 1) % channel->num_gpfifo_entries];
+    NvU64 completed_bytes;
+    NvU64 queued_bytes;
+
+    // Each push takes the next GPFIFO entry and tracking value, so the push
+    // completing value is at a fixed index. The entry is read without the pool
+    // lock, as waits may happen under locks ordered after it. If the push has
+    // not been submitted yet, or its entry has already been reused, fall back
+    // to all the work pending on the channel.
+    if (value == 0 || READ_ONCE(entry->tracking_semaphore_value) != value)
+        return uvm_channel_estimate_pending_ns(channel);
+
+    smp_rmb();
+    queued_bytes = READ_ONCE(entry->queued_ce_bytes);
+    completed_bytes = READ_ONCE(channel->completed_ce_bytes);
+
+    if (READ_ONCE(entry->tracking_semaphore_value) != value)
+        return uvm_channel_estimate_pending_ns(channel);
+
+    if (completed_bytes >= queued_bytes)
+        return 0;
+
+    return channel_estimate_ce_ns(channel, queued_bytes - completed_bytes);
+}
+
+void uvm_channel_wait_begin(uvm_channel_wait_t *wait, uvm_channel_t *channel, NvU64 value, uvm_spin_loop_t *spin)
+{
+    memset(wait, 0, sizeof(*wait));
+
+    wait->channel = channel;
+    wait->spin = spin;
+    wait->may_sleep = NV_MAY_SLEEP();
+    wait->start_time_ns = NV_GETTIME();
+    wait->backoff_ns = UVM_CHANNEL_WAIT_MIN_SLEEP_NS;
+
+    // Only the work queued up to the awaited value counts, but that still
+    // includes work already done and not yet noticed by
+    // uvm_channel_update_progress(), so the estimate errs on the long side.
+    // Only the part of it exceeding the spin time is slept through, and the
+    // sleeps are capped, which bounds the cost of a bad estimate.
+    if (wait->may_sleep)
+        wait->expected_end_ns = wait->start_time_ns + uvm_channel_estimate_pending_ns_until(channel, value);
+}
+
+NV_STATUS uvm_channel_wait_iter(uvm_channel_wait_t *wait)
+{
+    NvU64 spin_ns = READ_ONCE(uvm_channel_wait_spin_us) * 1000ULL;
+    NvU64 max_sleep_ns = max(READ_ONCE(uvm_channel_wait_max_sleep_us) * 1000ULL, UVM_CHANNEL_WAIT_MIN_SLEEP_NS);
+    NvU64 now = NV_GETTIME();
+    NvU64 sleep_ns = 0;
+
+    ++wait->iterations;
+
+    if (wait->may_sleep) {
+        if (wait->expected_end_ns > now + spin_ns) {
+            // Sleep until shortly before the work is expected to be done
+            sleep_ns = wait->expected_end_ns - now - spin_ns;
+        }
+        else if (now >= wait->expected_end_ns && now - wait->start_time_ns >= spin_ns) {
+            // The work is taking longer than estimated, and the spin time is
+            // used up. Back off exponentially.
+            sleep_ns = wait->backoff_ns;
+            wait->backoff_ns = min(wait->backoff_ns * 2, max_sleep_ns);
+        }
+    }
+
+    if (sleep_ns >= UVM_CHANNEL_WAIT_MIN_SLEEP_NS) {
+        NvU64 sleep_us = min(sleep_ns, max_sleep_ns) / 1000;
+
+        usleep_range(sleep_us, sleep_us + sleep_us / 4);
+
+        wait->sleep_ns += NV_GETTIME() - now;
+        ++wait->sleeps;
+    }
+
+    return UVM_SPIN_LOOP(wait->spin);
+}
+
+void uvm_channel_wait_end(uvm_channel_wait_t *wait)
+{
+    uvm_channel_manager_t *manager = wait->channel->pool->manager;
+    NvU64 elapsed;
+
+    // Waits that completed without waiting are not interesting
+    if (wait->iterations == 0)
+        return;
+
+    elapsed = NV_GETTIME() - wait->start_time_ns;
+
+    atomic64_inc(&manager->wait_stats.waits);
+    atomic64_add(elapsed - min(elapsed, wait->sleep_ns), &manager->wait_stats.spin_ns);
+
+    if (wait->sleeps > 0) {
+        atomic64_inc(&manager->wait_stats.sleeping_waits);
+        atomic64_add(wait->sleeps, &manager->wait_stats.sleeps);
+        atomic64_add(wait->sleep_ns, &manager->wait_stats.sleep_ns);
+    }
+}
+
 static void channel_destroy(uvm_channel_pool_t *pool, uvm_channel_t *channel)
 {
     UVM_ASSERT(pool->num_channels > 0);
@@ -548,10 +1036,12 @@ static void channel_destroy(uvm_channel_pool_t *pool, uvm_channel_t *channel)
         channel_update_progress_all(channel, UVM_CHANNEL_UPDATE_MODE_FORCE_ALL);
     }
 
+    uvm_procfs_destroy_entry(channel->procfs.push_trace);
     uvm_procfs_destroy_entry(channel->procfs.pushes);
     uvm_procfs_destroy_entry(channel->procfs.info);
     uvm_procfs_destroy_entry(channel->procfs.dir);
 
+    uvm_kvfree(channel->push_trace.records);
     uvm_kvfree(channel->push_acquire_infos);
     uvm_kvfree(channel->push_infos);
 
@@ -640,6 +1130,58 @@ static NV_STATUS proxy_channel_create(uvm_channel_t *channel, unsigned ce_index)
     return NV_OK;
 }
 
+// Index of the channel among all the channels of its channel manager. Pools are
+// created in order, so all the pools preceding the channel's pool have their
+// final number of channels by the time the channel is created.
+static unsigned channel_index_in_manager(uvm_channel_t *channel)
+{
+    uvm_channel_manager_t *manager = channel->pool->manager;
+    unsigned index = uvm_channel_index_in_pool(channel);
+    unsigned i;
+
+    for (i = 0; i < manager->num_channel_pools; i++) {
+        uvm_channel_pool_t *pool = manager->channel_pools + i;
+
+        if (pool == channel->pool)
+            break;
+
+        index += pool->num_channels;
+    }
+
+    return index;
+}
+
+NV_STATUS uvm_channel_push_trace_enable(uvm_channel_t *channel, NvU32 num_records)
+{
+    uvm_channel_push_trace_record_t *records;
+
+    UVM_ASSERT(!uvm_channel_is_proxy(channel));
+    UVM_ASSERT(num_records != 0);
+
+    if (uvm_channel_push_trace_enabled(channel))
+        return NV_OK;
+
+    records = uvm_kvmalloc_zero(sizeof(*records) * num_records);
+    if (records == NULL)
+        return NV_ERR_NO_MEMORY;
+
+    // Pushes of the channel may be completed concurrently, and records are
+    // only ever written with the pool lock held.
+    uvm_spin_lock(&channel->pool->lock);
+
+    if (channel->push_trace.records == NULL) {
+        channel->push_trace.num_records = num_records;
+        channel->push_trace.records = records;
+        records = NULL;
+    }
+
+    uvm_spin_unlock(&channel->pool->lock);
+
+    uvm_kvfree(records);
+
+    return NV_OK;
+}
+
 static NV_STATUS channel_create(uvm_channel_pool_t *pool, uvm_channel_t *channel)
 {
     NV_STATUS status;
@@ -651,6 +1193,8 @@ static NV_STATUS channel_create(uvm_channel_pool_t *pool, uvm_channel_t *channel
 
     channel->pool = pool;
     pool->num_channels++;
+    channel->tracker_bit = (uvm_id_gpu_index(gpu->id) * 16 + channel_index_in_manager(channel)) %
+                           UVM_TRACKER_CHANNEL_MASK_BITS;
     INIT_LIST_HEAD(&channel->available_push_infos);
     channel->tools.pending_event_count = 0;
     INIT_LIST_HEAD(&channel->tools.channel_list_node);
@@ -695,6 +1239,15 @@ static NV_STATUS channel_create(uvm_channel_pool_t *pool, uvm_channel_t *channel
     for (i = 0; i < channel->num_gpfifo_entries; i++)
         list_add_tail(&channel->push_infos[i].available_list_node, &channel->available_push_infos);
 
+    // Proxy channels cannot release timestamps, nor are they used for the
+    // copies tracing is meant to profile.
+    if (uvm_channel_push_trace_entries != 0 && !uvm_channel_is_proxy(channel)) {
+        status = uvm_channel_push_trace_enable(channel, min(uvm_channel_push_trace_entries,
+                                                            (unsigned)UVM_CHANNEL_PUSH_TRACE_ENTRIES_MAX));
+        if (status != NV_OK)
+            goto error;
+    }
+
     status = channel_create_procfs(channel);
     if (status != NV_OK)
         goto error;
@@ -976,7 +1529,67 @@ static NV_STATUS pick_ce_for_channel_type(uvm_channel_manager_t *manager,
     return NV_OK;
 }
 
-static NV_STATUS channel_manager_pick_copy_engines(uvm_channel_manager_t *manager, unsigned *preferred_ce)
+// Returns true if the CE is as capable as the preferred CE of the given type
+// on what matters the most for the type
+static bool ce_as_capable_for_channel_type(uvm_channel_type_t type,
+                                           const UvmGpuCopyEngineCaps *cap,
+                                           const UvmGpuCopyEngineCaps *preferred_cap)
+{
+    switch (type) {
+        case UVM_CHANNEL_TYPE_CPU_TO_GPU:
+            return cap->sysmemRead >= preferred_cap->sysmemRead;
+        case UVM_CHANNEL_TYPE_GPU_TO_CPU:
+            return cap->sysmemWrite >= preferred_cap->sysmemWrite;
+        case UVM_CHANNEL_TYPE_GPU_INTERNAL:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Select the CEs large transfers of the given type are striped across: the
+// preferred CE, plus the usable CEs as capable as it. CEs sharing PCEs with an
+// already selected CE are skipped, as the PCEs are what do the actual copies
+// and striping across them would not add any bandwidth. MEMOPS pushes are
+// small and latency bound, so they are never striped. Neither are GPU_TO_GPU
+// transfers, as the optimal CEs for those depend on the peer and its
+// interconnect, see pool_to_use.gpu_to_gpu.
+static void pick_stripe_ces_for_channel_type(const UvmGpuCopyEngineCaps *ce_caps,
+                                             uvm_channel_type_t type,
+                                             const unsigned *preferred_ce,
+                                             unsigned long *stripe_ce_mask)
+{
+    NvU32 i;
+    const UvmGpuCopyEngineCaps *preferred_cap = ce_caps + preferred_ce[type];
+    NvU32 pce_mask = preferred_cap->cePceMask;
+
+    bitmap_zero(stripe_ce_mask, UVM_COPY_ENGINE_COUNT_MAX);
+    __set_bit(preferred_ce[type], stripe_ce_mask);
+
+    // Without PCE information, CEs cannot be told apart from each other
+    if (type == UVM_CHANNEL_TYPE_MEMOPS || type == UVM_CHANNEL_TYPE_GPU_TO_GPU || pce_mask == 0)
+        return;
+
+    for (i = 0; i < UVM_COPY_ENGINE_COUNT_MAX; ++i) {
+        const UvmGpuCopyEngineCaps *cap = ce_caps + i;
+
+        if (i == preferred_ce[type] || !ce_usable_for_channel_type(type, cap))
+            continue;
+
+        if (!ce_as_capable_for_channel_type(type, cap, preferred_cap))
+            continue;
+
+        if (cap->cePceMask == 0 || (cap->cePceMask & pce_mask) != 0)
+            continue;
+
+        __set_bit(i, stripe_ce_mask);
+        pce_mask |= cap->cePceMask;
+    }
+}
+
+static NV_STATUS channel_manager_pick_copy_engines(uvm_channel_manager_t *manager,
+                                                   unsigned *preferred_ce,
+                                                   unsigned long (*stripe_ce_mask)[BITS_TO_LONGS(UVM_COPY_ENGINE_COUNT_MAX)])
 {
     NV_STATUS status;
     unsigned i;
@@ -1002,6 +1615,9 @@ static NV_STATUS channel_manager_pick_copy_engines(uvm_channel_manager_t *manage
             return status;
     }
 
+    for (i = 0; i < ARRAY_SIZE(types); ++i)
+        pick_stripe_ces_for_channel_type(ces_caps.copyEngineCaps, types[i], preferred_ce, stripe_ce_mask[types[i]]);
+
     return NV_OK;
 }
 
@@ -1186,11 +1802,12 @@ static NV_STATUS channel_manager_create_pools(uvm_channel_manager_t *manager)
     unsigned ce, type;
     unsigned num_channel_pools;
     unsigned preferred_ce[UVM_CHANNEL_TYPE_COUNT];
+    unsigned long stripe_ce_mask[UVM_CHANNEL_TYPE_COUNT][BITS_TO_LONGS(UVM_COPY_ENGINE_COUNT_MAX)];
 
     for (type = 0; type < ARRAY_SIZE(preferred_ce); type++)
         preferred_ce[type] = UVM_COPY_ENGINE_COUNT_MAX;
 
-    status = channel_manager_pick_copy_engines(manager, preferred_ce);
+    status = channel_manager_pick_copy_engines(manager, preferred_ce, stripe_ce_mask);
     if (status != NV_OK)
         return status;
 
@@ -1218,6 +1835,17 @@ static NV_STATUS channel_manager_create_pools(uvm_channel_manager_t *manager)
         UVM_ASSERT(test_bit(ce, manager->ce_mask));
 
         manager->pool_to_use.default_for_type[type] = channel_manager_ce_pool(manager, ce);
+
+        manager->pool_to_use.stripe[type][0] = manager->pool_to_use.default_for_type[type];
+        manager->pool_to_use.num_stripe[type] = 1;
+
+        for_each_set_bit(ce, stripe_ce_mask[type], UVM_COPY_ENGINE_COUNT_MAX) {
+            if (ce == preferred_ce[type])
+                continue;
+
+            manager->pool_to_use.stripe[type][manager->pool_to_use.num_stripe[type]++] =
+                channel_manager_ce_pool(manager, ce);
+        }
     }
 
     // In SR-IOV heavy, add an additional, single-channel, pool that is
@@ -1231,6 +1859,8 @@ static NV_STATUS channel_manager_create_pools(uvm_channel_manager_t *manager)
             return status;
 
         manager->pool_to_use.default_for_type[channel_type] = pool;
+        manager->pool_to_use.stripe[channel_type][0] = pool;
+        manager->pool_to_use.num_stripe[channel_type] = 1;
     }
 
     return NV_OK;
@@ -1285,6 +1915,7 @@ void uvm_channel_manager_destroy(uvm_channel_manager_t *channel_manager)
     if (channel_manager == NULL)
         return;
 
+    uvm_procfs_destroy_entry(channel_manager->procfs.wait_stats);
     uvm_procfs_destroy_entry(channel_manager->procfs.pending_pushes);
 
     channel_manager_destroy_pools(channel_manager);
@@ -1387,6 +2018,7 @@ static void uvm_channel_print_info(uvm_channel_t *channel, struct seq_file *s)
     UVM_SEQ_OR_DBG_PRINT(s, "GPPUT location     %s\n", buffer_location_to_string(manager->conf.gpput_loc));
     UVM_SEQ_OR_DBG_PRINT(s, "get                %u\n", channel->gpu_get);
     UVM_SEQ_OR_DBG_PRINT(s, "put                %u\n", channel->cpu_put);
+    UVM_SEQ_OR_DBG_PRINT(s, "pending bytes      %llu\n", channel->pending_pushbuffer_bytes);
     UVM_SEQ_OR_DBG_PRINT(s, "Semaphore GPU VA   0x%llx\n", uvm_channel_tracking_semaphore_get_gpu_va(channel));
 
     uvm_spin_unlock(&channel->pool->lock);
@@ -1525,6 +2157,45 @@ static int nv_procfs_read_manager_pending_pushes_entry(struct seq_file *s, void
 
 UVM_DEFINE_SINGLE_PROCFS_FILE(manager_pending_pushes_entry);
 
+static void channel_manager_print_wait_stats(uvm_channel_manager_t *manager, struct seq_file *s)
+{
+    uvm_channel_pool_t *pool;
+
+    UVM_SEQ_OR_DBG_PRINT(s, "waits              %lld\n", atomic64_read(&manager->wait_stats.waits));
+    UVM_SEQ_OR_DBG_PRINT(s, "sleeping waits     %lld\n", atomic64_read(&manager->wait_stats.sleeping_waits));
+    UVM_SEQ_OR_DBG_PRINT(s, "sleeps             %lld\n", atomic64_read(&manager->wait_stats.sleeps));
+    UVM_SEQ_OR_DBG_PRINT(s, "spin ns            %lld\n", atomic64_read(&manager->wait_stats.spin_ns));
+    UVM_SEQ_OR_DBG_PRINT(s, "sleep ns           %lld\n", atomic64_read(&manager->wait_stats.sleep_ns));
+
+    uvm_for_each_pool(pool, manager) {
+        UVM_SEQ_OR_DBG_PRINT(s,
+                             "CE %u bytes/us      %llu\n",
+                             pool->ce_index,
+                             READ_ONCE(pool->ce_bytes_per_us));
+    }
+}
+
+static int nv_procfs_read_manager_wait_stats(struct seq_file *s, void *v)
+{
+    uvm_channel_manager_t *manager = (uvm_channel_manager_t *)s->private;
+
+    if (!uvm_down_read_trylock(&g_uvm_global.pm.lock))
+            return -EAGAIN;
+
+    channel_manager_print_wait_stats(manager, s);
+
+    uvm_up_read(&g_uvm_global.pm.lock);
+
+    return 0;
+}
+
+static int nv_procfs_read_manager_wait_stats_entry(struct seq_file *s, void *v)
+{
+    UVM_ENTRY_RET(nv_procfs_read_manager_wait_stats(s, v));
+}
+
+UVM_DEFINE_SINGLE_PROCFS_FILE(manager_wait_stats_entry);
+
 static NV_STATUS manager_create_procfs(uvm_channel_manager_t *manager)
 {
     uvm_gpu_t *gpu = manager->gpu;
@@ -1540,6 +2211,13 @@ static NV_STATUS manager_create_procfs(uvm_channel_manager_t *manager)
     if (manager->procfs.pending_pushes == NULL)
         return NV_ERR_OPERATING_SYSTEM;
 
+    manager->procfs.wait_stats = NV_CREATE_PROC_FILE("wait_stats",
+                                                     gpu->procfs.dir,
+                                                     manager_wait_stats_entry,
+                                                     manager);
+    if (manager->procfs.wait_stats == NULL)
+        return NV_ERR_OPERATING_SYSTEM;
+
     return NV_OK;
 }
 
@@ -1586,6 +2264,193 @@ static int nv_procfs_read_channel_pushes_entry(struct seq_file *s, void *v)
 
 UVM_DEFINE_SINGLE_PROCFS_FILE(channel_pushes_entry);
 
+// Aggregated push trace records of a single push site
+typedef struct
+{
+    const char *function;
+    int line;
+    NvU64 count;
+    NvU64 ce_bytes;
+
+    // Total CPU time spent building the pushes, from begin to submit
+    NvU64 build_ns;
+
+    // Total time spent in the GPFIFO before execution began, and executing.
+    // Only accounted for pushes with GPU timestamps.
+    NvU64 gpu_count;
+    NvU64 queue_ns;
+    NvU64 exec_ns;
+    NvU64 exec_ce_bytes;
+
+    // Total time between the GPU finishing a push and the CPU noticing it
+    NvU64 notice_ns;
+} channel_push_trace_summary_t;
+
+// Maximum number of distinct push sites summarized, pushes from any other
+// sites are only printed individually
+#define UVM_CHANNEL_PUSH_TRACE_SUMMARY_MAX 32
+
+static NvU64 push_trace_record_queue_ns(uvm_channel_push_trace_record_t *record)
+{
+    return record->gpu_begin_time_ns - min(record->gpu_submit_time_ns, record->gpu_begin_time_ns);
+}
+
+static NvU64 push_trace_record_exec_ns(uvm_channel_push_trace_record_t *record)
+{
+    return record->gpu_end_time_ns - min(record->gpu_begin_time_ns, record->gpu_end_time_ns);
+}
+
+// Time between the GPU finishing the push and the CPU noticing it, with the
+// GPU end time translated to the CPU clock through the submit times.
+static NvU64 push_trace_record_notice_ns(uvm_channel_push_trace_record_t *record)
+{
+    NvU64 gpu_done_ns = record->submit_time_ns + (record->gpu_end_time_ns - record->gpu_submit_time_ns);
+
+    return record->complete_time_ns - min(gpu_done_ns, record->complete_time_ns);
+}
+
+static void channel_push_trace_summary_add(channel_push_trace_summary_t *summary,
+                                           NvU32 *num_summary,
+                                           uvm_channel_push_trace_record_t *record)
+{
+    NvU32 i;
+    channel_push_trace_summary_t *site = NULL;
+
+    for (i = 0; i < *num_summary; ++i) {
+        if (summary[i].function == record->function && summary[i].line == record->line) {
+            site = &summary[i];
+            break;
+        }
+    }
+
+    if (!site) {
+        if (*num_summary == UVM_CHANNEL_PUSH_TRACE_SUMMARY_MAX)
+            return;
+
+        site = &summary[(*num_summary)++];
+        site->function = record->function;
+        site->line = record->line;
+    }
+
+    ++site->count;
+    site->ce_bytes += record->ce_bytes;
+    site->build_ns += record->submit_time_ns - min(record->begin_time_ns, record->submit_time_ns);
+
+    if (record->gpu_begin_time_ns != 0 && record->gpu_end_time_ns != 0) {
+        ++site->gpu_count;
+        site->queue_ns += push_trace_record_queue_ns(record);
+        site->exec_ns += push_trace_record_exec_ns(record);
+        site->exec_ce_bytes += record->ce_bytes;
+        site->notice_ns += push_trace_record_notice_ns(record);
+    }
+}
+
+// Print a summary per push site of the records in the push trace ring of the
+// channel, followed by the records themselves from oldest to newest.
+//
+// Bandwidth is computed over the GPU execution time of the pushes. Pushes
+// that spend most of their time queued are submission-bound (or behind other
+// work on the CE), those with a long build time are CPU-bound, and a long
+// notice time means the waiter was not polling for completion.
+static void channel_print_push_trace(uvm_channel_t *channel, struct seq_file *s)
+{
+    uvm_channel_push_trace_record_t *records;
+    channel_push_trace_summary_t *summary;
+    NvU32 num_summary = 0;
+    NvU32 num_records;
+    NvU64 count;
+    NvU32 first;
+    NvU32 i;
+
+    if (!uvm_channel_push_trace_enabled(channel)) {
+        UVM_SEQ_OR_DBG_PRINT(s, "push tracing disabled, see uvm_channel_push_trace_entries\n");
+        return;
+    }
+
+    records = uvm_kvmalloc(sizeof(*records) * channel->push_trace.num_records);
+    summary = uvm_kvmalloc_zero(sizeof(*summary) * UVM_CHANNEL_PUSH_TRACE_SUMMARY_MAX);
+    if (!records || !summary)
+        goto done;
+
+    // Take a snapshot of the ring to avoid printing with the lock held
+    uvm_spin_lock(&channel->pool->lock);
+    memcpy(records, channel->push_trace.records, sizeof(*records) * channel->push_trace.num_records);
+    count = channel->push_trace.count;
+    uvm_spin_unlock(&channel->pool->lock);
+
+    num_records = (NvU32)min(count, (NvU64)channel->push_trace.num_records);
+    first = count > num_records ? count % channel->push_trace.num_records : 0;
+
+    for (i = 0; i < num_records; ++i)
+        channel_push_trace_summary_add(summary, &num_summary, &records[(first + i) % channel->push_trace.num_records]);
+
+    UVM_SEQ_OR_DBG_PRINT(s, "pushes recorded %llu, showing %u\n", count, num_records);
+    UVM_SEQ_OR_DBG_PRINT(s, "%-40s %8s %14s %10s %10s %10s %10s %10s\n",
+                         "site", "pushes", "bytes", "MB/s", "build us", "queue us", "exec us", "notice us");
+
+    for (i = 0; i < num_summary; ++i) {
+        channel_push_trace_summary_t *site = &summary[i];
+        char site_name[64];
+        NvU64 gpu_count = max(site->gpu_count, 1ULL);
+
+        snprintf(site_name, sizeof(site_name), "%s:%d", site->function, site->line);
+        UVM_SEQ_OR_DBG_PRINT(s, "%-40s %8llu %14llu %10llu %10llu %10llu %10llu %10llu\n",
+                             site_name,
+                             site->count,
+                             site->ce_bytes,
+                             site->exec_ns ? site->exec_ce_bytes * 1000 / site->exec_ns : 0,
+                             site->build_ns / site->count / 1000,
+                             site->queue_ns / gpu_count / 1000,
+                             site->exec_ns / gpu_count / 1000,
+                             site->notice_ns / gpu_count / 1000);
+    }
+
+    UVM_SEQ_OR_DBG_PRINT(s, "\nrecords (times in ns):\n");
+
+    for (i = 0; i < num_records; ++i) {
+        uvm_channel_push_trace_record_t *record = &records[(first + i) % channel->push_trace.num_records];
+        bool has_gpu_times = record->gpu_begin_time_ns != 0 && record->gpu_end_time_ns != 0;
+
+        UVM_SEQ_OR_DBG_PRINT(s,
+                             " '%s' %s:%d in %s() bytes %llu pb %u build %llu queue %llu exec %llu notice %llu\n",
+                             record->description,
+                             record->filename,
+                             record->line,
+                             record->function,
+                             record->ce_bytes,
+                             record->pushbuffer_size,
+                             record->submit_time_ns - min(record->begin_time_ns, record->submit_time_ns),
+                             has_gpu_times ? push_trace_record_queue_ns(record) : 0,
+                             has_gpu_times ? push_trace_record_exec_ns(record) : 0,
+                             has_gpu_times ? push_trace_record_notice_ns(record) : 0);
+    }
+
+done:
+    uvm_kvfree(summary);
+    uvm_kvfree(records);
+}
+
+static int nv_procfs_read_channel_push_trace(struct seq_file *s, void *v)
+{
+    uvm_channel_t *channel = (uvm_channel_t *)s->private;
+
+    if (!uvm_down_read_trylock(&g_uvm_global.pm.lock))
+            return -EAGAIN;
+
+    channel_print_push_trace(channel, s);
+
+    uvm_up_read(&g_uvm_global.pm.lock);
+
+    return 0;
+}
+
+static int nv_procfs_read_channel_push_trace_entry(struct seq_file *s, void *v)
+{
+    UVM_ENTRY_RET(nv_procfs_read_channel_push_trace(s, v));
+}
+
+UVM_DEFINE_SINGLE_PROCFS_FILE(channel_push_trace_entry);
+
 static NV_STATUS channel_create_procfs(uvm_channel_t *channel)
 {
     char dirname[16];
@@ -1614,5 +2479,9 @@ static NV_STATUS channel_create_procfs(uvm_channel_t *channel)
     if (channel->procfs.pushes == NULL)
         return NV_ERR_OPERATING_SYSTEM;
 
+    channel->procfs.push_trace = NV_CREATE_PROC_FILE("push_trace", channel->procfs.dir, channel_push_trace_entry, channel);
+    if (channel->procfs.push_trace == NULL)
+        return NV_ERR_OPERATING_SYSTEM;
+
     return NV_OK;
 }
@@ -106,8 +106,72 @@ struct uvm_gpfifo_entry_struct
 
     // Push info for the pending push that used this GPFIFO entry
     uvm_push_info_t *push_info;
+
+    // Number of bytes copied or set by CE operations in the push
+    NvU64 ce_bytes;
+
+    // Value of the channel's queued_ce_bytes once this entry was submitted,
+    // i.e. the CE bytes of the push and of all the pushes before it
+    NvU64 queued_ce_bytes;
+
+    // Time at which the push was submitted to the GPU. Only recorded for
+    // pushes large enough to be used as CE throughput samples.
+    NvU64 submit_time_ns;
+
+    // Push trace state, only used if the channel keeps a push trace ring
+    struct
+    {
+        NvU64 begin_time_ns;
+        NvU64 submit_time_ns;
+        NvU64 gpu_submit_time_ns;
+
+        // CPU pointers to the GPU timestamps released at the beginning and at
+        // the end of the push
+        NvU64 *gpu_begin_timestamp;
+        NvU64 *gpu_end_timestamp;
+    } trace;
 };
 
+// Pushbuffer space used to release a GPU timestamp in a traced push: the inline
+// data NOOP, the 16-byte aligned semaphore and the CE methods releasing it,
+// padded to a fixed size. The space for the timestamp at the end of the push
+// is reserved out of UVM_MAX_PUSH_SIZE when the push begins, the same way
+// callers leave UVM_PUSH_END_SIZE for the end of the push.
+#define UVM_CHANNEL_PUSH_TRACE_TIMESTAMP_SIZE 64
+
+// Record of a completed push, kept in the push trace ring of its channel. The
+// ring is only allocated if the uvm_channel_push_trace_entries module
+// parameter is set, and can be read from the push_trace procfs file of the
+// channel.
+typedef struct
+{
+    // Push description and location, copied from its push info
+    char description[64];
+    const char *filename;
+    const char *function;
+    int line;
+
+    // Number of bytes copied or set by CE operations in the push
+    NvU64 ce_bytes;
+
+    // Size of the push in the pushbuffer
+    NvU32 pushbuffer_size;
+
+    // CPU times at which the push was begun, submitted to the GPU, and found
+    // to be completed
+    NvU64 begin_time_ns;
+    NvU64 submit_time_ns;
+    NvU64 complete_time_ns;
+
+    // GPU times at which the push was submitted, and at which the GPU began
+    // and finished executing it. The GPU timer is not synchronized with the
+    // CPU clock, so these are only meaningful relative to each other. The
+    // begin and end times are 0 if they could not be recorded.
+    NvU64 gpu_submit_time_ns;
+    NvU64 gpu_begin_time_ns;
+    NvU64 gpu_end_time_ns;
+} uvm_channel_push_trace_record_t;
+
 // A channel pool is a set of channels that use the same (logical) Copy Engine
 typedef struct
 {
@@ -128,6 +192,12 @@ typedef struct
 
     // Lock protecting the state of channels in the pool
     uvm_spinlock_t lock;
+
+    // Moving average of the CE throughput in bytes per microsecond, sampled
+    // from large pushes as they are found to be completed. Zero until the
+    // first sample is taken. Protected by the pool lock for writing, read
+    // locklessly to estimate how long pending work will take.
+    NvU64 ce_bytes_per_us;
 } uvm_channel_pool_t;
 
 struct uvm_channel_struct
@@ -160,6 +230,37 @@ struct uvm_channel_struct
     // GPFIFO entry for it.
     NvU32 current_pushes_count;
 
+    // Total size in bytes of the pushbuffer space used by the submitted but
+    // not yet completed GPFIFO entries, i.e. the entries in [gpu_get, cpu_put).
+    // Protected by the pool lock. Used as a tie-breaker when selecting the
+    // least loaded channel in a pool.
+    NvU64 pending_pushbuffer_bytes;
+
+    // Total number of bytes copied or set by CE operations in all the GPFIFO
+    // entries ever submitted on the channel, and in the ones completed since.
+    // Their difference is the CE work still pending. Protected by the pool
+    // lock, but only ever growing, so they can be read without it for an
+    // estimate.
+    NvU64 queued_ce_bytes;
+    NvU64 completed_ce_bytes;
+
+    // Time at which uvm_channel_update_progress() last completed a GPFIFO
+    // entry. Protected by the pool lock.
+    NvU64 last_completion_time_ns;
+
+    // Ring of records of the most recently completed pushes on the channel.
+    // Only allocated for UVM internal channels when push tracing is enabled.
+    // Protected by the pool lock.
+    struct
+    {
+        uvm_channel_push_trace_record_t *records;
+        NvU32 num_records;
+
+        // Total number of pushes recorded. The next record is written at index
+        // count % num_records.
+        NvU64 count;
+    } push_trace;
+
     // Array of uvm_push_info_t for all pending pushes on the channel
     uvm_push_info_t *push_infos;
 
@@ -178,6 +279,12 @@ struct uvm_channel_struct
     // uvm_channel_end_push().
     uvm_gpu_tracking_semaphore_t tracking_sem;
 
+    // Bit identifying the channel in the channel mask of trackers, see
+    // uvm_tracker_t. Derived from the index of the GPU and the index of the
+    // channel among all the channels of the GPU, so that different channels
+    // only share a bit once there are more channels than bits in the mask.
+    NvU32 tracker_bit;
+
     // RM channel information
     union
     {
@@ -208,6 +315,7 @@ struct uvm_channel_struct
         struct proc_dir_entry *dir;
         struct proc_dir_entry *info;
         struct proc_dir_entry *pushes;
+        struct proc_dir_entry *push_trace;
     } procfs;
 
     // Information managed by the tools event notification mechanism. Mainly
@@ -255,14 +363,39 @@ struct uvm_channel_manager_struct
         // If there is no optimal pool (the entry is NULL), use default pool
         // default_for_type[UVM_CHANNEL_GPU_TO_GPU] instead.
         uvm_channel_pool_t *gpu_to_gpu[UVM_ID_MAX_GPUS];
+
+        // Pools large transfers of each type are striped across, see
+        // uvm_channel_reserve_striped(). The pool in default_for_type[type] is
+        // always the first one.
+        uvm_channel_pool_t *stripe[UVM_CHANNEL_TYPE_COUNT][UVM_COPY_ENGINE_COUNT_MAX];
+        unsigned num_stripe[UVM_CHANNEL_TYPE_COUNT];
     } pool_to_use;
 
     struct
     {
         struct proc_dir_entry *channels_dir;
         struct proc_dir_entry *pending_pushes;
+        struct proc_dir_entry *wait_stats;
     } procfs;
 
+    // Statistics of the waits for GPU work done with uvm_channel_wait_t on
+    // the channels of this manager
+    struct
+    {
+        // Number of waits that did not complete immediately
+        atomic64_t waits;
+
+        // Number of waits that slept at least once
+        atomic64_t sleeping_waits;
+
+        // Total number of sleeps
+        atomic64_t sleeps;
+
+        // Time spent busy waiting and sleeping, respectively
+        atomic64_t spin_ns;
+        atomic64_t sleep_ns;
+    } wait_stats;
+
     struct
     {
         NvU32 num_gpfifo_entries;
@@ -280,6 +413,11 @@ static bool uvm_channel_is_proxy(uvm_channel_t *channel)
     return channel->pool->pool_type == UVM_CHANNEL_POOL_TYPE_CE_PROXY;
 }
 
+static bool uvm_channel_push_trace_enabled(uvm_channel_t *channel)
+{
+    return channel->push_trace.records != NULL;
+}
+
 // Proxy channels are used to push page tree related methods, so their channel
 // type is UVM_CHANNEL_TYPE_MEMOPS.
 static uvm_channel_type_t uvm_channel_proxy_channel_type(void)
@@ -348,6 +486,64 @@ bool uvm_channel_is_value_completed(uvm_channel_t *channel, NvU64 value);
 // Update and get the latest completed value by the channel
 NvU64 uvm_channel_update_completed_value(uvm_channel_t *channel);
 
+// Estimate how long it will take the GPU to complete the work currently
+// pending on the channel, based on the bytes to be processed by the CE and the
+// throughput measured on the channel's pool.
+NvU64 uvm_channel_estimate_pending_ns(uvm_channel_t *channel);
+
+// Same as uvm_channel_estimate_pending_ns(), but only for the work up to the
+// push completing the given tracking value.
+NvU64 uvm_channel_estimate_pending_ns_until(uvm_channel_t *channel, NvU64 value);
+
+// Adaptive wait for GPU work on a channel.
+//
+// Completion of GPU work is only observable by polling the channel's tracking
+// semaphore. Rather than busy waiting for the whole duration of the work, the
+// wait estimates when the pending work will be done, sleeps until shortly
+// before that and only spins for the remainder. If the work takes longer than
+// estimated, the wait keeps sleeping with an exponentially growing interval.
+// Waits in contexts that cannot sleep always spin.
+//
+// Usage:
+//     uvm_channel_wait_begin(&wait, channel, value, &spin);
+//     while (!done(...)) {
+//         if (uvm_channel_wait_iter(&wait) == NV_ERR_TIMEOUT_RETRY)
+//             ...print what is being waited on...
+//         ...check for errors...
+//     }
+//     uvm_channel_wait_end(&wait);
+typedef struct
+{
+    uvm_channel_t *channel;
+
+    // Spin loop state used to yield the CPU and report long waits, which may
+    // be shared by consecutive waits.
+    uvm_spin_loop_t *spin;
+
+    NvU64 start_time_ns;
+
+    // Estimated time at which the work waited on completes
+    NvU64 expected_end_ns;
+
+    // Next sleep interval used once the estimate has been exceeded
+    NvU64 backoff_ns;
+
+    NvU64 sleep_ns;
+    NvU32 sleeps;
+    NvU32 iterations;
+    bool may_sleep;
+} uvm_channel_wait_t;
+
+// Begin a wait for the channel's tracking semaphore to reach value
+void uvm_channel_wait_begin(uvm_channel_wait_t *wait, uvm_channel_t *channel, NvU64 value, uvm_spin_loop_t *spin);
+
+// Wait a bit, by either spinning or sleeping. Returns the value returned by
+// UVM_SPIN_LOOP().
+NV_STATUS uvm_channel_wait_iter(uvm_channel_wait_t *wait);
+
+// Record the statistics of the wait in the channel manager
+void uvm_channel_wait_end(uvm_channel_wait_t *wait);
+
 // Select and reserve a channel with the specified type for a push
 NV_STATUS uvm_channel_reserve_type(uvm_channel_manager_t *manager,
                                    uvm_channel_type_t type,
@@ -359,6 +555,23 @@ NV_STATUS uvm_channel_reserve_gpu_to_gpu(uvm_channel_manager_t *channel_manager,
                                          uvm_gpu_t *dst_gpu,
                                          uvm_channel_t **channel_out);
 
+// Select and reserve a channel for a transfer of size bytes of the specified
+// type. dst_gpu can be set to the destination of GPU_TO_GPU transfers, and
+// must be NULL for any other type.
+//
+// Transfers of at least uvm_channel_stripe_min_size bytes are spread across
+// all the CEs that are as capable for the type as the default one, picking the
+// CE with the least pending work as estimated from the CE bytes submitted to
+// it. Independent large transfers issued back to back, like the per VA block
+// copies of a large migration, thus proceed in parallel on different CEs.
+// Smaller transfers, and GPU_TO_GPU transfers of any size, use the same
+// channel as uvm_channel_reserve_type() or uvm_channel_reserve_gpu_to_gpu().
+NV_STATUS uvm_channel_reserve_striped(uvm_channel_manager_t *manager,
+                                      uvm_channel_type_t type,
+                                      uvm_gpu_t *dst_gpu,
+                                      NvU64 size,
+                                      uvm_channel_t **channel_out);
+
 // Reserve a specific channel for a push
 NV_STATUS uvm_channel_reserve(uvm_channel_t *channel);
 
@@ -369,6 +582,17 @@ void uvm_channel_manager_set_p2p_ce(uvm_channel_manager_t *manager, uvm_gpu_t *p
 // Should be used by uvm_push_*() only.
 NV_STATUS uvm_channel_begin_push(uvm_channel_t *channel, uvm_push_t *push);
 
+// Release the GPU timestamp at the beginning of a traced push, once all its
+// acquires have been pushed. No-op if the push is not traced.
+// Should be used by uvm_push_*() only.
+void uvm_channel_push_trace_begin(uvm_push_t *push);
+
+// Start keeping a push trace ring of num_records entries on the channel, if it
+// doesn't have one already. The ring is kept until the channel is destroyed.
+// Used at channel creation if uvm_channel_push_trace_entries is set, and by
+// tests.
+NV_STATUS uvm_channel_push_trace_enable(uvm_channel_t *channel, NvU32 num_records);
+
 // End a push
 // Should be used by uvm_push_end() only.
 void uvm_channel_end_push(uvm_push_t *push);
@@ -150,6 +150,96 @@ done:
     return status;
 }
 
+// Check the push trace record of the last push completed on the channel,
+// which is expected to be a memset of ce_bytes.
+static NV_STATUS test_push_trace_last_record(uvm_channel_t *channel, NvU64 ce_bytes)
+{
+    uvm_channel_push_trace_record_t record = {0};
+    NvU64 count;
+
+    uvm_channel_update_progress_all(channel);
+
+    uvm_spin_lock(&channel->pool->lock);
+    count = channel->push_trace.count;
+    if (count != 0)
+        record = channel->push_trace.records[(count - 1) % channel->push_trace.num_records];
+    uvm_spin_unlock(&channel->pool->lock);
+
+    TEST_CHECK_RET(count != 0);
+    TEST_CHECK_RET(record.ce_bytes == ce_bytes);
+    TEST_CHECK_RET(record.submit_time_ns >= record.begin_time_ns);
+    TEST_CHECK_RET(record.complete_time_ns >= record.submit_time_ns);
+    TEST_CHECK_RET(record.gpu_begin_time_ns != 0);
+    TEST_CHECK_RET(record.gpu_end_time_ns >= record.gpu_begin_time_ns);
+
+    return NV_OK;
+}
+
+// Push a memset large enough to take a while and be used as a CE throughput
+// sample, and check that waiting for it, which may sleep, only returns once
+// the memset is done. The push is traced, and its trace record checked.
+static NV_STATUS test_wait_for_gpu(uvm_gpu_t *gpu)
+{
+    NV_STATUS status;
+    uvm_rm_mem_t *mem = NULL;
+    uvm_channel_t *channel = gpu->channel_manager->pool_to_use.default_for_type[UVM_CHANNEL_TYPE_GPU_TO_CPU]->channels;
+    NvU32 *host_mem;
+    uvm_push_t push;
+    NvU64 gpu_va;
+    NvU32 i;
+    const NvU32 pattern = 0xcafe0001;
+    const size_t buffer_size = 4 * 1024 * 1024;
+
+    status = uvm_rm_mem_alloc_and_map_all(gpu, UVM_RM_MEM_TYPE_SYS, buffer_size, &mem);
+    TEST_CHECK_GOTO(status == NV_OK, done);
+
+    host_mem = (NvU32*)uvm_rm_mem_get_cpu_va(mem);
+    memset(host_mem, 0, buffer_size);
+
+    // Tracing is off by default, see uvm_channel_push_trace_entries
+    if (!uvm_channel_is_proxy(channel)) {
+        status = uvm_channel_push_trace_enable(channel, 16);
+        TEST_CHECK_GOTO(status == NV_OK, done);
+    }
+
+    status = uvm_push_begin_on_channel(channel, &push, "Wait test memset");
+    TEST_CHECK_GOTO(status == NV_OK, done);
+
+    gpu_va = uvm_rm_mem_get_gpu_va(mem, gpu, uvm_channel_is_proxy(push.channel));
+    gpu->parent->ce_hal->memset_v_4(&push, gpu_va, pattern, buffer_size);
+
+    TEST_CHECK_GOTO(push.ce_bytes == buffer_size, done);
+
+    status = uvm_push_end_and_wait(&push);
+    TEST_CHECK_GOTO(status == NV_OK, done);
+
+    for (i = 0; i < buffer_size / sizeof(*host_mem); ++i) {
+        if (host_mem[i] != pattern) {
+            UVM_TEST_PRINT("Bad value at host_mem[%u] = 0x%x instead of 0x%x\n", i, host_mem[i], pattern);
+            status = NV_ERR_INVALID_STATE;
+            goto done;
+        }
+    }
+
+    if (!uvm_channel_is_proxy(channel))
+        status = test_push_trace_last_record(channel, buffer_size);
+
+done:
+    uvm_rm_mem_free(mem);
+
+    return status;
+}
+
+static NV_STATUS test_wait(uvm_va_space_t *va_space)
+{
+    uvm_gpu_t *gpu;
+
+    for_each_va_space_gpu(gpu, va_space)
+        TEST_NV_CHECK_RET(test_wait_for_gpu(gpu));
+
+    return NV_OK;
+}
+
 static NV_STATUS uvm_test_rc_for_gpu(uvm_gpu_t *gpu)
 {
     uvm_push_t push;
@@ -650,6 +740,10 @@ NV_STATUS uvm_test_channel_sanity(UVM_TEST_CHANNEL_SANITY_PARAMS *params, struct
     if (status != NV_OK)
         goto done;
 
+    status = test_wait(va_space);
+    if (status != NV_OK)
+        goto done;
+
     if (g_uvm_global.num_simulated_devices == 0) {
         status = test_rc(va_space);
         if (status != NV_OK)
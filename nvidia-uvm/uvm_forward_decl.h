@@ -46,6 +46,7 @@ typedef struct uvm_channel_manager_struct uvm_channel_manager_t;
 typedef struct uvm_channel_struct uvm_channel_t;
 typedef struct uvm_user_channel_struct uvm_user_channel_t;
 typedef struct uvm_push_struct uvm_push_t;
+typedef struct uvm_push_coalesce_struct uvm_push_coalesce_t;
 typedef struct uvm_push_info_struct uvm_push_info_t;
 typedef struct uvm_push_acquire_info_struct uvm_push_acquire_info_t;
 typedef struct uvm_pushbuffer_struct uvm_pushbuffer_t;
@@ -79,6 +80,7 @@ typedef struct uvm_tlb_batch_struct uvm_tlb_batch_t;
 
 typedef struct uvm_fault_service_batch_context_struct uvm_fault_service_batch_context_t;
 typedef struct uvm_service_block_context_struct uvm_service_block_context_t;
+typedef struct uvm_va_block_context_arena_struct uvm_va_block_context_arena_t;
 
 typedef struct uvm_ats_fault_invalidate_struct uvm_ats_fault_invalidate_t;
 
@@ -140,6 +140,12 @@ NV_STATUS uvm_global_init(void)
         goto error;
     }
 
+    status = uvm_lock_stats_init();
+    if (status != NV_OK) {
+        UVM_ERR_PRINT("uvm_lock_stats_init() failed: %s\n", nvstatusToString(status));
+        goto error;
+    }
+
     status = uvm_rm_locked_call(nvUvmInterfaceSessionCreate(&g_uvm_global.rm_session_handle, &platform_info));
     if (status != NV_OK) {
         UVM_ERR_PRINT("nvUvmInterfaceSessionCreate() failed: %s\n", nvstatusToString(status));
@@ -249,12 +255,14 @@ void uvm_global_exit(void)
     uvm_range_group_exit();
     uvm_va_range_exit();
     uvm_mem_global_exit();
+    uvm_mmu_exit();
     uvm_pmm_sysmem_exit();
     uvm_gpu_exit();
 
     if (g_uvm_global.rm_session_handle != 0)
         uvm_rm_locked_call_void(nvUvmInterfaceSessionDestroy(g_uvm_global.rm_session_handle));
 
+    uvm_lock_stats_exit();
     uvm_procfs_exit();
 
     nv_kthread_q_stop(&g_uvm_global.deferred_release_q);
@@ -382,6 +382,14 @@ static void gpu_info_print_common(uvm_gpu_t *gpu, struct seq_file *s)
     NvU64 num_pages_in;
     NvU64 num_pages_out;
     NvU64 mapped_cpu_pages_size;
+    NvU64 pma_alloc_calls;
+    NvU64 pma_alloc_chunks;
+    NvU64 pma_free_calls;
+    NvU64 pma_free_chunks;
+    NvU64 dma_cache_hits;
+    NvU64 dma_cache_misses;
+    NvU64 dma_cache_unmap_batches;
+    NvU64 dma_cache_unmap_batch_mappings;
     NvU32 get, put;
     unsigned int cpu;
 
@@ -516,6 +524,44 @@ static void gpu_info_print_common(uvm_gpu_t *gpu, struct seq_file *s)
                          mapped_cpu_pages_size / PAGE_SIZE,
                          mapped_cpu_pages_size / (1024u * 1024u));
 
+    pma_alloc_calls = atomic64_read(&gpu->pmm.stats.num_pma_alloc_calls);
+    pma_alloc_chunks = atomic64_read(&gpu->pmm.stats.num_pma_alloc_chunks);
+    pma_free_calls = atomic64_read(&gpu->pmm.stats.num_pma_free_calls);
+    pma_free_chunks = atomic64_read(&gpu->pmm.stats.num_pma_free_chunks);
+
+    UVM_SEQ_OR_DBG_PRINT(s, "pma_alloc_calls                        %llu (%llu root chunks)\n",
+                         pma_alloc_calls,
+                         pma_alloc_chunks);
+    UVM_SEQ_OR_DBG_PRINT(s, "pma_free_calls                         %llu (%llu root chunks)\n",
+                         pma_free_calls,
+                         pma_free_chunks);
+    UVM_SEQ_OR_DBG_PRINT(s, "pma_calls_saved                        %llu\n",
+                         (pma_alloc_chunks - pma_alloc_calls) + (pma_free_chunks - pma_free_calls));
+
+    dma_cache_hits = atomic64_read(&gpu->pmm_sysmem_dma_cache.stats.hits);
+    dma_cache_misses = atomic64_read(&gpu->pmm_sysmem_dma_cache.stats.misses);
+    dma_cache_unmap_batches = atomic64_read(&gpu->pmm_sysmem_dma_cache.stats.unmap_batches);
+    dma_cache_unmap_batch_mappings = atomic64_read(&gpu->pmm_sysmem_dma_cache.stats.unmap_batch_mappings);
+
+    UVM_SEQ_OR_DBG_PRINT(s, "dma_cache_hits                         %llu\n", dma_cache_hits);
+    UVM_SEQ_OR_DBG_PRINT(s, "dma_cache_misses                       %llu\n", dma_cache_misses);
+    UVM_SEQ_OR_DBG_PRINT(s, "dma_cache_hit_rate                     %llu%%\n",
+                         (dma_cache_hits + dma_cache_misses) ?
+                             (dma_cache_hits * 100) / (dma_cache_hits + dma_cache_misses) : 0);
+    UVM_SEQ_OR_DBG_PRINT(s, "dma_cache_unmap_batches                %llu (%llu mappings)\n",
+                         dma_cache_unmap_batches,
+                         dma_cache_unmap_batch_mappings);
+    UVM_SEQ_OR_DBG_PRINT(s, "dma_cache_page_release_unmaps          %llu\n",
+                         (NvU64)atomic64_read(&gpu->pmm_sysmem_dma_cache.stats.page_release_unmaps));
+
+    if (gpu->parent->access_counters_supported) {
+        UVM_SEQ_OR_DBG_PRINT(s, "sysmem_reverse_map_extents             %zu (%llu pages)\n",
+                             gpu->pmm_sysmem_mappings.num_extents,
+                             gpu->pmm_sysmem_mappings.num_mapped_pages);
+        UVM_SEQ_OR_DBG_PRINT(s, "sysmem_reverse_map_size                %llu bytes\n",
+                             uvm_pmm_sysmem_mappings_memory_usage(&gpu->pmm_sysmem_mappings));
+    }
+
     gpu_info_print_ce_caps(gpu, s);
 }
 
@@ -1185,6 +1231,8 @@ static NV_STATUS init_gpu(uvm_gpu_t *gpu, const UvmGpuInfo *gpu_info)
         return status;
     }
 
+    uvm_pmm_sysmem_dma_cache_init(gpu, &gpu->pmm_sysmem_dma_cache);
+
     status = init_semaphore_pool(gpu);
     if (status != NV_OK) {
         UVM_ERR_PRINT("Failed to initialize the semaphore pool: %s, GPU %s\n",
@@ -1455,6 +1503,8 @@ static void deinit_gpu(uvm_gpu_t *gpu)
 
     deinit_semaphore_pool(gpu);
 
+    uvm_pmm_sysmem_dma_cache_deinit(&gpu->pmm_sysmem_dma_cache);
+
     uvm_pmm_sysmem_mappings_deinit(&gpu->pmm_sysmem_mappings);
 
     uvm_pmm_gpu_deinit(&gpu->pmm);
@@ -3167,6 +3217,14 @@ void uvm_gpu_unmap_cpu_pages(uvm_gpu_t *gpu, NvU64 dma_address, size_t size)
     atomic64_sub(size, &gpu->parent->mapped_cpu_pages_size);
 }
 
+void uvm_gpu_sync_cpu_pages_for_device(uvm_gpu_t *gpu, NvU64 dma_address, size_t size)
+{
+    UVM_ASSERT(PAGE_ALIGNED(size));
+
+    dma_address = gpu_addr_to_dma_addr(gpu->parent, dma_address);
+    dma_sync_single_for_device(&gpu->parent->pci_dev->dev, dma_address, size, DMA_BIDIRECTIONAL);
+}
+
 // This function implements the UvmRegisterGpu API call, as described in uvm.h.
 // Notes:
 //
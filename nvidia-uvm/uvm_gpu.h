@@ -45,6 +45,7 @@
 #include "uvm_perf_module.h"
 #include "uvm_ats_ibm.h"
 #include "uvm_rb_tree.h"
+#include "uvm_range_tree.h"
 #include "nv-kthread-q.h"
 
 
@@ -176,6 +177,13 @@ struct uvm_fault_service_batch_context_struct
     // max_batch_size
     uvm_fault_buffer_entry_t **ordered_fault_cache;
 
+    // Fault addresses of the ordered fault cache and the range tree nodes of
+    // the VA ranges containing them, looked up with uvm_va_range_find_batch()
+    // for all the faults of a VA space at once. The number of elements in
+    // these arrays is exactly max_batch_size
+    NvU64 *fault_addresses;
+    uvm_range_tree_node_t **fault_va_range_nodes;
+
     // Per uTLB fault information. Used for replay policies and fault
     // cancellation on Pascal
     uvm_fault_utlb_info_t *utlbs;
@@ -620,6 +628,8 @@ struct uvm_gpu_struct
 
     uvm_pmm_sysmem_mappings_t pmm_sysmem_mappings;
 
+    uvm_pmm_sysmem_dma_cache_t pmm_sysmem_dma_cache;
+
     // ECC handling
     // In order to trap ECC errors as soon as possible the driver has the hw
     // interrupt register mapped directly. If an ECC interrupt is ever noticed
@@ -1222,6 +1232,11 @@ NV_STATUS uvm_gpu_map_cpu_pages(uvm_gpu_t *gpu, struct page *page, size_t size,
 // Unmap num_pages pages previously mapped with uvm_gpu_map_cpu_pages().
 void uvm_gpu_unmap_cpu_pages(uvm_gpu_t *gpu, NvU64 dma_address, size_t size);
 
+// Make CPU writes to size bytes of sysmem mapped with uvm_gpu_map_cpu_pages()
+// at dma_address visible to the GPU. This is only needed when the mapping
+// outlives the CPU writes, since creating the mapping already does it.
+void uvm_gpu_sync_cpu_pages_for_device(uvm_gpu_t *gpu, NvU64 dma_address, size_t size);
+
 static NV_STATUS uvm_gpu_map_cpu_page(uvm_gpu_t *gpu, struct page *page, NvU64 *dma_address_out)
 {
     return uvm_gpu_map_cpu_pages(gpu, page, PAGE_SIZE, dma_address_out);
@@ -221,44 +221,45 @@ static NV_STATUS config_granularity_to_bytes(UVM_ACCESS_COUNTER_GRANULARITY gran
     return NV_OK;
 }
 
-// Clear the given access counter and add it to the per-GPU clear tracker
+// Clear the given access counters and add the operations to the per-GPU clear
+// tracker. Each clear is a single method, so the clears are coalesced into as
+// few pushes as possible instead of using a push each.
 static NV_STATUS access_counter_clear_targeted(uvm_gpu_t *gpu,
-                                               const uvm_access_counter_buffer_entry_t *entry)
+                                               uvm_access_counter_buffer_entry_t **entries,
+                                               NvU32 num_entries)
 {
-    NV_STATUS status;
+    NV_STATUS status = NV_OK;
+    NV_STATUS flush_status;
+    NvU32 i;
     uvm_push_t push;
+    uvm_push_coalesce_t coalesce;
     uvm_access_counter_buffer_info_t *access_counters = &gpu->parent->access_counter_buffer_info;
 
-    if (entry->address.is_virtual) {
-        status = uvm_push_begin(gpu->channel_manager,
-                                UVM_CHANNEL_TYPE_MEMOPS,
-                                &push,
-                                "Clear access counter with virtual address: 0x%llx",
-                                entry->address.address);
-    }
-    else {
-        status = uvm_push_begin(gpu->channel_manager,
-                                UVM_CHANNEL_TYPE_MEMOPS,
-                                &push,
-                                "Clear access counter with physical address: 0x%llx:%s",
-                                entry->address.address,
-                                uvm_aperture_string(entry->address.aperture));
-    }
+    uvm_tracker_remove_completed(&access_counters->clear_tracker);
 
-    if (status != NV_OK) {
-        UVM_ERR_PRINT("Error creating push to clear access counters: %s, GPU %s\n",
-                      nvstatusToString(status),
-                      uvm_gpu_name(gpu));
-        return status;
-    }
+    uvm_push_coalesce_init(&coalesce, &access_counters->clear_tracker);
+
+    for (i = 0; i < num_entries; ++i) {
+        status = uvm_push_begin_coalesced(&coalesce,
+                                          gpu->channel_manager,
+                                          UVM_CHANNEL_TYPE_MEMOPS,
+                                          &push,
+                                          "Clear access counters");
+        if (status != NV_OK) {
+            UVM_ERR_PRINT("Error creating push to clear access counters: %s, GPU %s\n",
+                          nvstatusToString(status),
+                          uvm_gpu_name(gpu));
+            break;
+        }
 
-    gpu->parent->host_hal->access_counter_clear_targeted(&push, entry);
+        gpu->parent->host_hal->access_counter_clear_targeted(&push, entries[i]);
 
-    uvm_push_end(&push);
+        uvm_push_end_coalesced(&coalesce, &push);
+    }
 
-    uvm_tracker_remove_completed(&access_counters->clear_tracker);
+    flush_status = uvm_push_coalesce_flush(&coalesce);
 
-    return uvm_tracker_add_push_safe(&access_counters->clear_tracker, &push);
+    return status == NV_OK ? flush_status : status;
 }
 
 // Clear all access counters and add the operation to the per-GPU clear tracker
@@ -1152,9 +1153,9 @@ static NV_STATUS service_phys_single_va_block(uvm_gpu_t *gpu,
 
     UVM_ASSERT(num_reverse_mappings > 0);
 
-    uvm_mutex_lock(&va_block->lock);
+    uvm_va_block_lock(va_block);
     va_space = uvm_va_block_get_va_space_maybe_dead(va_block);
-    uvm_mutex_unlock(&va_block->lock);
+    uvm_va_block_unlock(va_block);
 
     if (va_space) {
         uvm_va_block_retry_t va_block_retry;
@@ -1183,7 +1184,7 @@ static NV_STATUS service_phys_single_va_block(uvm_gpu_t *gpu,
         service_context->num_retries = 0;
         service_context->block_context.mm = mm;
 
-        uvm_mutex_lock(&va_block->lock);
+        uvm_va_block_lock(va_block);
 
         reverse_mappings_to_va_block_page_mask(va_block, reverse_mappings, num_reverse_mappings, accessed_pages);
 
@@ -1194,7 +1195,7 @@ static NV_STATUS service_phys_single_va_block(uvm_gpu_t *gpu,
                                                                    service_context,
                                                                    accessed_pages));
 
-        uvm_mutex_unlock(&va_block->lock);
+        uvm_va_block_unlock(va_block);
 
         if (status == NV_OK)
             *clear_counter = true;
@@ -1344,9 +1345,12 @@ static NV_STATUS service_phys_notification_translation(uvm_gpu_t *gpu,
     return status;
 }
 
+// clear_counter_out is set to true if the counter of the notification needs to
+// be cleared.
 static NV_STATUS service_phys_notification(uvm_gpu_t *gpu,
                                            uvm_access_counter_service_batch_context_t *batch_context,
-                                           const uvm_access_counter_buffer_entry_t *current_entry)
+                                           const uvm_access_counter_buffer_entry_t *current_entry,
+                                           bool *clear_counter_out)
 {
     NvU64 address;
     NvU64 translation_index;
@@ -1359,6 +1363,8 @@ static NV_STATUS service_phys_notification(uvm_gpu_t *gpu,
     NV_STATUS status = NV_OK;
     bool clear_counter = false;
 
+    *clear_counter_out = false;
+
     address = current_entry->address.address;
     UVM_ASSERT(address % config->translation_size == 0);
     sub_granularity = current_entry->sub_granularity;
@@ -1414,8 +1420,7 @@ static NV_STATUS service_phys_notification(uvm_gpu_t *gpu,
         uvm_tools_broadcast_access_counter(gpu, current_entry, on_managed);
     }
 
-    if (status == NV_OK && clear_counter)
-        status = access_counter_clear_targeted(gpu, current_entry);
+    *clear_counter_out = status == NV_OK && clear_counter;
 
     return status;
 }
@@ -1425,21 +1430,38 @@ static NV_STATUS service_phys_notifications(uvm_gpu_t *gpu,
                                             uvm_access_counter_service_batch_context_t *batch_context)
 {
     NvU32 i;
+    NvU32 num_clears = 0;
+    NV_STATUS status = NV_OK;
     preprocess_phys_notifications(batch_context);
 
     for (i = 0; i < batch_context->phys.num_notifications; ++i) {
-        NV_STATUS status;
         uvm_access_counter_buffer_entry_t *current_entry = batch_context->phys.notifications[i];
+        bool clear_counter;
 
         if (!UVM_ID_IS_VALID(current_entry->physical_info.resident_id))
             continue;
 
-        status = service_phys_notification(gpu, batch_context, current_entry);
+        status = service_phys_notification(gpu, batch_context, current_entry, &clear_counter);
         if (status != NV_OK)
-            return status;
+            break;
+
+        // Servicing takes locks that cannot be held while a push is on-going,
+        // so the counters are cleared after all the notifications are
+        // serviced. The notifications to clear are gathered at the front of
+        // the array, in slots that have already been visited.
+        if (clear_counter)
+            batch_context->phys.notifications[num_clears++] = current_entry;
     }
 
-    return NV_OK;
+    if (num_clears > 0) {
+        NV_STATUS clear_status;
+
+        clear_status = access_counter_clear_targeted(gpu, batch_context->phys.notifications, num_clears);
+        if (status == NV_OK)
+            status = clear_status;
+    }
+
+    return status;
 }
 
 void uvm_gpu_service_access_counters(uvm_gpu_t *gpu)
@@ -1720,6 +1742,7 @@ NV_STATUS uvm_test_reset_access_counters(UVM_TEST_RESET_ACCESS_COUNTERS_PARAMS *
     }
     else {
         uvm_access_counter_buffer_entry_t entry = { 0 };
+        uvm_access_counter_buffer_entry_t *entries[] = { &entry };
 
         if (params->counter_type == UVM_TEST_ACCESS_COUNTER_TYPE_MIMC)
             entry.counter_type = UVM_ACCESS_COUNTER_TYPE_MIMC;
@@ -1729,7 +1752,7 @@ NV_STATUS uvm_test_reset_access_counters(UVM_TEST_RESET_ACCESS_COUNTERS_PARAMS *
         entry.bank = params->bank;
         entry.tag = params->tag;
 
-        status = access_counter_clear_targeted(gpu, &entry);
+        status = access_counter_clear_targeted(gpu, entries, ARRAY_SIZE(entries));
     }
 
     if (status == NV_OK)
@@ -431,7 +431,7 @@ static NV_STATUS service_managed_fault_in_block(uvm_gpu_t *gpu,
     service_context->num_retries = 0;
     service_context->block_context.mm = mm;
 
-    uvm_mutex_lock(&va_block->lock);
+    uvm_va_block_lock(va_block);
 
     status = UVM_VA_BLOCK_RETRY_LOCKED(va_block, &va_block_retry,
                                        service_managed_fault_in_block_locked(gpu,
@@ -443,7 +443,7 @@ static NV_STATUS service_managed_fault_in_block(uvm_gpu_t *gpu,
     tracker_status = uvm_tracker_add_tracker_safe(&gpu->parent->fault_buffer_info.non_replayable.fault_service_tracker,
                                                   &va_block->tracker);
 
-    uvm_mutex_unlock(&va_block->lock);
+    uvm_va_block_unlock(va_block);
 
     return status == NV_OK? tracker_status: status;
 }
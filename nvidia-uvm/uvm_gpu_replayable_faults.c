@@ -158,6 +158,16 @@ static NV_STATUS fault_buffer_init_replayable_faults(uvm_parent_gpu_t *parent_gp
     if (!batch_context->ordered_fault_cache)
         return NV_ERR_NO_MEMORY;
 
+    batch_context->fault_addresses = uvm_kvmalloc_zero(replayable_faults->max_faults *
+                                                       sizeof(*batch_context->fault_addresses));
+    if (!batch_context->fault_addresses)
+        return NV_ERR_NO_MEMORY;
+
+    batch_context->fault_va_range_nodes = uvm_kvmalloc_zero(replayable_faults->max_faults *
+                                                            sizeof(*batch_context->fault_va_range_nodes));
+    if (!batch_context->fault_va_range_nodes)
+        return NV_ERR_NO_MEMORY;
+
     // This value must be initialized by HAL
     UVM_ASSERT(replayable_faults->utlb_count > 0);
 
@@ -220,10 +230,14 @@ static void fault_buffer_deinit_replayable_faults(uvm_parent_gpu_t *parent_gpu)
 
     uvm_kvfree(batch_context->fault_cache);
     uvm_kvfree(batch_context->ordered_fault_cache);
+    uvm_kvfree(batch_context->fault_addresses);
+    uvm_kvfree(batch_context->fault_va_range_nodes);
     uvm_kvfree(batch_context->utlbs);
-    batch_context->fault_cache         = NULL;
-    batch_context->ordered_fault_cache = NULL;
-    batch_context->utlbs               = NULL;
+    batch_context->fault_cache          = NULL;
+    batch_context->ordered_fault_cache  = NULL;
+    batch_context->fault_addresses      = NULL;
+    batch_context->fault_va_range_nodes = NULL;
+    batch_context->utlbs                = NULL;
 }
 
 NV_STATUS uvm_gpu_fault_buffer_init(uvm_parent_gpu_t *parent_gpu)
@@ -1329,6 +1343,120 @@ static NV_STATUS service_batch_managed_faults_in_block_locked(uvm_gpu_t *gpu,
     return status;
 }
 
+// Faults on pages which the GPU can already access are common when faults on
+// the same pages are serviced in a previous batch or by another GPU before the
+// replay. Servicing them does not change the block, so when VA block region
+// locking is enabled they are checked holding only the region of the block
+// spanned by the faults. Faults on disjoint regions of the same block, for
+// example from different GPUs, can then be handled concurrently.
+//
+// Returns true if all the faults in the block were already serviced, in which
+// case the fault events are notified and *block_faults is set. Otherwise, the
+// faults need to be serviced with the block lock held.
+static bool service_batch_managed_faults_in_block_region(uvm_gpu_t *gpu,
+                                                         uvm_va_block_t *va_block,
+                                                         NvU32 first_fault_index,
+                                                         uvm_fault_service_batch_context_t *batch_context,
+                                                         NvU32 *block_faults)
+{
+    uvm_fault_buffer_entry_t **ordered_fault_cache = batch_context->ordered_fault_cache;
+    uvm_va_space_t *va_space = uvm_va_block_get_va_space(va_block);
+    uvm_range_group_range_iter_t iter;
+    uvm_va_block_region_t region;
+    bool serviced = true;
+    NvU32 end;
+    NvU32 i;
+
+    if (!uvm_va_block_region_locking_enabled())
+        return false;
+
+    // HMM blocks are always serviced with the block lock held
+    if (!va_block->va_range)
+        return false;
+
+    for (end = first_fault_index;
+         end < batch_context->num_coalesced_faults &&
+         ordered_fault_cache[end]->va_space == va_space &&
+         ordered_fault_cache[end]->fault_address <= va_block->end;
+         ++end)
+        ;
+
+    // The faults are sorted by address
+    region = uvm_va_block_region(uvm_va_block_cpu_page_index(va_block, ordered_fault_cache[first_fault_index]->fault_address),
+                                 uvm_va_block_cpu_page_index(va_block, ordered_fault_cache[end - 1]->fault_address) + 1);
+
+    uvm_va_block_lock_region(va_block, region);
+
+    uvm_range_group_range_migratability_iter_first(va_space, va_block->start, va_block->end, &iter);
+
+    for (i = first_fault_index; i < end; ++i) {
+        uvm_fault_buffer_entry_t *current_entry = ordered_fault_cache[i];
+        uvm_page_index_t page_index = uvm_va_block_cpu_page_index(va_block, current_entry->fault_address);
+        NV_STATUS perm_status;
+
+        while (iter.end < current_entry->fault_address)
+            uvm_range_group_range_migratability_iter_next(va_space, &iter, va_block->end);
+
+        // Faults that are fatal or only partially serviceable are handled by
+        // the regular path
+        perm_status = uvm_va_range_check_logical_permissions(va_block->va_range,
+                                                             gpu->id,
+                                                             current_entry->fault_access_type,
+                                                             iter.migratable);
+        if (perm_status != NV_OK ||
+            !uvm_va_block_page_is_gpu_authorized(va_block,
+                                                 page_index,
+                                                 gpu->id,
+                                                 uvm_fault_access_type_to_prot(current_entry->fault_access_type))) {
+            serviced = false;
+            break;
+        }
+    }
+
+    // The replay must wait for any pending mapping work on the block, as in
+    // the regular path. Other region lock holders may read the block tracker
+    // concurrently, so it's only copied if that doesn't require removing
+    // completed entries from it to make room.
+    if (serviced) {
+        NV_STATUS status = uvm_tracker_reserve(&batch_context->tracker, va_block->tracker.size);
+
+        if (status == NV_OK)
+            status = uvm_tracker_add_tracker(&batch_context->tracker, &va_block->tracker);
+
+        serviced = status == NV_OK;
+    }
+
+    if (serviced) {
+        for (i = first_fault_index; i < end; ++i) {
+            uvm_fault_buffer_entry_t *current_entry = ordered_fault_cache[i];
+            bool is_duplicate = i > first_fault_index &&
+                                current_entry->fault_address == ordered_fault_cache[i - 1]->fault_address;
+
+            current_entry->is_fatal            = false;
+            current_entry->is_throttled        = false;
+            current_entry->is_invalid_prefetch = false;
+
+            uvm_perf_event_notify_gpu_fault(&va_space->perf_events,
+                                            va_block,
+                                            gpu->id,
+                                            current_entry,
+                                            batch_context->batch_id,
+                                            is_duplicate);
+
+            if (is_duplicate)
+                batch_context->num_duplicate_faults += current_entry->num_instances;
+            else
+                batch_context->num_duplicate_faults += current_entry->num_instances - 1;
+        }
+
+        *block_faults = end - first_fault_index;
+    }
+
+    uvm_va_block_unlock_region(va_block, region);
+
+    return serviced;
+}
+
 // We notify the fault event for all faults within the block so that the
 // performance heuristics are updated. The VA block lock is taken for the whole
 // fault servicing although it might be temporarily dropped and re-taken if
@@ -1352,7 +1480,10 @@ static NV_STATUS service_batch_managed_faults_in_block(uvm_gpu_t *gpu,
     fault_block_context->num_retries = 0;
     fault_block_context->block_context.mm = mm;
 
-    uvm_mutex_lock(&va_block->lock);
+    if (service_batch_managed_faults_in_block_region(gpu, va_block, first_fault_index, batch_context, block_faults))
+        return NV_OK;
+
+    uvm_va_block_lock(va_block);
 
     status = UVM_VA_BLOCK_RETRY_LOCKED(va_block, &va_block_retry,
                                        service_batch_managed_faults_in_block_locked(gpu,
@@ -1364,7 +1495,7 @@ static NV_STATUS service_batch_managed_faults_in_block(uvm_gpu_t *gpu,
 
     tracker_status = uvm_tracker_add_tracker_safe(&batch_context->tracker, &va_block->tracker);
 
-    uvm_mutex_unlock(&va_block->lock);
+    uvm_va_block_unlock(va_block);
 
     return status == NV_OK? tracker_status: status;
 }
@@ -1464,6 +1595,30 @@ static NV_STATUS service_non_managed_fault(uvm_fault_buffer_entry_t *current_ent
     return status;
 }
 
+// Look up the VA ranges of all the faults of va_space starting at first_index
+// at once. The ordered fault cache is sorted by VA space and fault address, so
+// consecutive faults mostly fall in the same or neighboring VA ranges.
+static void find_fault_va_ranges(uvm_fault_service_batch_context_t *batch_context,
+                                 uvm_va_space_t *va_space,
+                                 NvU32 first_index)
+{
+    NvU32 i;
+
+    for (i = first_index; i < batch_context->num_coalesced_faults; ++i) {
+        uvm_fault_buffer_entry_t *entry = batch_context->ordered_fault_cache[i];
+
+        if (entry->va_space != va_space)
+            break;
+
+        batch_context->fault_addresses[i] = entry->fault_address;
+    }
+
+    uvm_va_range_find_batch(va_space,
+                            batch_context->fault_addresses + first_index,
+                            i - first_index,
+                            batch_context->fault_va_range_nodes + first_index);
+}
+
 // Scan the ordered view of faults and group them by different va_blocks.
 // Service faults for each va_block, in batch.
 //
@@ -1537,6 +1692,8 @@ static NV_STATUS service_fault_batch(uvm_gpu_t *gpu,
 
             // The case where there is no valid GPU VA space for the GPU in this
             // VA space is handled next
+
+            find_fault_va_ranges(batch_context, va_space, i);
         }
 
         // Some faults could be already fatal if they cannot be handled by
@@ -1561,7 +1718,11 @@ static NV_STATUS service_fault_batch(uvm_gpu_t *gpu,
 
         // TODO: Bug 2103669: Service more than one ATS fault at a time so we
         //       don't do an unconditional VA range lookup for every ATS fault.
-        status = uvm_va_block_find_create(va_space, mm, current_entry->fault_address, &va_block);
+        status = uvm_va_block_find_create_in_range(va_space,
+                                                   uvm_va_range_container(batch_context->fault_va_range_nodes[i]),
+                                                   mm,
+                                                   current_entry->fault_address,
+                                                   &va_block);
         if (status == NV_OK) {
             status = service_batch_managed_faults_in_block(gpu_va_space->gpu,
                                                            mm,
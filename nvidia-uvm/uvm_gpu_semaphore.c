@@ -35,6 +35,21 @@
 #define UVM_SEMAPHORE_CANARY_BASE     0x0badc0de
 #define UVM_SEMAPHORE_CANARY_MASK     0xf0000000
 
+// Number of free semaphores moved at once between the cache of a CPU and the
+// page bitmaps when the cache runs empty or full.
+#define UVM_SEMAPHORE_CPU_CACHE_BATCH (UVM_GPU_SEMAPHORE_CPU_CACHE_SIZE / 2)
+
+// Per-CPU cache of free semaphores. The semaphores in a cache are marked as
+// allocated in their page bitmaps. A cache is only accessed by the owning CPU
+// with preemption disabled, or with the pool mutex held once the pool is being
+// destroyed.
+typedef struct
+{
+    NvU32 count;
+
+    uvm_gpu_semaphore_t semaphores[UVM_GPU_SEMAPHORE_CPU_CACHE_SIZE];
+} uvm_gpu_semaphore_cpu_cache_t;
+
 struct uvm_gpu_semaphore_pool_struct
 {
     // The GPU owning the pool
@@ -43,9 +58,14 @@ struct uvm_gpu_semaphore_pool_struct
     // List of all the semaphore pages belonging to the pool
     struct list_head pages;
 
-    // Count of free semaphores among all the pages
+    // Count of free semaphores among all the pages. Doesn't include the
+    // semaphores in the per-CPU caches.
     NvU32 free_semaphores_count;
 
+    // Per-CPU caches of free semaphores, which let uvm_gpu_semaphore_alloc()
+    // and uvm_gpu_semaphore_free() avoid taking the mutex in the common case
+    uvm_gpu_semaphore_cpu_cache_t __percpu *cpu_caches;
+
     // Lock protecting the state of the pool
     uvm_mutex_t mutex;
 };
@@ -184,12 +204,62 @@ static void pool_free_page(uvm_gpu_semaphore_pool_page_t *page)
     uvm_kvfree(page);
 }
 
-NV_STATUS uvm_gpu_semaphore_alloc(uvm_gpu_semaphore_pool_t *pool, uvm_gpu_semaphore_t *semaphore)
+// Take up to count free semaphores out of the page bitmaps and return the
+// number taken
+static NvU32 pool_take_free_locked(uvm_gpu_semaphore_pool_t *pool, uvm_gpu_semaphore_t *semaphores, NvU32 count)
 {
-    NV_STATUS status = NV_OK;
     uvm_gpu_semaphore_pool_page_t *page;
+    NvU32 taken = 0;
 
-    memset(semaphore, 0, sizeof(*semaphore));
+    uvm_assert_mutex_locked(&pool->mutex);
+
+    list_for_each_entry(page, &pool->pages, all_pages_node) {
+        char *base = uvm_rm_mem_get_cpu_va(page->memory);
+        NvU32 semaphore_index;
+
+        if (taken == count)
+            break;
+
+        for_each_set_bit(semaphore_index, page->free_semaphores, UVM_SEMAPHORE_COUNT_PER_PAGE) {
+            semaphores[taken].payload = (NvU32*)(base + semaphore_index * UVM_SEMAPHORE_SIZE);
+            semaphores[taken].page = page;
+
+            __clear_bit(semaphore_index, page->free_semaphores);
+
+            if (++taken == count)
+                break;
+        }
+    }
+
+    UVM_ASSERT(pool->free_semaphores_count >= taken);
+    pool->free_semaphores_count -= taken;
+
+    return taken;
+}
+
+// Return free semaphores to the page bitmaps
+static void pool_return_free_locked(uvm_gpu_semaphore_pool_t *pool, uvm_gpu_semaphore_t *semaphores, NvU32 count)
+{
+    NvU32 i;
+
+    uvm_assert_mutex_locked(&pool->mutex);
+
+    for (i = 0; i < count; i++) {
+        UVM_ASSERT(semaphores[i].page->pool == pool);
+        __set_bit(get_index(&semaphores[i]), semaphores[i].page->free_semaphores);
+    }
+
+    pool->free_semaphores_count += count;
+}
+
+// Slow path of uvm_gpu_semaphore_alloc() taken when the cache of the current
+// CPU is empty. Take a semaphore from the page bitmaps, allocating a new page if
+// none is free, and refill the cache with a batch of the remaining free
+// semaphores.
+static NV_STATUS pool_alloc_slow(uvm_gpu_semaphore_pool_t *pool, uvm_gpu_semaphore_t *semaphore)
+{
+    NV_STATUS status = NV_OK;
+    uvm_gpu_semaphore_cpu_cache_t *cache;
 
     uvm_mutex_lock(&pool->mutex);
 
@@ -199,39 +269,85 @@ NV_STATUS uvm_gpu_semaphore_alloc(uvm_gpu_semaphore_pool_t *pool, uvm_gpu_semaph
     if (status != NV_OK)
         goto done;
 
-    list_for_each_entry(page, &pool->pages, all_pages_node) {
-        NvU32 semaphore_index = find_first_bit(page->free_semaphores, UVM_SEMAPHORE_COUNT_PER_PAGE);
-        if (semaphore_index == UVM_SEMAPHORE_COUNT_PER_PAGE)
-            continue;
+    if (pool_take_free_locked(pool, semaphore, 1) != 1) {
+        UVM_ASSERT_MSG(0, "Failed to find a semaphore after allocating a new page\n");
+        status = NV_ERR_GENERIC;
+        goto done;
+    }
 
-        semaphore->payload = (NvU32*)((char*)uvm_rm_mem_get_cpu_va(page->memory) + semaphore_index * UVM_SEMAPHORE_SIZE);
-        semaphore->page = page;
+    // The thread may have moved to another CPU since it found the cache empty,
+    // so refill whichever cache the current CPU has up to the batch size.
+    cache = get_cpu_ptr(pool->cpu_caches);
+    if (cache->count < UVM_SEMAPHORE_CPU_CACHE_BATCH) {
+        cache->count += pool_take_free_locked(pool,
+                                              cache->semaphores + cache->count,
+                                              UVM_SEMAPHORE_CPU_CACHE_BATCH - cache->count);
+    }
+    put_cpu_ptr(pool->cpu_caches);
 
-        // Check for semaphore release-after-free
-        UVM_ASSERT(is_canary(uvm_gpu_semaphore_get_payload(semaphore)));
+done:
+    uvm_mutex_unlock(&pool->mutex);
 
-        uvm_gpu_semaphore_set_payload(semaphore, 0);
+    return status;
+}
 
-        __clear_bit(semaphore_index, page->free_semaphores);
-        --pool->free_semaphores_count;
+NV_STATUS uvm_gpu_semaphore_alloc(uvm_gpu_semaphore_pool_t *pool, uvm_gpu_semaphore_t *semaphore)
+{
+    uvm_gpu_semaphore_cpu_cache_t *cache;
 
-        goto done;
+    memset(semaphore, 0, sizeof(*semaphore));
+
+    // Semaphores are never allocated nor freed from interrupt context, so
+    // disabling preemption is enough for exclusive access to the cache of the
+    // current CPU.
+    cache = get_cpu_ptr(pool->cpu_caches);
+    if (cache->count > 0)
+        *semaphore = cache->semaphores[--cache->count];
+    put_cpu_ptr(pool->cpu_caches);
+
+    if (semaphore->page == NULL) {
+        NV_STATUS status = pool_alloc_slow(pool, semaphore);
+        if (status != NV_OK)
+            return status;
     }
 
-    UVM_ASSERT_MSG(0, "Failed to find a semaphore after allocating a new page\n");
-    status = NV_ERR_GENERIC;
+    // Check for semaphore release-after-free
+    UVM_ASSERT(is_canary(uvm_gpu_semaphore_get_payload(semaphore)));
 
-done:
-    uvm_mutex_unlock(&pool->mutex);
+    uvm_gpu_semaphore_set_payload(semaphore, 0);
 
-    return status;
+    return NV_OK;
+}
+
+// Slow path of uvm_gpu_semaphore_free() taken when the cache of the current
+// CPU is full. Return the semaphore to its page bitmap and drain a batch from
+// the cache so that the next frees on this CPU take the fast path again.
+static void pool_free_slow(uvm_gpu_semaphore_pool_t *pool, uvm_gpu_semaphore_t *semaphore)
+{
+    uvm_gpu_semaphore_cpu_cache_t *cache;
+
+    uvm_mutex_lock(&pool->mutex);
+
+    pool_return_free_locked(pool, semaphore, 1);
+
+    cache = get_cpu_ptr(pool->cpu_caches);
+    if (cache->count > UVM_GPU_SEMAPHORE_CPU_CACHE_SIZE - UVM_SEMAPHORE_CPU_CACHE_BATCH) {
+        NvU32 count = cache->count - (UVM_GPU_SEMAPHORE_CPU_CACHE_SIZE - UVM_SEMAPHORE_CPU_CACHE_BATCH);
+
+        cache->count -= count;
+        pool_return_free_locked(pool, cache->semaphores + cache->count, count);
+    }
+    put_cpu_ptr(pool->cpu_caches);
+
+    uvm_mutex_unlock(&pool->mutex);
 }
 
 void uvm_gpu_semaphore_free(uvm_gpu_semaphore_t *semaphore)
 {
     uvm_gpu_semaphore_pool_page_t *page;
     uvm_gpu_semaphore_pool_t *pool;
-    NvU32 index;
+    uvm_gpu_semaphore_cpu_cache_t *cache;
+    bool cached = false;
 
     UVM_ASSERT(semaphore);
 
@@ -243,22 +359,24 @@ void uvm_gpu_semaphore_free(uvm_gpu_semaphore_t *semaphore)
         return;
 
     pool = page->pool;
-    index = get_index(semaphore);
 
     // Write a known value lower than the current payload in an attempt to catch
     // release-after-free and acquire-after-free.
     if (UVM_IS_DEBUG())
         uvm_gpu_semaphore_set_payload(semaphore, make_canary(uvm_gpu_semaphore_get_payload(semaphore)));
 
-    uvm_mutex_lock(&pool->mutex);
+    cache = get_cpu_ptr(pool->cpu_caches);
+    if (cache->count < UVM_GPU_SEMAPHORE_CPU_CACHE_SIZE) {
+        cache->semaphores[cache->count++] = *semaphore;
+        cached = true;
+    }
+    put_cpu_ptr(pool->cpu_caches);
+
+    if (!cached)
+        pool_free_slow(pool, semaphore);
 
     semaphore->page = NULL;
     semaphore->payload = NULL;
-
-    ++pool->free_semaphores_count;
-    __set_bit(index, page->free_semaphores);
-
-    uvm_mutex_unlock(&pool->mutex);
 }
 
 NV_STATUS uvm_gpu_semaphore_pool_create(uvm_gpu_t *gpu, uvm_gpu_semaphore_pool_t **pool_out)
@@ -269,6 +387,12 @@ NV_STATUS uvm_gpu_semaphore_pool_create(uvm_gpu_t *gpu, uvm_gpu_semaphore_pool_t
     if (!pool)
         return NV_ERR_NO_MEMORY;
 
+    pool->cpu_caches = alloc_percpu(uvm_gpu_semaphore_cpu_cache_t);
+    if (!pool->cpu_caches) {
+        uvm_kvfree(pool);
+        return NV_ERR_NO_MEMORY;
+    }
+
     uvm_mutex_init(&pool->mutex, UVM_LOCK_ORDER_GPU_SEMAPHORE_POOL);
 
     INIT_LIST_HEAD(&pool->pages);
@@ -285,6 +409,7 @@ void uvm_gpu_semaphore_pool_destroy(uvm_gpu_semaphore_pool_t *pool)
 {
     uvm_gpu_semaphore_pool_page_t *page;
     uvm_gpu_semaphore_pool_page_t *next_page;
+    int cpu;
 
     if (!pool)
         return;
@@ -295,6 +420,14 @@ void uvm_gpu_semaphore_pool_destroy(uvm_gpu_semaphore_pool_t *pool)
     // Keep pool_free_page happy
     uvm_mutex_lock(&pool->mutex);
 
+    // Return the semaphores cached by all the CPUs to their pages
+    for_each_possible_cpu(cpu) {
+        uvm_gpu_semaphore_cpu_cache_t *cache = per_cpu_ptr(pool->cpu_caches, cpu);
+
+        pool_return_free_locked(pool, cache->semaphores, cache->count);
+        cache->count = 0;
+    }
+
     list_for_each_entry_safe(page, next_page, &pool->pages, all_pages_node)
         pool_free_page(page);
 
@@ -303,6 +436,7 @@ void uvm_gpu_semaphore_pool_destroy(uvm_gpu_semaphore_pool_t *pool)
 
     uvm_mutex_unlock(&pool->mutex);
 
+    free_percpu(pool->cpu_caches);
     uvm_kvfree(pool);
 }
 
@@ -29,6 +29,9 @@
 #include "uvm_rm_mem.h"
 #include "uvm_linux.h"
 
+// Maximum number of free semaphores of a pool cached by each CPU
+#define UVM_GPU_SEMAPHORE_CPU_CACHE_SIZE 32
+
 // A GPU semaphore is a memory location accessible by the GPUs and the CPU
 // that's used for synchronization among them.
 // The GPU has primitives to acquire (wait for) and release (set) 4-byte memory
@@ -36,7 +39,9 @@
 // allowing for different synchronization schemes.
 //
 // The UVM driver maintains a per-GPU semaphore pool that grows on demand as
-// semaphores are allocated out of it.
+// semaphores are allocated out of it. Each CPU caches up to
+// UVM_GPU_SEMAPHORE_CPU_CACHE_SIZE free semaphores of every pool, so that most
+// allocations and frees don't need to take the pool lock.
 //
 // TODO: Bug 200194638: Add support for timestamps (the GPU also supports
 //       releasing 16-byte semaphores that include an 8-byte timestamp).
@@ -98,7 +103,7 @@ void uvm_gpu_semaphore_pool_destroy(uvm_gpu_semaphore_pool_t *pool);
 // Locking:
 //  - Global lock needs to be held in read mode (for mapping on all GPUs)
 //  - Internally synchronized and hence safe to be called from multiple threads
-//  - Internally acquires:
+//  - Internally acquires, only if the cache of the current CPU is empty:
 //    - GPU semaphore pool lock
 //    - RM API lock
 //    - RM GPUs lock
@@ -107,6 +112,8 @@ NV_STATUS uvm_gpu_semaphore_alloc(uvm_gpu_semaphore_pool_t *pool, uvm_gpu_semaph
 // Free a semaphore
 // Locking:
 //  - Internally synchronized and hence safe to be called from multiple threads
+//  - Internally acquires:
+//    - GPU semaphore pool lock, only if the cache of the current CPU is full
 void uvm_gpu_semaphore_free(uvm_gpu_semaphore_t *semaphore);
 
 // Map all the semaphores from the pool on a GPU
@@ -172,6 +179,21 @@ bool uvm_gpu_tracking_semaphore_is_value_completed(uvm_gpu_tracking_semaphore_t
 // called from multiple threads.
 NvU64 uvm_gpu_tracking_semaphore_update_completed_value(uvm_gpu_tracking_semaphore_t *tracking_sem);
 
+// Check whether a specific value is known to be completed based on the last
+// completed value observed, without reading the semaphore.
+//
+// A false return doesn't mean that the value isn't completed yet, just that it
+// wasn't observed as completed. Unlike
+// uvm_gpu_tracking_semaphore_is_value_completed(), no memory ordering is
+// provided and if true is returned, the caller has to issue
+// smp_mb__after_atomic() before accessing any memory written by the work
+// completing the value. That allows checking many values with a single
+// barrier.
+static bool uvm_gpu_tracking_semaphore_is_value_completed_cached(uvm_gpu_tracking_semaphore_t *tracking_sem, NvU64 value)
+{
+    return (NvU64)atomic64_read(&tracking_sem->completed_value) >= value;
+}
+
 // See the comments for uvm_gpu_tracking_semaphore_is_value_completed
 static bool uvm_gpu_tracking_semaphore_is_completed(uvm_gpu_tracking_semaphore_t *tracking_sem)
 {
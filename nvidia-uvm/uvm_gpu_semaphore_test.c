@@ -21,12 +21,16 @@
 
 *******************************************************************************/
 
+#include "uvm_api.h"
 #include "uvm_global.h"
 #include "uvm_gpu_semaphore.h"
 #include "uvm_test.h"
+#include "uvm_test_rng.h"
 #include "uvm_va_space.h"
 #include "uvm_kvmalloc.h"
 
+#include <linux/kthread.h>
+
 static NV_STATUS add_and_test(uvm_gpu_tracking_semaphore_t *tracking_sem, NvU32 increment_by)
 {
     NvU64 new_value;
@@ -163,3 +167,220 @@ done:
 
     return status;
 }
+
+typedef struct
+{
+    uvm_gpu_semaphore_pool_t *pool;
+
+    NvU32 index;
+    NvU32 iterations;
+    NvU32 seed;
+
+    struct task_struct *task;
+
+    NV_STATUS status;
+
+    struct completion done;
+} gpu_semaphore_stress_thread_t;
+
+// Payload written to a semaphore allocated by a thread. Unique among all the
+// semaphores allocated at the same time, so that a semaphore handed out to two
+// threads at once is caught when either of them checks its payload.
+static NvU32 stress_payload(gpu_semaphore_stress_thread_t *thread, NvU32 iteration)
+{
+    return (thread->index << 24) | (iteration & 0xffffff);
+}
+
+static NV_STATUS gpu_semaphore_stress_thread_run(gpu_semaphore_stress_thread_t *thread)
+{
+    uvm_gpu_semaphore_t *semaphores;
+    NvU32 *payloads;
+    uvm_test_rng_t rng;
+    NvU32 num_live = 0;
+    NvU32 i;
+    NV_STATUS status = NV_OK;
+
+    semaphores = uvm_kvmalloc_zero(UVM_TEST_GPU_SEMAPHORE_STRESS_MAX_LIVE * sizeof(*semaphores));
+    payloads = uvm_kvmalloc_zero(UVM_TEST_GPU_SEMAPHORE_STRESS_MAX_LIVE * sizeof(*payloads));
+    if (!semaphores || !payloads) {
+        status = NV_ERR_NO_MEMORY;
+        goto done;
+    }
+
+    uvm_test_rng_init(&rng, thread->seed + thread->index);
+
+    for (i = 0; i < thread->iterations; i++) {
+        bool alloc = num_live == 0 ||
+                     (num_live < UVM_TEST_GPU_SEMAPHORE_STRESS_MAX_LIVE && uvm_test_rng_range_32(&rng, 0, 1));
+
+        if (alloc) {
+            uvm_gpu_semaphore_t *semaphore = &semaphores[num_live];
+
+            TEST_NV_CHECK_GOTO(uvm_gpu_semaphore_alloc(thread->pool, semaphore), done);
+            ++num_live;
+
+            TEST_CHECK_GOTO(uvm_gpu_semaphore_get_payload(semaphore) == 0, done);
+
+            payloads[num_live - 1] = stress_payload(thread, i);
+            uvm_gpu_semaphore_set_payload(semaphore, payloads[num_live - 1]);
+        }
+        else {
+            NvU32 victim = uvm_test_rng_range_32(&rng, 0, num_live - 1);
+
+            TEST_CHECK_GOTO(uvm_gpu_semaphore_get_payload(&semaphores[victim]) == payloads[victim], done);
+
+            uvm_gpu_semaphore_free(&semaphores[victim]);
+
+            --num_live;
+            semaphores[victim] = semaphores[num_live];
+            payloads[victim] = payloads[num_live];
+        }
+
+        if ((i % 1024) == 0)
+            cond_resched();
+    }
+
+    for (i = 0; i < num_live; i++)
+        TEST_CHECK_GOTO(uvm_gpu_semaphore_get_payload(&semaphores[i]) == payloads[i], done);
+
+done:
+    if (semaphores) {
+        for (i = 0; i < num_live; i++)
+            uvm_gpu_semaphore_free(&semaphores[i]);
+    }
+
+    uvm_kvfree(semaphores);
+    uvm_kvfree(payloads);
+
+    return status;
+}
+
+static void gpu_semaphore_stress_thread_entry(gpu_semaphore_stress_thread_t *thread)
+{
+    thread->status = gpu_semaphore_stress_thread_run(thread);
+}
+
+static int gpu_semaphore_stress_thread_func(void *arg)
+{
+    gpu_semaphore_stress_thread_t *thread = arg;
+
+    // Kernel threads have no thread context, which the lock tracking of the
+    // pool mutex requires.
+    UVM_ENTRY_VOID(gpu_semaphore_stress_thread_entry(thread));
+
+    complete(&thread->done);
+
+    // The thread must not exit before kthread_stop() is called on it
+    set_current_state(TASK_INTERRUPTIBLE);
+    while (!kthread_should_stop()) {
+        schedule();
+        set_current_state(TASK_INTERRUPTIBLE);
+    }
+    __set_current_state(TASK_RUNNING);
+
+    return 0;
+}
+
+// Grow the pool so that the threads never need to allocate a new page, which
+// requires the global lock held by the calling thread. Every semaphore is
+// either held by a thread or cached by a CPU, so that many free semaphores are
+// enough for the page bitmaps to never run empty.
+static NV_STATUS gpu_semaphore_stress_grow_pool(uvm_gpu_semaphore_pool_t *pool, NvU32 num_threads)
+{
+    uvm_gpu_semaphore_t *semaphores;
+    NvU32 count = num_threads * UVM_TEST_GPU_SEMAPHORE_STRESS_MAX_LIVE +
+                  num_possible_cpus() * UVM_GPU_SEMAPHORE_CPU_CACHE_SIZE;
+    NvU32 num_allocated;
+    NV_STATUS status = NV_OK;
+
+    semaphores = uvm_kvmalloc_zero(count * sizeof(*semaphores));
+    if (!semaphores)
+        return NV_ERR_NO_MEMORY;
+
+    for (num_allocated = 0; num_allocated < count; num_allocated++) {
+        status = uvm_gpu_semaphore_alloc(pool, &semaphores[num_allocated]);
+        if (status != NV_OK)
+            break;
+    }
+
+    while (num_allocated > 0)
+        uvm_gpu_semaphore_free(&semaphores[--num_allocated]);
+
+    uvm_kvfree(semaphores);
+
+    return status;
+}
+
+static NV_STATUS gpu_semaphore_stress(uvm_gpu_t *gpu, UVM_TEST_GPU_SEMAPHORE_STRESS_PARAMS *params)
+{
+    gpu_semaphore_stress_thread_t *threads;
+    NV_STATUS status;
+    NvU32 num_started;
+    NvU32 i;
+
+    status = gpu_semaphore_stress_grow_pool(gpu->semaphore_pool, params->num_threads);
+    if (status != NV_OK)
+        return status;
+
+    threads = uvm_kvmalloc_zero(sizeof(*threads) * params->num_threads);
+    if (!threads)
+        return NV_ERR_NO_MEMORY;
+
+    for (num_started = 0; num_started < params->num_threads; num_started++) {
+        gpu_semaphore_stress_thread_t *thread = &threads[num_started];
+
+        thread->pool = gpu->semaphore_pool;
+        thread->index = num_started;
+        thread->iterations = params->iterations;
+        thread->seed = params->seed;
+        init_completion(&thread->done);
+
+        thread->task = kthread_run(gpu_semaphore_stress_thread_func, thread, "uvm_sema_test%u", num_started);
+        if (IS_ERR(thread->task)) {
+            status = errno_to_nv_status(PTR_ERR(thread->task));
+            break;
+        }
+    }
+
+    for (i = 0; i < num_started; i++) {
+        wait_for_completion(&threads[i].done);
+        kthread_stop(threads[i].task);
+
+        if (status == NV_OK)
+            status = threads[i].status;
+    }
+
+    uvm_kvfree(threads);
+
+    return status;
+}
+
+NV_STATUS uvm_test_gpu_semaphore_stress(UVM_TEST_GPU_SEMAPHORE_STRESS_PARAMS *params, struct file *filp)
+{
+    NV_STATUS status;
+    uvm_gpu_t *gpu;
+    uvm_va_space_t *va_space = uvm_va_space_get(filp);
+
+    if (params->num_threads == 0 || params->num_threads > UVM_TEST_GPU_SEMAPHORE_STRESS_MAX_THREADS)
+        return NV_ERR_INVALID_ARGUMENT;
+
+    if (params->iterations == 0)
+        return NV_ERR_INVALID_ARGUMENT;
+
+    uvm_mutex_lock(&g_uvm_global.global_lock);
+    uvm_va_space_down_read_rm(va_space);
+
+    gpu = uvm_va_space_get_gpu_by_uuid(va_space, &params->gpu_uuid);
+    if (!gpu) {
+        status = NV_ERR_INVALID_DEVICE;
+        goto done;
+    }
+
+    status = gpu_semaphore_stress(gpu, params);
+
+done:
+    uvm_va_space_up_read_rm(va_space);
+    uvm_mutex_unlock(&g_uvm_global.global_lock);
+
+    return status;
+}
@@ -62,6 +62,7 @@
 
 #include <linux/random.h>           /* get_random_bytes()               */
 #include <linux/radix-tree.h>       /* Linux kernel radix tree          */
+#include <linux/rculist.h>          /* RCU-protected lists              */
 
 #include <linux/file.h>             /* fget()                           */
 
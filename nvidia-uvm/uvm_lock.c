@@ -21,9 +21,71 @@
 
 *******************************************************************************/
 
+#include "uvm_api.h"
 #include "uvm_lock.h"
 #include "uvm_thread_context.h"
 #include "uvm_kvmalloc.h"
+#include "uvm_procfs.h"
+
+#include <linux/hash.h>
+#include <linux/sort.h>
+
+// Enable lock contention profiling. Read-only, since it also decides whether
+// thread contexts carry the lock information used to measure hold times. See
+// uvm_lock_order_stats_t.
+int uvm_lock_stats = 0;
+module_param(uvm_lock_stats, int, S_IRUGO);
+MODULE_PARM_DESC(uvm_lock_stats, "Enable lock contention profiling, reported in /proc/driver/nvidia-uvm/lock_stats");
+
+// Contended call sites are tracked in an open-addressing hash table keyed by
+// the address of the call site. Call sites that do not find a slot within
+// UVM_LOCK_STATS_CALL_SITE_PROBES probes are only counted as dropped.
+#define UVM_LOCK_STATS_CALL_SITES_SHIFT 8
+#define UVM_LOCK_STATS_CALL_SITES       (1 << UVM_LOCK_STATS_CALL_SITES_SHIFT)
+#define UVM_LOCK_STATS_CALL_SITE_PROBES 8
+
+// Number of call sites reported in procfs
+#define UVM_LOCK_STATS_TOP_CALL_SITES   16
+
+typedef struct
+{
+    // Address of the call site. Zero if the slot is empty. Slots are claimed
+    // with cmpxchg and only released on reset.
+    atomic_long_t ip;
+
+    // Order of the lock acquired at the call site
+    uvm_lock_order_t lock_order;
+
+    atomic64_t contended;
+    atomic64_t wait_ns;
+} uvm_lock_stats_call_site_t;
+
+typedef struct
+{
+    unsigned long ip;
+    uvm_lock_order_t lock_order;
+    NvU64 contended;
+    NvU64 wait_ns;
+} uvm_lock_stats_call_site_snapshot_t;
+
+// Per-CPU statistics, updated with this_cpu_* operations so profiling does not
+// add cross-CPU cache line traffic to every lock acquisition.
+typedef struct
+{
+    uvm_lock_order_stats_t orders[UVM_LOCK_ORDER_COUNT];
+} uvm_lock_stats_cpu_t;
+
+static DEFINE_PER_CPU(uvm_lock_stats_cpu_t, g_uvm_lock_stats_cpu);
+
+static struct
+{
+    uvm_lock_stats_call_site_t call_sites[UVM_LOCK_STATS_CALL_SITES];
+
+    // Contended acquisitions whose call site could not be recorded
+    atomic64_t call_sites_dropped;
+
+    struct proc_dir_entry *procfs_file;
+} g_uvm_lock_stats;
 
 const char *uvm_lock_order_to_string(uvm_lock_order_t lock_order)
 {
@@ -128,6 +190,9 @@ bool __uvm_record_lock(void *lock, uvm_lock_order_t lock_order, uvm_lock_flags_t
 
     uvm_context->acquired[lock_order] = lock;
 
+    // Set after the lock is acquired, if the acquisition is profiled
+    uvm_context->acquired_time_ns[lock_order] = 0;
+
     return correct;
 }
 
@@ -367,3 +432,285 @@ void uvm_bit_locks_deinit(uvm_bit_locks_t *bit_locks)
     kfree(bit_locks->bits);
     memset(bit_locks, 0, sizeof(*bit_locks));
 }
+
+static unsigned lock_stats_histogram_bucket(NvU64 duration_ns)
+{
+    // Durations are bucketed by powers of two of 1024ns, which is close enough
+    // to 1us and avoids a division.
+    return min_t(unsigned, fls64(duration_ns >> 10), UVM_LOCK_STATS_HISTOGRAM_BUCKETS - 1);
+}
+
+static void lock_stats_record_call_site(uvm_lock_order_t lock_order, unsigned long ip, NvU64 wait_ns)
+{
+    unsigned long index = hash_long(ip, UVM_LOCK_STATS_CALL_SITES_SHIFT);
+    unsigned i;
+
+    for (i = 0; i < UVM_LOCK_STATS_CALL_SITE_PROBES; i++) {
+        uvm_lock_stats_call_site_t *call_site;
+        unsigned long call_site_ip;
+
+        call_site = &g_uvm_lock_stats.call_sites[(index + i) % UVM_LOCK_STATS_CALL_SITES];
+        call_site_ip = atomic_long_read(&call_site->ip);
+
+        if (call_site_ip == 0) {
+            call_site_ip = atomic_long_cmpxchg(&call_site->ip, 0, ip);
+            if (call_site_ip == 0) {
+                call_site->lock_order = lock_order;
+                call_site_ip = ip;
+            }
+        }
+
+        if (call_site_ip == ip) {
+            atomic64_inc(&call_site->contended);
+            atomic64_add(wait_ns, &call_site->wait_ns);
+            return;
+        }
+    }
+
+    atomic64_inc(&g_uvm_lock_stats.call_sites_dropped);
+}
+
+void __uvm_lock_stats_acquired(uvm_lock_order_t lock_order, NvU64 wait_start, unsigned long ip)
+{
+    uvm_thread_context_lock_t *uvm_context;
+    NvU64 now = NV_GETTIME();
+
+    UVM_ASSERT(lock_order < UVM_LOCK_ORDER_COUNT);
+
+    this_cpu_inc(g_uvm_lock_stats_cpu.orders[lock_order].acquisitions);
+
+    if (wait_start != 0) {
+        NvU64 wait_ns = now - wait_start;
+
+        this_cpu_inc(g_uvm_lock_stats_cpu.orders[lock_order].contended);
+        this_cpu_add(g_uvm_lock_stats_cpu.orders[lock_order].wait_ns, wait_ns);
+        this_cpu_inc(g_uvm_lock_stats_cpu.orders[lock_order].wait_histogram[lock_stats_histogram_bucket(wait_ns)]);
+
+        if (ip != 0)
+            lock_stats_record_call_site(lock_order, ip, wait_ns);
+    }
+
+    // Hold times are tracked through the thread's lock context, so they are
+    // not available when lock tracking is disabled.
+    uvm_context = uvm_thread_context_lock_get();
+    if (uvm_context && uvm_context->skip_lock_tracking == 0)
+        uvm_context->acquired_time_ns[lock_order] = now;
+}
+
+void __uvm_lock_stats_trylock(uvm_lock_order_t lock_order, bool locked)
+{
+    UVM_ASSERT(lock_order < UVM_LOCK_ORDER_COUNT);
+
+    if (locked)
+        __uvm_lock_stats_acquired(lock_order, 0, 0);
+    else
+        this_cpu_inc(g_uvm_lock_stats_cpu.orders[lock_order].trylock_failures);
+}
+
+void __uvm_lock_stats_released(uvm_lock_order_t lock_order)
+{
+    uvm_thread_context_lock_t *uvm_context = uvm_thread_context_lock_get();
+    NvU64 hold_ns;
+
+    UVM_ASSERT(lock_order < UVM_LOCK_ORDER_COUNT);
+
+    if (!uvm_context || uvm_context->skip_lock_tracking > 0)
+        return;
+
+    // The acquisition was not profiled
+    if (uvm_context->acquired_time_ns[lock_order] == 0)
+        return;
+
+    hold_ns = NV_GETTIME() - uvm_context->acquired_time_ns[lock_order];
+    uvm_context->acquired_time_ns[lock_order] = 0;
+
+    this_cpu_inc(g_uvm_lock_stats_cpu.orders[lock_order].holds);
+    this_cpu_add(g_uvm_lock_stats_cpu.orders[lock_order].hold_ns, hold_ns);
+    this_cpu_inc(g_uvm_lock_stats_cpu.orders[lock_order].hold_histogram[lock_stats_histogram_bucket(hold_ns)]);
+}
+
+void uvm_lock_stats_get(uvm_lock_order_t lock_order, uvm_lock_order_stats_t *stats)
+{
+    int cpu;
+    unsigned i;
+
+    UVM_ASSERT(lock_order < UVM_LOCK_ORDER_COUNT);
+
+    memset(stats, 0, sizeof(*stats));
+
+    for_each_possible_cpu(cpu) {
+        uvm_lock_order_stats_t *cpu_stats = &per_cpu_ptr(&g_uvm_lock_stats_cpu, cpu)->orders[lock_order];
+
+        stats->acquisitions += READ_ONCE(cpu_stats->acquisitions);
+        stats->contended += READ_ONCE(cpu_stats->contended);
+        stats->trylock_failures += READ_ONCE(cpu_stats->trylock_failures);
+        stats->wait_ns += READ_ONCE(cpu_stats->wait_ns);
+        stats->hold_ns += READ_ONCE(cpu_stats->hold_ns);
+        stats->holds += READ_ONCE(cpu_stats->holds);
+
+        for (i = 0; i < UVM_LOCK_STATS_HISTOGRAM_BUCKETS; i++) {
+            stats->wait_histogram[i] += READ_ONCE(cpu_stats->wait_histogram[i]);
+            stats->hold_histogram[i] += READ_ONCE(cpu_stats->hold_histogram[i]);
+        }
+    }
+}
+
+void uvm_lock_stats_reset(void)
+{
+    int cpu;
+    unsigned i;
+
+    // Updates racing with the reset may be lost or partially applied, which is
+    // acceptable for statistics.
+    for_each_possible_cpu(cpu)
+        memset(per_cpu_ptr(&g_uvm_lock_stats_cpu, cpu), 0, sizeof(uvm_lock_stats_cpu_t));
+
+    for (i = 0; i < UVM_LOCK_STATS_CALL_SITES; i++) {
+        uvm_lock_stats_call_site_t *call_site = &g_uvm_lock_stats.call_sites[i];
+
+        atomic64_set(&call_site->contended, 0);
+        atomic64_set(&call_site->wait_ns, 0);
+        atomic_long_set(&call_site->ip, 0);
+    }
+
+    atomic64_set(&g_uvm_lock_stats.call_sites_dropped, 0);
+}
+
+static int lock_stats_call_site_cmp(const void *a, const void *b)
+{
+    const uvm_lock_stats_call_site_snapshot_t *call_site_a = a;
+    const uvm_lock_stats_call_site_snapshot_t *call_site_b = b;
+
+    // Sort by decreasing total wait time
+    if (call_site_a->wait_ns != call_site_b->wait_ns)
+        return call_site_a->wait_ns < call_site_b->wait_ns ? 1 : -1;
+
+    return 0;
+}
+
+static void lock_stats_print_histogram(struct seq_file *s, const char *name, const NvU64 *histogram)
+{
+    unsigned i;
+
+    UVM_SEQ_OR_DBG_PRINT(s, "  %-18s", name);
+    for (i = 0; i < UVM_LOCK_STATS_HISTOGRAM_BUCKETS; i++)
+        UVM_SEQ_OR_DBG_PRINT(s, " %llu", histogram[i]);
+    UVM_SEQ_OR_DBG_PRINT(s, "\n");
+}
+
+static void lock_stats_print_call_sites(struct seq_file *s)
+{
+    uvm_lock_stats_call_site_snapshot_t *call_sites;
+    size_t num_call_sites = 0;
+    size_t i;
+
+    call_sites = uvm_kvmalloc(sizeof(*call_sites) * UVM_LOCK_STATS_CALL_SITES);
+    if (!call_sites) {
+        UVM_SEQ_OR_DBG_PRINT(s, "contended call sites unavailable: out of memory\n");
+        return;
+    }
+
+    for (i = 0; i < UVM_LOCK_STATS_CALL_SITES; i++) {
+        uvm_lock_stats_call_site_t *call_site = &g_uvm_lock_stats.call_sites[i];
+        unsigned long ip = atomic_long_read(&call_site->ip);
+
+        if (ip == 0)
+            continue;
+
+        call_sites[num_call_sites].ip = ip;
+        call_sites[num_call_sites].lock_order = call_site->lock_order;
+        call_sites[num_call_sites].contended = atomic64_read(&call_site->contended);
+        call_sites[num_call_sites].wait_ns = atomic64_read(&call_site->wait_ns);
+        num_call_sites++;
+    }
+
+    sort(call_sites, num_call_sites, sizeof(*call_sites), lock_stats_call_site_cmp, NULL);
+
+    UVM_SEQ_OR_DBG_PRINT(s, "top contended call sites (dropped %llu)\n",
+                         (NvU64)atomic64_read(&g_uvm_lock_stats.call_sites_dropped));
+
+    for (i = 0; i < min_t(size_t, num_call_sites, UVM_LOCK_STATS_TOP_CALL_SITES); i++) {
+        UVM_SEQ_OR_DBG_PRINT(s, "  %-48s contended %-10llu wait_ns %-14llu %pS\n",
+                             uvm_lock_order_to_string(call_sites[i].lock_order),
+                             call_sites[i].contended,
+                             call_sites[i].wait_ns,
+                             (void *)call_sites[i].ip);
+    }
+
+    uvm_kvfree(call_sites);
+}
+
+static int nv_procfs_read_lock_stats(struct seq_file *s, void *v)
+{
+    uvm_lock_order_t lock_order;
+    unsigned i;
+
+    UVM_SEQ_OR_DBG_PRINT(s, "enabled %d\n", uvm_lock_stats);
+
+    UVM_SEQ_OR_DBG_PRINT(s, "histogram buckets (us): <1");
+    for (i = 1; i < UVM_LOCK_STATS_HISTOGRAM_BUCKETS - 1; i++)
+        UVM_SEQ_OR_DBG_PRINT(s, " <%u", 1u << i);
+    UVM_SEQ_OR_DBG_PRINT(s, " >=%u\n", 1u << (UVM_LOCK_STATS_HISTOGRAM_BUCKETS - 2));
+
+    for (lock_order = UVM_LOCK_ORDER_INVALID + 1; lock_order < UVM_LOCK_ORDER_COUNT; lock_order++) {
+        uvm_lock_order_stats_t stats;
+
+        uvm_lock_stats_get(lock_order, &stats);
+        if (stats.acquisitions == 0 && stats.trylock_failures == 0)
+            continue;
+
+        UVM_SEQ_OR_DBG_PRINT(s, "%s\n", uvm_lock_order_to_string(lock_order));
+        UVM_SEQ_OR_DBG_PRINT(s, "  acquisitions       %llu\n", stats.acquisitions);
+        UVM_SEQ_OR_DBG_PRINT(s, "  contended          %llu\n", stats.contended);
+        UVM_SEQ_OR_DBG_PRINT(s, "  trylock_failures   %llu\n", stats.trylock_failures);
+        UVM_SEQ_OR_DBG_PRINT(s, "  wait_ns            %llu\n", stats.wait_ns);
+        UVM_SEQ_OR_DBG_PRINT(s, "  holds              %llu\n", stats.holds);
+        UVM_SEQ_OR_DBG_PRINT(s, "  hold_ns            %llu\n", stats.hold_ns);
+        lock_stats_print_histogram(s, "wait_histogram", stats.wait_histogram);
+        lock_stats_print_histogram(s, "hold_histogram", stats.hold_histogram);
+    }
+
+    lock_stats_print_call_sites(s);
+
+    return 0;
+}
+
+static int nv_procfs_read_lock_stats_entry(struct seq_file *s, void *v)
+{
+    UVM_ENTRY_RET(nv_procfs_read_lock_stats(s, v));
+}
+
+// Any write resets the statistics
+static ssize_t nv_procfs_write_lock_stats(struct seq_file *s, const char __user *buf, size_t size)
+{
+    uvm_lock_stats_reset();
+
+    return size;
+}
+
+UVM_DEFINE_SINGLE_PROCFS_FILE_READ_WRITE(lock_stats_entry, nv_procfs_write_lock_stats);
+
+NV_STATUS uvm_lock_stats_init(void)
+{
+    // The file is always created when profiling was requested, so lock stats
+    // can be collected in release builds without enabling the debug procfs
+    // entries.
+    if (!uvm_lock_stats && !uvm_procfs_is_debug_enabled())
+        return NV_OK;
+
+    if (!uvm_procfs_is_enabled())
+        return NV_OK;
+
+    UVM_ASSERT(!g_uvm_lock_stats.procfs_file);
+    g_uvm_lock_stats.procfs_file = NV_CREATE_PROC_FILE("lock_stats", uvm_procfs_get_base_dir(), lock_stats_entry, NULL);
+    if (!g_uvm_lock_stats.procfs_file)
+        return NV_ERR_OPERATING_SYSTEM;
+
+    return NV_OK;
+}
+
+void uvm_lock_stats_exit(void)
+{
+    uvm_procfs_destroy_entry(g_uvm_lock_stats.procfs_file);
+    g_uvm_lock_stats.procfs_file = NULL;
+}
@@ -273,6 +273,12 @@
 //      - CPU page table mapping/unmapping
 //      - Pushing work (GPU page table mapping/unmapping)
 //
+//      When the uvm_va_block_region_locking module parameter is set, big-page
+//      regions of the block can be locked instead of the whole block (see
+//      uvm_va_block_lock_region()). Region locks share the VA block lock order
+//      and exclude the block lock: uvm_va_block_lock() waits for all of them
+//      to be released after acquiring the mutex.
+//
 //      Operations not allowed while holding the lock:
 //      - GPU memory allocation which can evict memory (would require nesting
 //        block locks)
@@ -522,6 +528,109 @@ bool __uvm_locking_initialized(void);
   #define uvm_record_unlock_rm_all()
 #endif
 
+// Lock contention profiling
+//
+// When the uvm_lock_stats module parameter is set, the lock wrappers below
+// record per lock order acquisition counts, wait and hold time histograms, and
+// the call sites of contended acquisitions. The statistics are exported in
+// /proc/driver/nvidia-uvm/lock_stats, and writing anything to that file resets
+// them.
+//
+// Contention is detected by attempting a non-blocking acquisition first, and
+// the wait time is measured only when that attempt fails. The hooks are
+// compiled in all builds, and the semaphores and mutexes they profile store
+// their lock order in all builds too. When disabled, the cost of the hooks is a
+// single predicted-not-taken branch per lock operation.
+//
+// Hold times are tracked through the thread context wrapper, which is used in
+// release builds when the parameter is set at load time. See
+// uvm_thread_context_wrapper_is_used().
+//
+// The mmap_lock, the RM locks, spinlocks and bit locks are not profiled.
+
+// Histogram bucket i counts durations in [2^(i - 1), 2^i) microseconds, except
+// for the first bucket which counts durations under 1us and the last one which
+// counts all the remaining durations.
+#define UVM_LOCK_STATS_HISTOGRAM_BUCKETS 16
+
+typedef struct
+{
+    // Successful acquisitions, including successful trylocks
+    NvU64 acquisitions;
+
+    // Acquisitions that had to wait because the lock was held
+    NvU64 contended;
+
+    // Failed trylock attempts
+    NvU64 trylock_failures;
+
+    // Total time spent waiting in contended acquisitions
+    NvU64 wait_ns;
+
+    // Total time the locks were held. Only acquisitions that were profiled and
+    // tracked by the thread's lock context contribute to this count.
+    NvU64 hold_ns;
+    NvU64 holds;
+
+    NvU64 wait_histogram[UVM_LOCK_STATS_HISTOGRAM_BUCKETS];
+    NvU64 hold_histogram[UVM_LOCK_STATS_HISTOGRAM_BUCKETS];
+} uvm_lock_order_stats_t;
+
+extern int uvm_lock_stats;
+
+#define uvm_lock_stats_enabled() unlikely(uvm_lock_stats != 0)
+
+NV_STATUS uvm_lock_stats_init(void);
+void uvm_lock_stats_exit(void);
+
+// Aggregate the statistics of the given lock order across all CPUs. The result
+// is approximate if locks of that order are being profiled concurrently.
+void uvm_lock_stats_get(uvm_lock_order_t lock_order, uvm_lock_order_stats_t *stats);
+
+// Clear all the lock statistics, including the contended call sites
+void uvm_lock_stats_reset(void);
+
+// Record an acquisition of a lock of the given order. wait_start is the time
+// at which the acquisition started waiting, or zero if it did not wait. ip is
+// the address of the acquisition call site.
+void __uvm_lock_stats_acquired(uvm_lock_order_t lock_order, NvU64 wait_start, unsigned long ip);
+
+// Record the result of a trylock attempt on a lock of the given order
+void __uvm_lock_stats_trylock(uvm_lock_order_t lock_order, bool locked);
+
+// Record the release of a lock of the given order
+void __uvm_lock_stats_released(uvm_lock_order_t lock_order);
+
+// Acquire a UVM lock (a lock that has a lock_order member) by executing
+// lock_stmt, and profile the acquisition if lock stats are enabled.
+// trylock_expr must be a non-blocking equivalent of lock_stmt that evaluates
+// to true if the lock was acquired.
+#define uvm_lock_stats_acquire(lock, trylock_expr, lock_stmt) do {                    \
+        if (uvm_lock_stats_enabled()) {                                               \
+            NvU64 _wait_start = 0;                                                    \
+            if (!(trylock_expr)) {                                                    \
+                _wait_start = NV_GETTIME();                                           \
+                lock_stmt;                                                            \
+            }                                                                         \
+            __uvm_lock_stats_acquired((lock)->lock_order, _wait_start, _THIS_IP_);    \
+        }                                                                             \
+        else {                                                                        \
+            lock_stmt;                                                                \
+        }                                                                             \
+    } while (0)
+
+#define uvm_lock_stats_trylock(lock, locked) do {                                     \
+        if (uvm_lock_stats_enabled())                                                 \
+            __uvm_lock_stats_trylock((lock)->lock_order, (locked));                   \
+    } while (0)
+
+// Must be called before the lock is released, since the lock may be freed
+// as soon as it is released.
+#define uvm_lock_stats_release(lock) do {                                             \
+        if (uvm_lock_stats_enabled())                                                 \
+            __uvm_lock_stats_released((lock)->lock_order);                            \
+    } while (0)
+
 #define uvm_locking_assert_initialized() UVM_ASSERT(__uvm_locking_initialized())
 #define uvm_thread_assert_all_unlocked() UVM_ASSERT(__uvm_thread_check_all_unlocked())
 #define uvm_assert_lockable_order(order) UVM_ASSERT(__uvm_check_lockable_order(order, UVM_LOCK_FLAGS_MODE_ANY))
@@ -590,9 +699,7 @@ bool __uvm_locking_initialized(void);
 typedef struct
 {
     struct rw_semaphore sem;
-#if UVM_IS_DEBUG()
     uvm_lock_order_t lock_order;
-#endif
 } uvm_rw_semaphore_t;
 
 //
@@ -622,21 +729,24 @@ static void uvm_init_rwsem(uvm_rw_semaphore_t *uvm_sem, uvm_lock_order_t lock_or
     init_rwsem(&uvm_sem->sem);
 #if UVM_IS_DEBUG()
     uvm_locking_assert_initialized();
-    uvm_sem->lock_order = lock_order;
 #endif
+    uvm_sem->lock_order = lock_order;
     uvm_assert_rwsem_unlocked(uvm_sem);
 }
 
-#define uvm_down_read(uvm_sem) ({                          \
-        typeof(uvm_sem) _sem = (uvm_sem);                  \
-        uvm_record_lock(_sem, UVM_LOCK_FLAGS_MODE_SHARED); \
-        down_read(&_sem->sem);                             \
-        uvm_assert_rwsem_locked_read(_sem);                \
+#define uvm_down_read(uvm_sem) ({                             \
+        typeof(uvm_sem) _sem = (uvm_sem);                     \
+        uvm_record_lock(_sem, UVM_LOCK_FLAGS_MODE_SHARED);    \
+        uvm_lock_stats_acquire(_sem,                          \
+                               down_read_trylock(&_sem->sem), \
+                               down_read(&_sem->sem));        \
+        uvm_assert_rwsem_locked_read(_sem);                   \
     })
 
 #define uvm_up_read(uvm_sem) ({                              \
         typeof(uvm_sem) _sem = (uvm_sem);                    \
         uvm_assert_rwsem_locked_read(_sem);                  \
+        uvm_lock_stats_release(_sem);                        \
         up_read(&_sem->sem);                                 \
         uvm_record_unlock(_sem, UVM_LOCK_FLAGS_MODE_SHARED); \
     })
@@ -651,11 +761,13 @@ static void uvm_init_rwsem(uvm_rw_semaphore_t *uvm_sem, uvm_lock_order_t lock_or
         up_read(&_sem->sem);                                 \
     })
 
-#define uvm_down_write(uvm_sem) ({                            \
-        typeof (uvm_sem) _sem = (uvm_sem);                    \
-        uvm_record_lock(_sem, UVM_LOCK_FLAGS_MODE_EXCLUSIVE); \
-        down_write(&_sem->sem);                               \
-        uvm_assert_rwsem_locked_write(_sem);                  \
+#define uvm_down_write(uvm_sem) ({                             \
+        typeof (uvm_sem) _sem = (uvm_sem);                     \
+        uvm_record_lock(_sem, UVM_LOCK_FLAGS_MODE_EXCLUSIVE);  \
+        uvm_lock_stats_acquire(_sem,                           \
+                               down_write_trylock(&_sem->sem), \
+                               down_write(&_sem->sem));        \
+        uvm_assert_rwsem_locked_write(_sem);                   \
     })
 
 // trylock for reading: returns 1 if successful, 0 if not.  Out-of-order lock
@@ -668,6 +780,7 @@ static void uvm_init_rwsem(uvm_rw_semaphore_t *uvm_sem, uvm_lock_order_t lock_or
         int locked;                                                                 \
         uvm_record_lock(_sem, UVM_LOCK_FLAGS_MODE_SHARED | UVM_LOCK_FLAGS_TRYLOCK); \
         locked = down_read_trylock(&_sem->sem);                                     \
+        uvm_lock_stats_trylock(_sem, locked);                                       \
         if (locked == 0)                                                            \
             uvm_record_unlock(_sem, UVM_LOCK_FLAGS_MODE_SHARED);                    \
         else                                                                        \
@@ -695,6 +808,7 @@ static void uvm_init_rwsem(uvm_rw_semaphore_t *uvm_sem, uvm_lock_order_t lock_or
         int locked;                                                                    \
         uvm_record_lock(_sem, UVM_LOCK_FLAGS_MODE_EXCLUSIVE | UVM_LOCK_FLAGS_TRYLOCK); \
         locked = down_write_trylock(&_sem->sem);                                       \
+        uvm_lock_stats_trylock(_sem, locked);                                          \
         if (locked == 0)                                                               \
             uvm_record_unlock(_sem, UVM_LOCK_FLAGS_MODE_EXCLUSIVE);                    \
         else                                                                           \
@@ -705,6 +819,7 @@ static void uvm_init_rwsem(uvm_rw_semaphore_t *uvm_sem, uvm_lock_order_t lock_or
 #define uvm_up_write(uvm_sem) ({                                \
         typeof(uvm_sem) _sem = (uvm_sem);                       \
         uvm_assert_rwsem_locked_write(_sem);                    \
+        uvm_lock_stats_release(_sem);                           \
         up_write(&_sem->sem);                                   \
         uvm_record_unlock(_sem, UVM_LOCK_FLAGS_MODE_EXCLUSIVE); \
     })
@@ -719,9 +834,7 @@ static void uvm_init_rwsem(uvm_rw_semaphore_t *uvm_sem, uvm_lock_order_t lock_or
 typedef struct
 {
     struct mutex m;
-#if UVM_IS_DEBUG()
     uvm_lock_order_t lock_order;
-#endif
 } uvm_mutex_t;
 
 //
@@ -758,8 +871,8 @@ static void uvm_mutex_init(uvm_mutex_t *mutex, uvm_lock_order_t lock_order)
     mutex_init(&mutex->m);
 #if UVM_IS_DEBUG()
     uvm_locking_assert_initialized();
-    mutex->lock_order = lock_order;
 #endif
+    mutex->lock_order = lock_order;
     uvm_assert_mutex_unlocked(mutex);
 }
 
@@ -767,7 +880,9 @@ static void uvm_mutex_init(uvm_mutex_t *mutex, uvm_lock_order_t lock_order)
         typeof(mutex) _mutex = (mutex);                         \
         uvm_assert_mutex_interrupts();                          \
         uvm_record_lock(_mutex, UVM_LOCK_FLAGS_MODE_EXCLUSIVE); \
-        mutex_lock(&_mutex->m);                                 \
+        uvm_lock_stats_acquire(_mutex,                          \
+                               mutex_trylock(&_mutex->m),       \
+                               mutex_lock(&_mutex->m));         \
         uvm_assert_mutex_locked(_mutex);                        \
     })
 
@@ -782,6 +897,7 @@ static void uvm_mutex_init(uvm_mutex_t *mutex, uvm_lock_order_t lock_order)
         typeof(mutex) _mutex = (mutex);                           \
         uvm_assert_mutex_interrupts();                            \
         uvm_assert_mutex_locked(_mutex);                          \
+        uvm_lock_stats_release(_mutex);                           \
         mutex_unlock(&_mutex->m);                                 \
         uvm_record_unlock(_mutex, UVM_LOCK_FLAGS_MODE_EXCLUSIVE); \
     })
@@ -789,6 +905,7 @@ static void uvm_mutex_init(uvm_mutex_t *mutex, uvm_lock_order_t lock_order)
         typeof(mutex) _mutex = (mutex);                                        \
         uvm_assert_mutex_interrupts();                                         \
         uvm_assert_mutex_locked(_mutex);                                       \
+        uvm_lock_stats_release(_mutex);                                        \
         mutex_unlock(&_mutex->m);                                              \
         uvm_record_unlock_out_of_order(_mutex, UVM_LOCK_FLAGS_MODE_EXCLUSIVE); \
     })
@@ -803,9 +920,7 @@ static void uvm_mutex_init(uvm_mutex_t *mutex, uvm_lock_order_t lock_order)
 typedef struct
 {
     struct semaphore sem;
-#if UVM_IS_DEBUG()
     uvm_lock_order_t lock_order;
-#endif
 } uvm_semaphore_t;
 
 static void uvm_sema_init(uvm_semaphore_t *semaphore, int val, uvm_lock_order_t lock_order)
@@ -813,8 +928,8 @@ static void uvm_sema_init(uvm_semaphore_t *semaphore, int val, uvm_lock_order_t
     sema_init(&semaphore->sem, val);
 #if UVM_IS_DEBUG()
     uvm_locking_assert_initialized();
-    semaphore->lock_order = lock_order;
 #endif
+    semaphore->lock_order = lock_order;
 }
 
 #define uvm_sem_is_locked(uvm_sem) uvm_check_locked(uvm_sem, UVM_LOCK_FLAGS_MODE_SHARED)
@@ -822,18 +937,22 @@ static void uvm_sema_init(uvm_semaphore_t *semaphore, int val, uvm_lock_order_t
 #define uvm_down(uvm_sem) ({                               \
         typeof(uvm_sem) _sem = (uvm_sem);                  \
         uvm_record_lock(_sem, UVM_LOCK_FLAGS_MODE_SHARED); \
-        down(&_sem->sem);                                  \
+        uvm_lock_stats_acquire(_sem,                       \
+                               !down_trylock(&_sem->sem),  \
+                               down(&_sem->sem));          \
     })
 
 #define uvm_up(uvm_sem) ({                                   \
         typeof(uvm_sem) _sem = (uvm_sem);                    \
         UVM_ASSERT(uvm_sem_is_locked(_sem));                 \
+        uvm_lock_stats_release(_sem);                        \
         up(&_sem->sem);                                      \
         uvm_record_unlock(_sem, UVM_LOCK_FLAGS_MODE_SHARED); \
     })
 #define uvm_up_out_of_order(uvm_sem) ({                                   \
         typeof(uvm_sem) _sem = (uvm_sem);                                 \
         UVM_ASSERT(uvm_sem_is_locked(_sem));                              \
+        uvm_lock_stats_release(_sem);                                     \
         up(&_sem->sem);                                                   \
         uvm_record_unlock_out_of_order(_sem, UVM_LOCK_FLAGS_MODE_SHARED); \
     })
@@ -891,13 +1010,16 @@ static void uvm_spin_lock_init(uvm_spinlock_t *spinlock, uvm_lock_order_t lock_o
 #define uvm_spin_lock(uvm_lock) ({                             \
         typeof(uvm_lock) _lock = (uvm_lock);                   \
         uvm_record_lock(_lock, UVM_LOCK_FLAGS_MODE_EXCLUSIVE); \
-        spin_lock(&_lock->lock);                               \
+        uvm_lock_stats_acquire(_lock,                          \
+                               spin_trylock(&_lock->lock),     \
+                               spin_lock(&_lock->lock));       \
         uvm_assert_spinlock_locked(_lock);                     \
     })
 
 #define uvm_spin_unlock(uvm_lock) ({                             \
         typeof(uvm_lock) _lock = (uvm_lock);                     \
         uvm_assert_spinlock_locked(_lock);                       \
+        uvm_lock_stats_release(_lock);                           \
         spin_unlock(&_lock->lock);                               \
         uvm_record_unlock(_lock, UVM_LOCK_FLAGS_MODE_EXCLUSIVE); \
     })
@@ -913,13 +1035,15 @@ static void uvm_spin_lock_irqsave_init(uvm_spinlock_irqsave_t *spinlock, uvm_loc
 }
 
 // Use a temp to not rely on flags being written after acquiring the lock.
-#define uvm_spin_lock_irqsave(uvm_lock) ({                     \
-        typeof(uvm_lock) _lock = (uvm_lock);                   \
-        unsigned long irq_flags;                               \
-        uvm_record_lock(_lock, UVM_LOCK_FLAGS_MODE_EXCLUSIVE); \
-        spin_lock_irqsave(&_lock->lock, irq_flags);            \
-        _lock->irq_flags = irq_flags;                          \
-        uvm_assert_spinlock_locked(_lock);                     \
+#define uvm_spin_lock_irqsave(uvm_lock) ({                                    \
+        typeof(uvm_lock) _lock = (uvm_lock);                                  \
+        unsigned long irq_flags;                                              \
+        uvm_record_lock(_lock, UVM_LOCK_FLAGS_MODE_EXCLUSIVE);                \
+        uvm_lock_stats_acquire(_lock,                                         \
+                               spin_trylock_irqsave(&_lock->lock, irq_flags), \
+                               spin_lock_irqsave(&_lock->lock, irq_flags));   \
+        _lock->irq_flags = irq_flags;                                         \
+        uvm_assert_spinlock_locked(_lock);                                    \
     })
 
 // Use a temp to not rely on flags being read before releasing the lock.
@@ -927,6 +1051,7 @@ static void uvm_spin_lock_irqsave_init(uvm_spinlock_irqsave_t *spinlock, uvm_loc
         typeof(uvm_lock) _lock = (uvm_lock);                     \
         unsigned long irq_flags = _lock->irq_flags;              \
         uvm_assert_spinlock_locked(_lock);                       \
+        uvm_lock_stats_release(_lock);                           \
         spin_unlock_irqrestore(&_lock->lock, irq_flags);         \
         uvm_record_unlock(_lock, UVM_LOCK_FLAGS_MODE_EXCLUSIVE); \
     })
@@ -996,33 +1121,49 @@ static void uvm_rwlock_irqsave_init(uvm_rwlock_irqsave_t *rwlock, uvm_lock_order
     uvm_assert_rwlock_unlocked(rwlock);
 }
 
+// The kernel only provides write_trylock_irqsave(). Interrupts are restored if
+// the read lock could not be acquired.
+#define uvm_read_trylock_irqsave(rwlock, irq_flags) ({  \
+        int _locked;                                    \
+        local_irq_save(irq_flags);                      \
+        _locked = read_trylock(rwlock);                 \
+        if (!_locked)                                   \
+            local_irq_restore(irq_flags);               \
+        _locked;                                        \
+    })
+
 // We can't store the irq_flags within the lock itself for readers, so they must
 // pass in their flags.
-#define uvm_read_lock_irqsave(uvm_rwlock, irq_flags) ({     \
-        typeof(uvm_rwlock) _lock = (uvm_rwlock);            \
-        uvm_record_lock(_lock, UVM_LOCK_FLAGS_MODE_SHARED); \
-        read_lock_irqsave(&_lock->lock, irq_flags);         \
-        uvm_rwlock_irqsave_inc(uvm_rwlock);                 \
-        uvm_assert_rwlock_locked_read(_lock);               \
+#define uvm_read_lock_irqsave(uvm_rwlock, irq_flags) ({                           \
+        typeof(uvm_rwlock) _lock = (uvm_rwlock);                                  \
+        uvm_record_lock(_lock, UVM_LOCK_FLAGS_MODE_SHARED);                       \
+        uvm_lock_stats_acquire(_lock,                                             \
+                               uvm_read_trylock_irqsave(&_lock->lock, irq_flags), \
+                               read_lock_irqsave(&_lock->lock, irq_flags));       \
+        uvm_rwlock_irqsave_inc(uvm_rwlock);                                       \
+        uvm_assert_rwlock_locked_read(_lock);                                     \
     })
 
 #define uvm_read_unlock_irqrestore(uvm_rwlock, irq_flags) ({    \
         typeof(uvm_rwlock) _lock = (uvm_rwlock);                \
         uvm_assert_rwlock_locked_read(_lock);                   \
         uvm_rwlock_irqsave_dec(uvm_rwlock);                     \
+        uvm_lock_stats_release(_lock);                          \
         read_unlock_irqrestore(&_lock->lock, irq_flags);        \
         uvm_record_unlock(_lock, UVM_LOCK_FLAGS_MODE_SHARED);   \
     })
 
 // Use a temp to not rely on flags being written after acquiring the lock.
-#define uvm_write_lock_irqsave(uvm_rwlock) ({                   \
-        typeof(uvm_rwlock) _lock = (uvm_rwlock);                \
-        unsigned long irq_flags;                                \
-        uvm_record_lock(_lock, UVM_LOCK_FLAGS_MODE_EXCLUSIVE);  \
-        write_lock_irqsave(&_lock->lock, irq_flags);            \
-        uvm_rwlock_irqsave_inc(uvm_rwlock);                     \
-        _lock->irq_flags = irq_flags;                           \
-        uvm_assert_rwlock_locked_write(_lock);                  \
+#define uvm_write_lock_irqsave(uvm_rwlock) ({                                  \
+        typeof(uvm_rwlock) _lock = (uvm_rwlock);                               \
+        unsigned long irq_flags;                                               \
+        uvm_record_lock(_lock, UVM_LOCK_FLAGS_MODE_EXCLUSIVE);                 \
+        uvm_lock_stats_acquire(_lock,                                          \
+                               write_trylock_irqsave(&_lock->lock, irq_flags), \
+                               write_lock_irqsave(&_lock->lock, irq_flags));   \
+        uvm_rwlock_irqsave_inc(uvm_rwlock);                                    \
+        _lock->irq_flags = irq_flags;                                          \
+        uvm_assert_rwlock_locked_write(_lock);                                 \
     })
 
 // Use a temp to not rely on flags being written after acquiring the lock.
@@ -1031,6 +1172,7 @@ static void uvm_rwlock_irqsave_init(uvm_rwlock_irqsave_t *rwlock, uvm_lock_order
         unsigned long irq_flags = _lock->irq_flags;                 \
         uvm_assert_rwlock_locked_write(_lock);                      \
         uvm_rwlock_irqsave_dec(uvm_rwlock);                         \
+        uvm_lock_stats_release(_lock);                              \
         write_unlock_irqrestore(&_lock->lock, irq_flags);           \
         uvm_record_unlock(_lock, UVM_LOCK_FLAGS_MODE_EXCLUSIVE);    \
     })
@@ -410,6 +410,47 @@ static NV_STATUS test_try_locking_out_of_order(void)
     return NV_OK;
 }
 
+static NV_STATUS test_lock_stats(void)
+{
+    uvm_mutex_t mutex;
+    uvm_lock_order_stats_t stats_before;
+    uvm_lock_order_stats_t stats_after;
+    int lock_stats_enabled = uvm_lock_stats;
+    NvU64 hold_histogram_count = 0;
+    unsigned i;
+    const unsigned num_acquisitions = 16;
+
+    uvm_mutex_init(&mutex, UVM_LOCK_ORDER_LEAF);
+
+    uvm_lock_stats_get(UVM_LOCK_ORDER_LEAF, &stats_before);
+
+    // The parameter is read-only for users, so that the use of the thread
+    // context wrapper is fixed at load time. Toggling it here is fine because
+    // the builtin tests already force the wrapper to be used.
+    TEST_CHECK_RET(uvm_thread_context_wrapper_is_used());
+    uvm_lock_stats = 1;
+    for (i = 0; i < num_acquisitions; i++) {
+        uvm_mutex_lock(&mutex);
+        uvm_mutex_unlock(&mutex);
+    }
+    uvm_lock_stats = lock_stats_enabled;
+
+    uvm_lock_stats_get(UVM_LOCK_ORDER_LEAF, &stats_after);
+
+    // Other threads may be profiling leaf locks concurrently, so only lower
+    // bounds can be checked.
+    TEST_CHECK_RET(stats_after.acquisitions - stats_before.acquisitions >= num_acquisitions);
+    TEST_CHECK_RET(stats_after.holds - stats_before.holds >= num_acquisitions);
+
+    for (i = 0; i < UVM_LOCK_STATS_HISTOGRAM_BUCKETS; i++)
+        hold_histogram_count += stats_after.hold_histogram[i] - stats_before.hold_histogram[i];
+    TEST_CHECK_RET(hold_histogram_count >= num_acquisitions);
+
+    TEST_CHECK_RET(__uvm_thread_check_all_unlocked());
+
+    return NV_OK;
+}
+
 static NV_STATUS run_all_lock_tests(void)
 {
     // The test needs all locks to be released initially
@@ -435,6 +476,7 @@ static NV_STATUS run_all_lock_tests(void)
     TEST_CHECK_RET(test_downgrading_when_different_instance_held() == NV_OK);
     TEST_CHECK_RET(test_downgrading_when_locked_as_shared() == NV_OK);
     TEST_CHECK_RET(test_try_locking_out_of_order() == NV_OK);
+    TEST_CHECK_RET(test_lock_stats() == NV_OK);
 
     return NV_OK;
 }
@@ -230,6 +230,8 @@ void uvm_hal_maxwell_ce_memcopy(uvm_push_t *push, uvm_gpu_address_t dst, uvm_gpu
 
     gpu->parent->ce_hal->memcopy_patch_src(push, &src);
 
+    push->ce_bytes += size;
+
     launch_dma_src_dst_type = gpu->parent->ce_hal->phys_mode(push, dst, src);
     launch_dma_plc_mode = gpu->parent->ce_hal->plc_mode();
 
@@ -295,6 +297,8 @@ static void memset_common(uvm_push_t *push, uvm_gpu_address_t dst, size_t size,
                    push->channel->name,
                    uvm_gpu_name(gpu));
 
+    push->ce_bytes += size * memset_element_size;
+
     launch_dma_dst_type = memset_push_phys_mode(push, dst);
     launch_dma_plc_mode = gpu->parent->ce_hal->plc_mode();
 
@@ -344,7 +344,7 @@ static bool va_block_should_do_cpu_preunmap(uvm_va_block_t *va_block,
 
     region = uvm_va_block_region_from_start_end(va_block, max(start, va_block->start), min(end, va_block->end));
 
-    uvm_mutex_lock(&va_block->lock);
+    uvm_va_block_lock(va_block);
 
     mapped_pages_cpu = uvm_va_block_map_mask_get(va_block, UVM_ID_CPU);
     if (uvm_processor_mask_test(&va_block->resident, dest_id)) {
@@ -365,7 +365,7 @@ static bool va_block_should_do_cpu_preunmap(uvm_va_block_t *va_block,
 
     *num_unmap_pages = uvm_page_mask_region_weight(mapped_pages_cpu, region) - num_cpu_unchanged_pages;
 
-    uvm_mutex_unlock(&va_block->lock);
+    uvm_va_block_unlock(va_block);
 
     return num_cpu_unchanged_pages == 0;
 }
@@ -136,16 +136,19 @@ static NV_STATUS migrate_vma_zero_begin_push(uvm_va_space_t *va_space,
                           outer);
 }
 
-// Create a new push to copy pages between src_id and dst_id
+// Create a new push to copy size bytes of pages between src_id and dst_id.
+// Large copies are striped across copy engines.
 static NV_STATUS migrate_vma_copy_begin_push(uvm_va_space_t *va_space,
                                              uvm_processor_id_t dst_id,
                                              uvm_processor_id_t src_id,
                                              unsigned long start,
                                              unsigned long outer,
+                                             NvU64 size,
                                              uvm_push_t *push)
 {
     uvm_channel_type_t channel_type;
     uvm_gpu_t *gpu;
+    uvm_gpu_t *dst_gpu = NULL;
 
     UVM_ASSERT_MSG(!uvm_id_equal(src_id, dst_id),
                    "Unexpected copy to self, processor %s\n",
@@ -183,26 +186,20 @@ static NV_STATUS migrate_vma_copy_begin_push(uvm_va_space_t *va_space,
                        uvm_va_space_processor_name(va_space, src_id));
     }
 
-    if (channel_type == UVM_CHANNEL_TYPE_GPU_TO_GPU) {
-        uvm_gpu_t *dst_gpu = uvm_va_space_get_gpu(va_space, dst_id);
-        return uvm_push_begin_gpu_to_gpu(gpu->channel_manager,
-                                         dst_gpu,
-                                         push,
-                                         "Copy from %s to %s for VMA region [0x%lx, 0x%lx]",
-                                         uvm_va_space_processor_name(va_space, src_id),
-                                         uvm_va_space_processor_name(va_space, dst_id),
-                                         start,
-                                         outer);
-    }
-
-    return uvm_push_begin(gpu->channel_manager,
-                          channel_type,
-                          push,
-                          "Copy from %s to %s for VMA region [0x%lx, 0x%lx]",
-                          uvm_va_space_processor_name(va_space, src_id),
-                          uvm_va_space_processor_name(va_space, dst_id),
-                          start,
-                          outer);
+    if (channel_type == UVM_CHANNEL_TYPE_GPU_TO_GPU)
+        dst_gpu = uvm_va_space_get_gpu(va_space, dst_id);
+
+    return uvm_push_begin_acquire_striped(gpu->channel_manager,
+                                          channel_type,
+                                          dst_gpu,
+                                          size,
+                                          NULL,
+                                          push,
+                                          "Copy from %s to %s for VMA region [0x%lx, 0x%lx]",
+                                          uvm_va_space_processor_name(va_space, src_id),
+                                          uvm_va_space_processor_name(va_space, dst_id),
+                                          start,
+                                          outer);
 }
 
 static void migrate_vma_compute_masks(struct vm_area_struct *vma, const unsigned long *src, migrate_vma_state_t *state)
@@ -453,7 +450,13 @@ static NV_STATUS migrate_vma_copy_pages_from(struct vm_area_struct *vma,
         }
 
         if (!copying_gpu) {
-            status = migrate_vma_copy_begin_push(va_space, dst_id, src_id, start, outer - 1, &push);
+            status = migrate_vma_copy_begin_push(va_space,
+                                                 dst_id,
+                                                 src_id,
+                                                 start,
+                                                 outer - 1,
+                                                 bitmap_weight(page_mask, state->num_pages) * PAGE_SIZE,
+                                                 &push);
             if (status != NV_OK) {
                 __free_page(dst_page);
                 return status;
@@ -23,6 +23,7 @@
 
 #include "uvm_types.h"
 #include "uvm_forward_decl.h"
+#include "uvm_api.h"
 #include "uvm_gpu.h"
 #include "uvm_mmu.h"
 #include "uvm_hal.h"
@@ -75,31 +76,44 @@ module_param(uvm_page_table_location, charp, S_IRUGO);
 MODULE_PARM_DESC(uvm_page_table_location,
                 "Set the location for UVM-allocated page tables. Choices are: vid, sys.");
 
-NV_STATUS uvm_mmu_init(void)
-{
-    UVM_ASSERT((page_table_aperture == UVM_APERTURE_VID) ||
-               (page_table_aperture == UVM_APERTURE_SYS) ||
-               (page_table_aperture == UVM_APERTURE_DEFAULT));
-
-    if (!uvm_page_table_location)
-        return NV_OK;
-
-    // TODO: Bug 1766651: Add modes for testing, e.g. alternating vidmem and
-    //       sysmem etc.
-    if (strcmp(uvm_page_table_location, "vid") == 0) {
-        page_table_aperture = UVM_APERTURE_VID;
-    }
-    else if (strcmp(uvm_page_table_location, "sys") == 0) {
-        page_table_aperture = UVM_APERTURE_SYS;
-    }
-    else {
-        pr_info("Invalid uvm_page_table_location %s. Using %s instead.\n",
-                uvm_page_table_location,
-                uvm_aperture_string(page_table_aperture));
-    }
-
-    return NV_OK;
-}
+// Maximum number of free page directories and tables cached by each page tree
+static unsigned uvm_page_table_cache_size = 16;
+module_param(uvm_page_table_cache_size, uint, S_IRUGO);
+MODULE_PARM_DESC(uvm_page_table_cache_size,
+                 "Maximum number of free page directories and tables kept initialized for reuse by each GPU page "
+                 "tree. 0 disables the cache.");
+
+// Page trees keep the page directories and tables released by put_ptes in
+// their table cache, after clearing them to invalid entries in the same push
+// that unlinks them from the tree. The next get_ptes that needs a directory
+// with the same depth and layout can then insert it right away, skipping both
+// the allocation and its initialization.
+//
+// Cached directories start in the dirs list of the tree, protected by the tree
+// lock. Sysmem directories are moved to the reclaimable list of the tree once
+// the tree tracker is known to be completed, from where the shrinker can free
+// them without taking the tree lock or waiting for the GPU. Vidmem directories
+// don't take any system memory and are not released by the shrinker. Instead
+// they are freed when a vidmem allocation for the tree fails and when the tree
+// is destroyed.
+static struct
+{
+    // Protects the trees list and the reclaimable lists of all the trees
+    uvm_spinlock_t lock;
+
+    // Trees with a table cache, linked through table_cache.trees_node
+    struct list_head trees;
+
+    // Number of directories in all the reclaimable lists
+    atomic64_t reclaimable_count;
+
+#if defined(NV_SHRINKER_ALLOC_PRESENT)
+    struct shrinker *shrinker;
+#else
+    struct shrinker shrinker;
+    bool shrinker_registered;
+#endif
+} g_table_cache;
 
 static NV_STATUS phys_mem_allocate_sysmem(uvm_page_tree_t *tree, NvLength size, uvm_mmu_page_table_alloc_t *out)
 {
@@ -182,6 +196,17 @@ static void phys_mem_deallocate_vidmem(uvm_page_tree_t *tree, uvm_mmu_page_table
     uvm_pmm_gpu_free(&tree->gpu->pmm, ptr->handle.chunk, &tree->tracker);
 }
 
+// Free sysmem that is not in use by the GPU anymore. Doesn't sleep so it can be
+// called with spinlocks held.
+static void phys_mem_free_sysmem(uvm_gpu_t *gpu, uvm_mmu_page_table_alloc_t *ptr)
+{
+    UVM_ASSERT(ptr->addr.aperture == UVM_APERTURE_SYS);
+
+    if (gpu->parent->pci_dev)
+        uvm_gpu_unmap_cpu_pages(gpu, ptr->addr.address, UVM_PAGE_ALIGN_UP(ptr->size));
+    __free_pages(ptr->handle.page, get_order(ptr->size));
+}
+
 static void phys_mem_deallocate_sysmem(uvm_page_tree_t *tree, uvm_mmu_page_table_alloc_t *ptr)
 {
     NV_STATUS status;
@@ -194,10 +219,7 @@ static void phys_mem_deallocate_sysmem(uvm_page_tree_t *tree, uvm_mmu_page_table
     if (status != NV_OK)
         UVM_ASSERT(status == uvm_global_get_status());
 
-    UVM_ASSERT(ptr->addr.aperture == UVM_APERTURE_SYS);
-    if (tree->gpu->parent->pci_dev)
-        uvm_gpu_unmap_cpu_pages(tree->gpu, ptr->addr.address, UVM_PAGE_ALIGN_UP(ptr->size));
-    __free_pages(ptr->handle.page, get_order(ptr->size));
+    phys_mem_free_sysmem(tree->gpu, ptr);
 }
 
 static void phys_mem_deallocate(uvm_page_tree_t *tree, uvm_mmu_page_table_alloc_t *ptr)
@@ -210,6 +232,336 @@ static void phys_mem_deallocate(uvm_page_tree_t *tree, uvm_mmu_page_table_alloc_
     memset(ptr, 0, sizeof(*ptr));
 }
 
+static void directory_free(uvm_page_tree_t *tree, uvm_page_directory_t *dir)
+{
+    phys_mem_deallocate(tree, &dir->phys_alloc);
+    uvm_kvfree(dir);
+}
+
+// Number of directories that can be added to the table cache of the tree.
+// The count of reclaimable directories can only go down behind our back, so
+// the returned room is a lower bound.
+static NvU32 table_cache_room(uvm_page_tree_t *tree)
+{
+    NvU32 count;
+
+    uvm_assert_mutex_locked(&tree->lock);
+
+    count = tree->table_cache.count + READ_ONCE(tree->table_cache.reclaimable_count);
+    if (count >= tree->table_cache.max_count)
+        return 0;
+
+    return tree->table_cache.max_count - count;
+}
+
+// Add a directory whose memory only contains invalid entries, once all the
+// pending GPU operations on the tree complete, to the table cache of the tree.
+// The caller must have checked that there is room for it.
+static void table_cache_add(uvm_page_tree_t *tree, uvm_page_directory_t *dir)
+{
+    uvm_assert_mutex_locked(&tree->lock);
+    UVM_ASSERT(dir->phys_alloc_clear);
+    UVM_ASSERT(dir->ref_count == 0);
+    UVM_ASSERT(table_cache_room(tree) > 0);
+
+    dir->host_parent = NULL;
+    dir->index_in_parent = 0;
+    list_add(&dir->cache_node, &tree->table_cache.dirs);
+    tree->table_cache.count++;
+}
+
+// Whether a cached directory can be used at the given depth for the given page
+// size. Besides exact matches, directories above the page tables are shared by
+// page sizes that use the same layout for them.
+static bool table_cache_dir_matches(uvm_page_tree_t *tree, uvm_page_directory_t *dir, NvU32 page_size, NvU32 depth)
+{
+    uvm_mmu_mode_hal_t *hal = tree->hal;
+
+    if (dir->depth != depth)
+        return false;
+
+    if (dir->page_size == page_size)
+        return true;
+
+    return depth < hal->page_table_depth(page_size) &&
+           depth < hal->page_table_depth(dir->page_size) &&
+           hal->allocation_size(depth, page_size) == hal->allocation_size(depth, dir->page_size) &&
+           hal->index_bits(depth, page_size) == hal->index_bits(depth, dir->page_size);
+}
+
+// Take a directory usable at the given depth for the given page size out of
+// the table cache of the tree. Returns NULL if there are none.
+static uvm_page_directory_t *table_cache_get(uvm_page_tree_t *tree, NvU32 page_size, NvU32 depth)
+{
+    uvm_page_directory_t *dir;
+
+    uvm_assert_mutex_locked(&tree->lock);
+
+    list_for_each_entry(dir, &tree->table_cache.dirs, cache_node) {
+        if (table_cache_dir_matches(tree, dir, page_size, depth)) {
+            list_del(&dir->cache_node);
+            tree->table_cache.count--;
+            return dir;
+        }
+    }
+
+    if (READ_ONCE(tree->table_cache.reclaimable_count) == 0)
+        return NULL;
+
+    uvm_spin_lock(&g_table_cache.lock);
+
+    list_for_each_entry(dir, &tree->table_cache.reclaimable, cache_node) {
+        if (table_cache_dir_matches(tree, dir, page_size, depth)) {
+            list_del(&dir->cache_node);
+            WRITE_ONCE(tree->table_cache.reclaimable_count, tree->table_cache.reclaimable_count - 1);
+            atomic64_dec(&g_table_cache.reclaimable_count);
+            uvm_spin_unlock(&g_table_cache.lock);
+            return dir;
+        }
+    }
+
+    uvm_spin_unlock(&g_table_cache.lock);
+
+    return NULL;
+}
+
+// Make the cached sysmem directories of the tree reclaimable if all the GPU
+// operations on the tree, including the ones that cleared the directories,
+// have completed.
+static void table_cache_update_reclaimable(uvm_page_tree_t *tree)
+{
+    NvU32 count = tree->table_cache.count;
+
+    uvm_assert_mutex_locked(&tree->lock);
+
+    // Only the directories of sysmem trees are ever reclaimable. Vidmem trees
+    // don't cache their sysmem fallback allocations.
+    if (tree->location != UVM_APERTURE_SYS || count == 0)
+        return;
+
+    if (!uvm_tracker_is_completed(&tree->tracker))
+        return;
+
+    uvm_spin_lock(&g_table_cache.lock);
+
+    list_splice_init(&tree->table_cache.dirs, &tree->table_cache.reclaimable);
+    WRITE_ONCE(tree->table_cache.reclaimable_count, tree->table_cache.reclaimable_count + count);
+    atomic64_add(count, &g_table_cache.reclaimable_count);
+
+    uvm_spin_unlock(&g_table_cache.lock);
+
+    tree->table_cache.count = 0;
+}
+
+// Free all the non-reclaimable directories in the table cache of the tree.
+// Returns whether any directory was freed.
+static bool table_cache_free_dirs(uvm_page_tree_t *tree)
+{
+    uvm_page_directory_t *dir, *next;
+    bool freed = !list_empty(&tree->table_cache.dirs);
+
+    uvm_assert_mutex_locked(&tree->lock);
+
+    list_for_each_entry_safe(dir, next, &tree->table_cache.dirs, cache_node) {
+        list_del(&dir->cache_node);
+        directory_free(tree, dir);
+    }
+
+    tree->table_cache.count = 0;
+
+    return freed;
+}
+
+// Free the cached vidmem directories of the tree so that a failed vidmem
+// allocation can be retried. Returns whether any directory was freed.
+static bool table_cache_trim(uvm_page_tree_t *tree)
+{
+    bool freed;
+
+    if (tree->location != UVM_APERTURE_VID)
+        return false;
+
+    uvm_mutex_lock(&tree->lock);
+    freed = table_cache_free_dirs(tree);
+    uvm_mutex_unlock(&tree->lock);
+
+    return freed;
+}
+
+static void table_cache_init(uvm_page_tree_t *tree)
+{
+    INIT_LIST_HEAD(&tree->table_cache.dirs);
+    INIT_LIST_HEAD(&tree->table_cache.reclaimable);
+    INIT_LIST_HEAD(&tree->table_cache.trees_node);
+    tree->table_cache.max_count = uvm_page_table_cache_size;
+}
+
+static void table_cache_register(uvm_page_tree_t *tree)
+{
+    if (tree->table_cache.max_count == 0)
+        return;
+
+    uvm_spin_lock(&g_table_cache.lock);
+    list_add_tail(&tree->table_cache.trees_node, &g_table_cache.trees);
+    uvm_spin_unlock(&g_table_cache.lock);
+}
+
+static void table_cache_deinit(uvm_page_tree_t *tree)
+{
+    NvU32 reclaimable_count;
+
+    uvm_assert_mutex_locked(&tree->lock);
+
+    uvm_spin_lock(&g_table_cache.lock);
+
+    list_del_init(&tree->table_cache.trees_node);
+
+    reclaimable_count = tree->table_cache.reclaimable_count;
+    list_splice_init(&tree->table_cache.reclaimable, &tree->table_cache.dirs);
+    WRITE_ONCE(tree->table_cache.reclaimable_count, 0);
+    atomic64_sub(reclaimable_count, &g_table_cache.reclaimable_count);
+
+    uvm_spin_unlock(&g_table_cache.lock);
+
+    tree->table_cache.count += reclaimable_count;
+    table_cache_free_dirs(tree);
+}
+
+static unsigned long table_cache_shrinker_count(struct shrinker *shrinker, struct shrink_control *sc)
+{
+    return atomic64_read(&g_table_cache.reclaimable_count);
+}
+
+static unsigned long table_cache_shrinker_count_entry(struct shrinker *shrinker, struct shrink_control *sc)
+{
+    UVM_ENTRY_RET(table_cache_shrinker_count(shrinker, sc));
+}
+
+static unsigned long table_cache_shrinker_scan(struct shrinker *shrinker, struct shrink_control *sc)
+{
+    uvm_page_tree_t *tree;
+    uvm_page_directory_t *dir, *next;
+    unsigned long freed = 0;
+    LIST_HEAD(free_list);
+
+    uvm_spin_lock(&g_table_cache.lock);
+
+    list_for_each_entry(tree, &g_table_cache.trees, table_cache.trees_node) {
+        while (freed < sc->nr_to_scan && !list_empty(&tree->table_cache.reclaimable)) {
+            dir = list_first_entry(&tree->table_cache.reclaimable, uvm_page_directory_t, cache_node);
+            list_move(&dir->cache_node, &free_list);
+            WRITE_ONCE(tree->table_cache.reclaimable_count, tree->table_cache.reclaimable_count - 1);
+
+            // The tree is only guaranteed to stay alive while the lock is
+            // held, so release the memory now. Only the directory itself is
+            // freed after dropping the lock.
+            phys_mem_free_sysmem(tree->gpu, &dir->phys_alloc);
+            freed++;
+        }
+
+        if (freed == sc->nr_to_scan)
+            break;
+    }
+
+    atomic64_sub(freed, &g_table_cache.reclaimable_count);
+
+    uvm_spin_unlock(&g_table_cache.lock);
+
+    list_for_each_entry_safe(dir, next, &free_list, cache_node)
+        uvm_kvfree(dir);
+
+    return freed ? freed : SHRINK_STOP;
+}
+
+static unsigned long table_cache_shrinker_scan_entry(struct shrinker *shrinker, struct shrink_control *sc)
+{
+    UVM_ENTRY_RET(table_cache_shrinker_scan(shrinker, sc));
+}
+
+static NV_STATUS table_cache_shrinker_register(void)
+{
+#if defined(NV_SHRINKER_ALLOC_PRESENT)
+    g_table_cache.shrinker = shrinker_alloc(0, "nvidia-uvm-page-table-cache");
+    if (!g_table_cache.shrinker)
+        return NV_ERR_NO_MEMORY;
+
+    g_table_cache.shrinker->count_objects = table_cache_shrinker_count_entry;
+    g_table_cache.shrinker->scan_objects = table_cache_shrinker_scan_entry;
+    g_table_cache.shrinker->seeks = DEFAULT_SEEKS;
+    shrinker_register(g_table_cache.shrinker);
+#else
+    int ret;
+
+    g_table_cache.shrinker.count_objects = table_cache_shrinker_count_entry;
+    g_table_cache.shrinker.scan_objects = table_cache_shrinker_scan_entry;
+    g_table_cache.shrinker.seeks = DEFAULT_SEEKS;
+
+#if defined(NV_REGISTER_SHRINKER_HAS_FORMAT_ARG)
+    ret = register_shrinker(&g_table_cache.shrinker, "nvidia-uvm-page-table-cache");
+#else
+    ret = register_shrinker(&g_table_cache.shrinker);
+#endif
+    if (ret != 0)
+        return errno_to_nv_status(ret);
+
+    g_table_cache.shrinker_registered = true;
+#endif
+
+    return NV_OK;
+}
+
+static void table_cache_shrinker_unregister(void)
+{
+#if defined(NV_SHRINKER_ALLOC_PRESENT)
+    if (g_table_cache.shrinker) {
+        shrinker_free(g_table_cache.shrinker);
+        g_table_cache.shrinker = NULL;
+    }
+#else
+    if (g_table_cache.shrinker_registered) {
+        unregister_shrinker(&g_table_cache.shrinker);
+        g_table_cache.shrinker_registered = false;
+    }
+#endif
+}
+
+NV_STATUS uvm_mmu_init(void)
+{
+    UVM_ASSERT((page_table_aperture == UVM_APERTURE_VID) ||
+               (page_table_aperture == UVM_APERTURE_SYS) ||
+               (page_table_aperture == UVM_APERTURE_DEFAULT));
+
+    uvm_spin_lock_init(&g_table_cache.lock, UVM_LOCK_ORDER_LEAF);
+    INIT_LIST_HEAD(&g_table_cache.trees);
+    atomic64_set(&g_table_cache.reclaimable_count, 0);
+
+    if (uvm_page_table_location) {
+        // TODO: Bug 1766651: Add modes for testing, e.g. alternating vidmem and
+        //       sysmem etc.
+        if (strcmp(uvm_page_table_location, "vid") == 0) {
+            page_table_aperture = UVM_APERTURE_VID;
+        }
+        else if (strcmp(uvm_page_table_location, "sys") == 0) {
+            page_table_aperture = UVM_APERTURE_SYS;
+        }
+        else {
+            pr_info("Invalid uvm_page_table_location %s. Using %s instead.\n",
+                    uvm_page_table_location,
+                    uvm_aperture_string(page_table_aperture));
+        }
+    }
+
+    if (uvm_page_table_cache_size == 0)
+        return NV_OK;
+
+    return table_cache_shrinker_register();
+}
+
+void uvm_mmu_exit(void)
+{
+    table_cache_shrinker_unregister();
+}
+
 static void page_table_range_init(uvm_page_table_range_t *range,
                                  NvU32 page_size,
                                  uvm_page_directory_t *dir,
@@ -271,6 +623,10 @@ static uvm_page_directory_t *allocate_directory(uvm_page_tree_t *tree,
 
     status = phys_mem_allocate(tree, phys_alloc_size, tree->location, pmm_flags, &dir->phys_alloc);
 
+    // Vidmem held by the table cache of the tree is better spent here
+    if ((status == NV_ERR_NO_MEMORY) && table_cache_trim(tree))
+        status = phys_mem_allocate(tree, phys_alloc_size, tree->location, pmm_flags, &dir->phys_alloc);
+
     // Fall back to sysmem if allocating page tables in vidmem with eviction
     // fails, and the fallback is allowed.
     if ((status == NV_ERR_NO_MEMORY) &&
@@ -285,6 +641,7 @@ static uvm_page_directory_t *allocate_directory(uvm_page_tree_t *tree,
         return NULL;
     }
     dir->depth = depth;
+    dir->page_size = page_size;
 
     return dir;
 }
@@ -479,6 +836,7 @@ static NV_STATUS write_gpu_state(uvm_page_tree_t *tree,
                                  uvm_page_directory_t **dirs_used)
 {
     NvS32 i;
+    NvU32 init_count = 0;
     uvm_push_t push;
     NV_STATUS status;
 
@@ -498,6 +856,13 @@ static NV_STATUS write_gpu_state(uvm_page_tree_t *tree,
     // only do GPU work once all the allocations have succeeded
     // first, zero-out the new allocations
     for (i = 0; i < used_count; i++) {
+        // Directories from the table cache were cleared by the push that
+        // released them, which the tracker acquired above is ordered after.
+        if (dirs_used[i]->phys_alloc_clear) {
+            dirs_used[i]->phys_alloc_clear = false;
+            continue;
+        }
+
         // Appropriate membar will be done after all the writes. Pipelining can
         // be enabled as they are all initializing newly allocated memory that
         // cannot have any writes pending.
@@ -505,6 +870,7 @@ static NV_STATUS write_gpu_state(uvm_page_tree_t *tree,
         uvm_push_set_flag(&push, UVM_PUSH_FLAG_CE_NEXT_MEMBAR_NONE);
 
         phys_mem_init(tree, page_size, dirs_used[i], &push);
+        init_count++;
 
         if (dirs_used[i]->phys_alloc.addr.aperture == UVM_APERTURE_SYS)
             membar_after_writes = UVM_MEMBAR_SYS;
@@ -514,8 +880,10 @@ static NV_STATUS write_gpu_state(uvm_page_tree_t *tree,
     // and the writes of the PDEs pointing to those page tables.
     // The membar can be local if all of the page tables and PDEs are in GPU memory,
     // but must be a sysmembar if any of them are in sysmem.
-    tree->gpu->parent->host_hal->wait_for_idle(&push);
-    uvm_hal_membar(tree->gpu, &push, membar_after_writes);
+    if (init_count > 0) {
+        tree->gpu->parent->host_hal->wait_for_idle(&push);
+        uvm_hal_membar(tree->gpu, &push, membar_after_writes);
+    }
 
     // Reset back to a local membar by default
     membar_after_writes = UVM_MEMBAR_GPU;
@@ -580,8 +948,10 @@ static void free_unused_directories(uvm_page_tree_t *tree,
             }
 
             if (j == used_count) {
-                phys_mem_deallocate(tree, &dir->phys_alloc);
-                uvm_kvfree(dir);
+                if (dir->phys_alloc_clear && table_cache_room(tree) > 0)
+                    table_cache_add(tree, dir);
+                else
+                    directory_free(tree, dir);
             }
         }
     }
@@ -769,6 +1139,12 @@ NV_STATUS uvm_page_tree_init(uvm_gpu_t *gpu,
 
     uvm_tracker_init(&tree->tracker);
 
+    uvm_tlb_batch_begin(tree, &tree->tlb_deferred.batch);
+    uvm_tracker_init(&tree->tlb_deferred.pte_tracker);
+    uvm_tracker_init(&tree->tlb_deferred.tracker);
+
+    table_cache_init(tree);
+
     tree->root = allocate_directory(tree, UVM_PAGE_SIZE_AGNOSTIC, 0, UVM_PMM_ALLOC_FLAGS_EVICT);
 
     if (tree->root == NULL)
@@ -785,7 +1161,13 @@ NV_STATUS uvm_page_tree_init(uvm_gpu_t *gpu,
         return status;
 
     phys_mem_init(tree, UVM_PAGE_SIZE_AGNOSTIC, tree->root, &push);
-    return page_tree_end_and_wait(tree, &push);
+    status = page_tree_end_and_wait(tree, &push);
+    if (status != NV_OK)
+        return status;
+
+    table_cache_register(tree);
+
+    return NV_OK;
 }
 
 void uvm_page_tree_deinit(uvm_page_tree_t *tree)
@@ -821,7 +1203,14 @@ void uvm_page_tree_deinit(uvm_page_tree_t *tree)
         }
     }
 
+    // Deferred TLB invalidates are always flushed by the operation deferring
+    // them, unless pushing the flush failed because of a fatal channel error.
+    UVM_ASSERT(tree->tlb_deferred.batch.count == 0 || uvm_global_get_status() != NV_OK);
+
     (void)uvm_tracker_wait(&tree->tracker);
+    (void)uvm_tracker_wait(&tree->tlb_deferred.pte_tracker);
+    (void)uvm_tracker_wait(&tree->tlb_deferred.tracker);
+    table_cache_deinit(tree);
     phys_mem_deallocate(tree, &tree->root->phys_alloc);
 
     if (tree->gpu->parent->map_remap_larger_page_promotion)
@@ -829,6 +1218,8 @@ void uvm_page_tree_deinit(uvm_page_tree_t *tree)
 
     uvm_mutex_unlock(&tree->lock);
 
+    uvm_tracker_deinit(&tree->tlb_deferred.tracker);
+    uvm_tracker_deinit(&tree->tlb_deferred.pte_tracker);
     uvm_tracker_deinit(&tree->tracker);
     uvm_kvfree(tree->root);
 }
@@ -842,16 +1233,21 @@ void uvm_page_tree_put_ptes_async(uvm_page_tree_t *tree, uvm_page_table_range_t
     uvm_push_t push;
     NV_STATUS status;
     NvU32 invalidate_depth = 0;
+    NvU32 cache_room;
+    NvU32 cache_count = 0;
 
     // The logic of what membar is needed when is pretty subtle, please refer to
     // the UVM Functional Spec (section 5.1) for all the details.
     uvm_membar_t membar_after_pde_clears = UVM_MEMBAR_GPU;
     uvm_membar_t membar_after_invalidate = UVM_MEMBAR_GPU;
+    uvm_membar_t membar_after_table_clears = UVM_MEMBAR_GPU;
 
     UVM_ASSERT(tree->hal->page_table_depth(range->page_size) <= MAX_OPERATION_DEPTH);
 
     uvm_mutex_lock(&tree->lock);
 
+    table_cache_update_reclaimable(tree);
+
     // release the range
     UVM_ASSERT(dir->ref_count >= range->entry_count);
     dir->ref_count -= range->entry_count;
@@ -900,6 +1296,7 @@ void uvm_page_tree_put_ptes_async(uvm_page_tree_t *tree, uvm_page_table_range_t
         // Add this dir to the queue of directories that should be freed once
         // the tracker value of the associated PDE writes is known.
         UVM_ASSERT(free_count < tree->hal->page_table_depth(range->page_size));
+        dir->phys_alloc_clear = false;
         free_queue[free_count++] = dir;
 
         dir = parent;
@@ -917,18 +1314,52 @@ void uvm_page_tree_put_ptes_async(uvm_page_tree_t *tree, uvm_page_table_range_t
                                                     invalidate_depth,
                                                     membar_after_invalidate);
 
+    // Clear the directories going to the table cache now that they can't be
+    // reached by the GPU anymore. Their previous contents are not necessarily
+    // invalid entries, e.g. the caller might have left sparse PTEs behind.
+    cache_room = table_cache_room(tree);
+    for (i = 0; i < free_count && cache_room > 0; i++) {
+        dir = free_queue[i];
+
+        // Sysmem fallback allocations of vidmem trees are not cached
+        if (dir->phys_alloc.addr.aperture != tree->location)
+            continue;
+
+        if (cache_count == 0)
+            tree->gpu->parent->host_hal->wait_for_idle(&push);
+
+        uvm_push_set_flag(&push, UVM_PUSH_FLAG_CE_NEXT_PIPELINED);
+        uvm_push_set_flag(&push, UVM_PUSH_FLAG_CE_NEXT_MEMBAR_NONE);
+        phys_mem_init(tree, dir->page_size, dir, &push);
+
+        if (dir->phys_alloc.addr.aperture == UVM_APERTURE_SYS)
+            membar_after_table_clears = UVM_MEMBAR_SYS;
+
+        dir->phys_alloc_clear = true;
+        cache_room--;
+        cache_count++;
+    }
+
     // We just did the appropriate membar above, no need for another one in push_end().
     // At least currently as if the L2 bypass path changes to only require a GPU
     // membar between PDE write and TLB invalidate, we'll need to push a
     // sysmembar so the end-of-push semaphore is ordered behind the PDE writes.
-    uvm_push_set_flag(&push, UVM_PUSH_FLAG_CE_NEXT_MEMBAR_NONE);
+    // If any directories were cleared, the end-of-push semaphore release
+    // carries the membar that makes the clears visible to future MMU walks.
+    if (cache_count == 0)
+        uvm_push_set_flag(&push, UVM_PUSH_FLAG_CE_NEXT_MEMBAR_NONE);
+    else if (membar_after_table_clears == UVM_MEMBAR_GPU)
+        uvm_push_set_flag(&push, UVM_PUSH_FLAG_CE_NEXT_MEMBAR_GPU);
+
     page_tree_end(tree, &push);
     page_tree_tracker_overwrite_with_push(tree, &push);
 
-    // now that we've traversed all the way up the tree, free everything
+    // now that we've traversed all the way up the tree, cache or free everything
     for (i = 0; i < free_count; i++) {
-        phys_mem_deallocate(tree, &free_queue[i]->phys_alloc);
-        uvm_kvfree(free_queue[i]);
+        if (free_queue[i]->phys_alloc_clear)
+            table_cache_add(tree, free_queue[i]);
+        else
+            directory_free(tree, free_queue[i]);
     }
 
     uvm_mutex_unlock(&tree->lock);
@@ -947,12 +1378,79 @@ NV_STATUS uvm_page_tree_wait(uvm_page_tree_t *tree)
     uvm_mutex_lock(&tree->lock);
 
     status = uvm_tracker_wait(&tree->tracker);
+    if (status == NV_OK)
+        table_cache_update_reclaimable(tree);
 
     uvm_mutex_unlock(&tree->lock);
 
     return status;
 }
 
+void uvm_page_tree_defer_tlb_invalidate(uvm_page_tree_t *tree,
+                                        uvm_tlb_batch_t *batch,
+                                        uvm_push_t *push,
+                                        uvm_membar_t tlb_membar)
+{
+    UVM_ASSERT(batch->tree == tree);
+    UVM_ASSERT(tree->gpu->channel_manager != NULL);
+
+    if (batch->count == 0)
+        return;
+
+    batch->membar = uvm_membar_max(tlb_membar, batch->membar);
+
+    uvm_mutex_lock(&tree->lock);
+
+    uvm_tlb_batch_merge(&tree->tlb_deferred.batch, batch);
+
+    // The flush needs to wait for the PTE writes to complete so that the GPU
+    // can't refill its TLBs with the old PTEs after the invalidate. The safe
+    // variant stalls instead of failing on allocation failures and other
+    // failures are fatal errors surfaced by the flush.
+    (void)uvm_tracker_add_push_safe(&tree->tlb_deferred.pte_tracker, push);
+
+    uvm_mutex_unlock(&tree->lock);
+}
+
+NV_STATUS uvm_page_tree_flush_deferred_tlb_invalidates(uvm_page_tree_t *tree, uvm_tracker_t *out_tracker)
+{
+    NV_STATUS status = NV_OK;
+    uvm_tlb_batch_t *batch = &tree->tlb_deferred.batch;
+    uvm_push_t push;
+
+    uvm_mutex_lock(&tree->lock);
+
+    uvm_tracker_remove_completed(&tree->tlb_deferred.tracker);
+
+    if (batch->count > 0) {
+        status = page_tree_begin_acquire(tree,
+                                         &tree->tlb_deferred.pte_tracker,
+                                         &push,
+                                         "deferred tlb invalidates: %u ranges",
+                                         batch->count);
+        if (status != NV_OK)
+            goto out;
+
+        uvm_tlb_batch_end(batch, &push, UVM_MEMBAR_NONE);
+        page_tree_end(tree, &push);
+
+        uvm_tracker_clear(&tree->tlb_deferred.pte_tracker);
+        uvm_tlb_batch_begin(tree, batch);
+
+        status = uvm_tracker_add_push_safe(&tree->tlb_deferred.tracker, &push);
+        if (status != NV_OK)
+            goto out;
+    }
+
+    if (out_tracker)
+        status = uvm_tracker_add_tracker_safe(out_tracker, &tree->tlb_deferred.tracker);
+
+out:
+    uvm_mutex_unlock(&tree->lock);
+
+    return status;
+}
+
 static NV_STATUS try_get_ptes(uvm_page_tree_t *tree,
                               NvU32 page_size,
                               NvU64 start,
@@ -1117,9 +1615,13 @@ NV_STATUS uvm_page_tree_get_ptes_async(uvm_page_tree_t *tree,
                                   range,
                                   &cur_depth,
                                   dir_cache)) == NV_ERR_MORE_PROCESSING_REQUIRED) {
+        // try_get_ptes never needs depth 0, so store a directory at its parent's depth
+        dir_cache[cur_depth] = table_cache_get(tree, page_size, cur_depth + 1);
+        if (dir_cache[cur_depth] != NULL)
+            continue;
+
         uvm_mutex_unlock(&tree->lock);
 
-        // try_get_ptes never needs depth 0, so store a directory at its parent's depth
         // TODO: Bug 1766655: Allocate everything below cur_depth instead of
         //       retrying for every level.
         dir_cache[cur_depth] = allocate_directory(tree, page_size, cur_depth + 1, pmm_flags);
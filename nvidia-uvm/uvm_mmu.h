@@ -30,6 +30,7 @@
 #include "uvm_types.h"
 #include "uvm_common.h"
 #include "uvm_tracker.h"
+#include "uvm_tlb_batch.h"
 #include "uvm_test_ioctl.h"
 
 // Used when the page size isn't known and should not matter.
@@ -147,6 +148,18 @@ struct uvm_page_directory_struct
     // depth from the root
     NvU32 depth;
 
+    // page size passed to the allocation of the directory, which together with
+    // the depth determines its size and the pattern of its invalid entries
+    NvU32 page_size;
+
+    // whether phys_alloc is known to only contain invalid entries, which is
+    // the case for directories taken from the table cache of the tree
+    bool phys_alloc_clear;
+
+    // node in one of the table cache lists of the tree while the directory is
+    // cached
+    struct list_head cache_node;
+
     // pointers to child directories on the host.
     // this array is variable length, so it needs to be last to allow it to
     // take up extra space
@@ -284,6 +297,43 @@ struct uvm_page_tree_struct
 
     // Tracker for all GPU operations on the tree
     uvm_tracker_t tracker;
+
+    // Cache of free page directories and tables, with their memory already
+    // initialized to invalid entries, reused by uvm_page_tree_get_ptes() before
+    // allocating new ones. See the table cache section of uvm_mmu.c.
+    struct
+    {
+        // Directories that might still be in use by pending GPU operations on
+        // the tree, or that are backed by vidmem. Protected by the tree lock.
+        struct list_head dirs;
+        NvU32 count;
+
+        // Idle sysmem directories that the shrinker can release at any time.
+        // Protected by the global table cache lock.
+        struct list_head reclaimable;
+        NvU32 reclaimable_count;
+
+        // Maximum number of directories in both lists
+        NvU32 max_count;
+
+        // Node in the global list of trees, protected by the global table
+        // cache lock
+        struct list_head trees_node;
+    } table_cache;
+
+    // TLB invalidates deferred with uvm_page_tree_defer_tlb_invalidate(),
+    // protected by the tree lock.
+    struct
+    {
+        // Invalidates queued up and not pushed yet
+        uvm_tlb_batch_t batch;
+
+        // Pushes writing the PTEs covered by the queued up invalidates
+        uvm_tracker_t pte_tracker;
+
+        // Pushes of the invalidates flushed so far
+        uvm_tracker_t tracker;
+    } tlb_deferred;
 };
 
 // A vector of page table ranges
@@ -311,6 +361,9 @@ struct uvm_page_table_range_vec_struct
 // Called at module init
 NV_STATUS uvm_mmu_init(void);
 
+// Called at module exit
+void uvm_mmu_exit(void);
+
 // Initialize MMU-specific information for the GPU/sub-processor
 void uvm_mmu_init_gpu_chunk_sizes(uvm_parent_gpu_t *parent_gpu);
 void uvm_mmu_init_gpu_peer_addresses(uvm_gpu_t *gpu);
@@ -414,6 +467,10 @@ void uvm_page_table_range_shrink(uvm_page_tree_t *tree, uvm_page_table_range_t *
 // Releases the range of PTEs.
 // It is the caller's responsibility to ensure that the empty PTE patterns have
 // already been written in the range passed to the function.
+//
+// Page directories and tables left unused are reinitialized to invalid entries
+// and kept in the table cache of the tree, up to uvm_page_table_cache_size of
+// them, or freed otherwise.
 void uvm_page_tree_put_ptes(uvm_page_tree_t *tree, uvm_page_table_range_t *range);
 
 // Same as uvm_page_tree_put_ptes(), but doesn't synchronize the GPU work.
@@ -424,6 +481,30 @@ void uvm_page_tree_put_ptes_async(uvm_page_tree_t *tree, uvm_page_table_range_t
 // Synchronize any pending operations
 NV_STATUS uvm_page_tree_wait(uvm_page_tree_t *tree);
 
+// Queue up the TLB invalidates of the batch in the tree instead of pushing
+// them, so that unmapping many VA blocks ends up pushing a single invalidate
+// with uvm_page_tree_flush_deferred_tlb_invalidates(). The batch is not ended
+// and the push, which writes the PTEs covered by the batch, has to be already
+// ended.
+//
+// Until the flush, the GPU may keep using the old translations of the covered
+// VAs. The flush has to be pushed, and the tracker it returns acquired, before
+// the memory the old translations point to is freed or reused and before any
+// new mapping of the VAs is made.
+//
+// Locking: acquires the tree lock.
+void uvm_page_tree_defer_tlb_invalidate(uvm_page_tree_t *tree,
+                                        uvm_tlb_batch_t *batch,
+                                        uvm_push_t *push,
+                                        uvm_membar_t tlb_membar);
+
+// Push all the TLB invalidates deferred in the tree with a single batch, if
+// any, and add the pushes of all the invalidates flushed so far, by this call
+// or by a previous one, to out_tracker.
+//
+// Locking: acquires the tree lock.
+NV_STATUS uvm_page_tree_flush_deferred_tlb_invalidates(uvm_page_tree_t *tree, uvm_tracker_t *out_tracker);
+
 // Returns the physical allocation that contains the root directory.
 static uvm_mmu_page_table_alloc_t *uvm_page_tree_pdb(uvm_page_tree_t *tree)
 {
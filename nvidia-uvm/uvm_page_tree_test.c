@@ -576,6 +576,75 @@ static NV_STATUS get_single_page_2m(uvm_gpu_t *gpu)
     return NV_OK;
 }
 
+static NV_STATUS table_cache_reuse(uvm_gpu_t *gpu)
+{
+    uvm_page_tree_t tree;
+    uvm_page_table_range_t range;
+    uvm_page_directory_t *table_64k;
+    uvm_page_directory_t *pde0;
+    NvU32 depth_64k;
+    NvU64 start = 1ULL << 42;
+    NvLength size = 64 * 1024;
+
+    MEM_NV_CHECK_RET(test_page_tree_init(gpu, BIG_PAGE_SIZE_PASCAL, &tree), NV_OK);
+
+    depth_64k = tree.hal->page_table_depth(UVM_PAGE_SIZE_64K);
+    if (tree.table_cache.max_count < 2 * depth_64k) {
+        uvm_page_tree_deinit(&tree);
+        return NV_OK;
+    }
+
+    // The async variants are used as waiting for the tree makes the cached
+    // directories reclaimable, and the shrinker could free them at any time.
+    MEM_NV_CHECK_RET(uvm_page_tree_get_ptes_async(&tree,
+                                                  UVM_PAGE_SIZE_64K,
+                                                  uvm_parent_gpu_canonical_address(gpu->parent, start),
+                                                  size,
+                                                  UVM_PMM_ALLOC_FLAGS_NONE,
+                                                  &range),
+                     NV_OK);
+    table_64k = range.table;
+    pde0 = table_64k->host_parent;
+
+    // All the directories below the root are cached once released
+    uvm_page_tree_put_ptes_async(&tree, &range);
+    TEST_CHECK_RET(tree.table_cache.count == depth_64k);
+    TEST_CHECK_RET(tree.root->entries[0] == NULL);
+
+    // Getting the same range again reuses all of them
+    MEM_NV_CHECK_RET(uvm_page_tree_get_ptes_async(&tree,
+                                                  UVM_PAGE_SIZE_64K,
+                                                  uvm_parent_gpu_canonical_address(gpu->parent, start),
+                                                  size,
+                                                  UVM_PMM_ALLOC_FLAGS_NONE,
+                                                  &range),
+                     NV_OK);
+    TEST_CHECK_RET(range.table == table_64k);
+    TEST_CHECK_RET(range.table->host_parent == pde0);
+    TEST_CHECK_RET(!range.table->phys_alloc_clear);
+    TEST_CHECK_RET(tree.table_cache.count == 0);
+
+    // 4K PTEs share the directories above the page tables, but not the
+    // 64K page table itself
+    uvm_page_tree_put_ptes_async(&tree, &range);
+    MEM_NV_CHECK_RET(uvm_page_tree_get_ptes_async(&tree,
+                                                  UVM_PAGE_SIZE_4K,
+                                                  uvm_parent_gpu_canonical_address(gpu->parent, start),
+                                                  UVM_PAGE_SIZE_4K,
+                                                  UVM_PMM_ALLOC_FLAGS_NONE,
+                                                  &range),
+                     NV_OK);
+    TEST_CHECK_RET(range.table != table_64k);
+    TEST_CHECK_RET(range.table->host_parent == pde0);
+    TEST_CHECK_RET(tree.table_cache.count == 1);
+
+    uvm_page_tree_put_ptes(&tree, &range);
+    TEST_CHECK_RET(tree.root->ref_count == 0);
+    uvm_page_tree_deinit(&tree);
+
+    return NV_OK;
+}
+
 static NV_STATUS alloc_512m_memory(uvm_gpu_t *gpu)
 {
     uvm_page_tree_t tree;
@@ -1166,6 +1235,77 @@ done:
     return status;
 }
 
+// Merge the batches of unmapping neighboring 2M blocks, like deferring the TLB
+// invalidates of a VA range unmap does, and check that they are pushed as a
+// single invalidate.
+static NV_STATUS test_tlb_batch_merge(uvm_gpu_t *gpu)
+{
+    NV_STATUS status = NV_OK;
+    uvm_page_tree_t tree;
+    uvm_push_t push;
+    uvm_tlb_batch_t batch;
+    uvm_tlb_batch_t merged;
+    NvU32 page_sizes = UVM_PAGE_SIZE_4K | UVM_PAGE_SIZE_2M;
+    NvU64 total_pages = 3 * (UVM_PAGE_SIZE_2M / UVM_PAGE_SIZE_4K);
+    bool allow_inval_all = (total_pages > gpu->parent->tlb_batch.max_pages) ||
+                           !gpu->parent->tlb_batch.va_invalidate_supported;
+    NvU32 depth;
+    int i;
+
+    MEM_NV_CHECK_RET(test_page_tree_init(gpu, BIG_PAGE_SIZE_PASCAL, &tree), NV_OK);
+
+    // Both the targeted invalidates and invalidate all use the depth of the
+    // biggest page size
+    depth = tree.hal->page_table_depth(UVM_PAGE_SIZE_2M);
+
+    TEST_NV_CHECK_GOTO(uvm_push_begin_fake(gpu, &push), done);
+
+    fake_tlb_invals_enable();
+
+    // Contiguous ranges are coalesced, and the membar is kept
+    uvm_tlb_batch_begin(&tree, &merged);
+    for (i = 0; i < 3; ++i) {
+        uvm_tlb_batch_begin(&tree, &batch);
+        uvm_tlb_batch_invalidate(&batch, (NvU64)i * UVM_PAGE_SIZE_2M, UVM_PAGE_SIZE_2M, page_sizes, UVM_MEMBAR_GPU);
+        uvm_tlb_batch_merge(&merged, &batch);
+    }
+    uvm_tlb_batch_end(&merged, &push, UVM_MEMBAR_NONE);
+
+    TEST_CHECK_GOTO(g_fake_invals_count == 1, out);
+    TEST_CHECK_GOTO(assert_invalidate_range(0,
+                                            3 * UVM_PAGE_SIZE_2M,
+                                            UVM_PAGE_SIZE_4K,
+                                            allow_inval_all,
+                                            depth,
+                                            depth,
+                                            true), out);
+    TEST_CHECK_GOTO(assert_and_reset_last_invalidate(depth, true), out);
+
+    // Merging a batch which fell back to invalidate all makes the merged batch
+    // fall back too
+    uvm_tlb_batch_begin(&tree, &merged);
+    uvm_tlb_batch_begin(&tree, &batch);
+    for (i = 0; i < UVM_TLB_BATCH_MAX_ENTRIES + 1; ++i)
+        uvm_tlb_batch_invalidate(&batch, (NvU64)i * 2 * UVM_PAGE_SIZE_2M, UVM_PAGE_SIZE_2M, page_sizes, UVM_MEMBAR_NONE);
+    uvm_tlb_batch_merge(&merged, &batch);
+
+    uvm_tlb_batch_begin(&tree, &batch);
+    uvm_tlb_batch_invalidate(&batch, UVM_PAGE_SIZE_2M, UVM_PAGE_SIZE_2M, page_sizes, UVM_MEMBAR_NONE);
+    uvm_tlb_batch_merge(&merged, &batch);
+    uvm_tlb_batch_end(&merged, &push, UVM_MEMBAR_NONE);
+
+    TEST_CHECK_GOTO(assert_last_invalidate_all(depth, false), out);
+
+out:
+    fake_tlb_invals_disable();
+    uvm_push_end_fake(&push);
+
+done:
+    uvm_page_tree_deinit(&tree);
+
+    return status;
+}
+
 typedef struct
 {
     NvU64 count;
@@ -2182,6 +2322,7 @@ static NV_STATUS pascal_test_page_tree(uvm_gpu_t *pascal)
     MEM_NV_CHECK_RET(allocate_then_free_all_16_64k(pascal), NV_OK);
     MEM_NV_CHECK_RET(allocate_then_free_8_8_64k(pascal), NV_OK);
     MEM_NV_CHECK_RET(get_single_page_2m(pascal), NV_OK);
+    MEM_NV_CHECK_RET(table_cache_reuse(pascal), NV_OK);
     MEM_NV_CHECK_RET(get_entire_table_4k(pascal), NV_OK);
     MEM_NV_CHECK_RET(split_4k_from_2m(pascal), NV_OK);
     MEM_NV_CHECK_RET(get_512mb_range(pascal), NV_OK);
@@ -2206,6 +2347,8 @@ static NV_STATUS pascal_test_page_tree(uvm_gpu_t *pascal)
     MEM_NV_CHECK_RET(test_tlb_batch_invalidates(pascal, page_sizes, num_page_sizes), NV_OK);
     pascal->parent->tlb_batch.va_invalidate_supported = true;
 
+    MEM_NV_CHECK_RET(test_tlb_batch_merge(pascal), NV_OK);
+
     for (i = 0; i < num_page_sizes; i++) {
         MEM_NV_CHECK_RET(shrink_test(pascal, BIG_PAGE_SIZE_PASCAL, page_sizes[i]), NV_OK);
         MEM_NV_CHECK_RET(get_upper_test(pascal, BIG_PAGE_SIZE_PASCAL, page_sizes[i]), NV_OK);
@@ -95,14 +95,14 @@ void uvm_perf_module_unload(uvm_perf_module_t *module, uvm_va_space_t *va_space)
             continue;
 
         for_each_va_block_in_va_range(va_range, block) {
-            uvm_mutex_lock(&block->lock);
+            uvm_va_block_lock(block);
 
             // Notify a fake va_block destruction to destroy the module-allocated data
             event_data.module_unload.block = block;
             event_data.module_unload.range = NULL;
             uvm_perf_event_notify(&va_space->perf_events, UVM_PERF_EVENT_MODULE_UNLOAD, &event_data);
 
-            uvm_mutex_unlock(&block->lock);
+            uvm_va_block_unlock(block);
         }
         // Notify a fake va_range destruction to destroy the module-allocated data
         event_data.module_unload.block = NULL;
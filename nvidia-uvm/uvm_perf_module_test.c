@@ -188,16 +188,16 @@ static NV_STATUS test_module_replace(uvm_va_space_t *va_space, NvU64 addr)
 
     // Notify (fake) page fault on block1
     event_data.fault.block = block1;
-    uvm_mutex_lock(&block1->lock);
+    uvm_va_block_lock(block1);
     uvm_perf_event_notify(&va_space->perf_events, UVM_PERF_EVENT_FAULT, &event_data);
-    uvm_mutex_unlock(&block1->lock);
+    uvm_va_block_unlock(block1);
 
     // Notify two (fake) page faults on block2
     event_data.fault.block = block2;
-    uvm_mutex_lock(&block2->lock);
+    uvm_va_block_lock(block2);
     uvm_perf_event_notify(&va_space->perf_events, UVM_PERF_EVENT_FAULT, &event_data);
     uvm_perf_event_notify(&va_space->perf_events, UVM_PERF_EVENT_FAULT, &event_data);
-    uvm_mutex_unlock(&block2->lock);
+    uvm_va_block_unlock(block2);
 
     module1_data = uvm_perf_module_type_data(block1->perf_modules_data, module1.type);
     if (module1_data)
@@ -219,16 +219,16 @@ static NV_STATUS test_module_replace(uvm_va_space_t *va_space, NvU64 addr)
 
     // Notify two (fake) page faults on block1
     event_data.fault.block = block1;
-    uvm_mutex_lock(&block1->lock);
+    uvm_va_block_lock(block1);
     uvm_perf_event_notify(&va_space->perf_events, UVM_PERF_EVENT_FAULT, &event_data);
     uvm_perf_event_notify(&va_space->perf_events, UVM_PERF_EVENT_FAULT, &event_data);
-    uvm_mutex_unlock(&block1->lock);
+    uvm_va_block_unlock(block1);
 
     // Notify (fake) page fault on block2
     event_data.fault.block = block2;
-    uvm_mutex_lock(&block2->lock);
+    uvm_va_block_lock(block2);
     uvm_perf_event_notify(&va_space->perf_events, UVM_PERF_EVENT_FAULT, &event_data);
-    uvm_mutex_unlock(&block2->lock);
+    uvm_va_block_unlock(block2);
 
     module2_data = uvm_perf_module_type_data(block1->perf_modules_data, module2.type);
     if (module2_data) {
@@ -1832,7 +1832,7 @@ static void thrashing_unpin_pages(struct work_struct *work)
             break;
 
         va_block = pinned_page->va_block;
-        uvm_mutex_lock(&va_block->lock);
+        uvm_va_block_lock(va_block);
 
         // Only operate if the pinned page's tracking state isn't already
         // cleared by thrashing_unpin_page()
@@ -1849,7 +1849,7 @@ static void thrashing_unpin_pages(struct work_struct *work)
             thrashing_reset_page(va_space_thrashing, va_block, block_thrashing, page_index);
         }
 
-        uvm_mutex_unlock(&va_block->lock);
+        uvm_va_block_unlock(va_block);
         kmem_cache_free(g_pinned_page_cache, pinned_page);
     }
 
@@ -2082,7 +2082,7 @@ NV_STATUS uvm_test_set_page_thrashing_policy(UVM_TEST_SET_PAGE_THRASHING_POLICY_
                 uvm_va_block_region_t va_block_region = uvm_va_block_region_from_block(va_block);
                 uvm_va_block_context_t *block_context = uvm_va_space_block_context(va_space, NULL);
 
-                uvm_mutex_lock(&va_block->lock);
+                uvm_va_block_lock(va_block);
 
                 // Unmap may split PTEs and require a retry. Needs to be called
                 // before the pinned pages information is destroyed.
@@ -2094,7 +2094,7 @@ NV_STATUS uvm_test_set_page_thrashing_policy(UVM_TEST_SET_PAGE_THRASHING_POLICY_
 
                 thrashing_info_destroy(va_block);
 
-                uvm_mutex_unlock(&va_block->lock);
+                uvm_va_block_unlock(va_block);
 
                 // Re-enable thrashing on failure to avoid getting asserts
                 // about having state while thrashing is disabled
@@ -171,6 +171,7 @@
 #include "uvm_va_space.h"
 #include "uvm_va_block.h"
 #include "uvm_test.h"
+#include "uvm_test_rng.h"
 #include "uvm_linux.h"
 
 
@@ -188,6 +189,21 @@ MODULE_PARM_DESC(uvm_global_oversubscription, "Enable (1) or disable (0) global
 static unsigned uvm_perf_pma_batch_nonpinned_order = UVM_PERF_PMA_BATCH_NONPINNED_ORDER_DEFAULT;
 module_param(uvm_perf_pma_batch_nonpinned_order, uint, S_IRUGO);
 
+#define UVM_PERF_PMA_RESERVE_LOW_DEFAULT  16
+#define UVM_PERF_PMA_RESERVE_HIGH_DEFAULT 64
+
+// Free non-pinned root chunks are not returned to PMA as soon as they are
+// freed. Instead, up to uvm_perf_pma_reserve_high of them are kept in the free
+// lists as a per-GPU reserve. Once the reserve grows past the high mark, it is
+// trimmed down to uvm_perf_pma_reserve_low root chunks with batched calls into
+// PMA. Root chunks in the reserve can still be reclaimed by PMA through
+// eviction. A high mark of 0 disables the reserve.
+static unsigned uvm_perf_pma_reserve_low = UVM_PERF_PMA_RESERVE_LOW_DEFAULT;
+module_param(uvm_perf_pma_reserve_low, uint, S_IRUGO);
+
+static unsigned uvm_perf_pma_reserve_high = UVM_PERF_PMA_RESERVE_HIGH_DEFAULT;
+module_param(uvm_perf_pma_reserve_high, uint, S_IRUGO);
+
 // Helper type for refcounting cache
 typedef struct
 {
@@ -321,6 +337,7 @@ static NV_STATUS split_gpu_chunk(uvm_pmm_gpu_t *pmm, uvm_gpu_chunk_t *chunk);
 static void free_chunk(uvm_pmm_gpu_t *pmm, uvm_gpu_chunk_t *chunk);
 static void free_chunk_with_merges(uvm_pmm_gpu_t *pmm, uvm_gpu_chunk_t *chunk);
 static bool free_next_available_root_chunk(uvm_pmm_gpu_t *pmm, uvm_pmm_gpu_memory_type_t type);
+static void trim_root_chunk_reserve(uvm_pmm_gpu_t *pmm, uvm_pmm_gpu_memory_type_t type);
 static struct list_head *find_free_list(uvm_pmm_gpu_t *pmm,
                                         uvm_pmm_gpu_memory_type_t type,
                                         uvm_chunk_size_t chunk_size,
@@ -351,6 +368,26 @@ static void root_chunk_unlock(uvm_pmm_gpu_t *pmm, uvm_gpu_root_chunk_t *root_chu
     uvm_bit_unlock(&pmm->root_chunks.bitlocks, root_chunk_index(pmm, root_chunk));
 }
 
+// Lock and unlock the PMM lock, tracking how long it is held for in the PMM
+// stats.
+static void pmm_lock(uvm_pmm_gpu_t *pmm)
+{
+    uvm_mutex_lock(&pmm->lock);
+
+    ++pmm->stats.lock_acquisitions;
+    pmm->stats.lock_acquired_ns = NV_GETTIME();
+}
+
+static void pmm_unlock(uvm_pmm_gpu_t *pmm)
+{
+    NvU64 hold_ns = NV_GETTIME() - pmm->stats.lock_acquired_ns;
+
+    pmm->stats.lock_hold_total_ns += hold_ns;
+    pmm->stats.lock_hold_max_ns = max(pmm->stats.lock_hold_max_ns, hold_ns);
+
+    uvm_mutex_unlock(&pmm->lock);
+}
+
 // TODO: Bug 1795559: Remove once PMA eviction is considered safe enough not to
 // have an opt-out.
 static bool gpu_supports_pma_eviction(uvm_gpu_t *gpu)
@@ -823,6 +860,8 @@ static void merge_gpu_chunk(uvm_pmm_gpu_t *pmm, uvm_gpu_chunk_t *chunk)
     uvm_assert_mutex_locked(&pmm->lock);
     UVM_ASSERT(assert_chunk_mergeable(pmm, chunk));
 
+    atomic64_inc(&pmm->stats.num_merges);
+
     // Transition the chunk state under the list lock first and then clean up
     // the subchunk state.
     uvm_spin_lock(&pmm->list_lock);
@@ -1070,7 +1109,7 @@ NV_STATUS uvm_pmm_gpu_split_chunk(uvm_pmm_gpu_t *pmm,
     UVM_ASSERT(subchunk_size & pmm->chunk_sizes[chunk->type]);
     UVM_ASSERT(subchunk_size < uvm_gpu_chunk_get_size(chunk));
 
-    uvm_mutex_lock(&pmm->lock);
+    pmm_lock(pmm);
 
     UVM_ASSERT(chunk->state == UVM_PMM_GPU_CHUNK_STATE_ALLOCATED ||
                chunk->state == UVM_PMM_GPU_CHUNK_STATE_TEMP_PINNED);
@@ -1095,7 +1134,7 @@ NV_STATUS uvm_pmm_gpu_split_chunk(uvm_pmm_gpu_t *pmm,
         UVM_ASSERT(walk_args.num_subchunks_curr == walk_args.num_subchunks_total);
     }
 
-    uvm_mutex_unlock(&pmm->lock);
+    pmm_unlock(pmm);
     return status;
 }
 
@@ -1157,7 +1196,7 @@ size_t uvm_pmm_gpu_get_subchunks(uvm_pmm_gpu_t *pmm,
                parent->state == UVM_PMM_GPU_CHUNK_STATE_TEMP_PINNED ||
                parent->state == UVM_PMM_GPU_CHUNK_STATE_IS_SPLIT);
 
-    uvm_mutex_lock(&pmm->lock);
+    pmm_lock(pmm);
 
     // Either pre- or post-order would work. Pick post-order just because we
     // only care about leaf chunks and we may exit early, so we'd get slightly
@@ -1168,7 +1207,7 @@ size_t uvm_pmm_gpu_get_subchunks(uvm_pmm_gpu_t *pmm,
         UVM_ASSERT(walk_args.num_written == walk_args.num_to_write);
     }
 
-    uvm_mutex_unlock(&pmm->lock);
+    pmm_unlock(pmm);
     return walk_args.num_written;
 }
 
@@ -1179,9 +1218,9 @@ static uvm_gpu_chunk_t *list_first_chunk(struct list_head *list)
 
 void uvm_pmm_gpu_merge_chunk(uvm_pmm_gpu_t *pmm, uvm_gpu_chunk_t *chunk)
 {
-    uvm_mutex_lock(&pmm->lock);
+    pmm_lock(pmm);
     uvm_pmm_gpu_merge_chunk_locked(pmm, chunk);
-    uvm_mutex_unlock(&pmm->lock);
+    pmm_unlock(pmm);
 }
 
 static void root_chunk_unmap_indirect_peer(uvm_pmm_gpu_t *pmm, uvm_gpu_root_chunk_t *root_chunk, uvm_gpu_t *other_gpu)
@@ -1427,13 +1466,13 @@ static NV_STATUS evict_root_chunk_from_va_block(uvm_pmm_gpu_t *pmm, uvm_gpu_root
 
     // To evict the chunks from the VA block we need to lock it, but we already
     // have the PMM lock held. Unlock it first and re-lock it after.
-    uvm_mutex_unlock(&pmm->lock);
+    pmm_unlock(pmm);
 
-    uvm_mutex_lock(&va_block->lock);
+    uvm_va_block_lock(va_block);
 
     status = uvm_va_block_evict_chunks(va_block, pmm->gpu, &root_chunk->chunk, &tracker);
 
-    uvm_mutex_unlock(&va_block->lock);
+    uvm_va_block_unlock(va_block);
 
     // The block has been retained by find_and_retain_va_block_to_evict(),
     // release it here as it's not needed any more. Notably do that even if
@@ -1448,7 +1487,7 @@ static NV_STATUS evict_root_chunk_from_va_block(uvm_pmm_gpu_t *pmm, uvm_gpu_root
 
     uvm_tracker_deinit(&tracker);
 
-    uvm_mutex_lock(&pmm->lock);
+    pmm_lock(pmm);
 
     return status;
 }
@@ -1607,6 +1646,8 @@ static NV_STATUS evict_root_chunk(uvm_pmm_gpu_t *pmm, uvm_gpu_root_chunk_t *root
 
     UVM_ASSERT(check_chunk(pmm, chunk));
 
+    atomic64_inc(&pmm->stats.num_evictions);
+
     return NV_OK;
 
 error:
@@ -1943,9 +1984,9 @@ static NV_STATUS alloc_or_evict_root_chunk_unlocked(uvm_pmm_gpu_t *pmm,
     status = alloc_root_chunk(pmm, type, flags, &chunk);
     if (status != NV_OK) {
         if ((flags & UVM_PMM_ALLOC_FLAGS_EVICT) && uvm_gpu_supports_eviction(pmm->gpu)) {
-            uvm_mutex_lock(&pmm->lock);
+            pmm_lock(pmm);
             status = pick_and_evict_root_chunk_retry(pmm, type, PMM_CONTEXT_DEFAULT, chunk_out);
-            uvm_mutex_unlock(&pmm->lock);
+            pmm_unlock(pmm);
         }
 
         return status;
@@ -2073,11 +2114,11 @@ NV_STATUS alloc_chunk(uvm_pmm_gpu_t *pmm,
     }
 
     // We didn't find a free chunk and we will require splits so acquire the PMM lock.
-    uvm_mutex_lock(&pmm->lock);
+    pmm_lock(pmm);
 
     status = alloc_chunk_with_splits(pmm, type, chunk_size, flags, &chunk);
 
-    uvm_mutex_unlock(&pmm->lock);
+    pmm_unlock(pmm);
 
     if (status != NV_OK) {
         (void)free_next_available_root_chunk(pmm, type);
@@ -2150,6 +2191,7 @@ NV_STATUS alloc_root_chunk(uvm_pmm_gpu_t *pmm,
     bool used_kmem_cache = false;
     UvmGpuPointer pa;
     UvmGpuPointer *pas;
+    NvU64 pma_start;
 
     // TODO: Bug 2444368: On P9 systems, PMA scrubbing is very slow. For now,
     // zero the chunk within UVM. Re-evaluate this condition once PMA scrubbing
@@ -2210,7 +2252,9 @@ NV_STATUS alloc_root_chunk(uvm_pmm_gpu_t *pmm,
     // flush out any pending allocs.
     uvm_down_read(&pmm->pma_lock);
 
+    pma_start = NV_GETTIME();
     status = nvUvmInterfacePmaAllocPages(pmm->pma, num_chunks, UVM_CHUNK_SIZE_MAX, &options, pas);
+    atomic64_add(NV_GETTIME() - pma_start, &pmm->stats.pma_alloc_ns);
     if (status != NV_OK)
         goto exit_unlock;
 
@@ -2222,6 +2266,9 @@ NV_STATUS alloc_root_chunk(uvm_pmm_gpu_t *pmm,
         num_chunks = options.numPagesAllocated;
     }
 
+    atomic64_inc(&pmm->stats.num_pma_alloc_calls);
+    atomic64_add(num_chunks, &pmm->stats.num_pma_alloc_chunks);
+
     for (i = 0; i < num_chunks; ++i) {
         uvm_pmm_gpu_chunk_state_t initial_state;
         uvm_gpu_root_chunk_t *root_chunk = root_chunk_from_address(pmm, pas[i]);
@@ -2254,15 +2301,14 @@ exit_unlock:
     return status;
 }
 
-void free_root_chunk(uvm_pmm_gpu_t *pmm, uvm_gpu_root_chunk_t *root_chunk, free_root_chunk_mode_t free_mode)
+// Transition a pinned root chunk that is about to be returned to PMA into the
+// PMA owned state. The PMA lock has to be held for read.
+static void root_chunk_prepare_pma_free(uvm_pmm_gpu_t *pmm, uvm_gpu_root_chunk_t *root_chunk)
 {
     NV_STATUS status;
     uvm_gpu_chunk_t *chunk = &root_chunk->chunk;
-    NvU32 flags = 0;
 
-    // Acquire the PMA lock for read so that uvm_pmm_gpu_pma_evict_range() can
-    // flush out any pending frees.
-    uvm_down_read(&pmm->pma_lock);
+    uvm_assert_rwsem_locked_read(&pmm->pma_lock);
 
     root_chunk_lock(pmm, root_chunk);
 
@@ -2288,6 +2334,19 @@ void free_root_chunk(uvm_pmm_gpu_t *pmm, uvm_gpu_root_chunk_t *root_chunk, free_
     uvm_spin_unlock(&pmm->list_lock);
 
     root_chunk_unlock(pmm, root_chunk);
+}
+
+void free_root_chunk(uvm_pmm_gpu_t *pmm, uvm_gpu_root_chunk_t *root_chunk, free_root_chunk_mode_t free_mode)
+{
+    uvm_gpu_chunk_t *chunk = &root_chunk->chunk;
+    NvU32 flags = 0;
+    NvU64 pma_start;
+
+    // Acquire the PMA lock for read so that uvm_pmm_gpu_pma_evict_range() can
+    // flush out any pending frees.
+    uvm_down_read(&pmm->pma_lock);
+
+    root_chunk_prepare_pma_free(pmm, root_chunk);
 
     if (free_mode == FREE_ROOT_CHUNK_MODE_SKIP_PMA_FREE) {
         uvm_up_read(&pmm->pma_lock);
@@ -2300,7 +2359,12 @@ void free_root_chunk(uvm_pmm_gpu_t *pmm, uvm_gpu_root_chunk_t *root_chunk, free_
     if (chunk->is_zero)
         flags |= UVM_PMA_FREE_IS_ZERO;
 
+    pma_start = NV_GETTIME();
     nvUvmInterfacePmaFreePages(pmm->pma, &chunk->address, 1, UVM_CHUNK_SIZE_MAX, flags);
+    atomic64_add(NV_GETTIME() - pma_start, &pmm->stats.pma_free_ns);
+
+    atomic64_inc(&pmm->stats.num_pma_free_calls);
+    atomic64_inc(&pmm->stats.num_pma_free_chunks);
 
     uvm_up_read(&pmm->pma_lock);
 }
@@ -2402,6 +2466,8 @@ NV_STATUS split_gpu_chunk(uvm_pmm_gpu_t *pmm, uvm_gpu_chunk_t *chunk)
 
     uvm_spin_unlock(&pmm->list_lock);
 
+    atomic64_inc(&pmm->stats.num_splits);
+
     return NV_OK;
 cleanup:
     for (i = 0; i < num_sub; i++) {
@@ -2655,20 +2721,21 @@ static void free_chunk(uvm_pmm_gpu_t *pmm, uvm_gpu_chunk_t *chunk)
     else {
         // Freeing a chunk can only fail if it requires merging. Take the PMM lock
         // and free it with merges supported.
-        uvm_mutex_lock(&pmm->lock);
+        pmm_lock(pmm);
         free_chunk_with_merges(pmm, chunk);
-        uvm_mutex_unlock(&pmm->lock);
+        pmm_unlock(pmm);
     }
 
     // Once try_chunk_free succeeds or free_chunk_with_merges returns, it's no
     // longer safe to access chunk in general. All you know is that the
     // chunk you freed was put on the free list by the call. Since the spin lock
     // has been dropped, any other thread could have come in and allocated the
-    // chunk in the meantime. Therefore, this next step just looks for a
-    // root chunk to free, without assuming that one is actually there.
+    // chunk in the meantime. Therefore, this next step just looks for root
+    // chunks to free past the reserve, without assuming that one is actually
+    // there.
 
     if (try_free)
-        (void)free_next_available_root_chunk(pmm, type);
+        trim_root_chunk_reserve(pmm, type);
 }
 
 // Finds and frees the next root chunk of the given type (if any) that can be
@@ -2716,6 +2783,149 @@ bool free_next_available_root_chunk(uvm_pmm_gpu_t *pmm, uvm_pmm_gpu_memory_type_
     return false;
 }
 
+// Returns up to max_chunks free root chunks of the given type to PMA, batching
+// all the root chunks of the same zero type into a single PMA call. At most
+// (1 << uvm_perf_pma_batch_nonpinned_order) root chunks are freed per call to
+// this function. Returns the number of root chunks freed.
+static size_t free_root_chunks_batched(uvm_pmm_gpu_t *pmm, uvm_pmm_gpu_memory_type_t type, size_t max_chunks)
+{
+    // Prefer non-zero free chunks as memory is about to be released to PMA
+    const uvm_pmm_list_zero_t zero_types[] = { UVM_PMM_LIST_NO_ZERO, UVM_PMM_LIST_ZERO };
+    UvmGpuPointer *pas;
+    size_t num_freed = 0;
+    size_t i;
+    NvU64 pma_start;
+
+    UVM_ASSERT(uvm_chunk_find_last_size(pmm->chunk_sizes[type]) == UVM_CHUNK_SIZE_MAX);
+
+    max_chunks = min(max_chunks, (size_t)1 << uvm_perf_pma_batch_nonpinned_order);
+    if (max_chunks == 0)
+        return 0;
+
+    pas = kmem_cache_alloc(g_pma_address_batch_cache_ref.cache, NV_UVM_GFP_FLAGS);
+    if (!pas)
+        return free_next_available_root_chunk(pmm, type) ? 1 : 0;
+
+    for (i = 0; i < ARRAY_SIZE(zero_types) && num_freed < max_chunks; ++i) {
+        struct list_head *free_list = find_free_list(pmm, type, UVM_CHUNK_SIZE_MAX, zero_types[i]);
+        size_t num_chunks = 0;
+        NvU32 flags = 0;
+        size_t j;
+
+        uvm_spin_lock(&pmm->list_lock);
+
+        while (num_freed + num_chunks < max_chunks) {
+            uvm_gpu_chunk_t *chunk = list_first_chunk(free_list);
+            if (!chunk)
+                break;
+
+            list_del_init(&chunk->list);
+            UVM_ASSERT(chunk->state == UVM_PMM_GPU_CHUNK_STATE_FREE);
+            UVM_ASSERT(uvm_gpu_chunk_get_size(chunk) == UVM_CHUNK_SIZE_MAX);
+            UVM_ASSERT(chunk->type == type);
+            UVM_ASSERT(chunk->is_zero == (zero_types[i] == UVM_PMM_LIST_ZERO));
+
+            // Pin the chunk to protect it from eviction by physical address
+            // once the list lock is dropped. See
+            // free_next_available_root_chunk().
+            chunk_pin(pmm, chunk);
+
+            pas[num_chunks++] = chunk->address;
+        }
+
+        uvm_spin_unlock(&pmm->list_lock);
+
+        if (num_chunks == 0)
+            continue;
+
+        // Acquire the PMA lock for read so that uvm_pmm_gpu_pma_evict_range()
+        // can flush out any pending frees.
+        uvm_down_read(&pmm->pma_lock);
+
+        for (j = 0; j < num_chunks; ++j)
+            root_chunk_prepare_pma_free(pmm, root_chunk_from_address(pmm, pas[j]));
+
+        if (zero_types[i] == UVM_PMM_LIST_ZERO)
+            flags |= UVM_PMA_FREE_IS_ZERO;
+
+        pma_start = NV_GETTIME();
+        nvUvmInterfacePmaFreePages(pmm->pma, pas, num_chunks, UVM_CHUNK_SIZE_MAX, flags);
+        atomic64_add(NV_GETTIME() - pma_start, &pmm->stats.pma_free_ns);
+
+        atomic64_inc(&pmm->stats.num_pma_free_calls);
+        atomic64_add(num_chunks, &pmm->stats.num_pma_free_chunks);
+
+        uvm_up_read(&pmm->pma_lock);
+
+        num_freed += num_chunks;
+    }
+
+    kmem_cache_free(g_pma_address_batch_cache_ref.cache, pas);
+
+    return num_freed;
+}
+
+static bool root_chunk_reserve_enabled(uvm_pmm_gpu_t *pmm, uvm_pmm_gpu_memory_type_t type)
+{
+    // Only non-pinned root chunks can be held back from PMA, as PMA can still
+    // reclaim them through eviction. Batching is disabled on NUMA-enabled GPUs
+    // so do the same for the reserve.
+    return uvm_perf_pma_reserve_high > 0 &&
+           memory_type_is_user(type) &&
+           gpu_supports_pma_eviction(pmm->gpu) &&
+           !pmm->gpu->parent->numa_info.enabled;
+}
+
+// Count the free root chunks of the given type, stopping at max_count
+static size_t count_free_root_chunks(uvm_pmm_gpu_t *pmm, uvm_pmm_gpu_memory_type_t type, size_t max_count)
+{
+    uvm_pmm_list_zero_t zero_type;
+    size_t count = 0;
+
+    uvm_spin_lock(&pmm->list_lock);
+
+    for (zero_type = 0; zero_type < UVM_PMM_LIST_ZERO_COUNT && count < max_count; ++zero_type) {
+        struct list_head *entry;
+
+        list_for_each(entry, find_free_list(pmm, type, UVM_CHUNK_SIZE_MAX, zero_type)) {
+            if (++count == max_count)
+                break;
+        }
+    }
+
+    uvm_spin_unlock(&pmm->list_lock);
+
+    return count;
+}
+
+// Return free root chunks of the given type to PMA once they exceed the
+// reserve's high mark, trimming the reserve down to its low mark. If the
+// reserve is disabled, a single free root chunk (if any) is returned.
+static void trim_root_chunk_reserve(uvm_pmm_gpu_t *pmm, uvm_pmm_gpu_memory_type_t type)
+{
+    const size_t high = uvm_perf_pma_reserve_high;
+    const size_t low = min(uvm_perf_pma_reserve_low, uvm_perf_pma_reserve_high);
+    size_t num_free;
+
+    if (!root_chunk_reserve_enabled(pmm, type)) {
+        (void)free_next_available_root_chunk(pmm, type);
+        return;
+    }
+
+    num_free = count_free_root_chunks(pmm, type, high + 1);
+    if (num_free <= high)
+        return;
+
+    // The count is capped at high + 1, so keep freeing until the reserve is
+    // down to the low mark.
+    while (num_free > low) {
+        if (free_root_chunks_batched(pmm, type, num_free - low) == 0)
+            break;
+
+        num_free = count_free_root_chunks(pmm, type, high + 1);
+    }
+}
+
 // Get free list for the given chunk size and type
 struct list_head *find_free_list(uvm_pmm_gpu_t *pmm,
                                  uvm_pmm_gpu_memory_type_t type,
@@ -2779,7 +2989,7 @@ static NV_STATUS uvm_pmm_gpu_pma_evict_pages(void *void_pmm,
         uvm_page_index_t page_index;
         NvU64 pages_this_time = min(pages_per_chunk, num_pages_left_to_evict);
 
-        uvm_mutex_lock(&pmm->lock);
+        pmm_lock(pmm);
 
         if (uvm_pmm_should_inject_pma_eviction_error(pmm)) {
             status = NV_ERR_NO_MEMORY;
@@ -2790,7 +3000,7 @@ static NV_STATUS uvm_pmm_gpu_pma_evict_pages(void *void_pmm,
                                                      PMM_CONTEXT_PMA_EVICTION,
                                                      &chunk);
         }
-        uvm_mutex_unlock(&pmm->lock);
+        pmm_unlock(pmm);
 
         // TODO: Bug 1795559: Consider waiting for any pinned user allocations
         // to be unpinned.
@@ -2949,12 +3159,12 @@ static NV_STATUS uvm_pmm_gpu_pma_evict_range(void *void_pmm, NvU64 phys_begin, N
         if (chunk->state == UVM_PMM_GPU_CHUNK_STATE_PMA_OWNED)
             continue;
 
-        uvm_mutex_lock(&pmm->lock);
+        pmm_lock(pmm);
 
         status = evict_root_chunk(pmm, root_chunk, PMM_CONTEXT_PMA_EVICTION);
         should_inject_error = uvm_pmm_should_inject_pma_eviction_error(pmm);
 
-        uvm_mutex_unlock(&pmm->lock);
+        pmm_unlock(pmm);
 
         if (status != NV_OK)
             return status;
@@ -3246,7 +3456,7 @@ NvU32 uvm_pmm_gpu_phys_to_virt(uvm_pmm_gpu_t *pmm, NvU64 phys_addr, NvU64 region
     UVM_ASSERT(PAGE_ALIGNED(phys_addr));
     UVM_ASSERT(PAGE_ALIGNED(region_size));
 
-    uvm_mutex_lock(&pmm->lock);
+    pmm_lock(pmm);
 
     // Traverse the whole requested region
     do {
@@ -3281,7 +3491,7 @@ NvU32 uvm_pmm_gpu_phys_to_virt(uvm_pmm_gpu_t *pmm, NvU64 phys_addr, NvU64 region
         size_in_chunk = min((NvU64)UVM_CHUNK_SIZE_MAX, region_size);
     } while (region_size > 0);
 
-    uvm_mutex_unlock(&pmm->lock);
+    pmm_unlock(pmm);
 
     return num_mappings;
 }
@@ -3412,7 +3622,7 @@ static void release_free_root_chunks(uvm_pmm_gpu_t *pmm)
     for (type = 0; type < UVM_PMM_GPU_MEMORY_TYPE_COUNT; ++type) {
         uvm_pmm_list_zero_t zero_type;
 
-        while (free_next_available_root_chunk(pmm, type))
+        while (free_root_chunks_batched(pmm, type, SIZE_MAX))
             ;
 
         for (zero_type = 0; zero_type < UVM_PMM_LIST_ZERO_COUNT; ++zero_type)
@@ -3517,7 +3727,7 @@ NV_STATUS uvm_test_evict_chunk(UVM_TEST_EVICT_CHUNK_PARAMS *params, struct file
     if (params->eviction_mode == UvmTestEvictModeVirtual) {
         UVM_ASSERT(block);
 
-        uvm_mutex_lock(&block->lock);
+        uvm_va_block_lock(block);
 
         // As the VA space lock is not held we need to make sure the block
         // is still alive.
@@ -3542,7 +3752,7 @@ NV_STATUS uvm_test_evict_chunk(UVM_TEST_EVICT_CHUNK_PARAMS *params, struct file
             status = NV_ERR_INVALID_ADDRESS;
         }
 
-        uvm_mutex_unlock(&block->lock);
+        uvm_va_block_unlock(block);
         uvm_va_block_release(block);
 
         if (status != NV_OK)
@@ -3587,9 +3797,9 @@ NV_STATUS uvm_test_evict_chunk(UVM_TEST_EVICT_CHUNK_PARAMS *params, struct file
         goto out;
     }
 
-    uvm_mutex_lock(&pmm->lock);
+    pmm_lock(pmm);
     status = evict_root_chunk(pmm, root_chunk, PMM_CONTEXT_DEFAULT);
-    uvm_mutex_unlock(&pmm->lock);
+    pmm_unlock(pmm);
 
     if (status != NV_OK)
         goto out;
@@ -3755,9 +3965,9 @@ NV_STATUS uvm_test_pmm_inject_pma_evict_error(UVM_TEST_PMM_INJECT_PMA_EVICT_ERRO
 
     pmm = &gpu->pmm;
 
-    uvm_mutex_lock(&pmm->lock);
+    pmm_lock(pmm);
     pmm->inject_pma_evict_error_after_num_chunks = params->error_after_num_chunks;
-    uvm_mutex_unlock(&pmm->lock);
+    pmm_unlock(pmm);
 
     uvm_gpu_release(gpu);
     return NV_OK;
@@ -3812,3 +4022,285 @@ NV_STATUS uvm_test_pmm_query_pma_stats(UVM_TEST_PMM_QUERY_PMA_STATS_PARAMS *para
     uvm_gpu_release(gpu);
     return NV_OK;
 }
+
+// Upper bound on the number of chunk slots a replayed trace can reference
+#define PMM_TRACE_REPLAY_MAX_SLOTS (1024 * 1024)
+
+// Number of trace entries copied from user space at a time
+#define PMM_TRACE_REPLAY_BATCH_SIZE 64
+
+// Period, in operations, of evictions in synthetic traces
+#define PMM_TRACE_REPLAY_EVICT_PERIOD 64
+
+static void trace_replay_synthetic_entry(uvm_pmm_gpu_t *pmm,
+                                         uvm_gpu_chunk_t **slots,
+                                         NvU32 num_slots,
+                                         NvU32 index,
+                                         uvm_test_rng_t *rng,
+                                         UvmTestPmmTraceEntry *entry)
+{
+    uvm_chunk_sizes_mask_t chunk_sizes = pmm->chunk_sizes[UVM_PMM_GPU_MEMORY_TYPE_USER];
+    uvm_chunk_size_t chunk_size;
+    NvU32 size_index;
+
+    memset(entry, 0, sizeof(*entry));
+
+    if ((index % PMM_TRACE_REPLAY_EVICT_PERIOD) == PMM_TRACE_REPLAY_EVICT_PERIOD - 1) {
+        entry->op = UvmTestPmmTraceOpEvict;
+        return;
+    }
+
+    entry->slot = uvm_test_rng_range_32(rng, 0, num_slots - 1);
+    if (slots[entry->slot]) {
+        entry->op = UvmTestPmmTraceOpFree;
+        return;
+    }
+
+    // Pick one of the supported chunk sizes uniformly
+    size_index = uvm_test_rng_range_32(rng, 0, hweight_long(chunk_sizes) - 1);
+    for_each_chunk_size(chunk_size, chunk_sizes) {
+        if (size_index-- == 0)
+            break;
+    }
+
+    entry->op = UvmTestPmmTraceOpAlloc;
+    entry->chunk_size = chunk_size;
+}
+
+static void trace_replay_free_list_bytes(uvm_pmm_gpu_t *pmm, NvU64 *free_bytes, NvU64 *free_root_chunk_bytes)
+{
+    uvm_pmm_gpu_memory_type_t type = UVM_PMM_GPU_MEMORY_TYPE_USER;
+    uvm_chunk_size_t chunk_size;
+
+    *free_bytes = 0;
+    *free_root_chunk_bytes = 0;
+
+    uvm_spin_lock(&pmm->list_lock);
+
+    for_each_chunk_size(chunk_size, pmm->chunk_sizes[type]) {
+        uvm_pmm_list_zero_t zero_type;
+
+        for (zero_type = 0; zero_type < UVM_PMM_LIST_ZERO_COUNT; ++zero_type) {
+            uvm_gpu_chunk_t *chunk;
+
+            list_for_each_entry(chunk, find_free_list(pmm, type, chunk_size, zero_type), list) {
+                *free_bytes += chunk_size;
+                if (chunk_size == UVM_CHUNK_SIZE_MAX)
+                    *free_root_chunk_bytes += chunk_size;
+            }
+        }
+    }
+
+    uvm_spin_unlock(&pmm->list_lock);
+}
+
+static NV_STATUS trace_replay_evict(uvm_pmm_gpu_t *pmm, bool *evicted)
+{
+    NV_STATUS status;
+    uvm_gpu_root_chunk_t *root_chunk;
+
+    *evicted = false;
+
+    if (!uvm_gpu_supports_eviction(pmm->gpu))
+        return NV_OK;
+
+    root_chunk = pick_root_chunk_to_evict(pmm);
+    if (!root_chunk)
+        return NV_OK;
+
+    pmm_lock(pmm);
+    status = evict_root_chunk(pmm, root_chunk, PMM_CONTEXT_DEFAULT);
+    pmm_unlock(pmm);
+
+    if (status != NV_OK)
+        return status;
+
+    free_chunk(pmm, &root_chunk->chunk);
+    *evicted = true;
+
+    return NV_OK;
+}
+
+NV_STATUS uvm_test_pmm_trace_replay(UVM_TEST_PMM_TRACE_REPLAY_PARAMS *params, struct file *filp)
+{
+    NV_STATUS status = NV_OK;
+    uvm_va_space_t *va_space = uvm_va_space_get(filp);
+    uvm_gpu_t *gpu;
+    uvm_pmm_gpu_t *pmm;
+    uvm_gpu_chunk_t **slots = NULL;
+    UvmTestPmmTraceEntry *entries = NULL;
+    uvm_test_rng_t rng;
+    NvU64 start_lock_acquisitions;
+    NvU64 start_lock_hold_total_ns;
+    NvU64 start_splits;
+    NvU64 start_merges;
+    NvU64 start_pma_alloc_calls;
+    NvU64 start_pma_free_calls;
+    NvU64 start_pma_alloc_ns;
+    NvU64 start_pma_free_ns;
+    NvU64 start_time;
+    NvU32 i;
+
+    if (params->num_slots == 0 || params->num_slots > PMM_TRACE_REPLAY_MAX_SLOTS)
+        return NV_ERR_INVALID_ARGUMENT;
+
+    gpu = uvm_va_space_retain_gpu_by_uuid(va_space, &params->gpu_uuid);
+    if (!gpu)
+        return NV_ERR_INVALID_DEVICE;
+
+    pmm = &gpu->pmm;
+
+    slots = uvm_kvmalloc_zero(params->num_slots * sizeof(*slots));
+    if (!slots) {
+        status = NV_ERR_NO_MEMORY;
+        goto out;
+    }
+
+    if (params->trace) {
+        entries = uvm_kvmalloc(PMM_TRACE_REPLAY_BATCH_SIZE * sizeof(*entries));
+        if (!entries) {
+            status = NV_ERR_NO_MEMORY;
+            goto out;
+        }
+    }
+
+    uvm_test_rng_init(&rng, params->seed);
+
+    // Snapshot the lock stats without going through pmm_lock() so that the
+    // snapshots themselves are not accounted for.
+    uvm_mutex_lock(&pmm->lock);
+    start_lock_acquisitions = pmm->stats.lock_acquisitions;
+    start_lock_hold_total_ns = pmm->stats.lock_hold_total_ns;
+    pmm->stats.lock_hold_max_ns = 0;
+    uvm_mutex_unlock(&pmm->lock);
+
+    start_splits = atomic64_read(&pmm->stats.num_splits);
+    start_merges = atomic64_read(&pmm->stats.num_merges);
+    start_pma_alloc_calls = atomic64_read(&pmm->stats.num_pma_alloc_calls);
+    start_pma_free_calls = atomic64_read(&pmm->stats.num_pma_free_calls);
+    start_pma_alloc_ns = atomic64_read(&pmm->stats.pma_alloc_ns);
+    start_pma_free_ns = atomic64_read(&pmm->stats.pma_free_ns);
+
+    start_time = NV_GETTIME();
+
+    for (i = 0; i < params->num_entries; ++i) {
+        UvmTestPmmTraceEntry entry;
+        NvU64 op_start;
+        bool evicted;
+
+        if (params->trace) {
+            NvU32 batch_index = i % PMM_TRACE_REPLAY_BATCH_SIZE;
+
+            if (batch_index == 0) {
+                NvU32 count = min(params->num_entries - i, (NvU32)PMM_TRACE_REPLAY_BATCH_SIZE);
+                void __user *src = (void __user *)(params->trace + i * sizeof(*entries));
+
+                if (nv_copy_from_user(entries, src, count * sizeof(*entries))) {
+                    status = NV_ERR_INVALID_ADDRESS;
+                    goto out;
+                }
+            }
+
+            entry = entries[batch_index];
+        }
+        else {
+            trace_replay_synthetic_entry(pmm, slots, params->num_slots, i, &rng, &entry);
+        }
+
+        if (entry.op != UvmTestPmmTraceOpEvict && entry.slot >= params->num_slots) {
+            status = NV_ERR_INVALID_ARGUMENT;
+            goto out;
+        }
+
+        op_start = NV_GETTIME();
+
+        switch (entry.op) {
+            case UvmTestPmmTraceOpAlloc:
+                if (slots[entry.slot] ||
+                    !is_power_of_2(entry.chunk_size) ||
+                    !(entry.chunk_size & pmm->chunk_sizes[UVM_PMM_GPU_MEMORY_TYPE_USER])) {
+                    status = NV_ERR_INVALID_ARGUMENT;
+                    goto out;
+                }
+
+                status = uvm_pmm_gpu_alloc_user(pmm,
+                                                1,
+                                                entry.chunk_size,
+                                                UVM_PMM_ALLOC_FLAGS_NONE,
+                                                &slots[entry.slot],
+                                                NULL);
+                if (status == NV_ERR_NO_MEMORY) {
+                    // Running out of memory is an expected outcome of a trace
+                    ++params->num_failed_allocs;
+                    status = NV_OK;
+                }
+                else if (status != NV_OK) {
+                    goto out;
+                }
+                else {
+                    ++params->num_allocs;
+                    params->max_alloc_ns = max(params->max_alloc_ns, NV_GETTIME() - op_start);
+                }
+                break;
+
+            case UvmTestPmmTraceOpFree:
+                if (!slots[entry.slot]) {
+                    status = NV_ERR_INVALID_ARGUMENT;
+                    goto out;
+                }
+
+                uvm_pmm_gpu_free(pmm, slots[entry.slot], NULL);
+                slots[entry.slot] = NULL;
+
+                ++params->num_frees;
+                params->max_free_ns = max(params->max_free_ns, NV_GETTIME() - op_start);
+                break;
+
+            case UvmTestPmmTraceOpEvict:
+                status = trace_replay_evict(pmm, &evicted);
+                if (status != NV_OK)
+                    goto out;
+
+                if (evicted)
+                    ++params->num_evictions;
+                break;
+
+            default:
+                status = NV_ERR_INVALID_ARGUMENT;
+                goto out;
+        }
+    }
+
+    params->total_ns = NV_GETTIME() - start_time;
+    if (params->total_ns != 0)
+        params->ops_per_sec = div64_u64((NvU64)params->num_entries * NSEC_PER_SEC, params->total_ns);
+
+    trace_replay_free_list_bytes(pmm, &params->free_bytes, &params->free_root_chunk_bytes);
+
+    params->num_splits = atomic64_read(&pmm->stats.num_splits) - start_splits;
+    params->num_merges = atomic64_read(&pmm->stats.num_merges) - start_merges;
+    params->num_pma_alloc_calls = atomic64_read(&pmm->stats.num_pma_alloc_calls) - start_pma_alloc_calls;
+    params->num_pma_free_calls = atomic64_read(&pmm->stats.num_pma_free_calls) - start_pma_free_calls;
+    params->pma_alloc_ns = atomic64_read(&pmm->stats.pma_alloc_ns) - start_pma_alloc_ns;
+    params->pma_free_ns = atomic64_read(&pmm->stats.pma_free_ns) - start_pma_free_ns;
+
+    uvm_mutex_lock(&pmm->lock);
+    params->lock_acquisitions = pmm->stats.lock_acquisitions - start_lock_acquisitions;
+    params->lock_hold_total_ns = pmm->stats.lock_hold_total_ns - start_lock_hold_total_ns;
+    params->lock_hold_max_ns = pmm->stats.lock_hold_max_ns;
+    uvm_mutex_unlock(&pmm->lock);
+
+out:
+    if (slots) {
+        for (i = 0; i < params->num_slots; ++i) {
+            if (slots[i])
+                uvm_pmm_gpu_free(pmm, slots[i], NULL);
+        }
+    }
+
+    uvm_kvfree(entries);
+    uvm_kvfree(slots);
+    uvm_gpu_release(gpu);
+
+    return status;
+}
@@ -377,6 +377,39 @@ typedef struct
     DECLARE_BITMAP(chunk_split_cache_initialized, UVM_PMM_CHUNK_SPLIT_CACHE_SIZES);
 
     bool pma_address_cache_initialized;
+
+    // Allocator statistics, reported by UVM_TEST_PMM_TRACE_REPLAY
+    struct
+    {
+        // Number of chunk splits and merges
+        atomic64_t num_splits;
+        atomic64_t num_merges;
+
+        // Number of root chunks evicted
+        atomic64_t num_evictions;
+
+        // Number of calls into PMA to allocate and free root chunks, and the
+        // number of root chunks they covered. The difference between the two
+        // is the number of calls saved by batching.
+        atomic64_t num_pma_alloc_calls;
+        atomic64_t num_pma_alloc_chunks;
+        atomic64_t num_pma_free_calls;
+        atomic64_t num_pma_free_chunks;
+
+        // Total time spent in the PMA alloc and free calls above
+        atomic64_t pma_alloc_ns;
+        atomic64_t pma_free_ns;
+
+        // Number of PMM lock acquisitions, and the total and maximum time the
+        // lock was held for. Protected by the PMM lock.
+        NvU64 lock_acquisitions;
+        NvU64 lock_hold_total_ns;
+        NvU64 lock_hold_max_ns;
+
+        // Timestamp of the most recent PMM lock acquisition. Protected by the
+        // PMM lock.
+        NvU64 lock_acquired_ns;
+    } stats;
 } uvm_pmm_gpu_t;
 
 // Initialize PMM on GPU
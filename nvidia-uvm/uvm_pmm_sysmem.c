@@ -21,9 +21,11 @@
 
 *******************************************************************************/
 
+#include "uvm_api.h"
 #include "uvm_gpu.h"
 #include "uvm_pmm_sysmem.h"
 #include "uvm_kvmalloc.h"
+#include "uvm_procfs.h"
 #include "uvm_va_block.h"
 #include "uvm_va_space.h"
 
@@ -31,21 +33,795 @@ static int uvm_cpu_chunk_allocation_sizes = UVM_CPU_CHUNK_SIZES;
 module_param(uvm_cpu_chunk_allocation_sizes, uint, S_IRUGO | S_IWUSR);
 MODULE_PARM_DESC(uvm_cpu_chunk_allocation_sizes, "OR'ed value of all CPU chunk allocation sizes.");
 
-static struct kmem_cache *g_reverse_page_map_cache __read_mostly;
+static unsigned uvm_cpu_chunk_cache_size = 512;
+module_param(uvm_cpu_chunk_cache_size, uint, S_IRUGO);
+MODULE_PARM_DESC(uvm_cpu_chunk_cache_size, "Maximum number of freed CPU pages cached per NUMA node. 0 disables the cache.");
+
+static unsigned uvm_dma_cache_max_mappings = 4096;
+module_param(uvm_dma_cache_max_mappings, uint, S_IRUGO);
+MODULE_PARM_DESC(uvm_dma_cache_max_mappings, "Maximum number of idle sysmem DMA mappings cached per GPU. 0 disables the cache.");
+
+// Number of idle mappings unmapped at once when a GPU's DMA mapping cache goes
+// over uvm_dma_cache_max_mappings. Unmapping in batches lets the IOMMU driver
+// coalesce the IOTLB invalidations of consecutive unmaps.
+#define DMA_CACHE_UNMAP_BATCH_SIZE 64
+
+// Maximum number of unreserved spare extents kept by each reverse map. Extents
+// released beyond that are freed.
+#define REVERSE_MAP_MAX_SPARE_EXTENTS 32
+
+// Reverse translation for a set of DMA pages within the same window that
+// belong to the same VA block and processor, and whose DMA addresses and
+// virtual addresses are contiguous, i.e. they can be translated with a single
+// base. There can be unmapped holes between the first and the last pages of
+// the extent.
+typedef struct
+{
+    // Range of DMA page numbers covered by the extent. The first and the last
+    // pages in the range are always mapped.
+    uvm_range_tree_node_t node;
 
-NV_STATUS uvm_pmm_sysmem_init(void)
+    uvm_va_block_t *va_block;
+
+    uvm_processor_id_t owner;
+
+    // DMA page number that corresponds to the page index 0 of va_block
+    NvU64 dma_page_base;
+
+    // Bit i refers to the i-th page of the window. mapped tracks the pages
+    // mapped by the extent, and chunk_start the first page of each of the
+    // registered chunk mappings. Chunk mappings larger than the window are
+    // spread across several extents, and only the first one has the
+    // chunk_start bit set.
+    NvU64 mapped;
+    NvU64 chunk_start;
+} reverse_map_extent_t;
+
+static struct kmem_cache *g_reverse_map_extent_cache __read_mostly;
+
+typedef struct
+{
+    uvm_gpu_t *gpu;
+
+    struct page *page;
+
+    NvU64 dma_addr;
+
+    size_t size;
+
+    // Node in the LRU list of the owning uvm_pmm_sysmem_dma_cache_t
+    struct list_head lru_node;
+} dma_cache_entry_t;
+
+static struct
+{
+    // Serializes additions to and removals from the list below. The list is
+    // walked under RCU, and each cache is protected by its own lock.
+    uvm_mutex_t lock;
+
+    // List of all the initialized uvm_pmm_sysmem_dma_cache_t
+    struct list_head caches;
+
+    // Total number of idle mappings across all GPUs. Used to skip the lookups
+    // on page release when no mappings are cached.
+    atomic64_t num_mappings;
+
+    struct kmem_cache *entry_cache;
+} g_dma_caches;
+
+typedef struct
+{
+    // Protects the pages list and count
+    uvm_spinlock_t lock;
+
+    // Cached pages, linked through page->lru
+    struct list_head pages;
+
+    unsigned long count;
+} cpu_chunk_cache_node_t;
+
+// Bounded per-NUMA node cache of freed single-page CPU chunks. Chunks freed
+// by a VA block are parked here instead of being returned to the kernel, so
+// that the next uvm_cpu_chunk_alloc() on the same node can skip the page
+// allocator. The kernel can reclaim the cached pages at any time through the
+// shrinker.
+//
+// The VA block removes the reverse map entries of its chunks and hands their
+// GPU DMA mappings to the per-GPU DMA mapping caches before releasing them, so
+// a cached page may still have idle DMA mappings. Those are torn down with
+// uvm_pmm_sysmem_dma_cache_release_pages() when the page is returned to the
+// kernel, either when it doesn't fit in the cache or when the shrinker
+// reclaims it.
+static struct
+{
+    // Array of nr_node_ids entries. NULL if the cache is disabled.
+    cpu_chunk_cache_node_t *nodes;
+
+    struct
+    {
+        atomic64_t hits;
+        atomic64_t misses;
+        atomic64_t reclaimed;
+    } stats;
+
+#if defined(NV_SHRINKER_ALLOC_PRESENT)
+    struct shrinker *shrinker;
+#else
+    struct shrinker shrinker;
+    bool shrinker_registered;
+#endif
+
+    struct proc_dir_entry *procfs_file;
+} g_cpu_chunk_cache;
+
+static cpu_chunk_cache_node_t *cpu_chunk_cache_node(int nid)
+{
+    if (!g_cpu_chunk_cache.nodes || nid < 0 || nid >= nr_node_ids)
+        return NULL;
+
+    return &g_cpu_chunk_cache.nodes[nid];
+}
+
+struct page *uvm_cpu_chunk_cache_alloc_page(int nid, gfp_t gfp_flags)
+{
+    cpu_chunk_cache_node_t *node = cpu_chunk_cache_node(nid);
+    struct page *page = NULL;
+
+    if (!node)
+        return NULL;
+
+    uvm_spin_lock(&node->lock);
+
+    if (node->count > 0) {
+        page = list_first_entry(&node->pages, struct page, lru);
+        list_del(&page->lru);
+        --node->count;
+    }
+
+    uvm_spin_unlock(&node->lock);
+
+    if (!page) {
+        atomic64_inc(&g_cpu_chunk_cache.stats.misses);
+        return NULL;
+    }
+
+    atomic64_inc(&g_cpu_chunk_cache.stats.hits);
+
+    if (gfp_flags & __GFP_ZERO)
+        clear_highpage(page);
+
+    return page;
+}
+
+bool uvm_cpu_chunk_cache_free_page(struct page *page)
 {
-    g_reverse_page_map_cache = NV_KMEM_CACHE_CREATE("uvm_pmm_sysmem_page_reverse_map_t",
-                                                    uvm_reverse_map_t);
-    if (!g_reverse_page_map_cache)
+    cpu_chunk_cache_node_t *node = cpu_chunk_cache_node(page_to_nid(page));
+    bool cached = false;
+
+    if (!node)
+        return false;
+
+    // Only pages exclusively owned by UVM can be recycled. Pages still
+    // referenced elsewhere (e.g. pinned by get_user_pages) are released
+    // normally.
+    if (PageCompound(page) || page_mapped(page) || page_count(page) != 1)
+        return false;
+
+    // Cached pages look like freshly-allocated ones
+    ClearPageDirty(page);
+
+    uvm_spin_lock(&node->lock);
+
+    if (node->count < uvm_cpu_chunk_cache_size) {
+        list_add(&page->lru, &node->pages);
+        ++node->count;
+        cached = true;
+    }
+
+    uvm_spin_unlock(&node->lock);
+
+    return cached;
+}
+
+static unsigned long cpu_chunk_cache_node_trim(cpu_chunk_cache_node_t *node, unsigned long max_pages)
+{
+    LIST_HEAD(free_list);
+    struct page *page, *next;
+    unsigned long freed = 0;
+
+    uvm_spin_lock(&node->lock);
+
+    while (node->count > 0 && freed < max_pages) {
+        page = list_first_entry(&node->pages, struct page, lru);
+        list_move(&page->lru, &free_list);
+        --node->count;
+        ++freed;
+    }
+
+    uvm_spin_unlock(&node->lock);
+
+    // Release the pages outside of the lock
+    list_for_each_entry_safe(page, next, &free_list, lru) {
+        list_del(&page->lru);
+        uvm_pmm_sysmem_dma_cache_release_pages(page, PAGE_SIZE);
+        put_page(page);
+    }
+
+    return freed;
+}
+
+unsigned long uvm_cpu_chunk_cache_drain(void)
+{
+    unsigned long freed = 0;
+    int nid;
+
+    if (!g_cpu_chunk_cache.nodes)
+        return 0;
+
+    for (nid = 0; nid < nr_node_ids; nid++)
+        freed += cpu_chunk_cache_node_trim(&g_cpu_chunk_cache.nodes[nid], ULONG_MAX);
+
+    return freed;
+}
+
+unsigned long uvm_cpu_chunk_cache_count(int nid)
+{
+    cpu_chunk_cache_node_t *node = cpu_chunk_cache_node(nid);
+
+    if (!node)
+        return 0;
+
+    return READ_ONCE(node->count);
+}
+
+static unsigned long cpu_chunk_cache_shrinker_count(struct shrinker *shrinker, struct shrink_control *sc)
+{
+    return uvm_cpu_chunk_cache_count(sc->nid);
+}
+
+static unsigned long cpu_chunk_cache_shrinker_count_entry(struct shrinker *shrinker, struct shrink_control *sc)
+{
+    UVM_ENTRY_RET(cpu_chunk_cache_shrinker_count(shrinker, sc));
+}
+
+static unsigned long cpu_chunk_cache_shrinker_scan(struct shrinker *shrinker, struct shrink_control *sc)
+{
+    cpu_chunk_cache_node_t *node = cpu_chunk_cache_node(sc->nid);
+    unsigned long freed;
+
+    if (!node)
+        return SHRINK_STOP;
+
+    freed = cpu_chunk_cache_node_trim(node, sc->nr_to_scan);
+    atomic64_add(freed, &g_cpu_chunk_cache.stats.reclaimed);
+
+    return freed ? freed : SHRINK_STOP;
+}
+
+static unsigned long cpu_chunk_cache_shrinker_scan_entry(struct shrinker *shrinker, struct shrink_control *sc)
+{
+    UVM_ENTRY_RET(cpu_chunk_cache_shrinker_scan(shrinker, sc));
+}
+
+static NV_STATUS cpu_chunk_cache_shrinker_register(void)
+{
+#if defined(NV_SHRINKER_ALLOC_PRESENT)
+    g_cpu_chunk_cache.shrinker = shrinker_alloc(SHRINKER_NUMA_AWARE, "nvidia-uvm-cpu-chunk-cache");
+    if (!g_cpu_chunk_cache.shrinker)
         return NV_ERR_NO_MEMORY;
 
+    g_cpu_chunk_cache.shrinker->count_objects = cpu_chunk_cache_shrinker_count_entry;
+    g_cpu_chunk_cache.shrinker->scan_objects = cpu_chunk_cache_shrinker_scan_entry;
+    g_cpu_chunk_cache.shrinker->seeks = DEFAULT_SEEKS;
+    shrinker_register(g_cpu_chunk_cache.shrinker);
+#else
+    int ret;
+
+    g_cpu_chunk_cache.shrinker.count_objects = cpu_chunk_cache_shrinker_count_entry;
+    g_cpu_chunk_cache.shrinker.scan_objects = cpu_chunk_cache_shrinker_scan_entry;
+    g_cpu_chunk_cache.shrinker.seeks = DEFAULT_SEEKS;
+    g_cpu_chunk_cache.shrinker.flags = SHRINKER_NUMA_AWARE;
+
+#if defined(NV_REGISTER_SHRINKER_HAS_FORMAT_ARG)
+    ret = register_shrinker(&g_cpu_chunk_cache.shrinker, "nvidia-uvm-cpu-chunk-cache");
+#else
+    ret = register_shrinker(&g_cpu_chunk_cache.shrinker);
+#endif
+    if (ret != 0)
+        return errno_to_nv_status(ret);
+
+    g_cpu_chunk_cache.shrinker_registered = true;
+#endif
+
     return NV_OK;
 }
 
+static void cpu_chunk_cache_shrinker_unregister(void)
+{
+#if defined(NV_SHRINKER_ALLOC_PRESENT)
+    if (g_cpu_chunk_cache.shrinker) {
+        shrinker_free(g_cpu_chunk_cache.shrinker);
+        g_cpu_chunk_cache.shrinker = NULL;
+    }
+#else
+    if (g_cpu_chunk_cache.shrinker_registered) {
+        unregister_shrinker(&g_cpu_chunk_cache.shrinker);
+        g_cpu_chunk_cache.shrinker_registered = false;
+    }
+#endif
+}
+
+static int nv_procfs_read_cpu_chunk_cache(struct seq_file *s, void *v)
+{
+    unsigned long cached = 0;
+    int nid;
+
+    if (!uvm_down_read_trylock(&g_uvm_global.pm.lock))
+            return -EAGAIN;
+
+    for (nid = 0; nid < nr_node_ids; nid++)
+        cached += uvm_cpu_chunk_cache_count(nid);
+
+    UVM_SEQ_OR_DBG_PRINT(s, "max_pages_per_node %u\n", uvm_cpu_chunk_cache_size);
+    UVM_SEQ_OR_DBG_PRINT(s, "cached_pages       %lu\n", cached);
+    UVM_SEQ_OR_DBG_PRINT(s, "hits               %llu\n", (NvU64)atomic64_read(&g_cpu_chunk_cache.stats.hits));
+    UVM_SEQ_OR_DBG_PRINT(s, "misses             %llu\n", (NvU64)atomic64_read(&g_cpu_chunk_cache.stats.misses));
+    UVM_SEQ_OR_DBG_PRINT(s, "reclaimed          %llu\n", (NvU64)atomic64_read(&g_cpu_chunk_cache.stats.reclaimed));
+
+    uvm_up_read(&g_uvm_global.pm.lock);
+
+    return 0;
+}
+
+static int nv_procfs_read_cpu_chunk_cache_entry(struct seq_file *s, void *v)
+{
+    UVM_ENTRY_RET(nv_procfs_read_cpu_chunk_cache(s, v));
+}
+
+UVM_DEFINE_SINGLE_PROCFS_FILE(cpu_chunk_cache_entry);
+
+static NV_STATUS cpu_chunk_cache_init(void)
+{
+    NV_STATUS status;
+    int nid;
+
+    atomic64_set(&g_cpu_chunk_cache.stats.hits, 0);
+    atomic64_set(&g_cpu_chunk_cache.stats.misses, 0);
+    atomic64_set(&g_cpu_chunk_cache.stats.reclaimed, 0);
+
+    if (uvm_cpu_chunk_cache_size == 0)
+        return NV_OK;
+
+    g_cpu_chunk_cache.nodes = uvm_kvmalloc_zero(nr_node_ids * sizeof(*g_cpu_chunk_cache.nodes));
+    if (!g_cpu_chunk_cache.nodes)
+        return NV_ERR_NO_MEMORY;
+
+    for (nid = 0; nid < nr_node_ids; nid++) {
+        uvm_spin_lock_init(&g_cpu_chunk_cache.nodes[nid].lock, UVM_LOCK_ORDER_LEAF);
+        INIT_LIST_HEAD(&g_cpu_chunk_cache.nodes[nid].pages);
+    }
+
+    status = cpu_chunk_cache_shrinker_register();
+    if (status != NV_OK)
+        return status;
+
+    if (uvm_procfs_is_debug_enabled()) {
+        g_cpu_chunk_cache.procfs_file = NV_CREATE_PROC_FILE("cpu_chunk_cache",
+                                                            uvm_procfs_get_cpu_base_dir(),
+                                                            cpu_chunk_cache_entry,
+                                                            NULL);
+        if (!g_cpu_chunk_cache.procfs_file)
+            return NV_ERR_OPERATING_SYSTEM;
+    }
+
+    return NV_OK;
+}
+
+static void cpu_chunk_cache_exit(void)
+{
+    if (g_cpu_chunk_cache.procfs_file) {
+        uvm_procfs_destroy_entry(g_cpu_chunk_cache.procfs_file);
+        g_cpu_chunk_cache.procfs_file = NULL;
+    }
+
+    cpu_chunk_cache_shrinker_unregister();
+
+    uvm_cpu_chunk_cache_drain();
+    uvm_kvfree(g_cpu_chunk_cache.nodes);
+    g_cpu_chunk_cache.nodes = NULL;
+}
+
+NV_STATUS uvm_pmm_sysmem_init(void)
+{
+    g_reverse_map_extent_cache = NV_KMEM_CACHE_CREATE("uvm_pmm_sysmem_reverse_map_extent_t",
+                                                      reverse_map_extent_t);
+    if (!g_reverse_map_extent_cache)
+        return NV_ERR_NO_MEMORY;
+
+    g_dma_caches.entry_cache = NV_KMEM_CACHE_CREATE("uvm_pmm_sysmem_dma_cache_entry_t", dma_cache_entry_t);
+    if (!g_dma_caches.entry_cache)
+        return NV_ERR_NO_MEMORY;
+
+    uvm_mutex_init(&g_dma_caches.lock, UVM_LOCK_ORDER_LEAF);
+    INIT_LIST_HEAD(&g_dma_caches.caches);
+    atomic64_set(&g_dma_caches.num_mappings, 0);
+
+    // On failure, uvm_pmm_sysmem_exit() is called from uvm_global_exit()
+    return cpu_chunk_cache_init();
+}
+
 void uvm_pmm_sysmem_exit(void)
 {
-    kmem_cache_destroy_safe(&g_reverse_page_map_cache);
+    cpu_chunk_cache_exit();
+    kmem_cache_destroy_safe(&g_dma_caches.entry_cache);
+    kmem_cache_destroy_safe(&g_reverse_map_extent_cache);
+}
+
+static NvU64 extent_window_first(NvU64 dma_page)
+{
+    return dma_page & ~((NvU64)UVM_REVERSE_MAP_EXTENT_PAGES - 1);
+}
+
+static unsigned extent_window_bit(NvU64 dma_page)
+{
+    return dma_page & (UVM_REVERSE_MAP_EXTENT_PAGES - 1);
+}
+
+static NvU64 extent_window_bits(unsigned first_bit, unsigned num_bits)
+{
+    UVM_ASSERT(num_bits > 0);
+    UVM_ASSERT(first_bit + num_bits <= UVM_REVERSE_MAP_EXTENT_PAGES);
+
+    if (num_bits == UVM_REVERSE_MAP_EXTENT_PAGES)
+        return ~0ULL;
+
+    return ((1ULL << num_bits) - 1) << first_bit;
+}
+
+// Mask for the DMA pages in [first, last], which must be in the same window
+static NvU64 extent_window_mask(NvU64 first, NvU64 last)
+{
+    UVM_ASSERT(first <= last);
+    UVM_ASSERT(extent_window_first(first) == extent_window_first(last));
+
+    return extent_window_bits(extent_window_bit(first), last - first + 1);
+}
+
+static reverse_map_extent_t *extent_from_node(uvm_range_tree_node_t *node)
+{
+    if (!node)
+        return NULL;
+
+    return container_of(node, reverse_map_extent_t, node);
+}
+
+static bool extent_matches(const reverse_map_extent_t *extent,
+                           uvm_va_block_t *va_block,
+                           uvm_processor_id_t owner,
+                           NvU64 dma_page_base)
+{
+    return extent->va_block == va_block &&
+           uvm_id_equal(extent->owner, owner) &&
+           extent->dma_page_base == dma_page_base;
+}
+
+// Number of pages of the chunk mapping piece that starts at first_bit in the
+// window of the extent
+static unsigned extent_chunk_piece_num_bits(const reverse_map_extent_t *extent, unsigned first_bit)
+{
+    unsigned bit = first_bit + 1;
+
+    while (bit < UVM_REVERSE_MAP_EXTENT_PAGES &&
+           (extent->mapped & (1ULL << bit)) &&
+           !(extent->chunk_start & (1ULL << bit)))
+        ++bit;
+
+    return bit - first_bit;
+}
+
+static void reverse_map_extent_put(uvm_pmm_sysmem_mappings_t *sysmem_mappings, reverse_map_extent_t *extent)
+{
+    if (sysmem_mappings->num_spare_extents >= sysmem_mappings->num_reserved_extents + REVERSE_MAP_MAX_SPARE_EXTENTS) {
+        kmem_cache_free(g_reverse_map_extent_cache, extent);
+        return;
+    }
+
+    list_add(&extent->node.list, &sysmem_mappings->spare_extents);
+    ++sysmem_mappings->num_spare_extents;
+}
+
+static reverse_map_extent_t *reverse_map_extent_get(uvm_pmm_sysmem_mappings_t *sysmem_mappings)
+{
+    reverse_map_extent_t *extent;
+
+    UVM_ASSERT(sysmem_mappings->num_spare_extents > 0);
+
+    extent = list_first_entry(&sysmem_mappings->spare_extents, reverse_map_extent_t, node.list);
+    list_del(&extent->node.list);
+    --sysmem_mappings->num_spare_extents;
+
+    return extent;
+}
+
+static void reverse_map_extent_insert(uvm_pmm_sysmem_mappings_t *sysmem_mappings, reverse_map_extent_t *extent)
+{
+    NV_STATUS status = uvm_range_tree_add(&sysmem_mappings->reverse_map_tree, &extent->node);
+    UVM_ASSERT(status == NV_OK);
+
+    ++sysmem_mappings->num_extents;
+}
+
+static void reverse_map_extent_release(uvm_pmm_sysmem_mappings_t *sysmem_mappings, reverse_map_extent_t *extent)
+{
+    uvm_range_tree_remove(&sysmem_mappings->reverse_map_tree, &extent->node);
+    --sysmem_mappings->num_extents;
+
+    reverse_map_extent_put(sysmem_mappings, extent);
+}
+
+static void reverse_map_extent_resize(uvm_pmm_sysmem_mappings_t *sysmem_mappings,
+                                      reverse_map_extent_t *extent,
+                                      NvU64 start,
+                                      NvU64 end)
+{
+    NV_STATUS status;
+
+    uvm_range_tree_remove(&sysmem_mappings->reverse_map_tree, &extent->node);
+    extent->node.start = start;
+    extent->node.end = end;
+
+    status = uvm_range_tree_add(&sysmem_mappings->reverse_map_tree, &extent->node);
+    UVM_ASSERT(status == NV_OK);
+}
+
+// Shrink the extent to its first and last mapped pages, or release it if no
+// pages are left
+static void reverse_map_extent_trim(uvm_pmm_sysmem_mappings_t *sysmem_mappings, reverse_map_extent_t *extent)
+{
+    const NvU64 window_first = extent_window_first(extent->node.start);
+
+    if (!extent->mapped) {
+        reverse_map_extent_release(sysmem_mappings, extent);
+        return;
+    }
+
+    uvm_range_tree_shrink_node(&sysmem_mappings->reverse_map_tree,
+                               &extent->node,
+                               window_first + __ffs64(extent->mapped),
+                               window_first + fls64(extent->mapped) - 1);
+}
+
+// Move the pages of the extent starting at split_page to a new extent with the
+// same translation, which is returned. The extent must have mapped pages on
+// both sides of split_page. A spare extent must be available.
+static reverse_map_extent_t *reverse_map_extent_split(uvm_pmm_sysmem_mappings_t *sysmem_mappings,
+                                                      reverse_map_extent_t *extent,
+                                                      NvU64 split_page)
+{
+    const NvU64 window_first = extent_window_first(extent->node.start);
+    const NvU64 upper_mask = extent_window_mask(split_page, window_first + UVM_REVERSE_MAP_EXTENT_PAGES - 1);
+    reverse_map_extent_t *upper;
+
+    UVM_ASSERT(split_page > extent->node.start);
+    UVM_ASSERT(split_page <= extent->node.end);
+
+    upper = reverse_map_extent_get(sysmem_mappings);
+    upper->va_block      = extent->va_block;
+    upper->owner         = extent->owner;
+    upper->dma_page_base = extent->dma_page_base;
+    upper->mapped        = extent->mapped & upper_mask;
+    upper->chunk_start   = extent->chunk_start & upper_mask;
+    upper->node.start    = window_first + __ffs64(upper->mapped);
+    upper->node.end      = extent->node.end;
+
+    extent->mapped      &= ~upper_mask;
+    extent->chunk_start &= ~upper_mask;
+    reverse_map_extent_trim(sysmem_mappings, extent);
+
+    reverse_map_extent_insert(sysmem_mappings, upper);
+
+    return upper;
+}
+
+// Find the closest extents before and after the [first, last] DMA page range
+// within its window. The range must not overlap any extent.
+static void reverse_map_find_neighbors(uvm_pmm_sysmem_mappings_t *sysmem_mappings,
+                                       NvU64 first,
+                                       NvU64 last,
+                                       reverse_map_extent_t **prev_out,
+                                       reverse_map_extent_t **next_out)
+{
+    const NvU64 window_first = extent_window_first(first);
+    uvm_range_tree_node_t *node;
+
+    *prev_out = NULL;
+    *next_out = NULL;
+
+    uvm_range_tree_for_each_in(node, &sysmem_mappings->reverse_map_tree, window_first, last) {
+        UVM_ASSERT(node->end < first);
+        *prev_out = extent_from_node(node);
+    }
+
+    if (last + 1 == window_first + UVM_REVERSE_MAP_EXTENT_PAGES)
+        return;
+
+    node = uvm_range_tree_iter_first(&sysmem_mappings->reverse_map_tree,
+                                     last + 1,
+                                     window_first + UVM_REVERSE_MAP_EXTENT_PAGES - 1);
+    *next_out = extent_from_node(node);
+}
+
+// Merge next into prev, if they have the same translation. Both extents must
+// be in the same window.
+static void reverse_map_extent_try_merge(uvm_pmm_sysmem_mappings_t *sysmem_mappings,
+                                         reverse_map_extent_t *prev,
+                                         reverse_map_extent_t *next)
+{
+    NvU64 end;
+
+    if (!prev || !next || !extent_matches(prev, next->va_block, next->owner, next->dma_page_base))
+        return;
+
+    UVM_ASSERT(extent_window_first(prev->node.start) == extent_window_first(next->node.start));
+
+    prev->mapped      |= next->mapped;
+    prev->chunk_start |= next->chunk_start;
+
+    end = next->node.end;
+    reverse_map_extent_release(sysmem_mappings, next);
+    reverse_map_extent_resize(sysmem_mappings, prev, prev->node.start, end);
+}
+
+// Register the [first, last] DMA pages, which must be in the same window. At
+// most two spare extents are consumed.
+static void reverse_map_add_piece(uvm_pmm_sysmem_mappings_t *sysmem_mappings,
+                                  NvU64 first,
+                                  NvU64 last,
+                                  bool chunk_start,
+                                  uvm_va_block_t *va_block,
+                                  uvm_processor_id_t owner,
+                                  NvU64 dma_page_base)
+{
+    const NvU64 mask = extent_window_mask(first, last);
+    const NvU64 chunk_start_mask = chunk_start ? (1ULL << extent_window_bit(first)) : 0;
+    reverse_map_extent_t *extent;
+    reverse_map_extent_t *prev;
+    reverse_map_extent_t *next;
+
+    // The pages can only overlap a hole of an existing extent. Either fill the
+    // hole if the translation matches, or split the extent around it.
+    extent = extent_from_node(uvm_range_tree_iter_first(&sysmem_mappings->reverse_map_tree, first, last));
+    if (extent) {
+        UVM_ASSERT(!(extent->mapped & mask));
+        UVM_ASSERT(extent->node.start < first);
+        UVM_ASSERT(extent->node.end > last);
+
+        if (extent_matches(extent, va_block, owner, dma_page_base)) {
+            extent->mapped      |= mask;
+            extent->chunk_start |= chunk_start_mask;
+            return;
+        }
+
+        reverse_map_extent_split(sysmem_mappings, extent, last + 1);
+    }
+
+    reverse_map_find_neighbors(sysmem_mappings, first, last, &prev, &next);
+
+    if (prev && !extent_matches(prev, va_block, owner, dma_page_base))
+        prev = NULL;
+
+    if (next && !extent_matches(next, va_block, owner, dma_page_base))
+        next = NULL;
+
+    if (prev) {
+        prev->mapped      |= mask;
+        prev->chunk_start |= chunk_start_mask;
+        reverse_map_extent_resize(sysmem_mappings, prev, prev->node.start, last);
+        reverse_map_extent_try_merge(sysmem_mappings, prev, next);
+    }
+    else if (next) {
+        next->mapped      |= mask;
+        next->chunk_start |= chunk_start_mask;
+        reverse_map_extent_resize(sysmem_mappings, next, first, next->node.end);
+    }
+    else {
+        extent = reverse_map_extent_get(sysmem_mappings);
+        extent->va_block      = va_block;
+        extent->owner         = owner;
+        extent->dma_page_base = dma_page_base;
+        extent->mapped        = mask;
+        extent->chunk_start   = chunk_start_mask;
+        extent->node.start    = first;
+        extent->node.end      = last;
+
+        reverse_map_extent_insert(sysmem_mappings, extent);
+    }
+}
+
+// Return the extent with the chunk mapping that starts at dma_page, if any
+static reverse_map_extent_t *reverse_map_find_chunk(uvm_pmm_sysmem_mappings_t *sysmem_mappings, NvU64 dma_page)
+{
+    const NvU64 bit = 1ULL << extent_window_bit(dma_page);
+    reverse_map_extent_t *extent = extent_from_node(uvm_range_tree_find(&sysmem_mappings->reverse_map_tree,
+                                                                        dma_page));
+
+    if (!extent || !(extent->mapped & bit) || !(extent->chunk_start & bit))
+        return NULL;
+
+    return extent;
+}
+
+// Return the extent with the continuation of a chunk mapping that crosses into
+// the window starting at dma_page, if any
+static reverse_map_extent_t *reverse_map_find_continuation(uvm_pmm_sysmem_mappings_t *sysmem_mappings,
+                                                           NvU64 dma_page)
+{
+    reverse_map_extent_t *extent = extent_from_node(uvm_range_tree_find(&sysmem_mappings->reverse_map_tree,
+                                                                        dma_page));
+
+    UVM_ASSERT(extent_window_bit(dma_page) == 0);
+
+    if (!extent || !(extent->mapped & 1) || (extent->chunk_start & 1))
+        return NULL;
+
+    return extent;
+}
+
+// Number of pages of the chunk mapping that starts at dma_page in extent
+static size_t reverse_map_chunk_num_pages(uvm_pmm_sysmem_mappings_t *sysmem_mappings,
+                                          reverse_map_extent_t *extent,
+                                          NvU64 dma_page)
+{
+    size_t num_pages = 0;
+
+    do {
+        unsigned num_bits = extent_chunk_piece_num_bits(extent, extent_window_bit(dma_page));
+
+        num_pages += num_bits;
+        dma_page  += num_bits;
+        if (extent_window_bit(dma_page) != 0)
+            break;
+
+        extent = reverse_map_find_continuation(sysmem_mappings, dma_page);
+    } while (extent);
+
+    return num_pages;
+}
+
+// Lock the reverse map and make sure that num_extents spare extents are
+// available on top of the reserved ones. On error, the lock is not held.
+static NV_STATUS reverse_map_lock_and_prealloc(uvm_pmm_sysmem_mappings_t *sysmem_mappings, size_t num_extents)
+{
+    uvm_mutex_lock(&sysmem_mappings->reverse_map_lock);
+
+    while (sysmem_mappings->num_spare_extents < sysmem_mappings->num_reserved_extents + num_extents) {
+        size_t num_missing = sysmem_mappings->num_reserved_extents + num_extents - sysmem_mappings->num_spare_extents;
+        LIST_HEAD(new_extents);
+        size_t i;
+
+        uvm_mutex_unlock(&sysmem_mappings->reverse_map_lock);
+
+        for (i = 0; i < num_missing; ++i) {
+            reverse_map_extent_t *extent = nv_kmem_cache_zalloc(g_reverse_map_extent_cache, NV_UVM_GFP_FLAGS);
+            if (!extent) {
+                reverse_map_extent_t *next;
+
+                list_for_each_entry_safe(extent, next, &new_extents, node.list)
+                    kmem_cache_free(g_reverse_map_extent_cache, extent);
+
+                return NV_ERR_NO_MEMORY;
+            }
+
+            list_add(&extent->node.list, &new_extents);
+        }
+
+        uvm_mutex_lock(&sysmem_mappings->reverse_map_lock);
+
+        list_splice(&new_extents, &sysmem_mappings->spare_extents);
+        sysmem_mappings->num_spare_extents += num_missing;
+    }
+
+    return NV_OK;
 }
 
 NV_STATUS uvm_pmm_sysmem_mappings_init(uvm_gpu_t *gpu, uvm_pmm_sysmem_mappings_t *sysmem_mappings)
@@ -55,24 +831,34 @@ NV_STATUS uvm_pmm_sysmem_mappings_init(uvm_gpu_t *gpu, uvm_pmm_sysmem_mappings_t
     sysmem_mappings->gpu = gpu;
 
     uvm_mutex_init(&sysmem_mappings->reverse_map_lock, UVM_LOCK_ORDER_LEAF);
-    uvm_init_radix_tree_preloadable(&sysmem_mappings->reverse_map_tree);
+    uvm_range_tree_init(&sysmem_mappings->reverse_map_tree);
+    INIT_LIST_HEAD(&sysmem_mappings->spare_extents);
 
     return NV_OK;
 }
 
 void uvm_pmm_sysmem_mappings_deinit(uvm_pmm_sysmem_mappings_t *sysmem_mappings)
 {
+    reverse_map_extent_t *extent, *next;
+
     if (sysmem_mappings->gpu) {
-        UVM_ASSERT_MSG(radix_tree_empty(&sysmem_mappings->reverse_map_tree),
-                       "radix_tree not empty for GPU %s\n",
+        UVM_ASSERT_MSG(uvm_range_tree_empty(&sysmem_mappings->reverse_map_tree),
+                       "reverse map not empty for GPU %s\n",
                        uvm_gpu_name(sysmem_mappings->gpu));
+        UVM_ASSERT(sysmem_mappings->num_reserved_extents == 0);
+
+        list_for_each_entry_safe(extent, next, &sysmem_mappings->spare_extents, node.list)
+            kmem_cache_free(g_reverse_map_extent_cache, extent);
     }
 
     sysmem_mappings->gpu = NULL;
 }
 
-// TODO: Bug 1995015: use a more efficient data structure for
-// physically-contiguous allocations.
+NvU64 uvm_pmm_sysmem_mappings_memory_usage(uvm_pmm_sysmem_mappings_t *sysmem_mappings)
+{
+    return (sysmem_mappings->num_extents + sysmem_mappings->num_spare_extents) * sizeof(reverse_map_extent_t);
+}
+
 NV_STATUS uvm_pmm_sysmem_mappings_add_gpu_mapping(uvm_pmm_sysmem_mappings_t *sysmem_mappings,
                                                   NvU64 dma_addr,
                                                   NvU64 virt_addr,
@@ -80,12 +866,12 @@ NV_STATUS uvm_pmm_sysmem_mappings_add_gpu_mapping(uvm_pmm_sysmem_mappings_t *sys
                                                   uvm_va_block_t *va_block,
                                                   uvm_processor_id_t owner)
 {
-    NV_STATUS status = NV_OK;
-    uvm_reverse_map_t *new_reverse_map;
-    NvU64 key;
-    const NvU64 base_key = dma_addr / PAGE_SIZE;
+    NV_STATUS status;
+    const NvU64 first_page = dma_addr / PAGE_SIZE;
     const NvU32 num_pages = region_size / PAGE_SIZE;
-    uvm_page_index_t page_index;
+    const NvU32 piece_pages = min(num_pages, (NvU32)UVM_REVERSE_MAP_EXTENT_PAGES);
+    NvU64 dma_page_base;
+    NvU64 page;
 
     UVM_ASSERT(va_block);
     UVM_ASSERT(!uvm_va_block_is_dead(va_block));
@@ -100,72 +886,86 @@ NV_STATUS uvm_pmm_sysmem_mappings_add_gpu_mapping(uvm_pmm_sysmem_mappings_t *sys
     if (!sysmem_mappings->gpu->parent->access_counters_supported)
         return NV_OK;
 
-    new_reverse_map = nv_kmem_cache_zalloc(g_reverse_page_map_cache, NV_UVM_GFP_FLAGS);
-    if (!new_reverse_map)
-        return NV_ERR_NO_MEMORY;
-
-    page_index = uvm_va_block_cpu_page_index(va_block, virt_addr);
+    dma_page_base = first_page - uvm_va_block_cpu_page_index(va_block, virt_addr);
 
-    new_reverse_map->va_block = va_block;
-    new_reverse_map->region   = uvm_va_block_region(page_index, page_index + num_pages);
-    new_reverse_map->owner    = owner;
+    // Each window touched by the mapping may need a new extent, plus another
+    // one if the mapping falls in a hole of an extent that has to be split
+    status = reverse_map_lock_and_prealloc(sysmem_mappings, 2 * (num_pages / piece_pages));
+    if (status != NV_OK)
+        return status;
 
-    uvm_mutex_lock(&sysmem_mappings->reverse_map_lock);
-    for (key = base_key; key < base_key + num_pages; ++key) {
-        int ret = radix_tree_insert(&sysmem_mappings->reverse_map_tree, key, new_reverse_map);
-        if (ret != 0) {
-            NvU64 remove_key;
+    // Since the region is naturally aligned, it either fits in a single window
+    // or it covers whole windows
+    for (page = first_page; page < first_page + num_pages; page += piece_pages) {
+        reverse_map_add_piece(sysmem_mappings,
+                              page,
+                              page + piece_pages - 1,
+                              page == first_page,
+                              va_block,
+                              owner,
+                              dma_page_base);
+    }
 
-            for (remove_key = base_key; remove_key < key; ++remove_key)
-                (void *)radix_tree_delete(&sysmem_mappings->reverse_map_tree, remove_key);
+    sysmem_mappings->num_mapped_pages += num_pages;
 
-            kmem_cache_free(g_reverse_page_map_cache, new_reverse_map);
-            status = errno_to_nv_status(ret);
-            break;
-        }
-    }
     uvm_mutex_unlock(&sysmem_mappings->reverse_map_lock);
 
-    // The assert is added for Coverity's sake. It is equivalent to adding
-    // assert(num_pages > 0) before the loop. However, Coverity is not able to
-    // deduce that the loop has to execute at least once from num_pages > 0.
-    UVM_ASSERT(key != base_key || status != NV_OK);
-
-    return status;
+    return NV_OK;
 }
 
 static void pmm_sysmem_mappings_remove_gpu_mapping(uvm_pmm_sysmem_mappings_t *sysmem_mappings,
                                                    NvU64 dma_addr,
                                                    bool check_mapping)
 {
-    uvm_reverse_map_t *reverse_map;
-    NvU64 key;
-    const NvU64 base_key = dma_addr / PAGE_SIZE;
+    reverse_map_extent_t *extent;
+    NvU64 page = dma_addr / PAGE_SIZE;
 
     if (!sysmem_mappings->gpu->parent->access_counters_supported)
         return;
 
     uvm_mutex_lock(&sysmem_mappings->reverse_map_lock);
 
-    reverse_map = radix_tree_delete(&sysmem_mappings->reverse_map_tree, base_key);
+    extent = reverse_map_find_chunk(sysmem_mappings, page);
     if (check_mapping)
-        UVM_ASSERT(reverse_map);
+        UVM_ASSERT(extent);
 
-    if (!reverse_map) {
+    if (!extent) {
         uvm_mutex_unlock(&sysmem_mappings->reverse_map_lock);
         return;
     }
 
-    uvm_assert_mutex_locked(&reverse_map->va_block->lock);
+    uvm_assert_mutex_locked(&extent->va_block->lock);
 
-    for (key = base_key + 1; key < base_key + uvm_va_block_region_num_pages(reverse_map->region); ++key) {
-        uvm_reverse_map_t *curr_reverse_map = radix_tree_delete(&sysmem_mappings->reverse_map_tree, key);
-        UVM_ASSERT(curr_reverse_map == reverse_map);
-    }
+    do {
+        unsigned num_bits = extent_chunk_piece_num_bits(extent, extent_window_bit(page));
+        NvU64 mask = extent_window_bits(extent_window_bit(page), num_bits);
 
-    uvm_mutex_unlock(&sysmem_mappings->reverse_map_lock);
+        extent->mapped      &= ~mask;
+        extent->chunk_start &= ~mask;
+        sysmem_mappings->num_mapped_pages -= num_bits;
 
-    kmem_cache_free(g_reverse_page_map_cache, reverse_map);
+        if (extent->mapped) {
+            reverse_map_extent_trim(sysmem_mappings, extent);
+        }
+        else {
+            reverse_map_extent_t *prev;
+            reverse_map_extent_t *next;
+
+            // Removing the extent may leave two extents with the same
+            // translation next to each other
+            reverse_map_extent_release(sysmem_mappings, extent);
+            reverse_map_find_neighbors(sysmem_mappings, page, page + num_bits - 1, &prev, &next);
+            reverse_map_extent_try_merge(sysmem_mappings, prev, next);
+        }
+
+        page += num_bits;
+        if (extent_window_bit(page) != 0)
+            break;
+
+        extent = reverse_map_find_continuation(sysmem_mappings, page);
+    } while (extent);
+
+    uvm_mutex_unlock(&sysmem_mappings->reverse_map_lock);
 }
 
 void uvm_pmm_sysmem_mappings_remove_gpu_mapping(uvm_pmm_sysmem_mappings_t *sysmem_mappings, NvU64 dma_addr)
@@ -173,19 +973,51 @@ void uvm_pmm_sysmem_mappings_remove_gpu_mapping(uvm_pmm_sysmem_mappings_t *sysme
     pmm_sysmem_mappings_remove_gpu_mapping(sysmem_mappings, dma_addr, true);
 }
 
-void uvm_pmm_sysmem_mappings_remove_gpu_mapping_on_eviction(uvm_pmm_sysmem_mappings_t *sysmem_mappings, NvU64 dma_addr)
-{
-    pmm_sysmem_mappings_remove_gpu_mapping(sysmem_mappings, dma_addr, false);
+void uvm_pmm_sysmem_mappings_remove_gpu_mapping_on_eviction(uvm_pmm_sysmem_mappings_t *sysmem_mappings, NvU64 dma_addr)
+{
+    pmm_sysmem_mappings_remove_gpu_mapping(sysmem_mappings, dma_addr, false);
+}
+
+NV_STATUS uvm_pmm_sysmem_mappings_reserve_extents(uvm_pmm_sysmem_mappings_t *sysmem_mappings, size_t num_extents)
+{
+    NV_STATUS status;
+
+    if (!sysmem_mappings->gpu->parent->access_counters_supported)
+        return NV_OK;
+
+    status = reverse_map_lock_and_prealloc(sysmem_mappings, num_extents);
+    if (status != NV_OK)
+        return status;
+
+    sysmem_mappings->num_reserved_extents += num_extents;
+
+    uvm_mutex_unlock(&sysmem_mappings->reverse_map_lock);
+
+    return NV_OK;
+}
+
+void uvm_pmm_sysmem_mappings_unreserve_extents(uvm_pmm_sysmem_mappings_t *sysmem_mappings, size_t num_extents)
+{
+    if (!sysmem_mappings->gpu->parent->access_counters_supported)
+        return;
+
+    uvm_mutex_lock(&sysmem_mappings->reverse_map_lock);
+
+    UVM_ASSERT(sysmem_mappings->num_reserved_extents >= num_extents);
+    sysmem_mappings->num_reserved_extents -= num_extents;
+
+    while (sysmem_mappings->num_spare_extents > sysmem_mappings->num_reserved_extents + REVERSE_MAP_MAX_SPARE_EXTENTS)
+        kmem_cache_free(g_reverse_map_extent_cache, reverse_map_extent_get(sysmem_mappings));
+
+    uvm_mutex_unlock(&sysmem_mappings->reverse_map_lock);
 }
 
 void uvm_pmm_sysmem_mappings_reparent_gpu_mapping(uvm_pmm_sysmem_mappings_t *sysmem_mappings,
                                                   NvU64 dma_addr,
                                                   uvm_va_block_t *va_block)
 {
-    NvU64 virt_addr;
-    uvm_reverse_map_t *reverse_map;
-    const NvU64 base_key = dma_addr / PAGE_SIZE;
-    uvm_page_index_t new_start_page;
+    reverse_map_extent_t *extent;
+    NvU64 page = dma_addr / PAGE_SIZE;
 
     UVM_ASSERT(PAGE_ALIGNED(dma_addr));
     UVM_ASSERT(va_block);
@@ -196,20 +1028,43 @@ void uvm_pmm_sysmem_mappings_reparent_gpu_mapping(uvm_pmm_sysmem_mappings_t *sys
 
     uvm_mutex_lock(&sysmem_mappings->reverse_map_lock);
 
-    reverse_map = radix_tree_lookup(&sysmem_mappings->reverse_map_tree, base_key);
-    UVM_ASSERT(reverse_map);
+    extent = reverse_map_find_chunk(sysmem_mappings, page);
+    UVM_ASSERT(extent);
+
+    do {
+        unsigned num_bits = extent_chunk_piece_num_bits(extent, extent_window_bit(page));
+
+        // All the pages of the extent at or above the start of the new VA
+        // block belong to it. Compute that page by hand since the old VA
+        // block may be messed up during split. Other chunks of the extent
+        // already moved to the new block are reparented by this call, too.
+        if (extent->va_block != va_block) {
+            NvU64 new_dma_page_base;
+
+            UVM_ASSERT(va_block->start > extent->va_block->start);
+
+            new_dma_page_base = extent->dma_page_base + (va_block->start - extent->va_block->start) / PAGE_SIZE;
+            UVM_ASSERT(new_dma_page_base <= page);
 
-    // Compute virt address by hand since the old VA block may be messed up
-    // during split
-    virt_addr = reverse_map->va_block->start + reverse_map->region.first * PAGE_SIZE;
-    new_start_page = uvm_va_block_cpu_page_index(va_block, virt_addr);
+            if (new_dma_page_base > extent->node.start)
+                extent = reverse_map_extent_split(sysmem_mappings, extent, new_dma_page_base);
 
-    reverse_map->region   = uvm_va_block_region(new_start_page,
-                                                new_start_page + uvm_va_block_region_num_pages(reverse_map->region));
-    reverse_map->va_block = va_block;
+            extent->va_block      = va_block;
+            extent->dma_page_base = new_dma_page_base;
+        }
+
+        UVM_ASSERT(uvm_va_block_contains_address(va_block,
+                                                 va_block->start + (page - extent->dma_page_base) * PAGE_SIZE));
+        UVM_ASSERT(uvm_va_block_contains_address(va_block,
+                                                 va_block->start +
+                                                 (page + num_bits - extent->dma_page_base) * PAGE_SIZE - 1));
+
+        page += num_bits;
+        if (extent_window_bit(page) != 0)
+            break;
 
-    UVM_ASSERT(uvm_va_block_contains_address(va_block, uvm_reverse_map_start(reverse_map)));
-    UVM_ASSERT(uvm_va_block_contains_address(va_block, uvm_reverse_map_end(reverse_map)));
+        extent = reverse_map_find_continuation(sysmem_mappings, page);
+    } while (extent);
 
     uvm_mutex_unlock(&sysmem_mappings->reverse_map_lock);
 }
@@ -218,12 +1073,11 @@ NV_STATUS uvm_pmm_sysmem_mappings_split_gpu_mappings(uvm_pmm_sysmem_mappings_t *
                                                      NvU64 dma_addr,
                                                      NvU64 new_region_size)
 {
-    uvm_reverse_map_t *orig_reverse_map;
-    const NvU64 base_key = dma_addr / PAGE_SIZE;
+    reverse_map_extent_t *extent;
+    const NvU64 first_page = dma_addr / PAGE_SIZE;
     const size_t num_pages = new_region_size / PAGE_SIZE;
     size_t old_num_pages;
-    size_t subregion, num_subregions;
-    uvm_reverse_map_t **new_reverse_maps;
+    NvU64 page;
 
     UVM_ASSERT(IS_ALIGNED(dma_addr, new_region_size));
     UVM_ASSERT(new_region_size <= UVM_VA_BLOCK_SIZE);
@@ -233,65 +1087,26 @@ NV_STATUS uvm_pmm_sysmem_mappings_split_gpu_mappings(uvm_pmm_sysmem_mappings_t *
         return NV_OK;
 
     uvm_mutex_lock(&sysmem_mappings->reverse_map_lock);
-    orig_reverse_map = radix_tree_lookup(&sysmem_mappings->reverse_map_tree, base_key);
-    uvm_mutex_unlock(&sysmem_mappings->reverse_map_lock);
-
-    // We can access orig_reverse_map outside the tree lock because we hold the
-    // VA block lock so we cannot have concurrent modifications in the tree for
-    // the mappings of the chunks that belong to that VA block.
-    UVM_ASSERT(orig_reverse_map);
-    UVM_ASSERT(orig_reverse_map->va_block);
-    uvm_assert_mutex_locked(&orig_reverse_map->va_block->lock);
-    old_num_pages = uvm_va_block_region_num_pages(orig_reverse_map->region);
-    UVM_ASSERT(num_pages < old_num_pages);
-
-    num_subregions = old_num_pages / num_pages;
-
-    new_reverse_maps = uvm_kvmalloc_zero(sizeof(*new_reverse_maps) * (num_subregions - 1));
-    if (!new_reverse_maps)
-        return NV_ERR_NO_MEMORY;
-
-    // Allocate the descriptors for the new subregions
-    for (subregion = 1; subregion < num_subregions; ++subregion) {
-        uvm_reverse_map_t *new_reverse_map = nv_kmem_cache_zalloc(g_reverse_page_map_cache, NV_UVM_GFP_FLAGS);
-        uvm_page_index_t page_index = orig_reverse_map->region.first + num_pages * subregion;
-
-        if (new_reverse_map == NULL) {
-            // On error, free the previously-created descriptors
-            while (--subregion != 0)
-                kmem_cache_free(g_reverse_page_map_cache, new_reverse_maps[subregion - 1]);
 
-            uvm_kvfree(new_reverse_maps);
-            return NV_ERR_NO_MEMORY;
-        }
-
-        new_reverse_map->va_block = orig_reverse_map->va_block;
-        new_reverse_map->region   = uvm_va_block_region(page_index, page_index + num_pages);
-        new_reverse_map->owner    = orig_reverse_map->owner;
-
-        new_reverse_maps[subregion - 1] = new_reverse_map;
-    }
-
-    uvm_mutex_lock(&sysmem_mappings->reverse_map_lock);
+    extent = reverse_map_find_chunk(sysmem_mappings, first_page);
+    UVM_ASSERT(extent);
+    uvm_assert_mutex_locked(&extent->va_block->lock);
 
-    for (subregion = 1; subregion < num_subregions; ++subregion) {
-        NvU64 key;
+    old_num_pages = reverse_map_chunk_num_pages(sysmem_mappings, extent, first_page);
+    UVM_ASSERT(num_pages < old_num_pages);
 
-        for (key = base_key + num_pages * subregion; key < base_key + num_pages * (subregion + 1); ++key) {
-            void **slot = radix_tree_lookup_slot(&sysmem_mappings->reverse_map_tree, key);
-            UVM_ASSERT(slot);
-            UVM_ASSERT(radix_tree_deref_slot(slot) == orig_reverse_map);
+    // Splitting a chunk mapping only needs to mark the start of the new
+    // subregions, since they share the translation of the original mapping
+    for (page = first_page + num_pages; page < first_page + old_num_pages; page += num_pages) {
+        extent = extent_from_node(uvm_range_tree_find(&sysmem_mappings->reverse_map_tree, page));
+        UVM_ASSERT(extent);
+        UVM_ASSERT(extent->mapped & (1ULL << extent_window_bit(page)));
 
-            NV_RADIX_TREE_REPLACE_SLOT(&sysmem_mappings->reverse_map_tree, slot, new_reverse_maps[subregion - 1]);
-        }
+        extent->chunk_start |= 1ULL << extent_window_bit(page);
     }
 
-    orig_reverse_map->region = uvm_va_block_region(orig_reverse_map->region.first,
-                                                   orig_reverse_map->region.first + num_pages);
-
     uvm_mutex_unlock(&sysmem_mappings->reverse_map_lock);
 
-    uvm_kvfree(new_reverse_maps);
     return NV_OK;
 }
 
@@ -299,12 +1114,11 @@ void uvm_pmm_sysmem_mappings_merge_gpu_mappings(uvm_pmm_sysmem_mappings_t *sysme
                                                 NvU64 dma_addr,
                                                 NvU64 new_region_size)
 {
-    uvm_reverse_map_t *first_reverse_map;
-    uvm_page_index_t running_page_index;
-    NvU64 key;
-    const NvU64 base_key = dma_addr / PAGE_SIZE;
-    const size_t num_pages = new_region_size / PAGE_SIZE;
-    size_t num_mapping_pages;
+    reverse_map_extent_t *first_extent;
+    uvm_range_tree_node_t *node;
+    const NvU64 first_page = dma_addr / PAGE_SIZE;
+    const NvU64 last_page = first_page + new_region_size / PAGE_SIZE - 1;
+    size_t num_mapped_pages = 0;
 
     UVM_ASSERT(IS_ALIGNED(dma_addr, new_region_size));
     UVM_ASSERT(new_region_size <= UVM_VA_BLOCK_SIZE);
@@ -315,58 +1129,25 @@ void uvm_pmm_sysmem_mappings_merge_gpu_mappings(uvm_pmm_sysmem_mappings_t *sysme
 
     uvm_mutex_lock(&sysmem_mappings->reverse_map_lock);
 
-    // Find the first mapping in the region
-    first_reverse_map = radix_tree_lookup(&sysmem_mappings->reverse_map_tree, base_key);
-    UVM_ASSERT(first_reverse_map);
-    num_mapping_pages = uvm_va_block_region_num_pages(first_reverse_map->region);
-    UVM_ASSERT(num_pages >= num_mapping_pages);
-    UVM_ASSERT(IS_ALIGNED(base_key, num_mapping_pages));
-
-    // The region in the tree matches the size of the merged region, just return
-    if (num_pages == num_mapping_pages)
-        goto unlock_no_update;
-
-    // Otherwise update the rest of slots to point at the same reverse map
-    // descriptor
-    key = base_key + uvm_va_block_region_num_pages(first_reverse_map->region);
-    running_page_index = first_reverse_map->region.outer;
-    while (key < base_key + num_pages) {
-        uvm_reverse_map_t *reverse_map = NULL;
-        void **slot = radix_tree_lookup_slot(&sysmem_mappings->reverse_map_tree, key);
-        size_t slot_index;
-        UVM_ASSERT(slot);
-
-        reverse_map = radix_tree_deref_slot(slot);
-        UVM_ASSERT(reverse_map);
-        UVM_ASSERT(reverse_map != first_reverse_map);
-        UVM_ASSERT(reverse_map->va_block == first_reverse_map->va_block);
-        UVM_ASSERT(uvm_id_equal(reverse_map->owner, first_reverse_map->owner));
-        UVM_ASSERT(reverse_map->region.first == running_page_index);
-
-        NV_RADIX_TREE_REPLACE_SLOT(&sysmem_mappings->reverse_map_tree, slot, first_reverse_map);
-
-        num_mapping_pages = uvm_va_block_region_num_pages(reverse_map->region);
-        UVM_ASSERT(IS_ALIGNED(key, num_mapping_pages));
-        UVM_ASSERT(key + num_mapping_pages <= base_key + num_pages);
-
-        for (slot_index = 1; slot_index < num_mapping_pages; ++slot_index) {
-            slot = radix_tree_lookup_slot(&sysmem_mappings->reverse_map_tree, key + slot_index);
-            UVM_ASSERT(slot);
-            UVM_ASSERT(reverse_map == radix_tree_deref_slot(slot));
-
-            NV_RADIX_TREE_REPLACE_SLOT(&sysmem_mappings->reverse_map_tree, slot, first_reverse_map);
-        }
+    first_extent = reverse_map_find_chunk(sysmem_mappings, first_page);
+    UVM_ASSERT(first_extent);
 
-        key += num_mapping_pages;
-        running_page_index = reverse_map->region.outer;
+    // All the pages in the region share the same translation, so merging the
+    // chunk mappings only needs to clear the start of all but the first one
+    uvm_range_tree_for_each_in(node, &sysmem_mappings->reverse_map_tree, first_page, last_page) {
+        reverse_map_extent_t *extent = extent_from_node(node);
+        NvU64 mask = extent_window_mask(max(node->start, first_page), min(node->end, last_page));
 
-        kmem_cache_free(g_reverse_page_map_cache, reverse_map);
+        UVM_ASSERT(extent_matches(extent, first_extent->va_block, first_extent->owner, first_extent->dma_page_base));
+
+        num_mapped_pages += hweight64(extent->mapped & mask);
+        extent->chunk_start &= ~mask;
     }
 
-    // Grow the first mapping to cover the whole region
-    first_reverse_map->region.outer = first_reverse_map->region.first + num_pages;
+    UVM_ASSERT(num_mapped_pages == last_page - first_page + 1);
+
+    first_extent->chunk_start |= 1ULL << extent_window_bit(first_page);
 
-unlock_no_update:
     uvm_mutex_unlock(&sysmem_mappings->reverse_map_lock);
 }
 
@@ -376,10 +1157,11 @@ size_t uvm_pmm_sysmem_mappings_dma_to_virt(uvm_pmm_sysmem_mappings_t *sysmem_map
                                            uvm_reverse_map_t *out_mappings,
                                            size_t max_out_mappings)
 {
-    NvU64 key;
+    uvm_range_tree_node_t *node;
     size_t num_mappings = 0;
-    const NvU64 base_key = dma_addr / PAGE_SIZE;
-    NvU32 num_pages = region_size / PAGE_SIZE;
+    NvU64 next_dma_page = 0;
+    const NvU64 first_page = dma_addr / PAGE_SIZE;
+    const NvU64 last_page = first_page + region_size / PAGE_SIZE - 1;
 
     UVM_ASSERT(region_size >= PAGE_SIZE);
     UVM_ASSERT(PAGE_ALIGNED(region_size));
@@ -388,41 +1170,279 @@ size_t uvm_pmm_sysmem_mappings_dma_to_virt(uvm_pmm_sysmem_mappings_t *sysmem_map
 
     uvm_mutex_lock(&sysmem_mappings->reverse_map_lock);
 
-    key = base_key;
-    do {
-        uvm_reverse_map_t *reverse_map = radix_tree_lookup(&sysmem_mappings->reverse_map_tree, key);
-
-        if (reverse_map) {
-            size_t num_chunk_pages = uvm_va_block_region_num_pages(reverse_map->region);
-            NvU32 page_offset = key & (num_chunk_pages - 1);
-            NvU32 num_mapping_pages = min(num_pages, (NvU32)num_chunk_pages - page_offset);
-
-            // Sysmem mappings are removed during VA block destruction.
-            // Therefore, we can safely retain the VA blocks as long as they
-            // are in the reverse map and we hold the reverse map lock.
-            uvm_va_block_retain(reverse_map->va_block);
-            out_mappings[num_mappings]               = *reverse_map;
-            out_mappings[num_mappings].region.first += page_offset;
-            out_mappings[num_mappings].region.outer  = out_mappings[num_mappings].region.first + num_mapping_pages;
-
-            if (++num_mappings == max_out_mappings)
-                break;
+    uvm_range_tree_for_each_in(node, &sysmem_mappings->reverse_map_tree, first_page, last_page) {
+        reverse_map_extent_t *extent = extent_from_node(node);
+        const NvU64 window_first = extent_window_first(node->start);
+        NvU64 mask = extent->mapped & extent_window_mask(max(node->start, first_page), min(node->end, last_page));
+
+        // Translate each run of contiguous mapped pages, merging it with the
+        // previous translation if both are contiguous
+        while (mask) {
+            unsigned first_bit = __ffs64(mask);
+            NvU64 run = mask >> first_bit;
+            unsigned num_bits = ~run ? __ffs64(~run) : UVM_REVERSE_MAP_EXTENT_PAGES - first_bit;
+            NvU64 run_first_page = window_first + first_bit;
+            uvm_page_index_t page_index = run_first_page - extent->dma_page_base;
+            uvm_reverse_map_t *prev = num_mappings > 0 ? &out_mappings[num_mappings - 1] : NULL;
+
+            mask &= ~extent_window_bits(first_bit, num_bits);
+
+            if (prev &&
+                prev->va_block == extent->va_block &&
+                uvm_id_equal(prev->owner, extent->owner) &&
+                prev->region.outer == page_index &&
+                next_dma_page == run_first_page) {
+                prev->region.outer += num_bits;
+            }
+            else {
+                if (num_mappings == max_out_mappings)
+                    goto out;
+
+                // Sysmem mappings are removed during VA block destruction.
+                // Therefore, we can safely retain the VA blocks as long as
+                // they are in the reverse map and we hold the reverse map
+                // lock.
+                uvm_va_block_retain(extent->va_block);
+                out_mappings[num_mappings].va_block = extent->va_block;
+                out_mappings[num_mappings].owner    = extent->owner;
+                out_mappings[num_mappings].region   = uvm_va_block_region(page_index, page_index + num_bits);
+                ++num_mappings;
+            }
 
-            num_pages -= num_mapping_pages;
-            key       += num_mapping_pages;
-        }
-        else {
-            --num_pages;
-            ++key;
+            next_dma_page = run_first_page + num_bits;
         }
     }
-    while (num_pages > 0);
 
+out:
     uvm_mutex_unlock(&sysmem_mappings->reverse_map_lock);
 
     return num_mappings;
 }
 
+void uvm_pmm_sysmem_dma_cache_init(uvm_gpu_t *gpu, uvm_pmm_sysmem_dma_cache_t *dma_cache)
+{
+    memset(dma_cache, 0, sizeof(*dma_cache));
+
+    dma_cache->gpu = gpu;
+    uvm_spin_lock_init(&dma_cache->lock, UVM_LOCK_ORDER_LEAF);
+    uvm_init_radix_tree_preloadable(&dma_cache->tree);
+    INIT_LIST_HEAD(&dma_cache->lru);
+
+    uvm_mutex_lock(&g_dma_caches.lock);
+    list_add_tail_rcu(&dma_cache->list_node, &g_dma_caches.caches);
+    uvm_mutex_unlock(&g_dma_caches.lock);
+}
+
+// Remove the entry from the cache. The caller must hold the cache lock, and
+// unmap and free the entry with dma_cache_entry_free() once it has dropped it.
+static void dma_cache_entry_remove(uvm_pmm_sysmem_dma_cache_t *dma_cache, dma_cache_entry_t *entry)
+{
+    uvm_assert_spinlock_locked(&dma_cache->lock);
+
+    radix_tree_delete(&dma_cache->tree, page_to_pfn(entry->page));
+    list_del(&entry->lru_node);
+    --dma_cache->count;
+    atomic64_dec(&g_dma_caches.num_mappings);
+}
+
+// Unmap and free an entry removed from its cache
+static void dma_cache_entry_free(dma_cache_entry_t *entry)
+{
+    uvm_gpu_unmap_cpu_pages(entry->gpu, entry->dma_addr, entry->size);
+    kmem_cache_free(g_dma_caches.entry_cache, entry);
+}
+
+void uvm_pmm_sysmem_dma_cache_deinit(uvm_pmm_sysmem_dma_cache_t *dma_cache)
+{
+    dma_cache_entry_t *entry, *next;
+    LIST_HEAD(free_list);
+
+    if (!dma_cache->gpu)
+        return;
+
+    // Page releases may still be unmapping entries of the cache, wait for
+    // them to be done before tearing it down.
+    uvm_mutex_lock(&g_dma_caches.lock);
+    list_del_rcu(&dma_cache->list_node);
+    uvm_mutex_unlock(&g_dma_caches.lock);
+
+    synchronize_rcu();
+
+    uvm_spin_lock(&dma_cache->lock);
+
+    list_for_each_entry_safe(entry, next, &dma_cache->lru, lru_node) {
+        dma_cache_entry_remove(dma_cache, entry);
+        list_add_tail(&entry->lru_node, &free_list);
+    }
+
+    uvm_spin_unlock(&dma_cache->lock);
+
+    list_for_each_entry_safe(entry, next, &free_list, lru_node)
+        dma_cache_entry_free(entry);
+
+    UVM_ASSERT(dma_cache->count == 0);
+    UVM_ASSERT(radix_tree_empty(&dma_cache->tree));
+
+    dma_cache->gpu = NULL;
+}
+
+NV_STATUS uvm_pmm_sysmem_dma_cache_map(uvm_gpu_t *gpu, struct page *page, size_t size, NvU64 *dma_address_out)
+{
+    uvm_pmm_sysmem_dma_cache_t *dma_cache = &gpu->pmm_sysmem_dma_cache;
+    dma_cache_entry_t *entry = NULL;
+
+    if (atomic64_read(&g_dma_caches.num_mappings) > 0) {
+        uvm_spin_lock(&dma_cache->lock);
+
+        entry = radix_tree_lookup(&dma_cache->tree, page_to_pfn(page));
+        if (entry) {
+            UVM_ASSERT(entry->page == page);
+            dma_cache_entry_remove(dma_cache, entry);
+        }
+
+        uvm_spin_unlock(&dma_cache->lock);
+    }
+
+    if (entry && entry->size == size) {
+        *dma_address_out = entry->dma_addr;
+        kmem_cache_free(g_dma_caches.entry_cache, entry);
+
+        // The page contents may have been written by the CPU since the mapping
+        // was cached, e.g. when zeroing a recycled page.
+        uvm_gpu_sync_cpu_pages_for_device(gpu, *dma_address_out, size);
+        atomic64_inc(&dma_cache->stats.hits);
+        return NV_OK;
+    }
+
+    // A cached mapping of a different size is stale and it is dropped
+    if (entry)
+        dma_cache_entry_free(entry);
+
+    atomic64_inc(&dma_cache->stats.misses);
+
+    return uvm_gpu_map_cpu_pages(gpu, page, size, dma_address_out);
+}
+
+void uvm_pmm_sysmem_dma_cache_unmap(uvm_gpu_t *gpu, struct page *page, NvU64 dma_address, size_t size)
+{
+    uvm_pmm_sysmem_dma_cache_t *dma_cache = &gpu->pmm_sysmem_dma_cache;
+    dma_cache_entry_t *entry = NULL;
+    dma_cache_entry_t *victim, *next;
+    LIST_HEAD(victims);
+    size_t num_unmapped = 0;
+    int ret;
+
+    if (uvm_dma_cache_max_mappings > 0)
+        entry = nv_kmem_cache_zalloc(g_dma_caches.entry_cache, NV_UVM_GFP_FLAGS);
+
+    if (!entry) {
+        uvm_gpu_unmap_cpu_pages(gpu, dma_address, size);
+        return;
+    }
+
+    entry->gpu = gpu;
+    entry->page = page;
+    entry->dma_addr = dma_address;
+    entry->size = size;
+
+    uvm_spin_lock(&dma_cache->lock);
+
+    // The tree is initialized with GFP_NOWAIT so the insertion can fail under
+    // memory pressure. In that case the mapping is simply not cached.
+    ret = radix_tree_insert(&dma_cache->tree, page_to_pfn(page), entry);
+    if (ret == 0) {
+        list_add_tail(&entry->lru_node, &dma_cache->lru);
+        ++dma_cache->count;
+        atomic64_inc(&g_dma_caches.num_mappings);
+
+        if (dma_cache->count > uvm_dma_cache_max_mappings) {
+            while (!list_empty(&dma_cache->lru) && num_unmapped < DMA_CACHE_UNMAP_BATCH_SIZE) {
+                victim = list_first_entry(&dma_cache->lru, dma_cache_entry_t, lru_node);
+                dma_cache_entry_remove(dma_cache, victim);
+                list_add_tail(&victim->lru_node, &victims);
+                ++num_unmapped;
+            }
+        }
+    }
+
+    uvm_spin_unlock(&dma_cache->lock);
+
+    // The evicted mappings are torn down outside of the lock
+    list_for_each_entry_safe(victim, next, &victims, lru_node)
+        dma_cache_entry_free(victim);
+
+    if (ret != 0) {
+        uvm_gpu_unmap_cpu_pages(gpu, dma_address, size);
+        kmem_cache_free(g_dma_caches.entry_cache, entry);
+        return;
+    }
+
+    if (num_unmapped > 0) {
+        atomic64_inc(&dma_cache->stats.unmap_batches);
+        atomic64_add(num_unmapped, &dma_cache->stats.unmap_batch_mappings);
+    }
+}
+
+void uvm_pmm_sysmem_dma_cache_release_pages(struct page *page, size_t size)
+{
+    uvm_pmm_sysmem_dma_cache_t *dma_cache;
+    unsigned long first_pfn = page_to_pfn(page);
+    unsigned long end_pfn = first_pfn + size / PAGE_SIZE;
+
+    UVM_ASSERT(PAGE_ALIGNED(size));
+
+    // Mappings of the pages can only be added by their owner, which is the
+    // caller, so there is no race with the checks below.
+    if (atomic64_read(&g_dma_caches.num_mappings) == 0)
+        return;
+
+    // This is called when the shrinker trims the CPU chunk cache, so it must
+    // not sleep on a lock held by the map paths. The caches are walked under
+    // RCU, which also keeps their GPUs from going away, and looked up without
+    // their lock first, so that it's only taken for the GPUs that actually
+    // have a mapping of one of the pages.
+    //
+    // Mappings are keyed by the first page they map, and mappings of split
+    // chunks start in the middle of the original allocation, so every page
+    // needs to be looked up.
+    rcu_read_lock();
+
+    list_for_each_entry_rcu(dma_cache, &g_dma_caches.caches, list_node) {
+        dma_cache_entry_t *entry, *next;
+        LIST_HEAD(free_list);
+        unsigned long pfn;
+
+        for (pfn = first_pfn; pfn < end_pfn; ++pfn) {
+            if (radix_tree_lookup(&dma_cache->tree, pfn))
+                break;
+        }
+
+        if (pfn == end_pfn)
+            continue;
+
+        uvm_spin_lock(&dma_cache->lock);
+
+        for (; pfn < end_pfn; ++pfn) {
+            entry = radix_tree_lookup(&dma_cache->tree, pfn);
+            if (entry) {
+                dma_cache_entry_remove(dma_cache, entry);
+                list_add_tail(&entry->lru_node, &free_list);
+            }
+        }
+
+        uvm_spin_unlock(&dma_cache->lock);
+
+        list_for_each_entry_safe(entry, next, &free_list, lru_node) {
+            UVM_ASSERT(page_to_pfn(entry->page) + entry->size / PAGE_SIZE <= end_pfn);
+
+            dma_cache_entry_free(entry);
+            atomic64_inc(&dma_cache->stats.page_release_unmaps);
+        }
+    }
+
+    rcu_read_unlock();
+}
+
 uvm_chunk_sizes_mask_t uvm_cpu_chunk_get_allocation_sizes(void)
 {
         return uvm_cpu_chunk_allocation_sizes & UVM_CPU_CHUNK_SIZES;
@@ -450,6 +1470,247 @@ uvm_chunk_size_t uvm_cpu_chunk_get_size(uvm_cpu_chunk_t *chunk)
 #endif
 }
 
+// Compact tables are promoted when they overflow, but only demoted back once
+// half of the compact entries are free so that a table whose number of mapped
+// pages hovers around the compact capacity doesn't keep flipping between both
+// forms.
+#define CPU_DMA_ADDRS_DEMOTE_THRESHOLD (UVM_CPU_DMA_ADDRS_COMPACT_ENTRIES / 2)
+
+static int cpu_dma_addrs_compact_find(const uvm_cpu_dma_addrs_t *dma_addrs, uvm_page_index_t page_index)
+{
+    NvU32 i;
+
+    for (i = 0; i < dma_addrs->num_mapped; ++i) {
+        if (dma_addrs->compact_pages[i] == page_index)
+            return i;
+    }
+
+    return -1;
+}
+
+static void cpu_dma_addrs_compact_add(uvm_cpu_dma_addrs_t *dma_addrs, uvm_page_index_t page_index, NvU64 dma_addr)
+{
+    UVM_ASSERT(dma_addrs->num_mapped < UVM_CPU_DMA_ADDRS_COMPACT_ENTRIES);
+
+    dma_addrs->compact_pages[dma_addrs->num_mapped] = page_index;
+    dma_addrs->compact_dma_addrs[dma_addrs->num_mapped] = dma_addr;
+    ++dma_addrs->num_mapped;
+}
+
+// Switch a full table with few enough mapped pages back to the compact form
+static void cpu_dma_addrs_try_demote(uvm_cpu_dma_addrs_t *dma_addrs, size_t num_pages)
+{
+    NvU64 *full = dma_addrs->full;
+    size_t i;
+
+    if (!full || dma_addrs->num_mapped > CPU_DMA_ADDRS_DEMOTE_THRESHOLD)
+        return;
+
+    dma_addrs->full = NULL;
+    dma_addrs->num_mapped = 0;
+
+    for (i = 0; i < num_pages; ++i) {
+        if (full[i])
+            cpu_dma_addrs_compact_add(dma_addrs, i, full[i]);
+    }
+
+    uvm_kvfree(full);
+}
+
+NV_STATUS uvm_cpu_dma_addrs_set(uvm_cpu_dma_addrs_t *dma_addrs,
+                                size_t num_pages,
+                                uvm_page_index_t page_index,
+                                NvU64 dma_addr)
+{
+    NvU64 *full;
+    NvU32 i;
+    int index;
+
+    UVM_ASSERT(page_index < num_pages);
+
+    if (dma_addrs->full) {
+        NvU64 old_dma_addr = dma_addrs->full[page_index];
+
+        dma_addrs->full[page_index] = dma_addr;
+
+        if (old_dma_addr && !dma_addr) {
+            --dma_addrs->num_mapped;
+            cpu_dma_addrs_try_demote(dma_addrs, num_pages);
+        }
+        else if (!old_dma_addr && dma_addr) {
+            ++dma_addrs->num_mapped;
+        }
+
+        return NV_OK;
+    }
+
+    index = cpu_dma_addrs_compact_find(dma_addrs, page_index);
+    if (index >= 0) {
+        if (dma_addr) {
+            dma_addrs->compact_dma_addrs[index] = dma_addr;
+        }
+        else {
+            // Move the last entry into the hole
+            --dma_addrs->num_mapped;
+            dma_addrs->compact_pages[index] = dma_addrs->compact_pages[dma_addrs->num_mapped];
+            dma_addrs->compact_dma_addrs[index] = dma_addrs->compact_dma_addrs[dma_addrs->num_mapped];
+        }
+
+        return NV_OK;
+    }
+
+    if (!dma_addr)
+        return NV_OK;
+
+    if (dma_addrs->num_mapped < UVM_CPU_DMA_ADDRS_COMPACT_ENTRIES) {
+        cpu_dma_addrs_compact_add(dma_addrs, page_index, dma_addr);
+        return NV_OK;
+    }
+
+    // Promote to the full table
+    full = uvm_kvmalloc_zero(num_pages * sizeof(full[0]));
+    if (!full)
+        return NV_ERR_NO_MEMORY;
+
+    for (i = 0; i < dma_addrs->num_mapped; ++i)
+        full[dma_addrs->compact_pages[i]] = dma_addrs->compact_dma_addrs[i];
+
+    full[page_index] = dma_addr;
+    dma_addrs->full = full;
+    ++dma_addrs->num_mapped;
+
+    return NV_OK;
+}
+
+NvU64 uvm_cpu_dma_addrs_get(const uvm_cpu_dma_addrs_t *dma_addrs, uvm_page_index_t page_index)
+{
+    int index;
+
+    if (dma_addrs->full)
+        return dma_addrs->full[page_index];
+
+    index = cpu_dma_addrs_compact_find(dma_addrs, page_index);
+    if (index < 0)
+        return 0;
+
+    return dma_addrs->compact_dma_addrs[index];
+}
+
+static NvU32 cpu_dma_addrs_count_from(const uvm_cpu_dma_addrs_t *dma_addrs,
+                                      size_t num_pages,
+                                      uvm_page_index_t first_page_index)
+{
+    NvU32 count = 0;
+    size_t i;
+
+    if (dma_addrs->full) {
+        for (i = first_page_index; i < num_pages; ++i)
+            count += dma_addrs->full[i] != 0;
+    }
+    else {
+        for (i = 0; i < dma_addrs->num_mapped; ++i)
+            count += dma_addrs->compact_pages[i] >= first_page_index;
+    }
+
+    return count;
+}
+
+NV_STATUS uvm_cpu_dma_addrs_split_prealloc(const uvm_cpu_dma_addrs_t *dma_addrs,
+                                           uvm_cpu_dma_addrs_t *new_dma_addrs,
+                                           uvm_page_index_t split_page_index,
+                                           size_t new_pages)
+{
+    UVM_ASSERT(new_dma_addrs->num_mapped == 0);
+
+    if (new_dma_addrs->full)
+        return NV_OK;
+
+    if (cpu_dma_addrs_count_from(dma_addrs, split_page_index + new_pages, split_page_index) <=
+        UVM_CPU_DMA_ADDRS_COMPACT_ENTRIES)
+        return NV_OK;
+
+    new_dma_addrs->full = uvm_kvmalloc_zero(new_pages * sizeof(new_dma_addrs->full[0]));
+    if (!new_dma_addrs->full)
+        return NV_ERR_NO_MEMORY;
+
+    return NV_OK;
+}
+
+void uvm_cpu_dma_addrs_split(uvm_cpu_dma_addrs_t *dma_addrs,
+                             uvm_cpu_dma_addrs_t *new_dma_addrs,
+                             size_t num_pages,
+                             uvm_page_index_t split_page_index)
+{
+    size_t new_pages = num_pages - split_page_index;
+    NvU32 i;
+
+    UVM_ASSERT(new_dma_addrs->num_mapped == 0);
+
+    if (dma_addrs->full) {
+        size_t page_index;
+
+        for (page_index = split_page_index; page_index < num_pages; ++page_index) {
+            NvU64 dma_addr = dma_addrs->full[page_index];
+
+            if (!dma_addr)
+                continue;
+
+            if (new_dma_addrs->full) {
+                new_dma_addrs->full[page_index - split_page_index] = dma_addr;
+                ++new_dma_addrs->num_mapped;
+            }
+            else {
+                cpu_dma_addrs_compact_add(new_dma_addrs, page_index - split_page_index, dma_addr);
+            }
+
+            dma_addrs->full[page_index] = 0;
+            --dma_addrs->num_mapped;
+        }
+
+        cpu_dma_addrs_try_demote(dma_addrs, split_page_index);
+    }
+    else {
+        i = 0;
+        while (i < dma_addrs->num_mapped) {
+            uvm_page_index_t page_index = dma_addrs->compact_pages[i];
+            NvU64 dma_addr = dma_addrs->compact_dma_addrs[i];
+
+            if (page_index < split_page_index) {
+                ++i;
+                continue;
+            }
+
+            if (new_dma_addrs->full) {
+                new_dma_addrs->full[page_index - split_page_index] = dma_addr;
+                ++new_dma_addrs->num_mapped;
+            }
+            else {
+                cpu_dma_addrs_compact_add(new_dma_addrs, page_index - split_page_index, dma_addr);
+            }
+
+            --dma_addrs->num_mapped;
+            dma_addrs->compact_pages[i] = dma_addrs->compact_pages[dma_addrs->num_mapped];
+            dma_addrs->compact_dma_addrs[i] = dma_addrs->compact_dma_addrs[dma_addrs->num_mapped];
+        }
+    }
+
+    cpu_dma_addrs_try_demote(new_dma_addrs, new_pages);
+}
+
+void uvm_cpu_dma_addrs_free(uvm_cpu_dma_addrs_t *dma_addrs)
+{
+    uvm_kvfree(dma_addrs->full);
+    memset(dma_addrs, 0, sizeof(*dma_addrs));
+}
+
+size_t uvm_cpu_dma_addrs_allocated_size(const uvm_cpu_dma_addrs_t *dma_addrs, size_t num_pages)
+{
+    if (!dma_addrs->full)
+        return 0;
+
+    return num_pages * sizeof(dma_addrs->full[0]);
+}
+
 #if UVM_CPU_CHUNK_SIZE_IS_PAGE_SIZE()
 struct page *uvm_cpu_chunk_get_cpu_page(uvm_va_block_t *va_block, uvm_cpu_chunk_t *chunk, uvm_page_index_t page_index)
 {
@@ -460,31 +1721,48 @@ struct page *uvm_cpu_chunk_get_cpu_page(uvm_va_block_t *va_block, uvm_cpu_chunk_
 void uvm_cpu_chunk_put(uvm_cpu_chunk_t *chunk)
 {
     UVM_ASSERT(chunk);
-    put_page(chunk);
+
+    if (!uvm_cpu_chunk_cache_free_page(chunk)) {
+        uvm_pmm_sysmem_dma_cache_release_pages(chunk, PAGE_SIZE);
+        put_page(chunk);
+    }
 }
 
 NV_STATUS uvm_cpu_chunk_gpu_mapping_alloc(uvm_va_block_t *va_block, uvm_gpu_id_t id)
 {
     uvm_va_block_gpu_state_t *gpu_state = uvm_va_block_gpu_state_get(va_block, id);
-    size_t num_pages = uvm_va_block_num_cpu_pages(va_block);
 
+    // The table starts out in the compact form embedded in the GPU state, so
+    // there is nothing to allocate yet.
     UVM_ASSERT(gpu_state);
-    gpu_state->cpu_chunks_dma_addrs = uvm_kvmalloc_zero(num_pages * sizeof(gpu_state->cpu_chunks_dma_addrs[0]));
-    if (!gpu_state->cpu_chunks_dma_addrs)
-        return NV_ERR_NO_MEMORY;
+    UVM_ASSERT(!gpu_state->cpu_chunks_dma_addrs.full);
+    UVM_ASSERT(gpu_state->cpu_chunks_dma_addrs.num_mapped == 0);
 
     return NV_OK;
 }
 
-void uvm_cpu_chunk_gpu_mapping_split(uvm_va_block_t *existing, uvm_va_block_t *new, uvm_gpu_id_t id)
+NV_STATUS uvm_cpu_chunk_gpu_mapping_split_prealloc(uvm_va_block_t *existing, uvm_va_block_t *new, uvm_gpu_id_t id)
 {
     uvm_va_block_gpu_state_t *existing_state = uvm_va_block_gpu_state_get(existing, id);
     uvm_va_block_gpu_state_t *new_state = uvm_va_block_gpu_state_get(new, id);
     size_t new_pages = uvm_va_block_num_cpu_pages(new);
 
-    memcpy(&new_state->cpu_chunks_dma_addrs[0],
-           &existing_state->cpu_chunks_dma_addrs[uvm_va_block_num_cpu_pages(existing) - new_pages],
-           new_pages * sizeof(new_state->cpu_chunks_dma_addrs[0]));
+    return uvm_cpu_dma_addrs_split_prealloc(&existing_state->cpu_chunks_dma_addrs,
+                                            &new_state->cpu_chunks_dma_addrs,
+                                            uvm_va_block_num_cpu_pages(existing) - new_pages,
+                                            new_pages);
+}
+
+void uvm_cpu_chunk_gpu_mapping_split(uvm_va_block_t *existing, uvm_va_block_t *new, uvm_gpu_id_t id)
+{
+    uvm_va_block_gpu_state_t *existing_state = uvm_va_block_gpu_state_get(existing, id);
+    uvm_va_block_gpu_state_t *new_state = uvm_va_block_gpu_state_get(new, id);
+    size_t existing_pages = uvm_va_block_num_cpu_pages(existing);
+
+    uvm_cpu_dma_addrs_split(&existing_state->cpu_chunks_dma_addrs,
+                            &new_state->cpu_chunks_dma_addrs,
+                            existing_pages,
+                            existing_pages - uvm_va_block_num_cpu_pages(new));
 }
 
 void uvm_cpu_chunk_gpu_mapping_free(uvm_va_block_t *va_block, uvm_gpu_id_t id)
@@ -492,7 +1770,7 @@ void uvm_cpu_chunk_gpu_mapping_free(uvm_va_block_t *va_block, uvm_gpu_id_t id)
     uvm_va_block_gpu_state_t *gpu_state = uvm_va_block_gpu_state_get(va_block, id);
 
     if (gpu_state)
-        uvm_kvfree(gpu_state->cpu_chunks_dma_addrs);
+        uvm_cpu_dma_addrs_free(&gpu_state->cpu_chunks_dma_addrs);
 }
 
 NV_STATUS uvm_cpu_chunk_set_gpu_mapping_addr(uvm_va_block_t *va_block,
@@ -503,8 +1781,10 @@ NV_STATUS uvm_cpu_chunk_set_gpu_mapping_addr(uvm_va_block_t *va_block,
 {
     uvm_va_block_gpu_state_t *gpu_state = uvm_va_block_gpu_state_get(va_block, id);
 
-    gpu_state->cpu_chunks_dma_addrs[page_index] = dma_addr;
-    return NV_OK;
+    return uvm_cpu_dma_addrs_set(&gpu_state->cpu_chunks_dma_addrs,
+                                 uvm_va_block_num_cpu_pages(va_block),
+                                 page_index,
+                                 dma_addr);
 }
 
 NvU64 uvm_cpu_chunk_get_gpu_mapping_addr(uvm_va_block_t *va_block,
@@ -514,7 +1794,7 @@ NvU64 uvm_cpu_chunk_get_gpu_mapping_addr(uvm_va_block_t *va_block,
 {
     uvm_va_block_gpu_state_t *gpu_state = uvm_va_block_gpu_state_get(va_block, id);
 
-    return gpu_state->cpu_chunks_dma_addrs[page_index];
+    return uvm_cpu_dma_addrs_get(&gpu_state->cpu_chunks_dma_addrs, page_index);
 }
 
 NV_STATUS uvm_cpu_chunk_insert_in_block(uvm_va_block_t *va_block, uvm_cpu_chunk_t *chunk, uvm_page_index_t page_index)
@@ -564,7 +1844,9 @@ NV_STATUS uvm_cpu_chunk_alloc(uvm_va_block_t *va_block, uvm_page_index_t page_in
     if (!uvm_va_block_page_resident_processors_count(va_block, page_index))
         alloc_flags |= __GFP_ZERO;
 
-    chunk = alloc_pages(alloc_flags, 0);
+    chunk = uvm_cpu_chunk_cache_alloc_page(numa_mem_id(), alloc_flags);
+    if (!chunk)
+        chunk = alloc_pages(alloc_flags, 0);
     if (!chunk)
         return NV_ERR_NO_MEMORY;
 
@@ -611,7 +1893,10 @@ static void cpu_chunk_release(nv_kref_t *kref)
     if (!parent) {
         uvm_assert_spinlock_unlocked(&chunk->lock);
         uvm_kvfree(chunk->dirty_bitmap);
-        put_page(chunk->page);
+        if (uvm_cpu_chunk_get_phys_size(chunk) != PAGE_SIZE || !uvm_cpu_chunk_cache_free_page(chunk->page)) {
+            uvm_pmm_sysmem_dma_cache_release_pages(chunk->page, uvm_cpu_chunk_get_phys_size(chunk));
+            put_page(chunk->page);
+        }
     }
     else {
         uvm_cpu_chunk_put(parent);
@@ -638,6 +1923,11 @@ NV_STATUS uvm_cpu_chunk_gpu_mapping_alloc(uvm_va_block_t *va_block, uvm_gpu_id_t
     return NV_OK;
 }
 
+NV_STATUS uvm_cpu_chunk_gpu_mapping_split_prealloc(uvm_va_block_t *existing, uvm_va_block_t *new, uvm_gpu_id_t id)
+{
+    return NV_OK;
+}
+
 void uvm_cpu_chunk_gpu_mapping_split(uvm_va_block_t *existing, uvm_va_block_t *va_block, uvm_gpu_id_t id)
 {
     return;
@@ -1163,7 +2453,10 @@ NV_STATUS uvm_cpu_chunk_alloc(uvm_va_block_t *va_block, uvm_page_index_t page_in
         if (!uvm_page_mask_region_full(&zero_page_mask, region))
             alloc_flags |= __GFP_ZERO;
 
-        page = alloc_pages(alloc_flags, get_order(alloc_size));
+        if (alloc_size == PAGE_SIZE)
+            page = uvm_cpu_chunk_cache_alloc_page(numa_mem_id(), alloc_flags);
+        if (!page)
+            page = alloc_pages(alloc_flags, get_order(alloc_size));
         if (page) {
             if (alloc_flags & __GFP_ZERO)
                 SetPageDirty(page);
@@ -1210,8 +2503,10 @@ error:
     // and the page. Otherwise, only release the page.
     if (chunk)
         uvm_cpu_chunk_put(chunk);
-    else if (page)
+    else if (page) {
+        uvm_pmm_sysmem_dma_cache_release_pages(page, alloc_size);
         __free_pages(page, get_order(alloc_size));
+    }
 
     return status;
 }
@@ -28,26 +28,99 @@
 #include "uvm_linux.h"
 #include "uvm_forward_decl.h"
 #include "uvm_lock.h"
+#include "uvm_range_tree.h"
 
 // Module to handle per-GPU mappings to sysmem physical memory. Notably,
 // this implements a reverse map of the DMA address to {va_block, virt_addr}.
 // This is required by the GPU access counters feature since they may provide a
 // physical address in the notification packet (GPA notifications). We use the
-// table to obtain the VAs of the memory regions being accessed remotely. The
-// reverse map is implemented by a radix tree, which is indexed using the
-// DMA address. For now, only PAGE_SIZE translations are supported (i.e. no
-// big/huge pages).
+// table to obtain the VAs of the memory regions being accessed remotely.
 //
-// TODO: Bug 1995015: add support for physically-contiguous mappings.
+// The reverse map is a range tree of extents indexed by DMA page number. An
+// extent stores the translation of a set of DMA pages that belong to the same
+// VA block and owner, and that are contiguous both in the DMA and the virtual
+// address spaces, so contiguous mappings only need a single entry regardless
+// of the size of the chunks being mapped. Extents are bounded to
+// naturally-aligned windows of UVM_REVERSE_MAP_EXTENT_PAGES pages, and track
+// which pages of the window are mapped and where each chunk mapping starts with
+// per-window bitmasks. Hence, splitting and merging chunk mappings doesn't
+// require any allocation. Only PAGE_SIZE translations are supported (i.e. no
+// big/huge pages).
+#define UVM_REVERSE_MAP_EXTENT_PAGES 64
+
 struct uvm_pmm_sysmem_mappings_struct
 {
     uvm_gpu_t                                      *gpu;
 
-    struct radix_tree_root             reverse_map_tree;
+    uvm_range_tree_t                   reverse_map_tree;
 
     uvm_mutex_t                        reverse_map_lock;
+
+    // Free extent descriptors, used to update the tree without allocating
+    // memory under the lock. num_reserved_extents of them are set aside for
+    // uvm_pmm_sysmem_mappings_reparent_gpu_mapping, which cannot fail.
+    struct list_head                      spare_extents;
+    size_t                            num_spare_extents;
+    size_t                         num_reserved_extents;
+
+    // Number of extents in the tree and of DMA pages they map. Protected by
+    // reverse_map_lock, but they may be read without it for reporting.
+    size_t                                  num_extents;
+    NvU64                              num_mapped_pages;
 };
 
+// Per-GPU cache of idle DMA mappings of sysmem pages owned by UVM. When a VA
+// block tears down the GPU mapping of one of its CPU chunks, the mapping is
+// parked in the cache instead of being unmapped, keyed by the page it maps.
+// If the same page is mapped on the GPU again (for example after being
+// recycled by the CPU chunk cache, or when the GPU is registered again in the
+// VA space), the cached DMA address is reused and the dma_map/IOMMU update is
+// skipped.
+//
+// Idle mappings are unmapped lazily in batches of the oldest entries once the
+// cache grows beyond the uvm_dma_cache_max_mappings module parameter, and
+// unconditionally before the page is returned to the kernel.
+//
+// Each cache is protected by its own spinlock, and mappings are only torn down
+// outside of it. Pages released to the kernel need to be looked up in the
+// caches of all GPUs, which are walked under RCU so that releasing a page,
+// which can happen from the shrinker, never blocks on the map paths.
+typedef struct
+{
+    uvm_gpu_t *gpu;
+
+    // Protects the tree, the LRU list and the count below
+    uvm_spinlock_t lock;
+
+    // Idle mappings indexed by the PFN of the first page they map. Can be
+    // looked up without the lock under rcu_read_lock().
+    struct radix_tree_root tree;
+
+    // Idle mappings ordered from least to most recently parked
+    struct list_head lru;
+
+    size_t count;
+
+    // Node in the RCU-protected global list of DMA mapping caches
+    struct list_head list_node;
+
+    struct
+    {
+        // Number of mapping requests satisfied by the cache
+        atomic64_t hits;
+
+        // Number of mapping requests that required a new DMA mapping
+        atomic64_t misses;
+
+        // Number of batches and mappings unmapped due to cache pressure
+        atomic64_t unmap_batches;
+        atomic64_t unmap_batch_mappings;
+
+        // Number of mappings unmapped because their page was released
+        atomic64_t page_release_unmaps;
+    } stats;
+} uvm_pmm_sysmem_dma_cache_t;
+
 // See comments in uvm_linux.h
 #ifdef NV_RADIX_TREE_REPLACE_SLOT_PRESENT
 #define uvm_pmm_sysmem_mappings_indirect_supported() true
@@ -110,9 +183,23 @@ static void uvm_pmm_sysmem_mappings_remove_gpu_chunk_mapping(uvm_pmm_sysmem_mapp
 // mapping doesn't exist. See uvm_va_block_evict_chunks for more information.
 void uvm_pmm_sysmem_mappings_remove_gpu_mapping_on_eviction(uvm_pmm_sysmem_mappings_t *sysmem_mappings, NvU64 dma_addr);
 
+// Return the number of bytes of memory used by the reverse map
+NvU64 uvm_pmm_sysmem_mappings_memory_usage(uvm_pmm_sysmem_mappings_t *sysmem_mappings);
+
+// Set aside num_extents extent descriptors for subsequent calls to
+// uvm_pmm_sysmem_mappings_reparent_gpu_mapping. Each reparent call may need one
+// for each extent that spans both VA blocks, which is at most one per mapping
+// owner. The reservation must be dropped with
+// uvm_pmm_sysmem_mappings_unreserve_extents once the reparent operations are
+// done.
+NV_STATUS uvm_pmm_sysmem_mappings_reserve_extents(uvm_pmm_sysmem_mappings_t *sysmem_mappings, size_t num_extents);
+void uvm_pmm_sysmem_mappings_unreserve_extents(uvm_pmm_sysmem_mappings_t *sysmem_mappings, size_t num_extents);
+
 // If the GPU used to initialize sysmem_mappings supports access counters, the
 // mapping for the region starting at dma_addr is updated with va_block.
-// This is required on VA block split.
+// This is required on VA block split, and va_block must be the block split
+// off the VA block that owns the mapping. Extents need to be reserved with
+// uvm_pmm_sysmem_mappings_reserve_extents before calling this function.
 void uvm_pmm_sysmem_mappings_reparent_gpu_mapping(uvm_pmm_sysmem_mappings_t *sysmem_mappings,
                                                   NvU64 dma_addr,
                                                   uvm_va_block_t *va_block);
@@ -166,7 +253,10 @@ static void uvm_pmm_sysmem_mappings_merge_gpu_chunk_mappings(uvm_pmm_sysmem_mapp
 //
 // Valid translations are written to out_mappings sequentially (there are no
 // gaps). max_out_mappings are written, at most. The caller is required to
-// provide enough entries in out_mappings.
+// provide enough entries in out_mappings. Pages that are contiguous in both the
+// DMA and the virtual address spaces, and that belong to the same VA block and
+// owner, are returned in a single translation even if they were registered as
+// different mappings.
 //
 // The VA Block in each returned translation entry is retained, and it's up to
 // the caller to release them
@@ -176,6 +266,109 @@ size_t uvm_pmm_sysmem_mappings_dma_to_virt(uvm_pmm_sysmem_mappings_t *sysmem_map
                                            uvm_reverse_map_t *out_mappings,
                                            size_t max_out_mappings);
 
+// Initialize the DMA mapping cache of the given GPU
+void uvm_pmm_sysmem_dma_cache_init(uvm_gpu_t *gpu, uvm_pmm_sysmem_dma_cache_t *dma_cache);
+
+// Unmap all the idle mappings in the cache and destroy it
+void uvm_pmm_sysmem_dma_cache_deinit(uvm_pmm_sysmem_dma_cache_t *dma_cache);
+
+// Map size bytes of contiguous sysmem starting at page on the GPU, like
+// uvm_gpu_map_cpu_pages(), but reuse an idle mapping of the same page and size
+// from the GPU's DMA mapping cache if there is one.
+NV_STATUS uvm_pmm_sysmem_dma_cache_map(uvm_gpu_t *gpu, struct page *page, size_t size, NvU64 *dma_address_out);
+
+// Release a mapping created with uvm_pmm_sysmem_dma_cache_map(). The mapping is
+// kept in the GPU's DMA mapping cache for later reuse. The caller must call
+// uvm_pmm_sysmem_dma_cache_release_pages() before page is returned to the
+// kernel.
+void uvm_pmm_sysmem_dma_cache_unmap(uvm_gpu_t *gpu, struct page *page, NvU64 dma_address, size_t size);
+
+// Unmap the idle mappings of the size bytes of contiguous sysmem starting at
+// page on all GPUs, including mappings of only part of the range. Must be
+// called before pages that may have been mapped with
+// uvm_pmm_sysmem_dma_cache_map() are returned to the kernel.
+void uvm_pmm_sysmem_dma_cache_release_pages(struct page *page, size_t size);
+
+// Per-NUMA node cache of freed single-page CPU chunks, bounded by the
+// uvm_cpu_chunk_cache_size module parameter. Cached pages are released to the
+// kernel under memory pressure through a shrinker.
+//
+// Take a page from the cache of node nid. If gfp_flags contains __GFP_ZERO the
+// page is zeroed. Return NULL if the cache for that node is empty or disabled.
+struct page *uvm_cpu_chunk_cache_alloc_page(int nid, gfp_t gfp_flags);
+
+// Try to park a page in the cache of the node it belongs to. Only order-0
+// pages whose only reference is held by the caller are accepted. Return true
+// if the page was cached, in which case the caller's reference is consumed.
+bool uvm_cpu_chunk_cache_free_page(struct page *page);
+
+// Return the number of pages currently cached for node nid.
+unsigned long uvm_cpu_chunk_cache_count(int nid);
+
+// Release all cached pages to the kernel. Return the number of pages released.
+unsigned long uvm_cpu_chunk_cache_drain(void);
+
+// Number of entries of the compact form of uvm_cpu_dma_addrs_t
+#define UVM_CPU_DMA_ADDRS_COMPACT_ENTRIES 16
+
+// Table of the DMA addresses of the CPU pages of a VA block mapped by a GPU,
+// indexed by the page index within the block. Each GPU state of a block has
+// one.
+//
+// GPUs usually map only a few CPU pages of a block, if any: most of the block
+// tends to be resident on the GPUs themselves. So the table starts out in a
+// compact form, which holds up to UVM_CPU_DMA_ADDRS_COMPACT_ENTRIES addresses
+// inline, and is promoted to a full array with an entry per page of the block
+// when more pages are mapped. It goes back to the compact form once few enough
+// pages remain mapped.
+typedef struct
+{
+    // Full table, or NULL while the compact form is used
+    NvU64 *full;
+
+    // Number of pages with a DMA address
+    NvU32 num_mapped;
+
+    // Compact form: the first num_mapped entries of each array are the pages
+    // with a DMA address, in no particular order.
+    NvU16 compact_pages[UVM_CPU_DMA_ADDRS_COMPACT_ENTRIES];
+    NvU64 compact_dma_addrs[UVM_CPU_DMA_ADDRS_COMPACT_ENTRIES];
+} uvm_cpu_dma_addrs_t;
+
+// Set the DMA address of the given page in a table for a block of num_pages
+// pages. Setting a zero address removes the page from the table. Only adding a
+// page can fail, in which case NV_ERR_NO_MEMORY is returned and the table is
+// left unchanged.
+NV_STATUS uvm_cpu_dma_addrs_set(uvm_cpu_dma_addrs_t *dma_addrs,
+                                size_t num_pages,
+                                uvm_page_index_t page_index,
+                                NvU64 dma_addr);
+
+// Get the DMA address of the given page, or 0 if the page is not in the table
+NvU64 uvm_cpu_dma_addrs_get(const uvm_cpu_dma_addrs_t *dma_addrs, uvm_page_index_t page_index);
+
+// Allocate what's needed in new_dma_addrs, an empty table for a block of
+// new_pages pages, to take the pages at split_page_index and above from
+// dma_addrs in uvm_cpu_dma_addrs_split().
+NV_STATUS uvm_cpu_dma_addrs_split_prealloc(const uvm_cpu_dma_addrs_t *dma_addrs,
+                                           uvm_cpu_dma_addrs_t *new_dma_addrs,
+                                           uvm_page_index_t split_page_index,
+                                           size_t new_pages);
+
+// Move the pages at split_page_index and above from dma_addrs, a table for a
+// block of num_pages pages, to new_dma_addrs. The moved pages are rebased to
+// start at 0. This cannot fail once uvm_cpu_dma_addrs_split_prealloc() has
+// succeeded.
+void uvm_cpu_dma_addrs_split(uvm_cpu_dma_addrs_t *dma_addrs,
+                             uvm_cpu_dma_addrs_t *new_dma_addrs,
+                             size_t num_pages,
+                             uvm_page_index_t split_page_index);
+
+void uvm_cpu_dma_addrs_free(uvm_cpu_dma_addrs_t *dma_addrs);
+
+// Bytes allocated outside of the table itself for a block of num_pages pages
+size_t uvm_cpu_dma_addrs_allocated_size(const uvm_cpu_dma_addrs_t *dma_addrs, size_t num_pages);
+
 #define UVM_CPU_CHUNK_SIZES PAGE_SIZE
 
 #if UVM_CPU_CHUNK_SIZES == PAGE_SIZE
@@ -344,6 +537,10 @@ void uvm_cpu_chunk_get(uvm_cpu_chunk_t *chunk);
 void uvm_cpu_chunk_put(uvm_cpu_chunk_t *chunk);
 
 NV_STATUS uvm_cpu_chunk_gpu_mapping_alloc(uvm_va_block_t *va_block, uvm_gpu_id_t id);
+
+// Preallocate what uvm_cpu_chunk_gpu_mapping_split() needs in the GPU state of
+// the new block. The GPU state must already exist in both blocks.
+NV_STATUS uvm_cpu_chunk_gpu_mapping_split_prealloc(uvm_va_block_t *existing, uvm_va_block_t *new, uvm_gpu_id_t id);
 void uvm_cpu_chunk_gpu_mapping_split(uvm_va_block_t *existing, uvm_va_block_t *new, uvm_gpu_id_t id);
 void uvm_cpu_chunk_gpu_mapping_free(uvm_va_block_t *va_block, uvm_gpu_id_t id);
 
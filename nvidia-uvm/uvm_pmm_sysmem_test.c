@@ -27,6 +27,7 @@
 #include "uvm_global.h"
 #include "uvm_gpu.h"
 #include "uvm_pmm_sysmem.h"
+#include "uvm_test_rng.h"
 #include "uvm_va_block.h"
 #include "uvm_va_range.h"
 #include "uvm_va_space.h"
@@ -40,6 +41,10 @@ static uvm_pmm_sysmem_mappings_t g_reverse_map;
 
 static uvm_gpu_t *g_volta_plus_gpu;
 
+// Reference copies of the DMA address tables tested by test_cpu_dma_addrs()
+static NvU64 g_dma_addrs_ref[PAGES_PER_UVM_VA_BLOCK];
+static NvU64 g_new_dma_addrs_ref[PAGES_PER_UVM_VA_BLOCK];
+
 // Check that the DMA addresses in the range defined by
 // [base_dma_addr:base_dma_addr + uvm_va_block_size(va_block)] and page_mask
 // are registered in the reverse map, using one call per entry. The returned
@@ -186,14 +191,14 @@ static NV_STATUS test_pmm_sysmem_reverse_map_single(uvm_va_block_t *va_block,
 
     for_each_va_block_subregion_in_mask(subregion, page_mask, uvm_va_block_region_from_block(va_block)) {
         TEST_CHECK_RET(is_power_of_2(uvm_va_block_region_size(subregion)));
-        uvm_mutex_lock(&va_block->lock);
+        uvm_va_block_lock(va_block);
         status = uvm_pmm_sysmem_mappings_add_gpu_mapping(&g_reverse_map,
                                                          g_base_dma_addr + subregion.first * PAGE_SIZE,
                                                          va_block->start + subregion.first * PAGE_SIZE,
                                                          uvm_va_block_region_size(subregion),
                                                          va_block,
                                                          UVM_ID_CPU);
-        uvm_mutex_unlock(&va_block->lock);
+        uvm_va_block_unlock(va_block);
         if (status != NV_OK)
             return status;
     }
@@ -205,11 +210,11 @@ static NV_STATUS test_pmm_sysmem_reverse_map_single(uvm_va_block_t *va_block,
         for_each_va_block_subregion_in_mask(subregion, page_mask, uvm_va_block_region_from_block(va_block)) {
             TEST_CHECK_RET(uvm_va_block_region_size(subregion) > split_size);
 
-            uvm_mutex_lock(&va_block->lock);
+            uvm_va_block_lock(va_block);
             status = uvm_pmm_sysmem_mappings_split_gpu_mappings(&g_reverse_map,
                                                                 g_base_dma_addr + subregion.first * PAGE_SIZE,
                                                                 split_size);
-            uvm_mutex_unlock(&va_block->lock);
+            uvm_va_block_unlock(va_block);
             TEST_CHECK_RET(status == NV_OK);
         }
 
@@ -232,21 +237,21 @@ static NV_STATUS test_pmm_sysmem_reverse_map_single(uvm_va_block_t *va_block,
         NvU64 subregion_dma_addr = g_base_dma_addr + subregion.first * PAGE_SIZE;
 
         if (split_size == UVM_CHUNK_SIZE_MAX || merge) {
-            uvm_mutex_lock(&va_block->lock);
+            uvm_va_block_lock(va_block);
             uvm_pmm_sysmem_mappings_remove_gpu_mapping(&g_reverse_map, subregion_dma_addr);
-            uvm_mutex_unlock(&va_block->lock);
+            uvm_va_block_unlock(va_block);
         }
         else {
             size_t chunk;
             size_t num_chunks = uvm_va_block_region_size(subregion) / split_size;
             TEST_CHECK_RET(num_chunks > 1);
 
-            uvm_mutex_lock(&va_block->lock);
+            uvm_va_block_lock(va_block);
 
             for (chunk = 0; chunk < num_chunks; ++chunk)
                 uvm_pmm_sysmem_mappings_remove_gpu_mapping(&g_reverse_map, subregion_dma_addr + chunk * split_size);
 
-            uvm_mutex_unlock(&va_block->lock);
+            uvm_va_block_unlock(va_block);
         }
     }
 
@@ -339,24 +344,24 @@ static NV_STATUS test_pmm_sysmem_reverse_map_many_blocks(uvm_va_space_t *va_spac
     TEST_CHECK_RET(is_power_of_2(uvm_va_block_size(va_block0)));
     TEST_CHECK_RET(is_power_of_2(uvm_va_block_size(va_block1)));
 
-    uvm_mutex_lock(&va_block0->lock);
+    uvm_va_block_lock(va_block0);
     status = uvm_pmm_sysmem_mappings_add_gpu_mapping(&g_reverse_map,
                                                      base_dma_addr0,
                                                      va_block0->start,
                                                      uvm_va_block_size(va_block0),
                                                      va_block0,
                                                      UVM_ID_CPU);
-    uvm_mutex_unlock(&va_block0->lock);
+    uvm_va_block_unlock(va_block0);
     TEST_CHECK_RET(status == NV_OK);
 
-    uvm_mutex_lock(&va_block1->lock);
+    uvm_va_block_lock(va_block1);
     status = uvm_pmm_sysmem_mappings_add_gpu_mapping(&g_reverse_map,
                                                      base_dma_addr1,
                                                      va_block1->start,
                                                      uvm_va_block_size(va_block1),
                                                      va_block1,
                                                      UVM_ID_CPU);
-    uvm_mutex_unlock(&va_block1->lock);
+    uvm_va_block_unlock(va_block1);
 
     // Check each VA block individually
     if (status == NV_OK) {
@@ -369,14 +374,14 @@ static NV_STATUS test_pmm_sysmem_reverse_map_many_blocks(uvm_va_space_t *va_spac
         TEST_CHECK_GOTO(check_reverse_map_two_blocks_batch(g_base_dma_addr, va_block0, va_block1) == NV_OK, error);
 
 error:
-        uvm_mutex_lock(&va_block1->lock);
+        uvm_va_block_lock(va_block1);
         uvm_pmm_sysmem_mappings_remove_gpu_mapping(&g_reverse_map, base_dma_addr1);
-        uvm_mutex_unlock(&va_block1->lock);
+        uvm_va_block_unlock(va_block1);
     }
 
-    uvm_mutex_lock(&va_block0->lock);
+    uvm_va_block_lock(va_block0);
     uvm_pmm_sysmem_mappings_remove_gpu_mapping(&g_reverse_map, base_dma_addr0);
-    uvm_mutex_unlock(&va_block0->lock);
+    uvm_va_block_unlock(va_block0);
 
     return status;
 }
@@ -416,28 +421,28 @@ static NV_STATUS test_pmm_sysmem_reverse_map_merge(uvm_va_space_t *va_space, NvU
     for (i = 0; i < ARRAY_SIZE(chunks_64k_pos); ++i) {
         // Fill with 4K mappings until the next 64K mapping
         while (page_index < chunks_64k_pos[i]) {
-            uvm_mutex_lock(&va_block->lock);
+            uvm_va_block_lock(va_block);
             status = uvm_pmm_sysmem_mappings_add_gpu_mapping(&g_reverse_map,
                                                              g_base_dma_addr + page_index * PAGE_SIZE,
                                                              uvm_va_block_cpu_page_address(va_block, page_index),
                                                              PAGE_SIZE,
                                                              va_block,
                                                              UVM_ID_CPU);
-            uvm_mutex_unlock(&va_block->lock);
+            uvm_va_block_unlock(va_block);
             TEST_CHECK_RET(status == NV_OK);
 
             ++page_index;
         }
 
         // Register the 64K mapping
-        uvm_mutex_lock(&va_block->lock);
+        uvm_va_block_lock(va_block);
         status = uvm_pmm_sysmem_mappings_add_gpu_mapping(&g_reverse_map,
                                                          g_base_dma_addr + page_index * PAGE_SIZE,
                                                          uvm_va_block_cpu_page_address(va_block, page_index),
                                                          UVM_CHUNK_SIZE_64K,
                                                          va_block,
                                                          UVM_ID_CPU);
-        uvm_mutex_unlock(&va_block->lock);
+        uvm_va_block_unlock(va_block);
         TEST_CHECK_RET(status == NV_OK);
 
         page_index += UVM_PAGE_SIZE_64K / PAGE_SIZE;
@@ -445,14 +450,14 @@ static NV_STATUS test_pmm_sysmem_reverse_map_merge(uvm_va_space_t *va_space, NvU
 
     // Fill the tail with 4K mappings, too
     while (page_index < PAGES_PER_UVM_VA_BLOCK) {
-        uvm_mutex_lock(&va_block->lock);
+        uvm_va_block_lock(va_block);
         status = uvm_pmm_sysmem_mappings_add_gpu_mapping(&g_reverse_map,
                                                          g_base_dma_addr + page_index * PAGE_SIZE,
                                                          uvm_va_block_cpu_page_address(va_block, page_index),
                                                          PAGE_SIZE,
                                                          va_block,
                                                          UVM_ID_CPU);
-        uvm_mutex_unlock(&va_block->lock);
+        uvm_va_block_unlock(va_block);
         TEST_CHECK_RET(status == NV_OK);
 
         ++page_index;
@@ -461,18 +466,18 @@ static NV_STATUS test_pmm_sysmem_reverse_map_merge(uvm_va_space_t *va_space, NvU
     TEST_CHECK_RET(check_reverse_map_block_page(va_block, g_base_dma_addr, NULL) == NV_OK);
     TEST_CHECK_RET(check_reverse_map_block_batch(va_block, g_base_dma_addr, NULL) == NV_OK);
 
-    uvm_mutex_lock(&va_block->lock);
+    uvm_va_block_lock(va_block);
     uvm_pmm_sysmem_mappings_merge_gpu_mappings(&g_reverse_map,
                                                g_base_dma_addr,
                                                uvm_va_block_size(va_block));
-    uvm_mutex_unlock(&va_block->lock);
+    uvm_va_block_unlock(va_block);
 
     TEST_CHECK_RET(check_reverse_map_block_page(va_block, g_base_dma_addr, NULL) == NV_OK);
     TEST_CHECK_RET(check_reverse_map_block_batch(va_block, g_base_dma_addr, NULL) == NV_OK);
 
-    uvm_mutex_lock(&va_block->lock);
+    uvm_va_block_lock(va_block);
     uvm_pmm_sysmem_mappings_remove_gpu_mapping(&g_reverse_map, g_base_dma_addr);
-    uvm_mutex_unlock(&va_block->lock);
+    uvm_va_block_unlock(va_block);
 
     return status;
 }
@@ -487,18 +492,18 @@ static NV_STATUS test_pmm_sysmem_reverse_map_remove_on_eviction(uvm_va_space_t *
 
     TEST_CHECK_RET(is_power_of_2(uvm_va_block_size(va_block)));
 
-    uvm_mutex_lock(&va_block->lock);
+    uvm_va_block_lock(va_block);
     status = uvm_pmm_sysmem_mappings_add_gpu_mapping(&g_reverse_map,
                                                      g_base_dma_addr,
                                                      addr,
                                                      uvm_va_block_size(va_block),
                                                      va_block,
                                                      UVM_ID_CPU);
-    uvm_mutex_unlock(&va_block->lock);
+    uvm_va_block_unlock(va_block);
 
-    uvm_mutex_lock(&va_block->lock);
+    uvm_va_block_lock(va_block);
     uvm_pmm_sysmem_mappings_remove_gpu_mapping(&g_reverse_map, g_base_dma_addr);
-    uvm_mutex_unlock(&va_block->lock);
+    uvm_va_block_unlock(va_block);
 
     TEST_CHECK_RET(status == NV_OK);
 
@@ -508,6 +513,111 @@ static NV_STATUS test_pmm_sysmem_reverse_map_remove_on_eviction(uvm_va_space_t *
     return NV_OK;
 }
 
+static NV_STATUS reverse_map_add_page(uvm_va_block_t *va_block, uvm_page_index_t page_index, uvm_processor_id_t owner)
+{
+    NV_STATUS status;
+
+    uvm_va_block_lock(va_block);
+    status = uvm_pmm_sysmem_mappings_add_gpu_mapping(&g_reverse_map,
+                                                     g_base_dma_addr + page_index * PAGE_SIZE,
+                                                     uvm_va_block_cpu_page_address(va_block, page_index),
+                                                     PAGE_SIZE,
+                                                     va_block,
+                                                     owner);
+    uvm_va_block_unlock(va_block);
+
+    return status;
+}
+
+static size_t reverse_map_translate_block(uvm_va_block_t *va_block)
+{
+    size_t num_translations;
+    size_t i;
+
+    num_translations = uvm_pmm_sysmem_mappings_dma_to_virt(&g_reverse_map,
+                                                           g_base_dma_addr,
+                                                           uvm_va_block_size(va_block),
+                                                           g_sysmem_translations,
+                                                           PAGES_PER_UVM_VA_BLOCK);
+    for (i = 0; i < num_translations; ++i)
+        uvm_va_block_release(g_sysmem_translations[i].va_block);
+
+    return num_translations;
+}
+
+// This function registers one mapping per page with contiguous DMA and virtual
+// addresses, and checks that the reverse map stores them in one extent per
+// window, and that extents are split and coalesced when a page in the middle
+// changes its owner.
+static NV_STATUS test_pmm_sysmem_reverse_map_extents(uvm_va_space_t *va_space, NvU64 addr)
+{
+    NV_STATUS status;
+    uvm_va_block_t *va_block;
+    uvm_page_index_t page_index;
+    size_t num_pages;
+    size_t num_windows;
+
+    status = uvm_va_block_find(va_space, addr, &va_block);
+    if (status != NV_OK)
+        return status;
+
+    num_pages = uvm_va_block_num_cpu_pages(va_block);
+    num_windows = DIV_ROUND_UP(num_pages, UVM_REVERSE_MAP_EXTENT_PAGES);
+
+    TEST_CHECK_RET(is_power_of_2(uvm_va_block_size(va_block)));
+    TEST_CHECK_RET(num_pages >= 3);
+    TEST_CHECK_RET(g_reverse_map.num_extents == 0);
+
+    // Leave a hole in the second page
+    for_each_va_block_page(page_index, va_block) {
+        if (page_index == 1)
+            continue;
+
+        status = reverse_map_add_page(va_block, page_index, UVM_ID_CPU);
+        TEST_CHECK_GOTO(status == NV_OK, done);
+    }
+
+    TEST_CHECK_GOTO(g_reverse_map.num_extents == num_windows, done);
+    TEST_CHECK_GOTO(g_reverse_map.num_mapped_pages == num_pages - 1, done);
+    TEST_CHECK_GOTO(reverse_map_translate_block(va_block) == 2, done);
+
+    // Filling the hole with a different owner splits the first extent
+    status = reverse_map_add_page(va_block, 1, g_volta_plus_gpu->id);
+    TEST_CHECK_GOTO(status == NV_OK, done);
+    TEST_CHECK_GOTO(g_reverse_map.num_extents == num_windows + 2, done);
+    TEST_CHECK_GOTO(reverse_map_translate_block(va_block) == 3, done);
+
+    // Removing it coalesces the pieces back into a single extent
+    uvm_va_block_lock(va_block);
+    uvm_pmm_sysmem_mappings_remove_gpu_mapping(&g_reverse_map, g_base_dma_addr + PAGE_SIZE);
+    uvm_va_block_unlock(va_block);
+    TEST_CHECK_GOTO(g_reverse_map.num_extents == num_windows, done);
+
+    // With the hole filled with the same owner, the whole block is returned
+    // in a single translation
+    status = reverse_map_add_page(va_block, 1, UVM_ID_CPU);
+    TEST_CHECK_GOTO(status == NV_OK, done);
+    TEST_CHECK_GOTO(g_reverse_map.num_extents == num_windows, done);
+    TEST_CHECK_GOTO(g_reverse_map.num_mapped_pages == num_pages, done);
+    TEST_CHECK_GOTO(reverse_map_translate_block(va_block) == 1, done);
+    TEST_CHECK_GOTO(uvm_va_block_region_num_pages(g_sysmem_translations[0].region) == num_pages, done);
+
+done:
+    uvm_va_block_lock(va_block);
+
+    for_each_va_block_page(page_index, va_block)
+        uvm_pmm_sysmem_mappings_remove_gpu_mapping_on_eviction(&g_reverse_map, g_base_dma_addr + page_index * PAGE_SIZE);
+
+    uvm_va_block_unlock(va_block);
+
+    if (status == NV_OK) {
+        TEST_CHECK_RET(g_reverse_map.num_extents == 0);
+        TEST_CHECK_RET(g_reverse_map.num_mapped_pages == 0);
+    }
+
+    return status;
+}
+
 static NV_STATUS test_pmm_sysmem_reverse_map(uvm_va_space_t *va_space, NvU64 addr1, NvU64 addr2)
 {
     NV_STATUS status = NV_OK;
@@ -546,11 +656,271 @@ static NV_STATUS test_pmm_sysmem_reverse_map(uvm_va_space_t *va_space, NvU64 add
     if (status == NV_OK)
         status = test_pmm_sysmem_reverse_map_remove_on_eviction(va_space, addr1);
 
+    if (status == NV_OK)
+        status = test_pmm_sysmem_reverse_map_extents(va_space, addr1);
+
     uvm_pmm_sysmem_mappings_deinit(&g_reverse_map);
 
     return status;
 }
 
+// The cache is shared with any other UVM activity in the system, so this test
+// assumes that no other process is allocating or freeing CPU chunks while it
+// runs.
+static NV_STATUS test_cpu_chunk_cache(void)
+{
+    NV_STATUS status = NV_OK;
+    gfp_t gfp_flags = NV_UVM_GFP_FLAGS | GFP_HIGHUSER;
+    struct page *page;
+    NvU8 *data;
+    size_t i;
+    int nid;
+
+    // Start from an empty cache so that the pages returned below are the ones
+    // inserted by the test
+    uvm_cpu_chunk_cache_drain();
+
+    page = alloc_pages(gfp_flags, 0);
+    if (!page)
+        return NV_ERR_NO_MEMORY;
+
+    nid = page_to_nid(page);
+
+    data = kmap(page);
+    memset(data, 0xcd, PAGE_SIZE);
+    kunmap(page);
+
+    // Pages with references outside of UVM are never cached
+    get_page(page);
+    TEST_CHECK_GOTO(!uvm_cpu_chunk_cache_free_page(page), error);
+    put_page(page);
+
+    // The cache may be disabled, in which case the page is not taken
+    if (!uvm_cpu_chunk_cache_free_page(page)) {
+        TEST_CHECK_GOTO(uvm_cpu_chunk_cache_count(nid) == 0, error);
+        __free_page(page);
+        return NV_OK;
+    }
+
+    TEST_CHECK_RET(uvm_cpu_chunk_cache_count(nid) == 1);
+
+    // Cached pages must be zeroed when requested
+    page = uvm_cpu_chunk_cache_alloc_page(nid, gfp_flags | __GFP_ZERO);
+    TEST_CHECK_RET(page);
+    TEST_CHECK_GOTO(uvm_cpu_chunk_cache_count(nid) == 0, error);
+
+    data = kmap(page);
+    for (i = 0; i < PAGE_SIZE; i++) {
+        if (data[i] != 0)
+            break;
+    }
+    kunmap(page);
+    TEST_CHECK_GOTO(i == PAGE_SIZE, error);
+
+    // An empty cache misses
+    TEST_CHECK_GOTO(!uvm_cpu_chunk_cache_alloc_page(nid, gfp_flags), error);
+
+    // Drain releases the cached pages to the kernel
+    TEST_CHECK_RET(uvm_cpu_chunk_cache_free_page(page));
+    TEST_CHECK_RET(uvm_cpu_chunk_cache_drain() == 1);
+    TEST_CHECK_RET(uvm_cpu_chunk_cache_count(nid) == 0);
+
+    return NV_OK;
+
+error:
+    __free_page(page);
+    return status;
+}
+
+static NV_STATUS check_cpu_dma_addrs(const uvm_cpu_dma_addrs_t *dma_addrs, const NvU64 *ref, size_t num_pages)
+{
+    NvU32 num_mapped = 0;
+    size_t i;
+
+    for (i = 0; i < num_pages; ++i) {
+        TEST_CHECK_RET(uvm_cpu_dma_addrs_get(dma_addrs, i) == ref[i]);
+        num_mapped += ref[i] != 0;
+    }
+
+    TEST_CHECK_RET(dma_addrs->num_mapped == num_mapped);
+
+    // Full tables are only used past the compact capacity, and compact tables
+    // never exceed it
+    if (dma_addrs->full)
+        TEST_CHECK_RET(uvm_cpu_dma_addrs_allocated_size(dma_addrs, num_pages) == num_pages * sizeof(NvU64));
+    else
+        TEST_CHECK_RET(num_mapped <= UVM_CPU_DMA_ADDRS_COMPACT_ENTRIES);
+
+    return NV_OK;
+}
+
+// Set random pages of the table so that the number of mapped pages swings
+// between 0 and max_mapped, and check it against the reference after each
+// update.
+static NV_STATUS test_cpu_dma_addrs_random(uvm_cpu_dma_addrs_t *dma_addrs,
+                                           size_t num_pages,
+                                           NvU32 max_mapped,
+                                           uvm_test_rng_t *rng)
+{
+    NvU32 num_mapped = dma_addrs->num_mapped;
+    bool adding = true;
+    NvU32 i;
+
+    for (i = 0; i < 8 * max_mapped; ++i) {
+        uvm_page_index_t page_index = uvm_test_rng_range_32(rng, 0, num_pages - 1);
+        NvU64 dma_addr = 0;
+
+        if (num_mapped >= max_mapped)
+            adding = false;
+        else if (num_mapped == 0)
+            adding = true;
+
+        if (adding) {
+            dma_addr = ((NvU64)uvm_test_rng_32(rng) + 1) << PAGE_SHIFT;
+        }
+        else {
+            // Remove the first mapped page from the random index on
+            while (!g_dma_addrs_ref[page_index])
+                page_index = (page_index + 1) % num_pages;
+        }
+
+        TEST_NV_CHECK_RET(uvm_cpu_dma_addrs_set(dma_addrs, num_pages, page_index, dma_addr));
+
+        num_mapped += (!g_dma_addrs_ref[page_index] && dma_addr);
+        num_mapped -= (g_dma_addrs_ref[page_index] && !dma_addr);
+        g_dma_addrs_ref[page_index] = dma_addr;
+
+        TEST_NV_CHECK_RET(check_cpu_dma_addrs(dma_addrs, g_dma_addrs_ref, num_pages));
+    }
+
+    return NV_OK;
+}
+
+static NV_STATUS test_cpu_dma_addrs_split(uvm_cpu_dma_addrs_t *dma_addrs,
+                                          size_t num_pages,
+                                          uvm_page_index_t split_page_index)
+{
+    uvm_cpu_dma_addrs_t new_dma_addrs;
+    size_t new_pages = num_pages - split_page_index;
+    NV_STATUS status = NV_OK;
+
+    memset(&new_dma_addrs, 0, sizeof(new_dma_addrs));
+
+    TEST_NV_CHECK_RET(uvm_cpu_dma_addrs_split_prealloc(dma_addrs, &new_dma_addrs, split_page_index, new_pages));
+    uvm_cpu_dma_addrs_split(dma_addrs, &new_dma_addrs, num_pages, split_page_index);
+
+    memcpy(g_new_dma_addrs_ref, g_dma_addrs_ref + split_page_index, new_pages * sizeof(g_new_dma_addrs_ref[0]));
+    memset(g_dma_addrs_ref + split_page_index, 0, new_pages * sizeof(g_dma_addrs_ref[0]));
+
+    TEST_NV_CHECK_GOTO(check_cpu_dma_addrs(dma_addrs, g_dma_addrs_ref, split_page_index), done);
+    TEST_NV_CHECK_GOTO(check_cpu_dma_addrs(&new_dma_addrs, g_new_dma_addrs_ref, new_pages), done);
+
+done:
+    uvm_cpu_dma_addrs_free(&new_dma_addrs);
+    return status;
+}
+
+static NV_STATUS test_cpu_dma_addrs(void)
+{
+    uvm_cpu_dma_addrs_t dma_addrs;
+    uvm_test_rng_t rng;
+    size_t num_pages = PAGES_PER_UVM_VA_BLOCK;
+    NvU32 max_mapped;
+    NV_STATUS status = NV_OK;
+
+    uvm_test_rng_init(&rng, 0);
+    memset(&dma_addrs, 0, sizeof(dma_addrs));
+    memset(g_dma_addrs_ref, 0, sizeof(g_dma_addrs_ref));
+
+    // Stay within the compact form, then go well past it so the table gets
+    // promoted and demoted repeatedly
+    for (max_mapped = 1; max_mapped <= 4 * UVM_CPU_DMA_ADDRS_COMPACT_ENTRIES; max_mapped *= 2)
+        TEST_NV_CHECK_GOTO(test_cpu_dma_addrs_random(&dma_addrs, num_pages, max_mapped, &rng), done);
+
+    // Split a full table and a compact table, at the middle and at the last
+    // page
+    TEST_NV_CHECK_GOTO(test_cpu_dma_addrs_random(&dma_addrs,
+                                                 num_pages,
+                                                 4 * UVM_CPU_DMA_ADDRS_COMPACT_ENTRIES,
+                                                 &rng),
+                       done);
+    TEST_NV_CHECK_GOTO(test_cpu_dma_addrs_split(&dma_addrs, num_pages, num_pages / 2), done);
+    num_pages /= 2;
+
+    TEST_NV_CHECK_GOTO(test_cpu_dma_addrs_random(&dma_addrs, num_pages, UVM_CPU_DMA_ADDRS_COMPACT_ENTRIES / 2, &rng),
+                       done);
+    TEST_NV_CHECK_GOTO(test_cpu_dma_addrs_split(&dma_addrs, num_pages, num_pages - 1), done);
+
+done:
+    uvm_cpu_dma_addrs_free(&dma_addrs);
+    return status;
+}
+
+static NV_STATUS test_dma_cache_gpu(uvm_gpu_t *gpu)
+{
+    uvm_pmm_sysmem_dma_cache_t *dma_cache = &gpu->pmm_sysmem_dma_cache;
+    NV_STATUS status;
+    struct page *page;
+    NvU64 dma_addr;
+    NvU64 new_dma_addr;
+    NvU64 hits;
+    NvU64 misses;
+
+    page = alloc_page(NV_UVM_GFP_FLAGS | GFP_HIGHUSER);
+    if (!page)
+        return NV_ERR_NO_MEMORY;
+
+    status = uvm_pmm_sysmem_dma_cache_map(gpu, page, PAGE_SIZE, &dma_addr);
+    if (status != NV_OK)
+        goto done;
+
+    // Unmapping parks the mapping in the cache, if enabled. Mapping the same
+    // page again must then return the same DMA address.
+    hits = atomic64_read(&dma_cache->stats.hits);
+    uvm_pmm_sysmem_dma_cache_unmap(gpu, page, dma_addr, PAGE_SIZE);
+
+    status = uvm_pmm_sysmem_dma_cache_map(gpu, page, PAGE_SIZE, &new_dma_addr);
+    if (status != NV_OK)
+        goto release;
+
+    if (atomic64_read(&dma_cache->stats.hits) != hits)
+        TEST_CHECK_GOTO(new_dma_addr == dma_addr, unmap);
+
+    dma_addr = new_dma_addr;
+
+    // Releasing the page tears down its idle mapping, so the next mapping of
+    // the page misses
+    uvm_pmm_sysmem_dma_cache_unmap(gpu, page, dma_addr, PAGE_SIZE);
+    uvm_pmm_sysmem_dma_cache_release_pages(page, PAGE_SIZE);
+
+    misses = atomic64_read(&dma_cache->stats.misses);
+    status = uvm_pmm_sysmem_dma_cache_map(gpu, page, PAGE_SIZE, &dma_addr);
+    if (status != NV_OK)
+        goto done;
+
+    TEST_CHECK_GOTO(atomic64_read(&dma_cache->stats.misses) == misses + 1, unmap);
+
+unmap:
+    uvm_pmm_sysmem_dma_cache_unmap(gpu, page, dma_addr, PAGE_SIZE);
+
+release:
+    uvm_pmm_sysmem_dma_cache_release_pages(page, PAGE_SIZE);
+
+done:
+    __free_page(page);
+    return status;
+}
+
+static NV_STATUS test_dma_cache(uvm_va_space_t *va_space)
+{
+    uvm_gpu_t *gpu;
+
+    for_each_va_space_gpu(gpu, va_space)
+        TEST_NV_CHECK_RET(test_dma_cache_gpu(gpu));
+
+    return NV_OK;
+}
+
 NV_STATUS uvm_test_pmm_sysmem(UVM_TEST_PMM_SYSMEM_PARAMS *params, struct file *filp)
 {
     NV_STATUS status;
@@ -563,6 +933,18 @@ NV_STATUS uvm_test_pmm_sysmem(UVM_TEST_PMM_SYSMEM_PARAMS *params, struct file *f
     uvm_mutex_lock(&g_uvm_global.global_lock);
     uvm_va_space_down_write(va_space);
 
+    status = test_cpu_chunk_cache();
+    if (status != NV_OK)
+        goto done;
+
+    status = test_cpu_dma_addrs();
+    if (status != NV_OK)
+        goto done;
+
+    status = test_dma_cache(va_space);
+    if (status != NV_OK)
+        goto done;
+
     if (uvm_pmm_sysmem_mappings_indirect_supported()) {
         status = test_pmm_sysmem_reverse_map(va_space, params->range_address1, params->range_address2);
     }
@@ -571,6 +953,7 @@ NV_STATUS uvm_test_pmm_sysmem(UVM_TEST_PMM_SYSMEM_PARAMS *params, struct file *f
         status = NV_OK;
     }
 
+done:
     uvm_va_space_up_write(va_space);
     uvm_mutex_unlock(&g_uvm_global.global_lock);
 
@@ -1043,14 +1043,14 @@ static NV_STATUS test_pmm_reverse_map_single(uvm_gpu_t *gpu, uvm_va_space_t *va_
     TEST_CHECK_RET(uvm_va_block_size(va_block) == UVM_VA_BLOCK_SIZE);
 
     // Verify that all pages are populated on the GPU
-    uvm_mutex_lock(&va_block->lock);
+    uvm_va_block_lock(va_block);
 
     is_resident = uvm_processor_mask_test(&va_block->resident, gpu->id) &&
                   uvm_page_mask_full(uvm_va_block_resident_mask_get(va_block, gpu->id));
     if (is_resident)
         phys_addr = uvm_va_block_gpu_phys_page_address(va_block, 0, gpu);
 
-    uvm_mutex_unlock(&va_block->lock);
+    uvm_va_block_unlock(va_block);
 
     TEST_CHECK_RET(is_resident);
 
@@ -1088,7 +1088,7 @@ static NV_STATUS test_pmm_reverse_map_many_blocks(uvm_gpu_t *gpu, uvm_va_space_t
     }
     TEST_CHECK_RET(va_block);
 
-    uvm_mutex_lock(&va_block->lock);
+    uvm_va_block_lock(va_block);
 
     is_resident = uvm_id_equal(uvm_va_block_page_get_closest_resident(va_block, 0, gpu->id), gpu->id);
     if (is_resident) {
@@ -1096,7 +1096,7 @@ static NV_STATUS test_pmm_reverse_map_many_blocks(uvm_gpu_t *gpu, uvm_va_space_t
         phys_addr.address = UVM_ALIGN_DOWN(phys_addr.address, UVM_VA_BLOCK_SIZE);
     }
 
-    uvm_mutex_unlock(&va_block->lock);
+    uvm_va_block_unlock(va_block);
 
     TEST_CHECK_RET(is_resident);
 
@@ -1129,13 +1129,13 @@ static NV_STATUS test_pmm_reverse_map_many_blocks(uvm_gpu_t *gpu, uvm_va_space_t
                 UVM_ASSERT(uvm_va_block_contains_address(va_block, uvm_reverse_map_start(reverse_mapping)));
                 UVM_ASSERT(uvm_va_block_contains_address(va_block, uvm_reverse_map_end(reverse_mapping)));
 
-                uvm_mutex_lock(&va_block->lock);
+                uvm_va_block_lock(va_block);
 
                 // Verify that all pages are populated on the GPU
                 is_resident = uvm_page_mask_region_full(uvm_va_block_resident_mask_get(va_block, gpu->id),
                                                         reverse_mapping->region);
 
-                uvm_mutex_unlock(&va_block->lock);
+                uvm_va_block_unlock(va_block);
 
                 TEST_CHECK_RET(is_resident);
 
@@ -787,10 +787,10 @@ static NV_STATUS system_wide_atomics_set(uvm_va_space_t *va_space, const NvProce
             for_each_va_block_in_va_range(va_range, va_block) {
                 uvm_page_mask_t *non_resident_pages = &va_block_context->caller_page_mask;
 
-                uvm_mutex_lock(&va_block->lock);
+                uvm_va_block_lock(va_block);
 
                 if (!uvm_processor_mask_test(&va_block->mapped, gpu->id)) {
-                    uvm_mutex_unlock(&va_block->lock);
+                    uvm_va_block_unlock(va_block);
                     continue;
                 }
 
@@ -806,7 +806,7 @@ static NV_STATUS system_wide_atomics_set(uvm_va_space_t *va_space, const NvProce
 
                 tracker_status = uvm_tracker_add_tracker_safe(&local_tracker, &va_block->tracker);
 
-                uvm_mutex_unlock(&va_block->lock);
+                uvm_va_block_unlock(va_block);
 
                 if (status == NV_OK)
                     status = tracker_status;
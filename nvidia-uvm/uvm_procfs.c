@@ -95,6 +95,11 @@ void uvm_procfs_destroy_entry(struct proc_dir_entry *entry)
     procfs_destroy_entry_with_root(entry, entry);
 }
 
+struct proc_dir_entry *uvm_procfs_get_base_dir()
+{
+    return uvm_proc_dir;
+}
+
 struct proc_dir_entry *uvm_procfs_get_gpu_base_dir()
 {
     return uvm_proc_gpus;
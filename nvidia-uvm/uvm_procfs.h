@@ -50,6 +50,7 @@ static bool uvm_procfs_is_debug_enabled(void)
     return uvm_enable_debug_procfs != 0;
 }
 
+struct proc_dir_entry *uvm_procfs_get_base_dir(void);
 struct proc_dir_entry *uvm_procfs_get_gpu_base_dir(void);
 struct proc_dir_entry *uvm_procfs_get_cpu_base_dir(void);
 
@@ -74,6 +75,15 @@ void uvm_procfs_close_callback(void);
     NV_DEFINE_SINGLE_PROCFS_FILE_READ_ONLY(name, \
                                            uvm_procfs_open_callback, \
                                            uvm_procfs_close_callback)
+
+// write_callback has the signature
+// ssize_t write_callback(struct seq_file *s, const char __user *buf, size_t size)
+// and returns the number of bytes consumed or a negative errno.
+#define UVM_DEFINE_SINGLE_PROCFS_FILE_READ_WRITE(name, write_callback) \
+    NV_DEFINE_SINGLE_PROCFS_FILE_READ_WRITE(name, \
+                                            uvm_procfs_open_callback, \
+                                            uvm_procfs_close_callback, \
+                                            write_callback)
 #endif
 
 #endif // __UVM_PROCFS_H__
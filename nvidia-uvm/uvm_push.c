@@ -27,6 +27,7 @@
 #include "uvm_channel.h"
 #include "uvm_hal.h"
 #include "uvm_kvmalloc.h"
+#include "uvm_thread_context.h"
 #include "uvm_linux.h"
 #include "nv_stdarg.h"
 
@@ -189,6 +190,10 @@ static NV_STATUS push_begin_acquire_with_info(uvm_channel_t *channel,
 
     uvm_push_acquire_tracker(push, tracker);
 
+    // Begin the trace after the acquires, so that the GPU begin time doesn't
+    // include waiting for the dependencies of the push.
+    uvm_channel_push_trace_begin(push);
+
     return NV_OK;
 }
 
@@ -212,6 +217,8 @@ NV_STATUS __uvm_push_begin_acquire_with_info(uvm_channel_manager_t *manager,
         UVM_ASSERT(dst_gpu != manager->gpu);
     }
 
+    uvm_push_coalesce_flush_current_thread();
+
     status = push_reserve_channel(manager, type, dst_gpu, &channel);
     if (status != NV_OK)
         return status;
@@ -225,6 +232,42 @@ NV_STATUS __uvm_push_begin_acquire_with_info(uvm_channel_manager_t *manager,
     return status;
 }
 
+__attribute__ ((format(printf, 10, 11)))
+NV_STATUS __uvm_push_begin_acquire_striped_with_info(uvm_channel_manager_t *manager,
+                                                     uvm_channel_type_t type,
+                                                     uvm_gpu_t *dst_gpu,
+                                                     NvU64 size,
+                                                     uvm_tracker_t *tracker,
+                                                     uvm_push_t *push,
+                                                     const char *filename,
+                                                     const char *function,
+                                                     int line,
+                                                     const char *format, ...)
+{
+    va_list args;
+    NV_STATUS status;
+    uvm_channel_t *channel;
+
+    if (dst_gpu != NULL) {
+        UVM_ASSERT(type == UVM_CHANNEL_TYPE_GPU_TO_GPU);
+        UVM_ASSERT(dst_gpu != manager->gpu);
+    }
+
+    uvm_push_coalesce_flush_current_thread();
+
+    status = uvm_channel_reserve_striped(manager, type, dst_gpu, size, &channel);
+    if (status != NV_OK)
+        return status;
+
+    UVM_ASSERT(channel);
+
+    va_start(args, format);
+    status = push_begin_acquire_with_info(channel, tracker, push, filename, function, line, format, args);
+    va_end(args);
+
+    return status;
+}
+
 __attribute__ ((format(printf, 7, 8)))
 NV_STATUS __uvm_push_begin_acquire_on_channel_with_info(uvm_channel_t *channel,
                                                         uvm_tracker_t *tracker,
@@ -237,6 +280,8 @@ NV_STATUS __uvm_push_begin_acquire_on_channel_with_info(uvm_channel_t *channel,
     va_list args;
     NV_STATUS status;
 
+    uvm_push_coalesce_flush_current_thread();
+
     status = uvm_channel_reserve(channel);
     if (status != NV_OK)
         return status;
@@ -269,6 +314,154 @@ void uvm_push_end(uvm_push_t *push)
     UVM_ASSERT_MSG(flag == UVM_PUSH_FLAG_COUNT, "first flag set %d\n", flag);
 }
 
+// Number of coalescers with an on-going combined push, across all threads.
+// Lets the flush hooks skip the thread context lookup in the common case.
+static atomic_t g_push_coalesce_active = ATOMIC_INIT(0);
+
+static uvm_push_coalesce_t **push_coalesce_current_thread_slot(void)
+{
+    if (in_interrupt() || !uvm_thread_context_present())
+        return NULL;
+
+    return &uvm_thread_context()->push_coalesce;
+}
+
+void uvm_push_coalesce_init(uvm_push_coalesce_t *coalesce, uvm_tracker_t *tracker)
+{
+    memset(coalesce, 0, sizeof(*coalesce));
+    coalesce->tracker = tracker;
+}
+
+static void push_coalesce_submit(uvm_push_coalesce_t *coalesce)
+{
+    NV_STATUS status;
+    uvm_push_coalesce_t **slot = push_coalesce_current_thread_slot();
+
+    UVM_ASSERT(coalesce->num_pushes != 0);
+    UVM_ASSERT(slot);
+    UVM_ASSERT(*slot == coalesce);
+
+    *slot = NULL;
+    atomic_dec(&g_push_coalesce_active);
+
+    uvm_push_end(&coalesce->push);
+    coalesce->num_pushes = 0;
+
+    if (!coalesce->tracker)
+        return;
+
+    status = uvm_tracker_add_push_safe(coalesce->tracker, &coalesce->push);
+    if (status != NV_OK) {
+        // If the push cannot be tracked, wait for it so that the caller's
+        // later waits on the tracker still cover it.
+        NV_STATUS wait_status = uvm_push_wait(&coalesce->push);
+        if (coalesce->status == NV_OK)
+            coalesce->status = wait_status == NV_OK ? status : wait_status;
+    }
+}
+
+__attribute__ ((format(printf, 8, 9)))
+NV_STATUS __uvm_push_begin_coalesced_with_info(uvm_push_coalesce_t *coalesce,
+                                               uvm_channel_manager_t *manager,
+                                               uvm_channel_type_t type,
+                                               uvm_push_t *push,
+                                               const char *filename,
+                                               const char *function,
+                                               int line,
+                                               const char *format, ...)
+{
+    va_list args;
+    NV_STATUS status;
+    uvm_channel_t *channel;
+    uvm_push_coalesce_t **slot = push_coalesce_current_thread_slot();
+
+    UVM_ASSERT(slot);
+    UVM_ASSERT(type != UVM_CHANNEL_TYPE_GPU_TO_GPU);
+
+    if (coalesce->num_pushes != 0) {
+        UVM_ASSERT(*slot == coalesce);
+
+        if (coalesce->manager == manager && coalesce->type == type) {
+            *push = coalesce->push;
+            ++coalesce->num_pushes;
+            return NV_OK;
+        }
+
+        push_coalesce_submit(coalesce);
+    }
+    else if (*slot != NULL) {
+        // Another coalescer of this thread has an on-going combined push
+        push_coalesce_submit(*slot);
+    }
+
+    status = push_reserve_channel(manager, type, NULL, &channel);
+    if (status != NV_OK)
+        return status;
+
+    va_start(args, format);
+    status = push_begin_acquire_with_info(channel, NULL, &coalesce->push, filename, function, line, format, args);
+    va_end(args);
+
+    if (status != NV_OK)
+        return status;
+
+    coalesce->manager = manager;
+    coalesce->type = type;
+    coalesce->num_pushes = 1;
+
+    *slot = coalesce;
+    atomic_inc(&g_push_coalesce_active);
+
+    *push = coalesce->push;
+
+    return NV_OK;
+}
+
+void uvm_push_end_coalesced(uvm_push_coalesce_t *coalesce, uvm_push_t *push)
+{
+    uvm_push_flag_t flag;
+
+    UVM_ASSERT(coalesce->num_pushes != 0);
+    UVM_ASSERT(push->channel == coalesce->push.channel);
+    UVM_ASSERT(push->begin == coalesce->push.begin);
+    UVM_ASSERT(push->next >= coalesce->push.next);
+
+    // Flags apply to the next method only, so they cannot carry over to the
+    // next coalesced push.
+    flag = find_first_bit(push->flags, UVM_PUSH_FLAG_COUNT);
+    UVM_ASSERT_MSG(flag == UVM_PUSH_FLAG_COUNT, "first flag set %d\n", flag);
+
+    coalesce->push = *push;
+
+    // The individual push is never submitted on its own, which is caught by
+    // the assert in uvm_push_get_tracker_entry() if it's tracked by mistake.
+    push->channel_tracking_value = 0;
+
+    if (uvm_push_get_size(&coalesce->push) >= UVM_PUSH_COALESCE_MAX_SIZE ||
+        coalesce->num_pushes >= UVM_PUSH_COALESCE_MAX_PUSHES)
+        push_coalesce_submit(coalesce);
+}
+
+NV_STATUS uvm_push_coalesce_flush(uvm_push_coalesce_t *coalesce)
+{
+    if (coalesce->num_pushes != 0)
+        push_coalesce_submit(coalesce);
+
+    return coalesce->status;
+}
+
+void uvm_push_coalesce_flush_current_thread(void)
+{
+    uvm_push_coalesce_t **slot;
+
+    if (atomic_read(&g_push_coalesce_active) == 0)
+        return;
+
+    slot = push_coalesce_current_thread_slot();
+    if (slot && *slot)
+        push_coalesce_submit(*slot);
+}
+
 NV_STATUS uvm_push_wait(uvm_push_t *push)
 {
     uvm_tracker_entry_t entry;
@@ -309,9 +502,10 @@ void *uvm_push_inline_data_get(uvm_push_inline_data_t *data, size_t size)
 
     UVM_ASSERT(!uvm_global_is_suspended());
 
-    UVM_ASSERT_MSG(uvm_push_get_size(data->push) + uvm_push_inline_data_size(data) + UVM_METHOD_SIZE + size <= UVM_MAX_PUSH_SIZE,
-            "push size %u inline data size %zu new data size %zu max push %u\n",
-            uvm_push_get_size(data->push), uvm_push_inline_data_size(data), size, UVM_MAX_PUSH_SIZE);
+    UVM_ASSERT_MSG(uvm_push_has_space(data->push, uvm_push_inline_data_size(data) + UVM_METHOD_SIZE + size),
+            "push size %u inline data size %zu new data size %zu max push %u reserved %u\n",
+            uvm_push_get_size(data->push), uvm_push_inline_data_size(data), size, UVM_MAX_PUSH_SIZE,
+            data->push->trace.reserved_size);
     UVM_ASSERT_MSG(uvm_push_inline_data_size(data) + size <= UVM_PUSH_INLINE_DATA_MAX_SIZE,
             "inline data size %zu new data size %zu max %u\n",
             uvm_push_inline_data_size(data), size, UVM_PUSH_INLINE_DATA_MAX_SIZE);
@@ -83,8 +83,32 @@ struct uvm_push_struct
     // uvm_push_end()).
     NvU32 push_info_index;
 
+    // Index of the pushbuffer chunk the push is written to.
+    // Only valid for an on-going push.
+    NvU32 pushbuffer_chunk_index;
+
     // A bitmap of flags from uvm_push_flag_t
     DECLARE_BITMAP(flags, UVM_PUSH_FLAG_COUNT);
+
+    // Number of bytes copied or set by CE operations in the push. Used to
+    // estimate how long the push takes to execute.
+    NvU64 ce_bytes;
+
+    // Push trace state, only used if the channel keeps a push trace ring. See
+    // uvm_channel_push_trace_record_t.
+    struct
+    {
+        // CPU time at which the push was begun
+        NvU64 begin_time_ns;
+
+        // CPU pointer to the GPU timestamp released at the beginning of the
+        // push, after its acquires
+        NvU64 *gpu_begin_timestamp;
+
+        // Space reserved out of UVM_MAX_PUSH_SIZE for the GPU timestamp
+        // released at the end of the push. 0 if the push is not traced.
+        NvU32 reserved_size;
+    } trace;
 };
 
 #define UVM_PUSH_ACQUIRE_INFO_MAX_ENTRIES 16
@@ -173,6 +197,19 @@ NV_STATUS __uvm_push_begin_acquire_with_info(uvm_channel_manager_t *manager,
                                              int line,
                                              const char *format, ...);
 
+// Internal helper for uvm_push_begin_acquire_striped
+__attribute__ ((format(printf, 10, 11)))
+NV_STATUS __uvm_push_begin_acquire_striped_with_info(uvm_channel_manager_t *manager,
+                                                     uvm_channel_type_t type,
+                                                     uvm_gpu_t *dst_gpu,
+                                                     NvU64 size,
+                                                     uvm_tracker_t *tracker,
+                                                     uvm_push_t *push,
+                                                     const char *filename,
+                                                     const char *function,
+                                                     int line,
+                                                     const char *format, ...);
+
 // Internal helper for uvm_push_begin_on_channel and
 // uvm_push_begin_acquire_on_channel
 __attribute__ ((format(printf, 7, 8)))
@@ -222,6 +259,14 @@ NV_STATUS __uvm_push_begin_acquire_on_channel_with_info(uvm_channel_t *channel,
     __uvm_push_begin_acquire_with_info((manager), UVM_CHANNEL_TYPE_GPU_TO_GPU, (dst_gpu), (tracker), (push), \
         __FILE__, __FUNCTION__, __LINE__, (format), ##__VA_ARGS__)
 
+// Same as uvm_push_begin_acquire, or uvm_push_begin_acquire_gpu_to_gpu if
+// dst_gpu is not NULL, for a push transferring size bytes. Large transfers are
+// striped across the CEs suitable for the type, see
+// uvm_channel_reserve_striped().
+#define uvm_push_begin_acquire_striped(manager, type, dst_gpu, size, tracker, push, format, ...)   \
+    __uvm_push_begin_acquire_striped_with_info((manager), (type), (dst_gpu), (size), (tracker), (push), \
+        __FILE__, __FUNCTION__, __LINE__, (format), ##__VA_ARGS__)
+
 // Begin a push on a specific channel
 // If the channel is busy, spin wait for it to become available.
 //
@@ -266,6 +311,107 @@ NV_STATUS uvm_push_wait(uvm_push_t *push);
 // Shortcut for uvm_push_end() and uvm_push_wait().
 NV_STATUS uvm_push_end_and_wait(uvm_push_t *push);
 
+// Push coalescing
+//
+// Many operations end up as tiny pushes (a semaphore release, a few PTE
+// writes, a membar), each of which costs a GPFIFO entry, a tracking semaphore
+// release and a GPPUT write. Callers issuing a series of such pushes that do
+// not need to track each of them individually can opt-in to have consecutive
+// pushes merged into a single one with a coalescer:
+//
+//     uvm_push_coalesce_init(&coalesce, &tracker);
+//     for (...) {
+//         status = uvm_push_begin_coalesced(&coalesce, manager, type, &push, "...");
+//         ...push methods...
+//         uvm_push_end_coalesced(&coalesce, &push);
+//     }
+//     status = uvm_push_coalesce_flush(&coalesce);
+//
+// A coalesced push continues the combined push left on-going by the previous
+// coalesced push, as long as both use the same channel manager and channel
+// type and the combined push is still small. Otherwise the combined push is
+// submitted first. Submitted combined pushes are added to the coalescer's
+// tracker, if any, which is how the work of coalesced pushes is tracked: the
+// pushes themselves cannot be used with uvm_push_get_tracker_entry() or
+// uvm_push_wait().
+//
+// The combined push stays on-going between coalesced pushes, holding the
+// concurrent push semaphore and a GPFIFO entry of its channel. To keep the
+// semantics of the code around it, it is submitted (flushed) automatically
+// whenever its thread begins a regular push or waits for GPU work through
+// trackers or channels. Other than that, the rules for code between coalesced
+// pushes are the same as for code between uvm_push_begin() and uvm_push_end():
+// it must not take locks ordered before UVM_LOCK_ORDER_PUSH, nor sleep for a
+// long time.
+//
+// Only a single coalescer can have an on-going combined push in a thread at
+// any given time, and coalescing is not supported in interrupt context.
+
+// Coalesced pushes end the combined push once it reaches this size, so every
+// coalesced push can use up to UVM_MAX_PUSH_SIZE - UVM_PUSH_COALESCE_MAX_SIZE.
+#define UVM_PUSH_COALESCE_MAX_SIZE (16 * 1024)
+
+// Maximum number of pushes merged into one
+#define UVM_PUSH_COALESCE_MAX_PUSHES 64
+
+struct uvm_push_coalesce_struct
+{
+    // Combined push, on-going if num_pushes is not 0
+    uvm_push_t push;
+
+    // Number of pushes merged into the combined push so far
+    NvU32 num_pushes;
+
+    // Channel manager and type the combined push was begun with
+    uvm_channel_manager_t *manager;
+    uvm_channel_type_t type;
+
+    // Tracker the combined pushes are added to when submitted. Can be NULL.
+    uvm_tracker_t *tracker;
+
+    // First error encountered when submitting a combined push
+    NV_STATUS status;
+};
+
+// Initialize a coalescer. The tracker can be NULL if the submitted work does
+// not need to be tracked, other than by the channel order.
+void uvm_push_coalesce_init(uvm_push_coalesce_t *coalesce, uvm_tracker_t *tracker);
+
+// Internal helper for uvm_push_begin_coalesced
+__attribute__ ((format(printf, 8, 9)))
+NV_STATUS __uvm_push_begin_coalesced_with_info(uvm_push_coalesce_t *coalesce,
+                                               uvm_channel_manager_t *manager,
+                                               uvm_channel_type_t type,
+                                               uvm_push_t *push,
+                                               const char *filename,
+                                               const char *function,
+                                               int line,
+                                               const char *format, ...);
+
+// Begin a push that can be merged with the previous and following pushes of
+// the coalescer. The description is only used if a new combined push is
+// begun.
+//
+// Locking: on success the concurrent push semaphore may remain acquired until
+// the coalescer is flushed
+#define uvm_push_begin_coalesced(coalesce, manager, type, push, format, ...)         \
+    __uvm_push_begin_coalesced_with_info((coalesce), (manager), (type), (push),      \
+        __FILE__, __FUNCTION__, __LINE__, (format), ##__VA_ARGS__)
+
+// End a push begun with uvm_push_begin_coalesced(). The methods are only
+// submitted to the GPU once the combined push is large enough or the coalescer
+// is flushed.
+void uvm_push_end_coalesced(uvm_push_coalesce_t *coalesce, uvm_push_t *push);
+
+// Submit the on-going combined push, if any, and add it to the coalescer's
+// tracker. Returns the first error encountered by the coalescer.
+NV_STATUS uvm_push_coalesce_flush(uvm_push_coalesce_t *coalesce);
+
+// Flush the coalescer with an on-going combined push in the current thread,
+// if any. Called before beginning regular pushes and before waiting for GPU
+// work. Errors are recorded in the coalescer.
+void uvm_push_coalesce_flush_current_thread(void);
+
 // Get the tracker entry tracking the push
 // The push has to be finished before calling this function.
 static void uvm_push_get_tracker_entry(uvm_push_t *push, uvm_tracker_entry_t *entry)
@@ -308,7 +454,7 @@ static NvU32 uvm_push_get_size(uvm_push_t *push)
 // Check whether the push still has free_space bytes available to be pushed
 static bool uvm_push_has_space(uvm_push_t *push, NvU32 free_space)
 {
-    return (UVM_MAX_PUSH_SIZE - uvm_push_get_size(push)) >= free_space;
+    return (UVM_MAX_PUSH_SIZE - push->trace.reserved_size - uvm_push_get_size(push)) >= free_space;
 }
 
 // Fake push begin and end
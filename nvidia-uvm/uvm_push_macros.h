@@ -132,7 +132,7 @@
 #define __NV_PUSH_0U(subch, count, a1)                                                  \
     do {                                                                                \
         UVM_ASSERT(!uvm_global_is_suspended());                                         \
-        UVM_ASSERT(uvm_push_get_size(push) + (count + 1) * 4 <= UVM_MAX_PUSH_SIZE);     \
+        UVM_ASSERT(uvm_push_has_space(push, (count + 1) * 4));                          \
         UVM_ASSERT_MSG(a1 % 4 == 0, "Address %u\n", a1);                                \
                                                                                         \
         push->next[0] = UVM_METHOD_INC(subch, a1, count);                               \
@@ -249,7 +249,7 @@
 #define __NV_PUSH_NU_NONINC(subch, count, address)                                      \
     do {                                                                                \
         UVM_ASSERT(!uvm_global_is_suspended());                                         \
-        UVM_ASSERT(uvm_push_get_size(push) + (count + 1) * 4 <= UVM_MAX_PUSH_SIZE);     \
+        UVM_ASSERT(uvm_push_has_space(push, (count + 1) * 4));                          \
         UVM_ASSERT_MSG(address % 4 == 0, "Address %u\n", address);                      \
         push->next[0] = UVM_METHOD_NONINC(subch, address, count);                       \
         push->next += count + 1;                                                        \
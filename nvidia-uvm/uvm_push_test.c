@@ -44,6 +44,7 @@ static NV_STATUS test_push_end_size(uvm_va_space_t *va_space)
     NV_STATUS status = NV_OK;
     uvm_gpu_t *gpu;
     NvU32 push_size;
+    NvU32 end_size;
     NvU32 i;
 
     for_each_va_space_gpu(gpu, va_space) {
@@ -55,10 +56,17 @@ static NV_STATUS test_push_end_size(uvm_va_space_t *va_space)
 
             push_size = uvm_push_get_size(&push);
             uvm_push_end(&push);
-            if (uvm_push_get_size(&push) - push_size != UVM_PUSH_END_SIZE) {
+
+            // Traced pushes also release a GPU timestamp when they end, in
+            // space reserved out of the push when it began.
+            end_size = UVM_PUSH_END_SIZE;
+            if (push.trace.gpu_begin_timestamp != NULL)
+                end_size += UVM_CHANNEL_PUSH_TRACE_TIMESTAMP_SIZE;
+
+            if (uvm_push_get_size(&push) - push_size != end_size) {
                 UVM_TEST_PRINT("UVM_PUSH_END_SIZE incorrect, %u instead of %u for GPU %s\n",
                                uvm_push_get_size(&push) - push_size,
-                               UVM_PUSH_END_SIZE,
+                               end_size,
                                uvm_gpu_name(gpu));
                 status = NV_ERR_INVALID_STATE;
                 goto done;
@@ -409,19 +417,24 @@ static NV_STATUS test_push_exactly_max_push(uvm_gpu_t *gpu,
 {
     NV_STATUS status;
     NvU64 semaphore_gpu_va;
+    NvU32 max_size;
 
     status = uvm_push_begin(gpu->channel_manager, UVM_CHANNEL_TYPE_GPU_INTERNAL, push, "Test push");
     if (status != NV_OK)
         return status;
 
-    TEST_CHECK_RET(uvm_push_has_space(push, UVM_MAX_PUSH_SIZE));
-    TEST_CHECK_RET(!uvm_push_has_space(push, UVM_MAX_PUSH_SIZE + 1));
+    // Traced pushes begin with a GPU timestamp and keep space for another one
+    // at the end.
+    max_size = UVM_MAX_PUSH_SIZE - push->trace.reserved_size;
+
+    TEST_CHECK_RET(uvm_push_has_space(push, max_size - uvm_push_get_size(push)));
+    TEST_CHECK_RET(!uvm_push_has_space(push, max_size - uvm_push_get_size(push) + 1));
 
     semaphore_gpu_va = uvm_gpu_semaphore_get_gpu_va(sema_to_acquire, gpu, uvm_channel_is_proxy(push->channel));
     gpu->parent->host_hal->semaphore_acquire(push, semaphore_gpu_va, value);
 
     // Push a noop leaving just UVM_PUSH_END_SIZE in the pushbuffer.
-    gpu->parent->host_hal->noop(push, UVM_MAX_PUSH_SIZE - uvm_push_get_size(push) - UVM_PUSH_END_SIZE);
+    gpu->parent->host_hal->noop(push, max_size - uvm_push_get_size(push) - UVM_PUSH_END_SIZE);
 
     TEST_CHECK_RET(uvm_push_has_space(push, UVM_PUSH_END_SIZE));
     TEST_CHECK_RET(!uvm_push_has_space(push, UVM_PUSH_END_SIZE + 1));
@@ -436,7 +449,7 @@ static NvU32 test_count_idle_chunks(uvm_pushbuffer_t *pushbuffer)
 {
     NvU32 i;
     NvU32 count = 0;
-    for (i = 0; i < UVM_PUSHBUFFER_CHUNKS; ++i)
+    for (i = 0; i < UVM_PUSHBUFFER_MAX_CHUNKS; ++i)
         count += test_bit(i, pushbuffer->idle_chunks) ? 1 : 0;
     return count;
 }
@@ -445,13 +458,22 @@ static NvU32 test_count_available_chunks(uvm_pushbuffer_t *pushbuffer)
 {
     NvU32 i;
     NvU32 count = 0;
-    for (i = 0; i < UVM_PUSHBUFFER_CHUNKS; ++i)
+    for (i = 0; i < UVM_PUSHBUFFER_MAX_CHUNKS; ++i)
         count += test_bit(i, pushbuffer->available_chunks) ? 1 : 0;
     return count;
 }
 
-// Reuse the whole pushbuffer 4 times, one UVM_MAX_PUSH_SIZE at a time
-#define EXTRA_MAX_PUSHES_WHILE_FULL (4 * UVM_PUSHBUFFER_SIZE / UVM_MAX_PUSH_SIZE)
+// Reuse the whole initial pushbuffer 4 times, one UVM_MAX_PUSH_SIZE at a time
+#define EXTRA_MAX_PUSHES_WHILE_FULL (4 * UVM_PUSHBUFFER_MIN_SIZE / UVM_MAX_PUSH_SIZE)
+
+static void test_pushbuffer_set_resize_disabled(uvm_pushbuffer_t *pushbuffer, bool disabled)
+{
+    uvm_spin_lock(&pushbuffer->lock);
+
+    pushbuffer->test.resize_disabled = disabled;
+
+    uvm_spin_unlock(&pushbuffer->lock);
+}
 
 // Test doing pushes of exactly UVM_MAX_PUSH_SIZE size and only allowing them to
 // complete one by one.
@@ -461,12 +483,15 @@ static NV_STATUS test_max_pushes_on_gpu(uvm_gpu_t *gpu)
 
     uvm_tracker_t tracker;
     uvm_gpu_semaphore_t sema;
+    uvm_pushbuffer_t *pushbuffer = gpu->channel_manager->pushbuffer;
     NvU32 total_push_size = 0;
     NvU32 push_count = 0;
     NvU32 i;
 
     uvm_tracker_init(&tracker);
 
+    test_pushbuffer_set_resize_disabled(pushbuffer, true);
+
     status = uvm_gpu_semaphore_alloc(gpu->semaphore_pool, &sema);
     TEST_CHECK_GOTO(status == NV_OK, done);
 
@@ -489,7 +514,7 @@ static NV_STATUS test_max_pushes_on_gpu(uvm_gpu_t *gpu)
         TEST_NV_CHECK_GOTO(uvm_tracker_add_push(&tracker, &push), done);
     }
 
-    if (total_push_size != UVM_PUSHBUFFER_SIZE) {
+    if (total_push_size != uvm_pushbuffer_num_chunks(pushbuffer) * UVM_PUSHBUFFER_CHUNK_SIZE) {
         UVM_TEST_PRINT("Unexpected space in the pushbuffer, total push %u\n", total_push_size);
         uvm_pushbuffer_print(gpu->channel_manager->pushbuffer);
         status = NV_ERR_INVALID_STATE;
@@ -529,22 +554,29 @@ done:
 
     uvm_gpu_semaphore_free(&sema);
 
+    test_pushbuffer_set_resize_disabled(pushbuffer, false);
+
     return status;
 }
 
 
-// Test doing UVM_PUSHBUFFER_CHUNKS independent pushes expecting each one to use
-// a different chunk in the pushbuffer.
+// Test doing as many independent pushes as there are chunks expecting each one
+// to use a different chunk in the pushbuffer.
 static NV_STATUS test_idle_chunks_on_gpu(uvm_gpu_t *gpu)
 {
     NV_STATUS status;
 
     uvm_gpu_semaphore_t sema;
     uvm_tracker_t tracker = UVM_TRACKER_INIT();
+    uvm_pushbuffer_t *pushbuffer = gpu->channel_manager->pushbuffer;
+    NvU32 num_chunks;
     NvU32 i;
 
     uvm_tracker_init(&tracker);
 
+    test_pushbuffer_set_resize_disabled(pushbuffer, true);
+    num_chunks = uvm_pushbuffer_num_chunks(pushbuffer);
+
     status = uvm_gpu_semaphore_alloc(gpu->semaphore_pool, &sema);
     TEST_CHECK_GOTO(status == NV_OK, done);
 
@@ -555,7 +587,7 @@ static NV_STATUS test_idle_chunks_on_gpu(uvm_gpu_t *gpu)
     status = uvm_channel_manager_wait(gpu->channel_manager);
     TEST_CHECK_GOTO(status == NV_OK, done);
 
-    for (i = 0; i < UVM_PUSHBUFFER_CHUNKS; ++i) {
+    for (i = 0; i < num_chunks; ++i) {
         NvU64 semaphore_gpu_va;
         uvm_push_t push;
 
@@ -568,34 +600,102 @@ static NV_STATUS test_idle_chunks_on_gpu(uvm_gpu_t *gpu)
 
         TEST_NV_CHECK_GOTO(uvm_tracker_add_push(&tracker, &push), done);
 
-        if (test_count_idle_chunks(gpu->channel_manager->pushbuffer) != UVM_PUSHBUFFER_CHUNKS - i - 1) {
+        if (test_count_idle_chunks(pushbuffer) != num_chunks - i - 1) {
             UVM_TEST_PRINT("Unexpected count of idle chunks in the pushbuffer %u instead of %u\n",
-                           test_count_idle_chunks(gpu->channel_manager->pushbuffer), UVM_PUSHBUFFER_CHUNKS - i - 1);
-            uvm_pushbuffer_print(gpu->channel_manager->pushbuffer);
+                           test_count_idle_chunks(pushbuffer), num_chunks - i - 1);
+            uvm_pushbuffer_print(pushbuffer);
             status = NV_ERR_INVALID_STATE;
             goto done;
         }
     }
-    uvm_gpu_semaphore_set_payload(&sema, UVM_PUSHBUFFER_CHUNKS + 1);
+    uvm_gpu_semaphore_set_payload(&sema, num_chunks + 1);
 
     status = uvm_channel_manager_wait(gpu->channel_manager);
     TEST_CHECK_GOTO(status == NV_OK, done);
 
-    if (test_count_idle_chunks(gpu->channel_manager->pushbuffer) != UVM_PUSHBUFFER_CHUNKS) {
+    if (test_count_idle_chunks(pushbuffer) != num_chunks) {
         UVM_TEST_PRINT("Unexpected count of idle chunks in the pushbuffer %u\n",
-                       test_count_idle_chunks(gpu->channel_manager->pushbuffer));
-        uvm_pushbuffer_print(gpu->channel_manager->pushbuffer);
+                       test_count_idle_chunks(pushbuffer));
+        uvm_pushbuffer_print(pushbuffer);
         status = NV_ERR_INVALID_STATE;
         goto done;
     }
 
 done:
-    uvm_gpu_semaphore_set_payload(&sema, UVM_PUSHBUFFER_CHUNKS + 1);
+    uvm_gpu_semaphore_set_payload(&sema, num_chunks + 1);
     uvm_tracker_wait(&tracker);
 
     uvm_gpu_semaphore_free(&sema);
     uvm_tracker_deinit(&tracker);
 
+    test_pushbuffer_set_resize_disabled(pushbuffer, false);
+
+    return status;
+}
+
+// Test that a push begun while all the chunks are full of pending pushes that
+// cannot complete gets a chunk added by the resize worker instead of waiting
+// for them.
+static NV_STATUS test_grow_on_gpu(uvm_gpu_t *gpu)
+{
+    NV_STATUS status;
+
+    uvm_tracker_t tracker = UVM_TRACKER_INIT();
+    uvm_gpu_semaphore_t sema;
+    uvm_pushbuffer_t *pushbuffer = gpu->channel_manager->pushbuffer;
+    uvm_push_t push;
+    NvU32 num_chunks;
+    NvU64 grows;
+
+    if (uvm_pushbuffer_num_chunks(pushbuffer) == pushbuffer->max_chunks)
+        return NV_OK;
+
+    test_pushbuffer_set_resize_disabled(pushbuffer, true);
+
+    status = uvm_gpu_semaphore_alloc(gpu->semaphore_pool, &sema);
+    TEST_CHECK_GOTO(status == NV_OK, done);
+
+    uvm_gpu_semaphore_set_payload(&sema, 0);
+
+    status = uvm_channel_manager_wait(gpu->channel_manager);
+    TEST_CHECK_GOTO(status == NV_OK, done);
+
+    // None of these pushes can complete until the semaphore is released
+    while (uvm_pushbuffer_has_space(pushbuffer)) {
+        status = test_push_exactly_max_push(gpu, &push, &sema, 1);
+        TEST_CHECK_GOTO(status == NV_OK, done);
+
+        TEST_NV_CHECK_GOTO(uvm_tracker_add_push(&tracker, &push), done);
+    }
+
+    num_chunks = uvm_pushbuffer_num_chunks(pushbuffer);
+    grows = pushbuffer->stats.grows;
+
+    test_pushbuffer_set_resize_disabled(pushbuffer, false);
+
+    status = uvm_push_begin(gpu->channel_manager, UVM_CHANNEL_TYPE_GPU_INTERNAL, &push, "Push growing the pushbuffer");
+    TEST_CHECK_GOTO(status == NV_OK, done);
+
+    uvm_push_end(&push);
+    TEST_NV_CHECK_GOTO(uvm_tracker_add_push(&tracker, &push), done);
+
+    if (uvm_pushbuffer_num_chunks(pushbuffer) != num_chunks + 1 || pushbuffer->stats.grows != grows + 1) {
+        UVM_TEST_PRINT("Unexpected pushbuffer size %u instead of %u\n",
+                       uvm_pushbuffer_num_chunks(pushbuffer),
+                       num_chunks + 1);
+        uvm_pushbuffer_print(pushbuffer);
+        status = NV_ERR_INVALID_STATE;
+        goto done;
+    }
+
+done:
+    uvm_gpu_semaphore_set_payload(&sema, 1);
+    uvm_tracker_wait_deinit(&tracker);
+
+    uvm_gpu_semaphore_free(&sema);
+
+    test_pushbuffer_set_resize_disabled(pushbuffer, false);
+
     return status;
 }
 
@@ -606,6 +706,7 @@ static NV_STATUS test_pushbuffer(uvm_va_space_t *va_space)
     for_each_va_space_gpu(gpu, va_space) {
         TEST_NV_CHECK_RET(test_max_pushes_on_gpu(gpu));
         TEST_NV_CHECK_RET(test_idle_chunks_on_gpu(gpu));
+        TEST_NV_CHECK_RET(test_grow_on_gpu(gpu));
     }
     return NV_OK;
 }
@@ -671,6 +772,123 @@ static NV_STATUS test_timestamp(uvm_va_space_t *va_space)
     return NV_OK;
 }
 
+#define TEST_PUSH_COALESCING_NUM_PUSHES 16
+
+static NV_STATUS test_push_coalescing_on_gpu(uvm_gpu_t *gpu)
+{
+    NV_STATUS status;
+    uvm_push_coalesce_t coalesce;
+    uvm_tracker_t tracker = UVM_TRACKER_INIT();
+    uvm_push_t push;
+    uvm_channel_t *channel = NULL;
+    uvm_rm_mem_t *mem = NULL;
+    NvU32 *host_va;
+    NvU64 queued_value = 0;
+    NvU32 i;
+    const size_t size = sizeof(NvU32) * (TEST_PUSH_COALESCING_NUM_PUSHES + 1);
+
+    BUILD_BUG_ON(TEST_PUSH_COALESCING_NUM_PUSHES >= UVM_PUSH_COALESCE_MAX_PUSHES);
+
+    status = uvm_rm_mem_alloc_and_map_cpu(gpu, UVM_RM_MEM_TYPE_SYS, size, &mem);
+    TEST_CHECK_GOTO(status == NV_OK, done);
+    host_va = (NvU32 *)uvm_rm_mem_get_cpu_va(mem);
+    memset(host_va, 0, size);
+
+    uvm_push_coalesce_init(&coalesce, &tracker);
+
+    // Each coalesced push releases a semaphore at a different location. All
+    // of them should end up in a single combined push.
+    for (i = 0; i < TEST_PUSH_COALESCING_NUM_PUSHES; ++i) {
+        NvU64 gpu_va;
+
+        status = uvm_push_begin_coalesced(&coalesce,
+                                          gpu->channel_manager,
+                                          UVM_CHANNEL_TYPE_GPU_INTERNAL,
+                                          &push,
+                                          "Coalesced release %u",
+                                          i);
+        TEST_CHECK_GOTO(status == NV_OK, done);
+
+        if (i == 0) {
+            channel = push.channel;
+            queued_value = channel->tracking_sem.queued_value;
+        }
+
+        TEST_CHECK_GOTO(push.channel == channel, done);
+
+        gpu_va = uvm_rm_mem_get_gpu_va(mem, gpu, uvm_channel_is_proxy(push.channel));
+        gpu->parent->ce_hal->semaphore_release(&push, gpu_va + sizeof(NvU32) * i, i + 1);
+
+        uvm_push_end_coalesced(&coalesce, &push);
+    }
+
+    TEST_CHECK_GOTO(coalesce.num_pushes == TEST_PUSH_COALESCING_NUM_PUSHES, done);
+    TEST_CHECK_GOTO(uvm_tracker_is_empty(&tracker), done);
+
+    // Waiting for the tracker flushes the combined push first
+    status = uvm_tracker_wait(&tracker);
+    TEST_CHECK_GOTO(status == NV_OK, done);
+    TEST_CHECK_GOTO(coalesce.num_pushes == 0, done);
+    TEST_CHECK_GOTO(channel->tracking_sem.queued_value == queued_value + 1, done);
+
+    for (i = 0; i < TEST_PUSH_COALESCING_NUM_PUSHES; ++i) {
+        if (host_va[i] != i + 1) {
+            UVM_TEST_PRINT("Observed semaphore value %u at index %u but expected %u\n", host_va[i], i, i + 1);
+            status = NV_ERR_INVALID_STATE;
+            goto done;
+        }
+    }
+
+    // Beginning a regular push flushes the combined push too
+    status = uvm_push_begin_coalesced(&coalesce,
+                                      gpu->channel_manager,
+                                      UVM_CHANNEL_TYPE_GPU_INTERNAL,
+                                      &push,
+                                      "Coalesced release before a regular push");
+    TEST_CHECK_GOTO(status == NV_OK, done);
+    gpu->parent->ce_hal->semaphore_release(&push,
+                                           uvm_rm_mem_get_gpu_va(mem, gpu, uvm_channel_is_proxy(push.channel)) +
+                                           sizeof(NvU32) * TEST_PUSH_COALESCING_NUM_PUSHES,
+                                           1);
+    uvm_push_end_coalesced(&coalesce, &push);
+
+    status = uvm_push_begin(gpu->channel_manager, UVM_CHANNEL_TYPE_GPU_INTERNAL, &push, "Regular push");
+    TEST_CHECK_GOTO(status == NV_OK, done);
+    TEST_CHECK_GOTO(coalesce.num_pushes == 0, done);
+    uvm_push_end(&push);
+
+    status = uvm_push_wait(&push);
+    TEST_CHECK_GOTO(status == NV_OK, done);
+
+    status = uvm_push_coalesce_flush(&coalesce);
+    TEST_CHECK_GOTO(status == NV_OK, done);
+
+    status = uvm_tracker_wait(&tracker);
+    TEST_CHECK_GOTO(status == NV_OK, done);
+    TEST_CHECK_GOTO(host_va[TEST_PUSH_COALESCING_NUM_PUSHES] == 1, done);
+
+done:
+    if (status != NV_OK)
+        uvm_push_coalesce_flush(&coalesce);
+
+    uvm_tracker_wait_deinit(&tracker);
+    uvm_rm_mem_free(mem);
+
+    return status;
+}
+
+// Merge small pushes through a coalescer and check that they are submitted as
+// a single GPFIFO entry, and that waits and regular pushes flush them.
+static NV_STATUS test_push_coalescing(uvm_va_space_t *va_space)
+{
+    uvm_gpu_t *gpu;
+
+    for_each_va_space_gpu(gpu, va_space)
+        TEST_NV_CHECK_RET(test_push_coalescing_on_gpu(gpu));
+
+    return NV_OK;
+}
+
 static NV_STATUS sync_memcopy(uvm_channel_type_t type, uvm_mem_t *dst, uvm_mem_t *src)
 {
     uvm_push_t push;
@@ -856,6 +1074,10 @@ NV_STATUS uvm_test_push_sanity(UVM_TEST_PUSH_SANITY_PARAMS *params, struct file
     if (status != NV_OK)
         goto done;
 
+    status = test_push_coalescing(va_space);
+    if (status != NV_OK)
+        goto done;
+
     if (!params->skipTimestampTest) {
         status = test_timestamp(va_space);
         if (status != NV_OK)
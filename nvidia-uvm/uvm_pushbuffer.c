@@ -33,6 +33,18 @@
 #include "uvm_common.h"
 #include "uvm_linux.h"
 
+static unsigned uvm_pushbuffer_max_chunks = 32;
+module_param(uvm_pushbuffer_max_chunks, uint, S_IRUGO);
+MODULE_PARM_DESC(uvm_pushbuffer_max_chunks,
+                 "Maximum number of chunks the pushbuffer of each GPU can grow to. Chunks are 1MB.");
+
+// Chunks added by growing the pushbuffer are freed once they have been idle
+// for this long.
+#define UVM_PUSHBUFFER_SHRINK_IDLE_NS (1000 * 1000 * 1000ULL)
+
+// Minimum time between two checks for chunks to free
+#define UVM_PUSHBUFFER_SHRINK_CHECK_INTERVAL_NS (100 * 1000 * 1000ULL)
+
 // Print pushbuffer state into a seq_file if provided or with UVM_DBG_PRINT() if not.
 static void uvm_pushbuffer_print_common(uvm_pushbuffer_t *pushbuffer, struct seq_file *s);
 
@@ -75,42 +87,62 @@ static NV_STATUS create_procfs(uvm_pushbuffer_t *pushbuffer)
     return NV_OK;
 }
 
+static NV_STATUS chunk_alloc_memory(uvm_pushbuffer_t *pushbuffer, uvm_rm_mem_t **memory_out)
+{
+    uvm_channel_manager_t *channel_manager = pushbuffer->channel_manager;
+
+    UVM_ASSERT(channel_manager->conf.pushbuffer_loc == UVM_BUFFER_LOCATION_SYS ||
+               channel_manager->conf.pushbuffer_loc == UVM_BUFFER_LOCATION_VID);
+
+    return uvm_rm_mem_alloc_and_map_cpu(channel_manager->gpu,
+                                        (channel_manager->conf.pushbuffer_loc == UVM_BUFFER_LOCATION_SYS)?
+                                            UVM_RM_MEM_TYPE_SYS:
+                                            UVM_RM_MEM_TYPE_GPU,
+                                        UVM_PUSHBUFFER_CHUNK_SIZE,
+                                        memory_out);
+}
+
 NV_STATUS uvm_pushbuffer_create(uvm_channel_manager_t *channel_manager, uvm_pushbuffer_t **pushbuffer_out)
 {
     NV_STATUS status;
     int i;
-    uvm_gpu_t *gpu = channel_manager->gpu;
 
     uvm_pushbuffer_t *pushbuffer = uvm_kvmalloc_zero(sizeof(*pushbuffer));
     if (pushbuffer == NULL)
         return NV_ERR_NO_MEMORY;
 
     pushbuffer->channel_manager = channel_manager;
+    pushbuffer->max_chunks = clamp(uvm_pushbuffer_max_chunks,
+                                   (unsigned)UVM_PUSHBUFFER_MIN_CHUNKS,
+                                   (unsigned)UVM_PUSHBUFFER_MAX_CHUNKS);
 
     uvm_spin_lock_init(&pushbuffer->lock, UVM_LOCK_ORDER_LEAF);
 
-    // Currently the pushbuffer supports UVM_PUSHBUFFER_CHUNKS of concurrent
-    // pushes.
-    uvm_sema_init(&pushbuffer->concurrent_pushes_sema, UVM_PUSHBUFFER_CHUNKS, UVM_LOCK_ORDER_PUSH);
-
-    UVM_ASSERT(channel_manager->conf.pushbuffer_loc == UVM_BUFFER_LOCATION_SYS ||
-               channel_manager->conf.pushbuffer_loc == UVM_BUFFER_LOCATION_VID);
+    // Each on-going push needs a chunk of its own, so the pushbuffer supports
+    // as many concurrent pushes as it can have chunks.
+    uvm_sema_init(&pushbuffer->concurrent_pushes_sema, pushbuffer->max_chunks, UVM_LOCK_ORDER_PUSH);
 
-    status = uvm_rm_mem_alloc_and_map_cpu(gpu,
-                                          (channel_manager->conf.pushbuffer_loc == UVM_BUFFER_LOCATION_SYS)?
-                                              UVM_RM_MEM_TYPE_SYS:
-                                              UVM_RM_MEM_TYPE_GPU,
-                                          UVM_PUSHBUFFER_SIZE,
-                                          &pushbuffer->memory);
+    status = errno_to_nv_status(nv_kthread_q_init(&pushbuffer->resize_q, "UVM pushbuffer resize"));
     if (status != NV_OK)
         goto error;
 
-    bitmap_fill(pushbuffer->idle_chunks, UVM_PUSHBUFFER_CHUNKS);
-    bitmap_fill(pushbuffer->available_chunks, UVM_PUSHBUFFER_CHUNKS);
+    nv_kthread_q_item_init(&pushbuffer->resize_q_item, pushbuffer_resize_entry, pushbuffer);
 
-    for (i = 0; i < UVM_PUSHBUFFER_CHUNKS; ++i)
+    for (i = 0; i < UVM_PUSHBUFFER_MAX_CHUNKS; ++i)
         INIT_LIST_HEAD(&pushbuffer->chunks[i].pending_gpfifos);
 
+    for (i = 0; i < UVM_PUSHBUFFER_MIN_CHUNKS; ++i) {
+        status = chunk_alloc_memory(pushbuffer, &pushbuffer->chunks[i].memory);
+        if (status != NV_OK)
+            goto error;
+    }
+
+    pushbuffer->num_chunks = UVM_PUSHBUFFER_MIN_CHUNKS;
+    pushbuffer->stats.num_chunks_high_water = UVM_PUSHBUFFER_MIN_CHUNKS;
+
+    bitmap_set(pushbuffer->idle_chunks, 0, UVM_PUSHBUFFER_MIN_CHUNKS);
+    bitmap_set(pushbuffer->available_chunks, 0, UVM_PUSHBUFFER_MIN_CHUNKS);
+
     status = create_procfs(pushbuffer);
     if (status != NV_OK)
         goto error;
@@ -126,13 +158,15 @@ error:
 
 static uvm_pushbuffer_chunk_t *get_chunk_in_mask(uvm_pushbuffer_t *pushbuffer, unsigned long *mask)
 {
-    NvU32 index = find_first_bit(mask, UVM_PUSHBUFFER_CHUNKS);
+    NvU32 index = find_first_bit(mask, UVM_PUSHBUFFER_MAX_CHUNKS);
 
     uvm_assert_spinlock_locked(&pushbuffer->lock);
 
-    if (index == UVM_PUSHBUFFER_CHUNKS)
+    if (index == UVM_PUSHBUFFER_MAX_CHUNKS)
         return NULL;
 
+    UVM_ASSERT(index < pushbuffer->num_chunks);
+
     return &pushbuffer->chunks[index];
 }
 
@@ -149,7 +183,7 @@ static uvm_pushbuffer_chunk_t *get_idle_chunk(uvm_pushbuffer_t *pushbuffer)
 static NvU32 chunk_get_index(uvm_pushbuffer_t *pushbuffer, uvm_pushbuffer_chunk_t *chunk)
 {
     NvU32 index = chunk - pushbuffer->chunks;
-    UVM_ASSERT(index < UVM_PUSHBUFFER_CHUNKS);
+    UVM_ASSERT(index < UVM_PUSHBUFFER_MAX_CHUNKS);
     return index;
 }
 
@@ -188,6 +222,15 @@ static uvm_pushbuffer_chunk_t *pick_chunk(uvm_pushbuffer_t *pushbuffer)
     return chunk;
 }
 
+static void update_busy_chunks_high_water(uvm_pushbuffer_t *pushbuffer)
+{
+    NvU32 busy_chunks = pushbuffer->num_chunks - bitmap_weight(pushbuffer->idle_chunks, UVM_PUSHBUFFER_MAX_CHUNKS);
+
+    uvm_assert_spinlock_locked(&pushbuffer->lock);
+
+    pushbuffer->stats.busy_chunks_high_water = max(pushbuffer->stats.busy_chunks_high_water, busy_chunks);
+}
+
 static bool try_claim_chunk(uvm_pushbuffer_t *pushbuffer, uvm_push_t *push, uvm_pushbuffer_chunk_t **chunk_out)
 {
     uvm_pushbuffer_chunk_t *chunk;
@@ -198,10 +241,15 @@ static bool try_claim_chunk(uvm_pushbuffer_t *pushbuffer, uvm_push_t *push, uvm_
     if (!chunk)
         goto done;
 
+    // Only chunks backed by memory are ever idle or available
+    UVM_ASSERT(chunk->memory != NULL);
+
     chunk->current_push = push;
     clear_chunk(pushbuffer, chunk, pushbuffer->idle_chunks);
     clear_chunk(pushbuffer, chunk, pushbuffer->available_chunks);
 
+    update_busy_chunks_high_water(pushbuffer);
+
 done:
     uvm_spin_unlock(&pushbuffer->lock);
     *chunk_out = chunk;
@@ -211,8 +259,7 @@ done:
 
 static NvU32 *chunk_get_next_push_start_addr(uvm_pushbuffer_t *pushbuffer, uvm_pushbuffer_chunk_t *chunk)
 {
-    char *push_start = (char *)uvm_rm_mem_get_cpu_va(pushbuffer->memory);
-    push_start += chunk_get_offset(pushbuffer, chunk);
+    char *push_start = (char *)uvm_rm_mem_get_cpu_va(chunk->memory);
     push_start += chunk->next_push_start;
 
     UVM_ASSERT(((NvU64)push_start) % sizeof(NvU32) == 0);
@@ -220,17 +267,159 @@ static NvU32 *chunk_get_next_push_start_addr(uvm_pushbuffer_t *pushbuffer, uvm_p
     return (NvU32*)push_start;
 }
 
+// Add a new chunk to the pushbuffer, idle and available for pushes to claim.
+// Only called from the resize worker, as allocating the chunk calls into RM.
+static void pushbuffer_grow(uvm_pushbuffer_t *pushbuffer)
+{
+    NV_STATUS status;
+    uvm_rm_mem_t *memory = NULL;
+    uvm_pushbuffer_chunk_t *chunk;
+
+    status = chunk_alloc_memory(pushbuffer, &memory);
+
+    uvm_spin_lock(&pushbuffer->lock);
+
+    pushbuffer->grow_requested = false;
+
+    if (status == NV_OK &&
+        pushbuffer->num_chunks < pushbuffer->max_chunks &&
+        !pushbuffer->test.resize_disabled) {
+        chunk = &pushbuffer->chunks[pushbuffer->num_chunks++];
+        UVM_ASSERT(chunk->memory == NULL);
+        UVM_ASSERT(chunk->current_push == NULL);
+        UVM_ASSERT(list_empty(&chunk->pending_gpfifos));
+
+        chunk->memory = memory;
+        chunk->next_push_start = 0;
+        chunk->idle_time_ns = NV_GETTIME();
+        memory = NULL;
+
+        set_chunk(pushbuffer, chunk, pushbuffer->idle_chunks);
+        set_chunk(pushbuffer, chunk, pushbuffer->available_chunks);
+
+        ++pushbuffer->stats.grows;
+        pushbuffer->stats.num_chunks_high_water = max(pushbuffer->stats.num_chunks_high_water,
+                                                      pushbuffer->num_chunks);
+    }
+
+    uvm_spin_unlock(&pushbuffer->lock);
+
+    uvm_rm_mem_free(memory);
+}
+
+// Free the last chunk of the pushbuffer if it was added by growing and has
+// been idle for long enough. At most one chunk is freed per call. Only called
+// from the resize worker, as freeing the chunk calls into RM.
+static void pushbuffer_shrink(uvm_pushbuffer_t *pushbuffer)
+{
+    uvm_rm_mem_t *memory = NULL;
+    NvU64 now = NV_GETTIME();
+
+    uvm_spin_lock(&pushbuffer->lock);
+
+    if (!pushbuffer->test.resize_disabled && pushbuffer->num_chunks > UVM_PUSHBUFFER_MIN_CHUNKS) {
+        NvU32 index = pushbuffer->num_chunks - 1;
+        uvm_pushbuffer_chunk_t *chunk = &pushbuffer->chunks[index];
+
+        if (test_bit(index, pushbuffer->idle_chunks) && now - chunk->idle_time_ns >= UVM_PUSHBUFFER_SHRINK_IDLE_NS) {
+            UVM_ASSERT(chunk->current_push == NULL);
+            UVM_ASSERT(list_empty(&chunk->pending_gpfifos));
+
+            clear_chunk(pushbuffer, chunk, pushbuffer->idle_chunks);
+            clear_chunk(pushbuffer, chunk, pushbuffer->available_chunks);
+
+            memory = chunk->memory;
+            chunk->memory = NULL;
+
+            --pushbuffer->num_chunks;
+            ++pushbuffer->stats.shrinks;
+        }
+    }
+
+    uvm_spin_unlock(&pushbuffer->lock);
+
+    uvm_rm_mem_free(memory);
+}
+
+static void pushbuffer_resize(uvm_pushbuffer_t *pushbuffer)
+{
+    bool grow;
+
+    uvm_spin_lock(&pushbuffer->lock);
+
+    grow = pushbuffer->grow_requested;
+
+    uvm_spin_unlock(&pushbuffer->lock);
+
+    if (grow)
+        pushbuffer_grow(pushbuffer);
+    else
+        pushbuffer_shrink(pushbuffer);
+}
+
+static void pushbuffer_resize_entry(void *args)
+{
+    UVM_ENTRY_VOID(pushbuffer_resize(args));
+}
+
+// Ask the resize worker to add a chunk to the pushbuffer, unless it's at its
+// maximum size or a chunk is already being added. Pushes never allocate chunks
+// themselves, as that would call into RM on the push path.
+static void request_grow(uvm_pushbuffer_t *pushbuffer)
+{
+    bool schedule = false;
+
+    uvm_spin_lock(&pushbuffer->lock);
+
+    if (!pushbuffer->grow_requested &&
+        pushbuffer->num_chunks < pushbuffer->max_chunks &&
+        !pushbuffer->test.resize_disabled) {
+        pushbuffer->grow_requested = true;
+        schedule = true;
+    }
+
+    uvm_spin_unlock(&pushbuffer->lock);
+
+    if (schedule)
+        nv_kthread_q_schedule_q_item(&pushbuffer->resize_q, &pushbuffer->resize_q_item);
+}
+
+// Ask the resize worker to look for an idle chunk to free. The checks are rate
+// limited so that this is cheap enough to call on every push.
+static void request_shrink(uvm_pushbuffer_t *pushbuffer)
+{
+    NvU64 now;
+
+    if (READ_ONCE(pushbuffer->num_chunks) <= UVM_PUSHBUFFER_MIN_CHUNKS)
+        return;
+
+    now = NV_GETTIME();
+    if (now - READ_ONCE(pushbuffer->last_shrink_check_time_ns) < UVM_PUSHBUFFER_SHRINK_CHECK_INTERVAL_NS)
+        return;
+
+    WRITE_ONCE(pushbuffer->last_shrink_check_time_ns, now);
+
+    nv_kthread_q_schedule_q_item(&pushbuffer->resize_q, &pushbuffer->resize_q_item);
+}
+
 static NV_STATUS claim_chunk(uvm_pushbuffer_t *pushbuffer, uvm_push_t *push, uvm_pushbuffer_chunk_t **chunk_out)
 {
     NV_STATUS status = NV_OK;
     uvm_channel_manager_t *channel_manager = pushbuffer->channel_manager;
     uvm_spin_loop_t spin;
+    NvU64 wait_start;
 
     if (try_claim_chunk(pushbuffer, push, chunk_out))
         return NV_OK;
 
+    wait_start = NV_GETTIME();
+
     uvm_channel_manager_update_progress(channel_manager);
 
+    // All the chunks are in use, have a new one added if possible. It becomes
+    // available to claim once it's allocated, unless a chunk frees up first.
+    request_grow(pushbuffer);
+
     uvm_spin_loop_init(&spin);
     while (!try_claim_chunk(pushbuffer, push, chunk_out) && status == NV_OK) {
         UVM_SPIN_LOOP(&spin);
@@ -238,6 +427,13 @@ static NV_STATUS claim_chunk(uvm_pushbuffer_t *pushbuffer, uvm_push_t *push, uvm
         uvm_channel_manager_update_progress(channel_manager);
     }
 
+    uvm_spin_lock(&pushbuffer->lock);
+
+    ++pushbuffer->stats.chunk_waits;
+    pushbuffer->stats.chunk_wait_ns += NV_GETTIME() - wait_start;
+
+    uvm_spin_unlock(&pushbuffer->lock);
+
     return status;
 }
 
@@ -252,6 +448,8 @@ NV_STATUS uvm_pushbuffer_begin_push(uvm_pushbuffer_t *pushbuffer, uvm_push_t *pu
     // Note that this semaphore is uvm_up()ed in end_push().
     uvm_down(&pushbuffer->concurrent_pushes_sema);
 
+    request_shrink(pushbuffer);
+
     status = claim_chunk(pushbuffer, push, &chunk);
     if (status != NV_OK) {
         uvm_up(&pushbuffer->concurrent_pushes_sema);
@@ -260,6 +458,7 @@ NV_STATUS uvm_pushbuffer_begin_push(uvm_pushbuffer_t *pushbuffer, uvm_push_t *pu
 
     UVM_ASSERT(chunk);
 
+    push->pushbuffer_chunk_index = chunk_get_index(pushbuffer, chunk);
     push->begin = chunk_get_next_push_start_addr(pushbuffer, chunk);
     push->next = push->begin;
 
@@ -325,6 +524,8 @@ static void update_chunk(uvm_pushbuffer_t *pushbuffer, uvm_pushbuffer_chunk_t *c
         // helps avoid the waste that can happen at the very end of the chunk
         // described at the top of uvm_pushbuffer.h.
         chunk->next_push_start = 0;
+
+        chunk->idle_time_ns = NV_GETTIME();
     }
     else if (gpu_get > cpu_put) {
         if (gpu_get - cpu_put >= UVM_MAX_PUSH_SIZE) {
@@ -351,21 +552,49 @@ static void update_chunk(uvm_pushbuffer_t *pushbuffer, uvm_pushbuffer_chunk_t *c
 
 void uvm_pushbuffer_destroy(uvm_pushbuffer_t *pushbuffer)
 {
+    NvU32 i;
+
     if (pushbuffer == NULL)
         return;
 
     uvm_procfs_destroy_entry(pushbuffer->procfs.info_file);
 
-    uvm_rm_mem_free(pushbuffer->memory);
+    // Wait for the resize worker, which may have been scheduled by the last
+    // pushes. It's safe to call nv_kthread_q_stop() even if
+    // nv_kthread_q_init() failed in uvm_pushbuffer_create().
+    nv_kthread_q_stop(&pushbuffer->resize_q);
+
+    for (i = 0; i < UVM_PUSHBUFFER_MAX_CHUNKS; ++i)
+        uvm_rm_mem_free(pushbuffer->chunks[i].memory);
+
     uvm_kvfree(pushbuffer);
 }
 
 static uvm_pushbuffer_chunk_t *offset_to_chunk(uvm_pushbuffer_t *pushbuffer, NvU32 offset)
 {
-    UVM_ASSERT(offset < UVM_PUSHBUFFER_SIZE);
+    UVM_ASSERT(offset < UVM_PUSHBUFFER_CHUNK_SIZE * UVM_PUSHBUFFER_MAX_CHUNKS);
     return &pushbuffer->chunks[offset / UVM_PUSHBUFFER_CHUNK_SIZE];
 }
 
+static uvm_pushbuffer_chunk_t *push_to_chunk(uvm_pushbuffer_t *pushbuffer, uvm_push_t *push)
+{
+    UVM_ASSERT(push->pushbuffer_chunk_index < UVM_PUSHBUFFER_MAX_CHUNKS);
+    return &pushbuffer->chunks[push->pushbuffer_chunk_index];
+}
+
+// Get the offset of the beginning of the push within its chunk
+static NvU32 push_get_offset_in_chunk(uvm_pushbuffer_t *pushbuffer, uvm_push_t *push)
+{
+    uvm_pushbuffer_chunk_t *chunk = push_to_chunk(pushbuffer, push);
+    NvU32 offset = (char *)push->begin - (char *)uvm_rm_mem_get_cpu_va(chunk->memory);
+
+    UVM_ASSERT(chunk->current_push == push);
+    UVM_ASSERT(offset < UVM_PUSHBUFFER_CHUNK_SIZE);
+    UVM_ASSERT(((NvU64)offset) % sizeof(NvU32) == 0);
+
+    return offset;
+}
+
 static uvm_pushbuffer_chunk_t *gpfifo_to_chunk(uvm_pushbuffer_t *pushbuffer, uvm_gpfifo_entry_t *gpfifo)
 {
     uvm_pushbuffer_chunk_t *chunk = offset_to_chunk(pushbuffer, gpfifo->pushbuffer_offset);
@@ -404,22 +633,18 @@ void uvm_pushbuffer_mark_completed(uvm_pushbuffer_t *pushbuffer, uvm_gpfifo_entr
 
 NvU32 uvm_pushbuffer_get_offset_for_push(uvm_pushbuffer_t *pushbuffer, uvm_push_t *push)
 {
-    NvU32 offset = (char*)push->begin - (char *)uvm_rm_mem_get_cpu_va(pushbuffer->memory);
-
-    UVM_ASSERT(((NvU64)offset) % sizeof(NvU32) == 0);
-
-    return offset;
+    return push->pushbuffer_chunk_index * UVM_PUSHBUFFER_CHUNK_SIZE + push_get_offset_in_chunk(pushbuffer, push);
 }
 
 NvU64 uvm_pushbuffer_get_gpu_va_for_push(uvm_pushbuffer_t *pushbuffer, uvm_push_t *push)
 {
-    NvU64 pushbuffer_base;
+    NvU64 chunk_base;
     uvm_gpu_t *gpu = uvm_push_get_gpu(push);
     bool is_proxy_channel = uvm_channel_is_proxy(push->channel);
 
-    pushbuffer_base = uvm_rm_mem_get_gpu_va(pushbuffer->memory, gpu, is_proxy_channel);
+    chunk_base = uvm_rm_mem_get_gpu_va(push_to_chunk(pushbuffer, push)->memory, gpu, is_proxy_channel);
 
-    return pushbuffer_base + uvm_pushbuffer_get_offset_for_push(pushbuffer, push);
+    return chunk_base + push_get_offset_in_chunk(pushbuffer, push);
 }
 
 void uvm_pushbuffer_end_push(uvm_pushbuffer_t *pushbuffer, uvm_push_t *push, uvm_gpfifo_entry_t *gpfifo)
@@ -445,6 +670,19 @@ void uvm_pushbuffer_end_push(uvm_pushbuffer_t *pushbuffer, uvm_push_t *push, uvm
     uvm_up_out_of_order(&pushbuffer->concurrent_pushes_sema);
 }
 
+NvU32 uvm_pushbuffer_num_chunks(uvm_pushbuffer_t *pushbuffer)
+{
+    NvU32 num_chunks;
+
+    uvm_spin_lock(&pushbuffer->lock);
+
+    num_chunks = pushbuffer->num_chunks;
+
+    uvm_spin_unlock(&pushbuffer->lock);
+
+    return num_chunks;
+}
+
 bool uvm_pushbuffer_has_space(uvm_pushbuffer_t *pushbuffer)
 {
     bool has_space;
@@ -467,7 +705,17 @@ void uvm_pushbuffer_print_common(uvm_pushbuffer_t *pushbuffer, struct seq_file *
 
     uvm_spin_lock(&pushbuffer->lock);
 
-    for (i = 0; i < UVM_PUSHBUFFER_CHUNKS; ++i) {
+    UVM_SEQ_OR_DBG_PRINT(s, " chunks: %u max %u high water %u busy high water %u\n",
+                         pushbuffer->num_chunks,
+                         pushbuffer->max_chunks,
+                         pushbuffer->stats.num_chunks_high_water,
+                         pushbuffer->stats.busy_chunks_high_water);
+    UVM_SEQ_OR_DBG_PRINT(s, " grows: %llu shrinks: %llu\n", pushbuffer->stats.grows, pushbuffer->stats.shrinks);
+    UVM_SEQ_OR_DBG_PRINT(s, " chunk waits: %llu wait ns: %llu\n",
+                         pushbuffer->stats.chunk_waits,
+                         pushbuffer->stats.chunk_wait_ns);
+
+    for (i = 0; i < pushbuffer->num_chunks; ++i) {
         uvm_pushbuffer_chunk_t *chunk = &pushbuffer->chunks[i];
         NvU32 cpu_put = chunk_get_cpu_put(pushbuffer, chunk);
         NvU32 gpu_get = chunk_get_gpu_get(pushbuffer, chunk);
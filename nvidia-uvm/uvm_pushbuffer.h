@@ -53,8 +53,20 @@
 //
 // With the above in mind, we can go through the implementation details of the
 // current solution.
-// The pushbuffer backing store is a single big allocation logically divided
-// into largely independent parts called chunks.
+// The pushbuffer backing store is divided into largely independent parts
+// called chunks, each backed by its own allocation. A push never crosses a
+// chunk boundary, so the chunks need not be contiguous in either the CPU or
+// the GPU VA space. Offsets within the pushbuffer (as stored in
+// uvm_gpfifo_entry_t) are made of the chunk index and the offset within the
+// chunk, as if all the chunks were laid out back to back.
+//
+// The pushbuffer starts with UVM_PUSHBUFFER_MIN_CHUNKS chunks and grows one
+// chunk at a time, up to the uvm_pushbuffer_max_chunks module parameter, when
+// a new push cannot find space in any of the existing chunks. Chunks added by
+// growing are freed again, highest index first, after staying idle for a
+// while. Chunks are allocated and freed by a deferred work item, so that pushes
+// never call into RM: a push that finds no space requests a new chunk and
+// waits for either it or an existing chunk to become available.
 // Each chunk is roughly a ringbuffer tracking multiple pending pushes being
 // processed by the GPU. The pushbuffer maintains two bitmaps, one tracking
 // completely idle (with no pending pushes) chunks and a second one tracking
@@ -145,15 +157,22 @@
 //
 #define UVM_MAX_PUSH_SIZE (128 * 1024)
 #define UVM_PUSHBUFFER_CHUNK_SIZE (8 * UVM_MAX_PUSH_SIZE)
-#define UVM_PUSHBUFFER_CHUNKS 16
 
-// Total size of the pushbuffer
-#define UVM_PUSHBUFFER_SIZE (UVM_PUSHBUFFER_CHUNK_SIZE * UVM_PUSHBUFFER_CHUNKS)
+// Number of chunks allocated at pushbuffer creation. These are never freed.
+#define UVM_PUSHBUFFER_MIN_CHUNKS 16
+
+// Upper bound of the uvm_pushbuffer_max_chunks module parameter
+#define UVM_PUSHBUFFER_MAX_CHUNKS 64
+
+// Size of the pushbuffer before it grows
+#define UVM_PUSHBUFFER_MIN_SIZE (UVM_PUSHBUFFER_CHUNK_SIZE * UVM_PUSHBUFFER_MIN_CHUNKS)
 
-// The max number of concurrent pushes that can be happening at the same time.
-// Concurrent pushes are ones that are after uvm_push_begin*(), but before
-// uvm_push_end().
-#define UVM_PUSH_MAX_CONCURRENT_PUSHES UVM_PUSHBUFFER_CHUNKS
+// The max number of concurrent pushes that are guaranteed to be able to happen
+// at the same time without the pushbuffer growing. Concurrent pushes are ones
+// that are after uvm_push_begin*(), but before uvm_push_end(). Up to
+// uvm_pushbuffer_t::max_chunks concurrent pushes are allowed, as long as the
+// pushbuffer can grow.
+#define UVM_PUSH_MAX_CONCURRENT_PUSHES UVM_PUSHBUFFER_MIN_CHUNKS
 
 typedef struct
 {
@@ -167,24 +186,51 @@ typedef struct
 
     // Currently on-going push in the chunk. There can be only one at a time.
     uvm_push_t *current_push;
+
+    // Memory allocation backing the chunk. NULL for chunks beyond
+    // uvm_pushbuffer_t::num_chunks.
+    uvm_rm_mem_t *memory;
+
+    // Time at which the chunk last became idle
+    NvU64 idle_time_ns;
 } uvm_pushbuffer_chunk_t;
 
 struct uvm_pushbuffer_struct
 {
     uvm_channel_manager_t *channel_manager;
 
-    // Memory allocation backing the pushbuffer
-    uvm_rm_mem_t *memory;
+    // Array of the pushbuffer chunks. Only the first num_chunks are backed by
+    // memory.
+    uvm_pushbuffer_chunk_t chunks[UVM_PUSHBUFFER_MAX_CHUNKS];
+
+    // Number of chunks currently backed by memory. Chunks are added and
+    // removed at the end of the array only. Protected by the lock.
+    NvU32 num_chunks;
+
+    // Number of chunks the pushbuffer can grow to
+    NvU32 max_chunks;
 
-    // Array of the pushbuffer chunks
-    uvm_pushbuffer_chunk_t chunks[UVM_PUSHBUFFER_CHUNKS];
+    // Whether a push is waiting for the resize worker to add a chunk.
+    // Protected by the lock.
+    bool grow_requested;
+
+    // Work item adding and freeing chunks. Chunks are only ever allocated and
+    // freed by it, as that calls into RM, which cannot be done on the push
+    // path.
+    //
+    // The item runs on a queue of its own rather than on the global queue:
+    // pushes made from global queue items, like the deferred eviction mappings
+    // work, may wait for a chunk to be added, which would never happen if the
+    // worker adding it was queued behind them.
+    nv_kthread_q_t resize_q;
+    nv_kthread_q_item_t resize_q_item;
 
     // Chunks that do not have an on-going push and have at least
     // UVM_MAX_PUSH_SIZE space free.
-    DECLARE_BITMAP(available_chunks, UVM_PUSHBUFFER_CHUNKS);
+    DECLARE_BITMAP(available_chunks, UVM_PUSHBUFFER_MAX_CHUNKS);
 
     // Chunks that do not have an on-going push nor any pending pushes.
-    DECLARE_BITMAP(idle_chunks, UVM_PUSHBUFFER_CHUNKS);
+    DECLARE_BITMAP(idle_chunks, UVM_PUSHBUFFER_MAX_CHUNKS);
 
     // Lock protecting chunk state and the bitmaps.
     uvm_spinlock_t lock;
@@ -192,14 +238,41 @@ struct uvm_pushbuffer_struct
     // Semaphore enforcing a limited number of concurrent pushes.
     // Decremented in uvm_pushbuffer_begin_push(), incremented in
     // uvm_pushbuffer_end_push().
-    // Initialized to the number of chunks as that's how many concurrent pushes
-    // are supported.
+    // Initialized to max_chunks as that's how many concurrent pushes are
+    // supported once the pushbuffer is fully grown.
     uvm_semaphore_t concurrent_pushes_sema;
 
+    // Time of the last check for idle chunks to free
+    NvU64 last_shrink_check_time_ns;
+
+    // Statistics, protected by the lock
+    struct
+    {
+        // Number of times a push had to wait for a chunk, and the total time
+        // spent waiting
+        NvU64 chunk_waits;
+        NvU64 chunk_wait_ns;
+
+        // Number of chunks added and freed
+        NvU64 grows;
+        NvU64 shrinks;
+
+        // Highest num_chunks, and highest number of chunks not idle at once
+        NvU32 num_chunks_high_water;
+        NvU32 busy_chunks_high_water;
+    } stats;
+
     struct
     {
         struct proc_dir_entry *info_file;
     } procfs;
+
+    struct
+    {
+        // Prevent the pushbuffer from growing or shrinking, so that tests can
+        // control exactly when there is space in it. Protected by the lock.
+        bool resize_disabled;
+    } test;
 };
 
 // Create a pushbuffer
@@ -229,10 +302,14 @@ NvU32 uvm_pushbuffer_get_offset_for_push(uvm_pushbuffer_t *pushbuffer, uvm_push_
 // enough space left.
 void uvm_pushbuffer_end_push(uvm_pushbuffer_t *pushbuffer, uvm_push_t *push, uvm_gpfifo_entry_t *gpfifo);
 
-// Query whether the pushbuffer has space for another push
+// Query whether the pushbuffer has space for another push without growing
 // Mostly useful in pushbuffer tests
 bool uvm_pushbuffer_has_space(uvm_pushbuffer_t *pushbuffer);
 
+// Get the number of chunks currently backed by memory
+// Mostly useful in pushbuffer tests
+NvU32 uvm_pushbuffer_num_chunks(uvm_pushbuffer_t *pushbuffer);
+
 // Helper to print pushbuffer state for debugging
 void uvm_pushbuffer_print(uvm_pushbuffer_t *pushbuffer);
 
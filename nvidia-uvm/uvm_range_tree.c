@@ -23,6 +23,53 @@
 
 #include "uvm_common.h"
 #include "uvm_range_tree.h"
+#include "uvm_kvmalloc.h"
+
+#include <linux/hash.h>
+
+#define RANGE_TREE_INDEX_LEAF_KEYS 32
+
+// Number of entries filled in each leaf when (re)building the index, leaving
+// room for insertions before leaves have to be split
+#define RANGE_TREE_INDEX_BUILD_KEYS ((RANGE_TREE_INDEX_LEAF_KEYS * 3) / 4)
+
+#define RANGE_TREE_LAST_HIT_SLOTS_SHIFT 3
+#define RANGE_TREE_LAST_HIT_SLOTS (1 << RANGE_TREE_LAST_HIT_SLOTS_SHIFT)
+
+typedef struct
+{
+    // Starts of the nodes, sorted. Kept apart from the node pointers so that
+    // searches only touch the keys.
+    NvU64 starts[RANGE_TREE_INDEX_LEAF_KEYS];
+
+    uvm_range_tree_node_t *nodes[RANGE_TREE_INDEX_LEAF_KEYS];
+
+    // Number of entries in use, never 0
+    NvU32 count;
+} range_tree_index_leaf_t;
+
+struct uvm_range_tree_index_struct
+{
+    // False if the index could not be kept up to date. Lookups use the
+    // rb-tree while the index is invalid.
+    bool valid;
+
+    // First start of each leaf, sorted
+    NvU64 *leaf_starts;
+
+    range_tree_index_leaf_t **leaves;
+
+    size_t num_leaves;
+
+    // Number of entries allocated in leaf_starts and leaves
+    size_t max_leaves;
+
+    // Last node found by the threads hashing to each slot. Updated without
+    // synchronization by concurrent lookups, so only accessed with READ_ONCE
+    // and WRITE_ONCE. Nodes are cleared from the cache when they are removed
+    // from the tree.
+    uvm_range_tree_node_t *last_hit[RANGE_TREE_LAST_HIT_SLOTS];
+};
 
 static uvm_range_tree_node_t *get_range_node(struct rb_node *rb_node)
 {
@@ -34,6 +81,369 @@ static bool range_nodes_overlap(uvm_range_tree_node_t *a, uvm_range_tree_node_t
     return uvm_ranges_overlap(a->start, a->end, b->start, b->end);
 }
 
+static void range_tree_index_free_leaves(uvm_range_tree_index_t *index)
+{
+    size_t i;
+
+    for (i = 0; i < index->num_leaves; i++)
+        uvm_kvfree(index->leaves[i]);
+
+    uvm_kvfree(index->leaves);
+    uvm_kvfree(index->leaf_starts);
+
+    index->leaves = NULL;
+    index->leaf_starts = NULL;
+    index->num_leaves = 0;
+    index->max_leaves = 0;
+}
+
+// Drop the contents of the index after a failure to update it. The last-hit
+// cache doesn't depend on the rest of the index and stays usable.
+static void range_tree_index_invalidate(uvm_range_tree_index_t *index)
+{
+    range_tree_index_free_leaves(index);
+    index->valid = false;
+}
+
+static NV_STATUS range_tree_index_reserve_leaves(uvm_range_tree_index_t *index, size_t num_leaves)
+{
+    size_t new_max = max_t(size_t, index->max_leaves, 4);
+    NvU64 *new_leaf_starts;
+    range_tree_index_leaf_t **new_leaves;
+
+    if (num_leaves <= index->max_leaves)
+        return NV_OK;
+
+    while (new_max < num_leaves)
+        new_max *= 2;
+
+    new_leaf_starts = uvm_kvrealloc(index->leaf_starts, new_max * sizeof(index->leaf_starts[0]));
+    if (!new_leaf_starts)
+        return NV_ERR_NO_MEMORY;
+    index->leaf_starts = new_leaf_starts;
+
+    new_leaves = uvm_kvrealloc(index->leaves, new_max * sizeof(index->leaves[0]));
+    if (!new_leaves)
+        return NV_ERR_NO_MEMORY;
+    index->leaves = new_leaves;
+
+    index->max_leaves = new_max;
+
+    return NV_OK;
+}
+
+// Rebuild the index from the list of nodes of the tree
+static NV_STATUS range_tree_index_build(uvm_range_tree_t *tree)
+{
+    uvm_range_tree_index_t *index = tree->index;
+    range_tree_index_leaf_t *leaf = NULL;
+    uvm_range_tree_node_t *node;
+    NV_STATUS status;
+    size_t num_nodes = 0;
+
+    range_tree_index_free_leaves(index);
+
+    uvm_range_tree_for_each(node, tree)
+        num_nodes++;
+
+    status = range_tree_index_reserve_leaves(index, DIV_ROUND_UP(num_nodes, RANGE_TREE_INDEX_BUILD_KEYS));
+    if (status != NV_OK)
+        goto error;
+
+    uvm_range_tree_for_each(node, tree) {
+        if (!leaf || leaf->count == RANGE_TREE_INDEX_BUILD_KEYS) {
+            leaf = uvm_kvmalloc(sizeof(*leaf));
+            if (!leaf) {
+                status = NV_ERR_NO_MEMORY;
+                goto error;
+            }
+
+            leaf->count = 0;
+            index->leaf_starts[index->num_leaves] = node->start;
+            index->leaves[index->num_leaves++] = leaf;
+        }
+
+        leaf->starts[leaf->count] = node->start;
+        leaf->nodes[leaf->count++] = node;
+    }
+
+    index->valid = true;
+
+    return NV_OK;
+
+error:
+    range_tree_index_invalidate(index);
+    return status;
+}
+
+// Return the index of the last leaf whose first start is <= addr, or
+// num_leaves if addr is below all starts.
+static size_t range_tree_index_find_leaf(uvm_range_tree_index_t *index, NvU64 addr)
+{
+    size_t lo = 0;
+    size_t hi = index->num_leaves;
+
+    if (hi == 0 || addr < index->leaf_starts[0])
+        return index->num_leaves;
+
+    // Invariant: leaf_starts[lo] <= addr, and addr < leaf_starts[hi] if hi is
+    // within the array.
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+
+        if (index->leaf_starts[mid] <= addr)
+            lo = mid;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+// Return the position of the last start <= addr in the leaf, or -1 if addr is
+// below all of them.
+static int range_tree_index_leaf_find(range_tree_index_leaf_t *leaf, NvU64 addr)
+{
+    int lo = -1;
+    int hi = leaf->count;
+
+    // Invariant: starts[lo] <= addr (or lo == -1), and addr < starts[hi] (or
+    // hi == count)
+    while (hi - lo > 1) {
+        int mid = lo + (hi - lo) / 2;
+
+        if (leaf->starts[mid] <= addr)
+            lo = mid;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+// Same semantics as range_node_find() for the node and next pointer
+static uvm_range_tree_node_t *range_tree_index_find(uvm_range_tree_t *tree,
+                                                    NvU64 addr,
+                                                    uvm_range_tree_node_t **next)
+{
+    uvm_range_tree_index_t *index = tree->index;
+    range_tree_index_leaf_t *leaf;
+    uvm_range_tree_node_t *node;
+    size_t leaf_index;
+    int pos;
+
+    leaf_index = range_tree_index_find_leaf(index, addr);
+    if (leaf_index == index->num_leaves) {
+        if (next)
+            *next = index->num_leaves ? index->leaves[0]->nodes[0] : NULL;
+
+        return NULL;
+    }
+
+    leaf = index->leaves[leaf_index];
+    pos = range_tree_index_leaf_find(leaf, addr);
+    UVM_ASSERT(pos >= 0);
+
+    node = leaf->nodes[pos];
+    if (next)
+        *next = uvm_range_tree_next(tree, node);
+
+    if (addr > node->end)
+        return NULL;
+
+    return node;
+}
+
+// Find the leaf and position of node, which must be in the index with the
+// given start.
+static range_tree_index_leaf_t *range_tree_index_locate(uvm_range_tree_index_t *index,
+                                                        uvm_range_tree_node_t *node,
+                                                        NvU64 start,
+                                                        size_t *leaf_index,
+                                                        int *pos)
+{
+    range_tree_index_leaf_t *leaf;
+
+    *leaf_index = range_tree_index_find_leaf(index, start);
+    UVM_ASSERT(*leaf_index < index->num_leaves);
+
+    leaf = index->leaves[*leaf_index];
+    *pos = range_tree_index_leaf_find(leaf, start);
+    UVM_ASSERT(*pos >= 0);
+    UVM_ASSERT(leaf->nodes[*pos] == node);
+
+    return leaf;
+}
+
+static void range_tree_index_insert_leaf(uvm_range_tree_index_t *index,
+                                         size_t leaf_index,
+                                         range_tree_index_leaf_t *leaf)
+{
+    UVM_ASSERT(index->num_leaves < index->max_leaves);
+
+    memmove(&index->leaf_starts[leaf_index + 1],
+            &index->leaf_starts[leaf_index],
+            (index->num_leaves - leaf_index) * sizeof(index->leaf_starts[0]));
+    memmove(&index->leaves[leaf_index + 1],
+            &index->leaves[leaf_index],
+            (index->num_leaves - leaf_index) * sizeof(index->leaves[0]));
+
+    index->leaf_starts[leaf_index] = leaf->starts[0];
+    index->leaves[leaf_index] = leaf;
+    index->num_leaves++;
+}
+
+static NV_STATUS range_tree_index_insert(uvm_range_tree_index_t *index, uvm_range_tree_node_t *node)
+{
+    range_tree_index_leaf_t *leaf;
+    size_t leaf_index;
+    int pos;
+
+    // Make sure everything that might be needed is allocated before modifying
+    // anything
+    if (index->num_leaves == 0 || index->leaves[0]->count == RANGE_TREE_INDEX_LEAF_KEYS ||
+        index->num_leaves == index->max_leaves) {
+        NV_STATUS status = range_tree_index_reserve_leaves(index, index->num_leaves + 1);
+        if (status != NV_OK)
+            return status;
+    }
+
+    if (index->num_leaves == 0) {
+        leaf = uvm_kvmalloc(sizeof(*leaf));
+        if (!leaf)
+            return NV_ERR_NO_MEMORY;
+
+        leaf->starts[0] = node->start;
+        leaf->nodes[0] = node;
+        leaf->count = 1;
+        range_tree_index_insert_leaf(index, 0, leaf);
+
+        return NV_OK;
+    }
+
+    // Nodes below all starts go at the front of the first leaf
+    leaf_index = range_tree_index_find_leaf(index, node->start);
+    if (leaf_index == index->num_leaves)
+        leaf_index = 0;
+
+    leaf = index->leaves[leaf_index];
+
+    if (leaf->count == RANGE_TREE_INDEX_LEAF_KEYS) {
+        range_tree_index_leaf_t *new_leaf;
+        NvU32 half = RANGE_TREE_INDEX_LEAF_KEYS / 2;
+
+        new_leaf = uvm_kvmalloc(sizeof(*new_leaf));
+        if (!new_leaf)
+            return NV_ERR_NO_MEMORY;
+
+        // Move the upper half of the entries to the new leaf
+        memcpy(new_leaf->starts, &leaf->starts[half], (leaf->count - half) * sizeof(leaf->starts[0]));
+        memcpy(new_leaf->nodes, &leaf->nodes[half], (leaf->count - half) * sizeof(leaf->nodes[0]));
+        new_leaf->count = leaf->count - half;
+        leaf->count = half;
+
+        range_tree_index_insert_leaf(index, leaf_index + 1, new_leaf);
+
+        if (node->start >= new_leaf->starts[0]) {
+            leaf_index++;
+            leaf = new_leaf;
+        }
+    }
+
+    pos = range_tree_index_leaf_find(leaf, node->start) + 1;
+
+    memmove(&leaf->starts[pos + 1], &leaf->starts[pos], (leaf->count - pos) * sizeof(leaf->starts[0]));
+    memmove(&leaf->nodes[pos + 1], &leaf->nodes[pos], (leaf->count - pos) * sizeof(leaf->nodes[0]));
+    leaf->starts[pos] = node->start;
+    leaf->nodes[pos] = node;
+    leaf->count++;
+
+    if (pos == 0)
+        index->leaf_starts[leaf_index] = node->start;
+
+    return NV_OK;
+}
+
+static void range_tree_index_remove(uvm_range_tree_index_t *index, uvm_range_tree_node_t *node)
+{
+    range_tree_index_leaf_t *leaf;
+    size_t leaf_index;
+    int pos;
+
+    leaf = range_tree_index_locate(index, node, node->start, &leaf_index, &pos);
+
+    leaf->count--;
+    memmove(&leaf->starts[pos], &leaf->starts[pos + 1], (leaf->count - pos) * sizeof(leaf->starts[0]));
+    memmove(&leaf->nodes[pos], &leaf->nodes[pos + 1], (leaf->count - pos) * sizeof(leaf->nodes[0]));
+
+    if (leaf->count == 0) {
+        uvm_kvfree(leaf);
+
+        index->num_leaves--;
+        memmove(&index->leaf_starts[leaf_index],
+                &index->leaf_starts[leaf_index + 1],
+                (index->num_leaves - leaf_index) * sizeof(index->leaf_starts[0]));
+        memmove(&index->leaves[leaf_index],
+                &index->leaves[leaf_index + 1],
+                (index->num_leaves - leaf_index) * sizeof(index->leaves[0]));
+    }
+    else if (pos == 0) {
+        index->leaf_starts[leaf_index] = leaf->starts[0];
+    }
+}
+
+// Update the index after node->start changed from old_start without changing
+// the order of the nodes.
+static void range_tree_index_update_start(uvm_range_tree_t *tree, uvm_range_tree_node_t *node, NvU64 old_start)
+{
+    uvm_range_tree_index_t *index = tree->index;
+    range_tree_index_leaf_t *leaf;
+    size_t leaf_index;
+    int pos;
+
+    if (!index || !index->valid || node->start == old_start)
+        return;
+
+    leaf = range_tree_index_locate(index, node, old_start, &leaf_index, &pos);
+    leaf->starts[pos] = node->start;
+    if (pos == 0)
+        index->leaf_starts[leaf_index] = node->start;
+}
+
+static uvm_range_tree_node_t **range_tree_last_hit_slot(uvm_range_tree_index_t *index)
+{
+    return &index->last_hit[hash_ptr(current, RANGE_TREE_LAST_HIT_SLOTS_SHIFT)];
+}
+
+NV_STATUS uvm_range_tree_enable_index(uvm_range_tree_t *tree)
+{
+    NV_STATUS status;
+
+    UVM_ASSERT(!tree->index);
+
+    tree->index = uvm_kvmalloc_zero(sizeof(*tree->index));
+    if (!tree->index)
+        return NV_ERR_NO_MEMORY;
+
+    status = range_tree_index_build(tree);
+    if (status != NV_OK) {
+        uvm_kvfree(tree->index);
+        tree->index = NULL;
+    }
+
+    return status;
+}
+
+void uvm_range_tree_deinit(uvm_range_tree_t *tree)
+{
+    if (!tree->index)
+        return;
+
+    range_tree_index_free_leaves(tree->index);
+    uvm_kvfree(tree->index);
+    tree->index = NULL;
+}
+
 // Workhorse tree walking function.
 //
 // The parent and next pointers may be NULL if the caller doesn't need them.
@@ -102,7 +512,49 @@ void uvm_range_tree_init(uvm_range_tree_t *tree)
     INIT_LIST_HEAD(&tree->head);
 }
 
+static NV_STATUS range_tree_add_rb(uvm_range_tree_t *tree, uvm_range_tree_node_t *node);
+
 NV_STATUS uvm_range_tree_add(uvm_range_tree_t *tree, uvm_range_tree_node_t *node)
+{
+    NV_STATUS status = range_tree_add_rb(tree, node);
+
+    if (status != NV_OK || !tree->index)
+        return status;
+
+    // The node is in the tree at this point, so failing to update the index
+    // only drops it
+    if (tree->index->valid) {
+        if (range_tree_index_insert(tree->index, node) != NV_OK)
+            range_tree_index_invalidate(tree->index);
+    }
+    else {
+        (void)range_tree_index_build(tree);
+    }
+
+    return NV_OK;
+}
+
+void uvm_range_tree_remove(uvm_range_tree_t *tree, uvm_range_tree_node_t *node)
+{
+    uvm_range_tree_index_t *index = tree->index;
+
+    if (index) {
+        size_t i;
+
+        if (index->valid)
+            range_tree_index_remove(index, node);
+
+        for (i = 0; i < RANGE_TREE_LAST_HIT_SLOTS; i++) {
+            if (index->last_hit[i] == node)
+                WRITE_ONCE(index->last_hit[i], NULL);
+        }
+    }
+
+    rb_erase(&node->rb_node, &tree->rb_root);
+    list_del(&node->list);
+}
+
+static NV_STATUS range_tree_add_rb(uvm_range_tree_t *tree, uvm_range_tree_node_t *node)
 {
     uvm_range_tree_node_t *match, *parent, *prev, *next;
 
@@ -159,10 +611,13 @@ void uvm_range_tree_shrink_node(uvm_range_tree_t *tree, uvm_range_tree_node_t *n
     UVM_ASSERT_MSG(node->start <= new_start, "start 0x%llx new_start 0x%llx\n", node->start, new_start);
     UVM_ASSERT_MSG(node->end >= new_end, "end 0x%llx new_end 0x%llx\n", node->end, new_end);
 
-    // The tree is not needed currently, but might be in the future.
-    (void)tree;
+    if (new_start != node->start) {
+        NvU64 old_start = node->start;
+
+        node->start = new_start;
+        range_tree_index_update_start(tree, node, old_start);
+    }
 
-    node->start = new_start;
     node->end = new_end;
 }
 
@@ -194,6 +649,7 @@ uvm_range_tree_node_t *uvm_range_tree_merge_prev(uvm_range_tree_t *tree, uvm_ran
 
     uvm_range_tree_remove(tree, prev);
     node->start = prev->start;
+    range_tree_index_update_start(tree, node, prev->end + 1);
     return prev;
 }
 
@@ -208,9 +664,73 @@ uvm_range_tree_node_t *uvm_range_tree_merge_next(uvm_range_tree_t *tree, uvm_ran
     return next;
 }
 
+// Look up addr in the last-hit cache and then the index of the tree if it has
+// one, or else walk the rb-tree. The next pointer follows the semantics of
+// range_node_find() but is only set when the cache misses, so the cached node
+// is returned with *next untouched.
+static uvm_range_tree_node_t *range_tree_lookup(uvm_range_tree_t *tree,
+                                                NvU64 addr,
+                                                uvm_range_tree_node_t **next)
+{
+    uvm_range_tree_index_t *index = tree->index;
+    uvm_range_tree_node_t **slot;
+    uvm_range_tree_node_t *node;
+
+    if (!index)
+        return range_node_find(tree, addr, NULL, next);
+
+    slot = range_tree_last_hit_slot(index);
+    node = READ_ONCE(*slot);
+    if (node && addr >= node->start && addr <= node->end)
+        return node;
+
+    if (index->valid)
+        node = range_tree_index_find(tree, addr, next);
+    else
+        node = range_node_find(tree, addr, NULL, next);
+
+    if (node)
+        WRITE_ONCE(*slot, node);
+
+    return node;
+}
+
 uvm_range_tree_node_t *uvm_range_tree_find(uvm_range_tree_t *tree, NvU64 addr)
 {
-    return range_node_find(tree, addr, NULL, NULL);
+    return range_tree_lookup(tree, addr, NULL);
+}
+
+void uvm_range_tree_find_batch(uvm_range_tree_t *tree,
+                               const NvU64 *addrs,
+                               size_t count,
+                               uvm_range_tree_node_t **nodes)
+{
+    uvm_range_tree_node_t *node = NULL;
+    size_t i;
+
+    for (i = 0; i < count; i++) {
+        NvU64 addr = addrs[i];
+
+        UVM_ASSERT(i == 0 || addrs[i - 1] <= addr);
+
+        if (node && addr > node->end) {
+            uvm_range_tree_node_t *next = uvm_range_tree_next(tree, node);
+
+            // The address is past the previous node: it's either in the gap
+            // before the next node, in the next node, or further away.
+            if (next && addr < next->start) {
+                nodes[i] = NULL;
+                continue;
+            }
+
+            node = (next && addr <= next->end) ? next : NULL;
+        }
+
+        if (!node || addr < node->start)
+            node = range_tree_lookup(tree, addr, NULL);
+
+        nodes[i] = node;
+    }
 }
 
 uvm_range_tree_node_t *uvm_range_tree_iter_first(uvm_range_tree_t *tree, NvU64 start, NvU64 end)
@@ -219,7 +739,7 @@ uvm_range_tree_node_t *uvm_range_tree_iter_first(uvm_range_tree_t *tree, NvU64 s
 
     UVM_ASSERT(start <= end);
 
-    node = range_node_find(tree, start, NULL, &next);
+    node = range_tree_lookup(tree, start, &next);
     if (node)
         return node;
 
@@ -30,7 +30,11 @@
 // Tree-based data structure for looking up and iterating over objects with
 // provided [start, end] ranges. The ranges are not allowed to overlap.
 //
-// All locking is up to the caller.
+// All locking is up to the caller. Lookups in a tree with an index (see
+// uvm_range_tree_enable_index()) update its last-hit cache, which is safe to
+// do concurrently from multiple readers.
+
+typedef struct uvm_range_tree_index_struct uvm_range_tree_index_t;
 
 typedef struct uvm_range_tree_struct
 {
@@ -41,6 +45,10 @@ typedef struct uvm_range_tree_struct
     // to avoid calling rb_next and rb_prev frequently, particularly while
     // iterating.
     struct list_head head;
+
+    // Optional lookup index, NULL unless enabled with
+    // uvm_range_tree_enable_index().
+    uvm_range_tree_index_t *index;
 } uvm_range_tree_t;
 
 typedef struct uvm_range_tree_node_struct
@@ -56,16 +64,35 @@ typedef struct uvm_range_tree_node_struct
 
 void uvm_range_tree_init(uvm_range_tree_t *tree);
 
+// Free the lookup index of the tree, if any. Only required for trees on which
+// uvm_range_tree_enable_index() was called. The nodes are not touched.
+void uvm_range_tree_deinit(uvm_range_tree_t *tree);
+
+// Add a lookup index to the tree, built from the nodes already in it, and keep
+// it up to date from then on.
+//
+// Walking the rb-tree chases a pointer per level, which shows up in lookups
+// from the fault paths of processes with many ranges. The index keeps the
+// node starts in sorted arrays instead: a top-level array with the first start
+// of each leaf, and leaves holding up to 32 starts (four cache lines), so that
+// a lookup is two binary searches over contiguous keys. In front of that, each
+// tree caches the last node found by each of a few thread slots, which catches
+// the repeated lookups of the same range that faults and policy changes tend
+// to do.
+//
+// If maintaining the index fails to allocate memory when adding a node, the
+// index is dropped and lookups fall back to the rb-tree until a later add
+// manages to rebuild it, so additions never fail because of the index.
+//
+// The tree must be deinitialized with uvm_range_tree_deinit().
+NV_STATUS uvm_range_tree_enable_index(uvm_range_tree_t *tree);
+
 // Set node->start and node->end before calling this function. Overlapping
 // ranges are not allowed. If the new node overlaps with an existing range node,
 // NV_ERR_UVM_ADDRESS_IN_USE is returned.
 NV_STATUS uvm_range_tree_add(uvm_range_tree_t *tree, uvm_range_tree_node_t *node);
 
-static void uvm_range_tree_remove(uvm_range_tree_t *tree, uvm_range_tree_node_t *node)
-{
-    rb_erase(&node->rb_node, &tree->rb_root);
-    list_del(&node->list);
-}
+void uvm_range_tree_remove(uvm_range_tree_t *tree, uvm_range_tree_node_t *node);
 
 // Shrink an existing node to [new_start, new_end].
 // The new range needs to be a subrange of the range being updated, that is
@@ -95,6 +122,18 @@ uvm_range_tree_node_t *uvm_range_tree_merge_next(uvm_range_tree_t *tree, uvm_ran
 // Returns the node containing addr, if any
 uvm_range_tree_node_t *uvm_range_tree_find(uvm_range_tree_t *tree, NvU64 addr);
 
+// Look up count addresses, sorted in ascending order, at once. nodes[i] is set
+// to the node containing addrs[i], or NULL if there is none.
+//
+// Consecutive addresses commonly fall in the same or in adjacent nodes, like
+// the addresses of a sorted fault batch. Those are resolved by checking the
+// node found for the previous address and the one following it, and only the
+// others go through a full lookup.
+void uvm_range_tree_find_batch(uvm_range_tree_t *tree,
+                               const NvU64 *addrs,
+                               size_t count,
+                               uvm_range_tree_node_t **nodes);
+
 // Returns the prev/next node in address order, or NULL if none exists
 static uvm_range_tree_node_t *uvm_range_tree_prev(uvm_range_tree_t *tree, uvm_range_tree_node_t *node)
 {
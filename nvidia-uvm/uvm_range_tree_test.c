@@ -29,11 +29,17 @@
 #include "uvm_test_ioctl.h"
 #include "uvm_test_rng.h"
 
+#include <linux/sort.h>
+
 // ------------------- Range Tree Test (RTT) ------------------- //
 
 // Arbitrary value, must be >= 1
 #define MAX_NODES_INIT 32
 
+// Number of addresses looked up at once when checking
+// uvm_range_tree_find_batch()
+#define RTT_BATCH_ADDRS 32
+
 typedef enum
 {
     RTT_OP_ADD,
@@ -131,11 +137,12 @@ static void rtt_state_destroy(rtt_state_t *state)
     for (i = 0; i < state->count; i++)
         uvm_kvfree(state->nodes[i]);
 
+    uvm_range_tree_deinit(&state->tree);
     uvm_kvfree(state->nodes);
     uvm_kvfree(state);
 }
 
-static rtt_state_t *rtt_state_create(void)
+static rtt_state_t *rtt_state_create(bool use_index)
 {
     rtt_state_t *state = uvm_kvmalloc_zero(sizeof(*state));
     if (!state)
@@ -149,6 +156,12 @@ static rtt_state_t *rtt_state_create(void)
     }
 
     uvm_range_tree_init(&state->tree);
+
+    if (use_index && uvm_range_tree_enable_index(&state->tree) != NV_OK) {
+        rtt_state_destroy(state);
+        return NULL;
+    }
+
     return state;
 }
 
@@ -349,6 +362,50 @@ static NV_STATUS rtt_check_node(rtt_state_t *state, uvm_range_tree_node_t *node)
     return NV_OK;
 }
 
+static NV_STATUS rtt_check_batch(rtt_state_t *state, NvU64 *addrs, size_t count)
+{
+    uvm_range_tree_node_t *nodes[RTT_BATCH_ADDRS];
+    size_t i;
+
+    uvm_range_tree_find_batch(&state->tree, addrs, count, nodes);
+
+    for (i = 0; i < count; i++)
+        TEST_CHECK_RET(nodes[i] == uvm_range_tree_find(&state->tree, addrs[i]));
+
+    return NV_OK;
+}
+
+// Look up the boundaries of all nodes, and the gaps between them, with
+// uvm_range_tree_find_batch().
+static NV_STATUS rtt_check_find_batch(rtt_state_t *state)
+{
+    uvm_range_tree_node_t *node;
+    NvU64 addrs[RTT_BATCH_ADDRS];
+    size_t count = 0;
+
+    uvm_range_tree_for_each(node, &state->tree) {
+        NvU64 node_addrs[] = {node->start, node->start + (node->end - node->start) / 2, node->end, node->end + 1};
+        size_t num_node_addrs = node->end == ULLONG_MAX ? 3 : 4;
+        size_t i;
+
+        if (count + num_node_addrs > RTT_BATCH_ADDRS) {
+            TEST_NV_CHECK_RET(rtt_check_batch(state, addrs, count));
+            count = 0;
+        }
+
+        for (i = 0; i < num_node_addrs; i++) {
+            // Consecutive nodes may share a boundary address
+            if (count == 0 || addrs[count - 1] < node_addrs[i])
+                addrs[count++] = node_addrs[i];
+        }
+    }
+
+    if (count)
+        TEST_NV_CHECK_RET(rtt_check_batch(state, addrs, count));
+
+    return NV_OK;
+}
+
 static NV_STATUS rtt_check_iterator_all(rtt_state_t *state)
 {
     uvm_range_tree_node_t *node, *next, *prev = NULL, *expected = NULL;
@@ -388,7 +445,8 @@ static NV_STATUS rtt_check_iterator_all(rtt_state_t *state)
     TEST_CHECK_RET(expected == NULL);
 
     TEST_CHECK_RET(iter_count == state->count);
-    return NV_OK;
+
+    return rtt_check_find_batch(state);
 }
 
 
@@ -847,13 +905,20 @@ NV_STATUS uvm_test_range_tree_directed(UVM_TEST_RANGE_TREE_DIRECTED_PARAMS *para
 {
     rtt_state_t *state;
     NV_STATUS status;
+    int use_index;
+
+    // Run the directed test on both the plain rb-tree and the indexed lookups
+    for (use_index = 0; use_index < 2; use_index++) {
+        state = rtt_state_create(use_index);
+        if (!state)
+            return NV_ERR_NO_MEMORY;
+        status = rtt_directed(state);
+        rtt_state_destroy(state);
+        if (status != NV_OK)
+            return status;
+    }
 
-    state = rtt_state_create();
-    if (!state)
-        return NV_ERR_NO_MEMORY;
-    status = rtt_directed(state);
-    rtt_state_destroy(state);
-    return status;
+    return NV_OK;
 }
 
 // ------------------------------ Random Test ------------------------------ //
@@ -1454,7 +1519,9 @@ NV_STATUS uvm_test_range_tree_random(UVM_TEST_RANGE_TREE_RANDOM_PARAMS *params,
         params->max_batch_count == 0)
         return NV_ERR_INVALID_PARAMETER;
 
-    state = rtt_state_create();
+    // Use the index in the random test, which exercises its maintenance on
+    // every operation
+    state = rtt_state_create(true);
     if (!state)
         return NV_ERR_NO_MEMORY;
 
@@ -1463,3 +1530,101 @@ NV_STATUS uvm_test_range_tree_random(UVM_TEST_RANGE_TREE_RANDOM_PARAMS *params,
     rtt_state_destroy(state);
     return status;
 }
+
+// ---------------------------- Lookup Benchmark ---------------------------- //
+
+static int rtt_addr_cmp(const void *a, const void *b)
+{
+    NvU64 addr_a = *(const NvU64 *)a;
+    NvU64 addr_b = *(const NvU64 *)b;
+
+    if (addr_a < addr_b)
+        return -1;
+    return addr_a > addr_b;
+}
+
+// Time num_lookups lookups of addrs with uvm_range_tree_find(), returning the
+// number of hits in found so the lookups can't be elided.
+static NvU64 rtt_time_lookups(uvm_range_tree_t *tree, NvU64 *addrs, NvU64 num_lookups, NvU64 *found)
+{
+    NvU64 start_time = NV_GETTIME();
+    NvU64 i;
+
+    *found = 0;
+    for (i = 0; i < num_lookups; i++) {
+        if (uvm_range_tree_find(tree, addrs[i]))
+            ++*found;
+    }
+
+    return NV_GETTIME() - start_time;
+}
+
+NV_STATUS uvm_test_range_tree_lookup_benchmark(UVM_TEST_RANGE_TREE_LOOKUP_BENCHMARK_PARAMS *params, struct file *filp)
+{
+    uvm_range_tree_t tree;
+    uvm_range_tree_node_t *nodes = NULL;
+    uvm_range_tree_node_t **batch_nodes = NULL;
+    NvU64 *addrs = NULL;
+    NvU64 found, expected_found, start_time;
+    uvm_test_rng_t rng;
+    NV_STATUS status = NV_OK;
+    NvU64 i;
+
+    // Ranges are placed at 1MB strides, leaving a gap after each one
+    const NvU64 stride = 1ULL << 20;
+
+    if (params->num_ranges == 0 || params->num_ranges > (1ULL << 24) ||
+        params->num_lookups == 0 || params->num_lookups > (1ULL << 24))
+        return NV_ERR_INVALID_PARAMETER;
+
+    uvm_range_tree_init(&tree);
+    uvm_test_rng_init(&rng, params->seed);
+
+    nodes = uvm_kvmalloc(params->num_ranges * sizeof(nodes[0]));
+    addrs = uvm_kvmalloc(params->num_lookups * sizeof(addrs[0]));
+    batch_nodes = uvm_kvmalloc(params->num_lookups * sizeof(batch_nodes[0]));
+    if (!nodes || !addrs || !batch_nodes) {
+        status = NV_ERR_NO_MEMORY;
+        goto done;
+    }
+
+    for (i = 0; i < params->num_ranges; i++) {
+        nodes[i].start = i * stride;
+        nodes[i].end = nodes[i].start + uvm_test_rng_range_64(&rng, 1, stride / 2) - 1;
+        TEST_NV_CHECK_GOTO(uvm_range_tree_add(&tree, &nodes[i]), done);
+    }
+
+    for (i = 0; i < params->num_lookups; i++)
+        addrs[i] = uvm_test_rng_range_64(&rng, 0, params->num_ranges * stride - 1);
+
+    // Random lookups through the rb-tree
+    params->rb_tree_ns = rtt_time_lookups(&tree, addrs, params->num_lookups, &expected_found);
+
+    // The same lookups through the index. The last-hit cache rarely hits with
+    // random addresses.
+    TEST_NV_CHECK_GOTO(uvm_range_tree_enable_index(&tree), done);
+    params->index_ns = rtt_time_lookups(&tree, addrs, params->num_lookups, &found);
+    TEST_CHECK_GOTO(found == expected_found, done);
+
+    // Sorted lookups, where consecutive addresses commonly fall in the same
+    // range like in fault batches, first one at a time going through the
+    // last-hit cache and then all at once.
+    sort(addrs, params->num_lookups, sizeof(addrs[0]), rtt_addr_cmp, NULL);
+    params->cached_ns = rtt_time_lookups(&tree, addrs, params->num_lookups, &found);
+    TEST_CHECK_GOTO(found == expected_found, done);
+
+    start_time = NV_GETTIME();
+    uvm_range_tree_find_batch(&tree, addrs, params->num_lookups, batch_nodes);
+    params->batch_ns = NV_GETTIME() - start_time;
+
+    for (i = 0; i < params->num_lookups; i++)
+        TEST_CHECK_GOTO(batch_nodes[i] == uvm_range_tree_find(&tree, addrs[i]), done);
+
+done:
+    uvm_range_tree_deinit(&tree);
+    uvm_kvfree(batch_nodes);
+    uvm_kvfree(addrs);
+    uvm_kvfree(nodes);
+
+    return status;
+}
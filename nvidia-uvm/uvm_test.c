@@ -312,6 +312,16 @@ long uvm_test_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
         UVM_ROUTE_CMD_STACK_INIT_CHECK(UVM_TEST_VA_RANGE_INJECT_ADD_GPU_VA_SPACE_ERROR,
                                        uvm_test_va_range_inject_add_gpu_va_space_error);
         UVM_ROUTE_CMD_STACK_INIT_CHECK(UVM_TEST_DESTROY_GPU_VA_SPACE_DELAY,   uvm_test_destroy_gpu_va_space_delay);
+        UVM_ROUTE_CMD_STACK_INIT_CHECK(UVM_TEST_PMM_TRACE_REPLAY,             uvm_test_pmm_trace_replay);
+        UVM_ROUTE_CMD_STACK_INIT_CHECK(UVM_TEST_PAGE_MASK_BENCHMARK,          uvm_test_page_mask_benchmark);
+        UVM_ROUTE_CMD_STACK_INIT_CHECK(UVM_TEST_VA_BLOCK_METADATA_INFO,       uvm_test_va_block_metadata_info);
+        UVM_ROUTE_CMD_STACK_NO_INIT_CHECK(UVM_TEST_VA_BLOCK_CONTEXT_ARENA_INFO, uvm_test_va_block_context_arena_info);
+        UVM_ROUTE_CMD_STACK_NO_INIT_CHECK(UVM_TEST_RANGE_TREE_LOOKUP_BENCHMARK, uvm_test_range_tree_lookup_benchmark);
+        UVM_ROUTE_CMD_STACK_INIT_CHECK(UVM_TEST_THREAD_CONTEXT_SCALABILITY, uvm_test_thread_context_scalability);
+        UVM_ROUTE_CMD_STACK_INIT_CHECK(UVM_TEST_CE_STRIPE_BANDWIDTH,        uvm_test_ce_stripe_bandwidth);
+        UVM_ROUTE_CMD_STACK_INIT_CHECK(UVM_TEST_TRACKER_BENCHMARK,          uvm_test_tracker_benchmark);
+        UVM_ROUTE_CMD_STACK_INIT_CHECK(UVM_TEST_GPU_SEMAPHORE_STRESS,       uvm_test_gpu_semaphore_stress);
+        UVM_ROUTE_CMD_STACK_INIT_CHECK(UVM_TEST_VA_BLOCK_REGION_LOCKS,      uvm_test_va_block_region_locks);
     }
 
     return -EINVAL;
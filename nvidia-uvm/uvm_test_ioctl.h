@@ -1390,6 +1390,310 @@ typedef struct
     NV_STATUS rmStatus;                                  // Out
 } UVM_TEST_DESTROY_GPU_VA_SPACE_DELAY_PARAMS;
 
+typedef enum
+{
+    // Allocate a user chunk of chunk_size into the given slot. The slot must
+    // be empty.
+    UvmTestPmmTraceOpAlloc = 1,
+
+    // Free the chunk held in the given slot. The slot must be occupied.
+    UvmTestPmmTraceOpFree  = 2,
+
+    // Evict a root chunk picked with the regular eviction heuristics. Ignored
+    // on GPUs that don't support eviction.
+    UvmTestPmmTraceOpEvict = 3,
+} UvmTestPmmTraceOp;
+
+typedef struct
+{
+    NvU32                           op;                                                 // UvmTestPmmTraceOp
+    NvU32                           slot;
+    NvU32                           chunk_size;
+} UvmTestPmmTraceEntry;
+
+// Replay a trace of allocations, frees and evictions against the GPU PMM and
+// report throughput, latency, lock hold times and fragmentation. Any chunks
+// still held when the trace ends are freed before returning.
+//
+// The replay runs in the driver against the PMM of a GPU registered in the VA
+// space, backed by the real PMA, so it requires a GPU and the results depend on
+// other users of its vidmem. PMM cannot be instantiated without a GPU, so there
+// is no mocked PMA mode. The time spent in PMA is reported separately so that
+// the cost of the PMM allocator policy itself can be told apart from RM.
+//
+// If trace is 0, a synthetic trace of num_entries operations is generated from
+// seed instead, randomly allocating chunks of the supported user chunk sizes
+// into empty slots, freeing occupied slots and occasionally evicting.
+//
+// Error returns:
+// NV_ERR_INVALID_DEVICE
+//  - gpu_uuid is not registered in the VA space
+// NV_ERR_INVALID_ARGUMENT
+//  - num_slots is 0 or too large
+//  - the trace references an invalid op, slot or chunk size, allocates into
+//    an occupied slot or frees an empty slot
+#define UVM_TEST_PMM_TRACE_REPLAY                        UVM_TEST_IOCTL_BASE(95)
+typedef struct
+{
+    NvProcessorUuid                 gpu_uuid;                                           // In
+
+    // User pointer to an array of num_entries UvmTestPmmTraceEntry, or 0 to
+    // generate a synthetic trace.
+    NvU64                           trace                            NV_ALIGN_BYTES(8); // In
+    NvU32                           num_entries;                                        // In
+
+    // Number of chunk slots referenced by the trace
+    NvU32                           num_slots;                                          // In
+
+    // Seed for the synthetic trace
+    NvU32                           seed;                                               // In
+
+    NvU64                           num_allocs                       NV_ALIGN_BYTES(8); // Out
+    NvU64                           num_failed_allocs                NV_ALIGN_BYTES(8); // Out
+    NvU64                           num_frees                        NV_ALIGN_BYTES(8); // Out
+    NvU64                           num_evictions                    NV_ALIGN_BYTES(8); // Out
+
+    // Total replay time and the resulting operation rate
+    NvU64                           total_ns                         NV_ALIGN_BYTES(8); // Out
+    NvU64                           ops_per_sec                      NV_ALIGN_BYTES(8); // Out
+
+    // Worst-case latency of a single allocation and free
+    NvU64                           max_alloc_ns                     NV_ALIGN_BYTES(8); // Out
+    NvU64                           max_free_ns                      NV_ALIGN_BYTES(8); // Out
+
+    // PMM lock acquisitions and hold times during the replay
+    NvU64                           lock_acquisitions                NV_ALIGN_BYTES(8); // Out
+    NvU64                           lock_hold_total_ns               NV_ALIGN_BYTES(8); // Out
+    NvU64                           lock_hold_max_ns                 NV_ALIGN_BYTES(8); // Out
+
+    // Chunk splits and merges, and calls into PMA during the replay
+    NvU64                           num_splits                       NV_ALIGN_BYTES(8); // Out
+    NvU64                           num_merges                       NV_ALIGN_BYTES(8); // Out
+    NvU64                           num_pma_alloc_calls              NV_ALIGN_BYTES(8); // Out
+    NvU64                           num_pma_free_calls               NV_ALIGN_BYTES(8); // Out
+
+    // Time spent in the PMA alloc and free calls during the replay
+    NvU64                           pma_alloc_ns                     NV_ALIGN_BYTES(8); // Out
+    NvU64                           pma_free_ns                      NV_ALIGN_BYTES(8); // Out
+
+    // Fragmentation at the end of the replay, before the remaining chunks are
+    // freed: bytes sitting in the user free lists and how many of those are
+    // in whole root chunks.
+    NvU64                           free_bytes                       NV_ALIGN_BYTES(8); // Out
+    NvU64                           free_root_chunk_bytes            NV_ALIGN_BYTES(8); // Out
+
+    NV_STATUS                       rmStatus;                                           // Out
+} UVM_TEST_PMM_TRACE_REPLAY_PARAMS;
+
+// Expressions timed by UVM_TEST_PAGE_MASK_BENCHMARK
+typedef enum
+{
+    // region & mask & and_mask & ~andnot_mask, as computed when copying
+    // resident pages between processors.
+    UvmTestPageMaskExprRegionAndAndnot = 0,
+
+    // (mask | or_mask) & and_mask & ~andnot_mask, as computed when mapping
+    // pages on a GPU.
+    UvmTestPageMaskExprOrAndAndnot,
+
+    // Whether region & mask & ~andnot_mask is non-empty
+    UvmTestPageMaskExprRegionTest,
+
+    UvmTestPageMaskExprCount
+} UvmTestPageMaskExpr;
+
+#define UVM_TEST_PAGE_MASK_BENCHMARK                     UVM_TEST_IOCTL_BASE(96)
+typedef struct
+{
+    // Number of evaluations of each expression
+    NvU32                           iterations;                                         // In
+
+    // Seed for the random masks and regions
+    NvU32                           seed;                                               // In
+
+    // Time spent evaluating each UvmTestPageMaskExpr with chained single
+    // operation page mask helpers, and with the fused page mask helpers.
+    NvU64                           chained_ns[UvmTestPageMaskExprCount] NV_ALIGN_BYTES(8); // Out
+    NvU64                           fused_ns[UvmTestPageMaskExprCount]   NV_ALIGN_BYTES(8); // Out
+
+    NV_STATUS                       rmStatus;                                           // Out
+} UVM_TEST_PAGE_MASK_BENCHMARK_PARAMS;
+
+#define UVM_TEST_VA_BLOCK_METADATA_INFO                  UVM_TEST_IOCTL_BASE(97)
+typedef struct
+{
+    // GPU whose per-block state is reported
+    NvProcessorUuid                 gpu_uuid;                                           // In
+
+    // Managed VA blocks overlapping [lookup_address, lookup_address + length)
+    // are reported. Unpopulated blocks are skipped.
+    NvU64                           lookup_address                   NV_ALIGN_BYTES(8); // In
+    NvU64                           length                           NV_ALIGN_BYTES(8); // In
+
+    // Number of VA blocks found, and how many of those have state for the GPU
+    NvU64                           num_blocks                       NV_ALIGN_BYTES(8); // Out
+    NvU64                           num_gpu_states                   NV_ALIGN_BYTES(8); // Out
+
+    // Number of GPU states whose table of CPU page DMA addresses uses the
+    // full form. The others use the compact form.
+    NvU64                           num_full_dma_tables              NV_ALIGN_BYTES(8); // Out
+
+    // Bytes taken by the GPU states themselves, by their arrays of GPU chunks
+    // and by the full tables of CPU page DMA addresses.
+    NvU64                           gpu_state_bytes                  NV_ALIGN_BYTES(8); // Out
+    NvU64                           chunks_bytes                     NV_ALIGN_BYTES(8); // Out
+    NvU64                           dma_addrs_bytes                  NV_ALIGN_BYTES(8); // Out
+
+    NV_STATUS                       rmStatus;                                           // Out
+} UVM_TEST_VA_BLOCK_METADATA_INFO_PARAMS;
+
+#define UVM_TEST_VA_BLOCK_CONTEXT_ARENA_INFO             UVM_TEST_IOCTL_BASE(98)
+typedef struct
+{
+    // Number of VA block context arenas currently allocated, and how many of
+    // those are in the global pool rather than attached to a thread
+    NvU64                           num_arenas                       NV_ALIGN_BYTES(8); // Out
+    NvU64                           num_free_arenas                  NV_ALIGN_BYTES(8); // Out
+
+    // Allocations of VA block contexts, scratch page masks and CPU fault
+    // service contexts served from an arena, and those which had to go to the
+    // heap instead, since module load.
+    NvU64                           hits                             NV_ALIGN_BYTES(8); // Out
+    NvU64                           misses                           NV_ALIGN_BYTES(8); // Out
+
+    NV_STATUS                       rmStatus;                                           // Out
+} UVM_TEST_VA_BLOCK_CONTEXT_ARENA_INFO_PARAMS;
+
+// Time lookups of random addresses in a range tree of num_ranges ranges, first
+// through the rb-tree alone and then through the lookup index. Then time the
+// same addresses, sorted, one at a time through the last-hit cache and all at
+// once with uvm_range_tree_find_batch().
+#define UVM_TEST_RANGE_TREE_LOOKUP_BENCHMARK             UVM_TEST_IOCTL_BASE(99)
+typedef struct
+{
+    NvU64                           num_ranges                       NV_ALIGN_BYTES(8); // In
+    NvU64                           num_lookups                      NV_ALIGN_BYTES(8); // In
+    NvU32                           seed;                                               // In
+
+    NvU64                           rb_tree_ns                       NV_ALIGN_BYTES(8); // Out
+    NvU64                           index_ns                         NV_ALIGN_BYTES(8); // Out
+    NvU64                           cached_ns                        NV_ALIGN_BYTES(8); // Out
+    NvU64                           batch_ns                         NV_ALIGN_BYTES(8); // Out
+
+    NV_STATUS                       rmStatus;                                           // Out
+} UVM_TEST_RANGE_TREE_LOOKUP_BENCHMARK_PARAMS;
+
+// Measure the throughput of thread context addition and removal, i.e. of
+// entering and exiting the UVM module, with 1, 2, 4, ... up to max_threads
+// kernel threads doing so concurrently.
+#define UVM_TEST_THREAD_CONTEXT_SCALABILITY_MAX_THREADS  128
+#define UVM_TEST_THREAD_CONTEXT_SCALABILITY_MAX_RUNS     8
+#define UVM_TEST_THREAD_CONTEXT_SCALABILITY              UVM_TEST_IOCTL_BASE(101)
+typedef struct
+{
+    // Must be in [1, UVM_TEST_THREAD_CONTEXT_SCALABILITY_MAX_THREADS]
+    NvU32                           max_threads;                                        // In
+
+    // Thread context additions and removals per thread and run
+    NvU32                           iterations;                                         // In
+
+    NvU32                           num_runs;                                           // Out
+
+    // Number of threads of each run
+    NvU32                           num_threads[UVM_TEST_THREAD_CONTEXT_SCALABILITY_MAX_RUNS]; // Out
+
+    // Average time, in nanoseconds, of an addition followed by a removal as
+    // seen by each thread, and aggregate number of such pairs per second
+    // across all the threads of each run.
+    NvU64                           ns_per_iteration[UVM_TEST_THREAD_CONTEXT_SCALABILITY_MAX_RUNS] NV_ALIGN_BYTES(8); // Out
+    NvU64                           iterations_per_sec[UVM_TEST_THREAD_CONTEXT_SCALABILITY_MAX_RUNS] NV_ALIGN_BYTES(8); // Out
+
+    NV_STATUS                       rmStatus;                                           // Out
+} UVM_TEST_THREAD_CONTEXT_SCALABILITY_PARAMS;
+
+// Copy size bytes from sysmem to vidmem of the given GPU in chunk_size
+// pieces, first with all the copies on the default CE for CPU to GPU
+// transfers, then striped across CEs like the copies of large migrations, and
+// report the aggregate bandwidth of each.
+#define UVM_TEST_CE_STRIPE_BANDWIDTH_MAX_SIZE            (256 * 1024 * 1024)
+#define UVM_TEST_CE_STRIPE_BANDWIDTH                     UVM_TEST_IOCTL_BASE(102)
+typedef struct
+{
+    NvProcessorUuid                 gpu_uuid;                                           // In
+
+    // Must be in [1, UVM_TEST_CE_STRIPE_BANDWIDTH_MAX_SIZE]
+    NvU64                           size                             NV_ALIGN_BYTES(8); // In
+
+    // Must be in [1, size]
+    NvU64                           chunk_size                       NV_ALIGN_BYTES(8); // In
+
+    // Number of distinct CEs used by the striped copies
+    NvU32                           num_ces;                                            // Out
+
+    NvU64                           single_ce_bytes_per_us           NV_ALIGN_BYTES(8); // Out
+    NvU64                           striped_bytes_per_us             NV_ALIGN_BYTES(8); // Out
+
+    NV_STATUS                       rmStatus;                                           // Out
+} UVM_TEST_CE_STRIPE_BANDWIDTH_PARAMS;
+
+// Build two trackers with entries on alternating channels of all the GPUs in
+// the VA space, then time iterations of merging them into a third tracker and
+// of querying a tracker with pending entries and one with completed entries for
+// completion. Times are totals over all iterations.
+#define UVM_TEST_TRACKER_BENCHMARK_MAX_ITERATIONS        (1024 * 1024)
+#define UVM_TEST_TRACKER_BENCHMARK                       UVM_TEST_IOCTL_BASE(103)
+typedef struct
+{
+    // Must be in [1, UVM_TEST_TRACKER_BENCHMARK_MAX_ITERATIONS]
+    NvU32                           iterations;                                         // In
+
+    // Number of entries in the merged tracker
+    NvU32                           num_entries;                                        // Out
+
+    NvU64                           merge_ns                         NV_ALIGN_BYTES(8); // Out
+    NvU64                           pending_query_ns                 NV_ALIGN_BYTES(8); // Out
+    NvU64                           completed_query_ns               NV_ALIGN_BYTES(8); // Out
+
+    NV_STATUS                       rmStatus;                                           // Out
+} UVM_TEST_TRACKER_BENCHMARK_PARAMS;
+
+// Allocate and free semaphores from the pool of the given GPU in num_threads
+// kernel threads concurrently, each keeping up to
+// UVM_TEST_GPU_SEMAPHORE_STRESS_MAX_LIVE semaphores allocated at a time, and
+// check that no semaphore is ever handed out twice.
+#define UVM_TEST_GPU_SEMAPHORE_STRESS_MAX_THREADS        64
+#define UVM_TEST_GPU_SEMAPHORE_STRESS_MAX_LIVE           64
+#define UVM_TEST_GPU_SEMAPHORE_STRESS                    UVM_TEST_IOCTL_BASE(104)
+typedef struct
+{
+    NvProcessorUuid                 gpu_uuid;                                           // In
+
+    // Must be in [1, UVM_TEST_GPU_SEMAPHORE_STRESS_MAX_THREADS]
+    NvU32                           num_threads;                                        // In
+
+    // Allocations or frees done by each thread
+    NvU32                           iterations;                                         // In
+    NvU32                           seed;                                               // In
+
+    NV_STATUS                       rmStatus;                                           // Out
+} UVM_TEST_GPU_SEMAPHORE_STRESS_PARAMS;
+
+// Test the sub-block region locks of the VA block containing lookup_address,
+// regardless of the uvm_va_block_region_locking module parameter: the lock
+// bits of all the page regions of the block, exclusion between overlapping
+// regions and between regions and the whole block lock, and concurrent holders
+// of disjoint regions.
+//
+// Error returns:
+// NV_ERR_INVALID_ADDRESS
+//  - lookup_address is not in a managed allocation
+#define UVM_TEST_VA_BLOCK_REGION_LOCKS                   UVM_TEST_IOCTL_BASE(105)
+typedef struct
+{
+    NvU64                           lookup_address                   NV_ALIGN_BYTES(8); // In
+    NV_STATUS                       rmStatus;                                           // Out
+} UVM_TEST_VA_BLOCK_REGION_LOCKS_PARAMS;
+
 #ifdef __cplusplus
 }
 #endif
@@ -26,11 +26,12 @@
 
 #include "uvm_linux.h"
 #include "uvm_common.h"
+#include "uvm_va_block.h"
 
 // Thread local storage implementation.
 //
 // The global data structure that contains the set of active thread contexts
-// is a table of UVM_THREAD_CONTEXT_TABLE_SIZE entries of type
+// is a table of uvm_thread_context_table_size() entries of type
 // uvm_thread_context_table_entry_t.
 // Each entry contains a small array of UVM_THREAD_CONTEXT_ARRAY_SIZE entries,
 // a red-black tree, and a lock protecting the tree.
@@ -53,6 +54,17 @@
 // Both the table and array entries are cache aligned to avoid false sharing
 // overheads due to cache thrashing between concurrent operations on separate
 // thread contexts.
+//
+// The table is sized proportionally to the number of possible CPUs, so the
+// number of concurrently active threads that hash to the same table entry, and
+// therefore share its cache lines and tree lock, stays low on large hosts. The
+// tree lock is only taken when the tree of the entry is not empty: a task only
+// ever inserts or removes its own thread context, so the task itself can never
+// observe an empty tree while its context is in it.
+//
+// Neither per-CPU tables nor task_struct storage are used: tasks can migrate
+// between CPUs while inside UVM, which would turn every miss into a search of
+// all the CPU tables, and task_struct has no slot reserved for modules.
 
 #define UVM_THREAD_CONTEXT_ARRAY_SIZE 8
 
@@ -86,8 +98,14 @@ typedef struct  {
     spinlock_t tree_lock;
 } ____cacheline_aligned_in_smp uvm_thread_context_table_entry_t;
 
-// Global data structure containing all the active thread contexts
-static uvm_thread_context_table_entry_t g_thread_context_table[UVM_THREAD_CONTEXT_TABLE_SIZE];
+static uvm_thread_context_table_entry_t g_thread_context_table_fallback[UVM_THREAD_CONTEXT_TABLE_MIN_SIZE];
+
+// Global data structure containing all the active thread contexts. Points to
+// either a table allocated at initialization, or to the static fallback table
+// if that allocation failed or the table is not initialized. Lookups in the
+// uninitialized, zeroed fallback table find no thread context.
+static uvm_thread_context_table_entry_t *g_thread_context_table __read_mostly = g_thread_context_table_fallback;
+static size_t g_thread_context_table_size __read_mostly = ARRAY_SIZE(g_thread_context_table_fallback);
 
 static bool g_thread_context_table_initialized __read_mostly = false;
 
@@ -107,8 +125,11 @@ bool uvm_thread_context_wrapper_is_used()
     // routines are a no-op outside of debug mode, unit tests do invoke their
     // internal counterparts __uvm_record_lock_X. To add coverage, lock
     // information is made available in develop and release modes if the
-    // builtin tests are enabled.
-    return UVM_IS_DEBUG() || uvm_enable_builtin_tests;
+    // builtin tests are enabled. Lock profiling stores the acquisition times
+    // of held locks in the wrapper too, so it is also used when lock stats are
+    // enabled. Both module parameters are read-only, so the result does not
+    // change while the module is loaded.
+    return UVM_IS_DEBUG() || uvm_enable_builtin_tests || uvm_lock_stats;
 }
 
 bool uvm_thread_context_global_initialized(void)
@@ -116,13 +137,39 @@ bool uvm_thread_context_global_initialized(void)
     return g_thread_context_table_initialized;
 }
 
+static size_t thread_context_table_size(void)
+{
+    size_t table_size = roundup_pow_of_two(4 * num_possible_cpus());
+
+    return clamp_t(size_t, table_size, UVM_THREAD_CONTEXT_TABLE_MIN_SIZE, UVM_THREAD_CONTEXT_TABLE_MAX_SIZE);
+}
+
+size_t uvm_thread_context_table_size(void)
+{
+    return g_thread_context_table_size;
+}
+
 void uvm_thread_context_global_init(void)
 {
     size_t table_index;
 
     UVM_ASSERT(!uvm_thread_context_global_initialized());
+    UVM_ASSERT(g_thread_context_table == g_thread_context_table_fallback);
+
+    // This runs before uvm_kvmalloc_init(), so the kernel allocator is used
+    // directly. An allocation failure is not fatal: the smaller, static table
+    // is used instead.
+    if (thread_context_table_size() > UVM_THREAD_CONTEXT_TABLE_MIN_SIZE) {
+        uvm_thread_context_table_entry_t *table;
+
+        table = vzalloc(sizeof(*table) * thread_context_table_size());
+        if (table) {
+            g_thread_context_table = table;
+            g_thread_context_table_size = thread_context_table_size();
+        }
+    }
 
-    for (table_index = 0; table_index < UVM_THREAD_CONTEXT_TABLE_SIZE; table_index++) {
+    for (table_index = 0; table_index < g_thread_context_table_size; table_index++) {
         uvm_thread_context_table_entry_t *table_entry = g_thread_context_table + table_index;
 
         spin_lock_init(&table_entry->tree_lock);
@@ -145,7 +192,7 @@ void uvm_thread_context_global_exit(void)
     // deleting its thread context after deinitialization of the global table,
     // it is deleted here. uvm_thread_context_remove will detect that the global
     // shutdown already happened and skip.
-    for (table_index = 0; table_index < UVM_THREAD_CONTEXT_TABLE_SIZE; table_index++) {
+    for (table_index = 0; table_index < g_thread_context_table_size; table_index++) {
         size_t array_index;
         struct rb_node *node;
         uvm_thread_context_table_entry_t *table_entry = g_thread_context_table + table_index;
@@ -185,6 +232,16 @@ void uvm_thread_context_global_exit(void)
     }
 
     g_thread_context_table_initialized = false;
+
+    // All the thread contexts have been removed, so the fallback table is
+    // empty and can be used by lookups in the remainder of the unload path.
+    if (g_thread_context_table != g_thread_context_table_fallback) {
+        uvm_thread_context_table_entry_t *table = g_thread_context_table;
+
+        g_thread_context_table = g_thread_context_table_fallback;
+        g_thread_context_table_size = ARRAY_SIZE(g_thread_context_table_fallback);
+        vfree(table);
+    }
 }
 
 static uvm_thread_context_t *thread_context_non_interrupt_tree_search(struct rb_root *root, struct task_struct *task)
@@ -274,6 +331,8 @@ static void thread_context_non_interrupt_init(uvm_thread_context_t *thread_conte
     UVM_ASSERT(!in_interrupt());
 
     thread_context->array_index = UVM_THREAD_CONTEXT_ARRAY_SIZE;
+    thread_context->va_block_context_arena = NULL;
+    thread_context->push_coalesce = NULL;
 
     if (uvm_thread_context_wrapper_is_used()) {
         uvm_thread_context_wrapper_t *thread_context_wrapper;
@@ -296,6 +355,11 @@ static void thread_context_non_interrupt_deinit(uvm_thread_context_t *thread_con
 
     UVM_ASSERT(!in_interrupt());
 
+    uvm_va_block_context_arena_put(thread_context->va_block_context_arena);
+    thread_context->va_block_context_arena = NULL;
+
+    UVM_ASSERT_MSG(thread_context->push_coalesce == NULL, "Coalesced push not flushed\n");
+
     context_lock = thread_context_lock_of(thread_context);
     if (context_lock != NULL) {
         UVM_ASSERT(__uvm_check_all_unlocked(context_lock));
@@ -316,13 +380,13 @@ static uvm_thread_context_table_entry_t *thread_context_non_interrupt_table_entr
     NvU64 current_ptr = (NvU64) current;
     NvU32 hash = jhash_2words((NvU32) current_ptr, (NvU32) (current_ptr >> 32), 0);
 
-    BUILD_BUG_ON(UVM_THREAD_CONTEXT_TABLE_SIZE > (1 << 16));
+    BUILD_BUG_ON(UVM_THREAD_CONTEXT_TABLE_MAX_SIZE > (1 << 16));
     BUILD_BUG_ON(UVM_THREAD_CONTEXT_ARRAY_SIZE > (1 << 16));
     UVM_ASSERT(!in_interrupt());
 
     // The upper 16 bits of the hash value index the table; the lower 16
     // index the array
-    table_index = (hash >> 16) % UVM_THREAD_CONTEXT_TABLE_SIZE;
+    table_index = (hash >> 16) % g_thread_context_table_size;
 
     if (array_index_hint != NULL)
         *array_index_hint = hash % UVM_THREAD_CONTEXT_ARRAY_SIZE;
@@ -330,6 +394,19 @@ static uvm_thread_context_table_entry_t *thread_context_non_interrupt_table_entr
     return g_thread_context_table + table_index;
 }
 
+// Returns false if the tree of the table entry cannot contain the thread
+// context of the current task, without taking the tree lock.
+//
+// This is only valid for the current task: a thread context is only inserted
+// into and removed from the tree by its own task, so while the context of the
+// current task is in the tree, the tree is not empty from the point of view of
+// that task. Contexts of other tasks being concurrently added or removed do
+// not matter.
+static bool thread_context_non_interrupt_tree_may_contain_current(uvm_thread_context_table_entry_t *table_entry)
+{
+    return READ_ONCE(table_entry->tree.rb_node) != NULL;
+}
+
 static uvm_thread_context_t *thread_context_non_interrupt(void)
 {
     unsigned long flags;
@@ -351,6 +428,9 @@ static uvm_thread_context_t *thread_context_non_interrupt(void)
         }
     }
 
+    if (!thread_context_non_interrupt_tree_may_contain_current(table_entry))
+        return NULL;
+
     spin_lock_irqsave(&table_entry->tree_lock, flags);
     thread_context = thread_context_non_interrupt_tree_search(&table_entry->tree, current);
     spin_unlock_irqrestore(&table_entry->tree_lock, flags);
@@ -414,7 +494,7 @@ static bool thread_context_non_interrupt_add(uvm_thread_context_t *thread_contex
     UVM_ASSERT(thread_context != NULL);
     UVM_ASSERT(table_entry != NULL);
     UVM_ASSERT(table_entry - g_thread_context_table >= 0);
-    UVM_ASSERT(table_entry - g_thread_context_table < UVM_THREAD_CONTEXT_TABLE_SIZE);
+    UVM_ASSERT(table_entry - g_thread_context_table < g_thread_context_table_size);
     UVM_ASSERT(array_index_hint < UVM_THREAD_CONTEXT_ARRAY_SIZE);
 
     thread_context_non_interrupt_init(thread_context);
@@ -449,6 +529,18 @@ static bool thread_context_non_interrupt_add(uvm_thread_context_t *thread_contex
         }
     }
 
+    // Fast path: the speculative insertion in the array succeeded, and the task
+    // cannot have a thread context in the tree. The array entry is only read
+    // by the task that claimed it, so no lock is needed to publish the
+    // context. Dummy thread contexts added by tests are not associated with
+    // the current task, so they always take the slow path.
+    if (thread_context->array_index != UVM_THREAD_CONTEXT_ARRAY_SIZE &&
+        thread_context->task == current &&
+        !thread_context_non_interrupt_tree_may_contain_current(table_entry)) {
+        table_entry->array[thread_context->array_index].thread_context = thread_context;
+        return true;
+    }
+
     spin_lock_irqsave(&table_entry->tree_lock, flags);
 
     if (thread_context->array_index == UVM_THREAD_CONTEXT_ARRAY_SIZE) {
@@ -502,6 +594,7 @@ bool uvm_thread_context_add_at(uvm_thread_context_t *thread_context, size_t tabl
 
     UVM_ASSERT(uvm_enable_builtin_tests != 0);
     UVM_ASSERT(uvm_thread_context_global_initialized());
+    UVM_ASSERT(table_index < g_thread_context_table_size);
 
     table_entry = g_thread_context_table + table_index;
     return thread_context_non_interrupt_add(thread_context, table_entry, 0);
@@ -516,7 +609,7 @@ static void thread_context_non_interrupt_remove(uvm_thread_context_t *thread_con
     UVM_ASSERT(thread_context != NULL);
     UVM_ASSERT(table_entry != NULL);
     UVM_ASSERT(table_entry - g_thread_context_table >= 0);
-    UVM_ASSERT(table_entry - g_thread_context_table < UVM_THREAD_CONTEXT_TABLE_SIZE);
+    UVM_ASSERT(table_entry - g_thread_context_table < g_thread_context_table_size);
 
     array_index = thread_context->array_index;
     UVM_ASSERT(array_index <= UVM_THREAD_CONTEXT_ARRAY_SIZE);
@@ -580,6 +673,7 @@ void uvm_thread_context_remove_at(uvm_thread_context_t *thread_context, size_t t
     uvm_thread_context_table_entry_t *table_entry = g_thread_context_table + table_index;
 
     UVM_ASSERT(uvm_enable_builtin_tests != 0);
+    UVM_ASSERT(table_index < g_thread_context_table_size);
 
     thread_context_non_interrupt_remove(thread_context, table_entry);
 }
@@ -625,6 +719,11 @@ static void thread_context_move(uvm_thread_context_t *dst, uvm_thread_context_t
         bitmap_zero(src_context_lock->out_of_order_acquired_lock_orders, UVM_LOCK_ORDER_COUNT);
 
         memcpy(dst_context_lock->acquired, src_context_lock->acquired, acquired_size);
+
+        memcpy(dst_context_lock->acquired_time_ns,
+               src_context_lock->acquired_time_ns,
+               sizeof(src_context_lock->acquired_time_ns));
+        memset(src_context_lock->acquired_time_ns, 0, sizeof(src_context_lock->acquired_time_ns));
     }
 }
 
@@ -29,7 +29,10 @@
 #include "uvm_common.h"
 #include "uvm_linux.h"
 
-#define UVM_THREAD_CONTEXT_TABLE_SIZE 64
+// The global thread context table is sized at initialization based on the
+// number of possible CPUs, within these bounds. See uvm_thread_context.c.
+#define UVM_THREAD_CONTEXT_TABLE_MIN_SIZE 64
+#define UVM_THREAD_CONTEXT_TABLE_MAX_SIZE 1024
 
 // Used to track lock correctness and store information about locks held by each
 // thread.
@@ -53,6 +56,10 @@ struct uvm_thread_context_lock_struct
     // The value at a given index is undefined if the corresponding bit is not
     // set in acquired_locked_orders.
     void **acquired;
+
+    // Time at which the lock of each order was acquired, if the acquisition
+    // was profiled. Zero otherwise. See uvm_lock_order_stats_t.
+    NvU64 acquired_time_ns[UVM_LOCK_ORDER_COUNT];
 };
 
 // UVM thread contexts provide thread local storage for all logical threads
@@ -74,6 +81,19 @@ struct uvm_thread_context_struct
     //
     // This field is ignored in interrupt paths
     struct rb_node node;
+
+    // Scratch state for VA block operations, attached on first use and
+    // returned to the global pool when the thread context is removed. See
+    // uvm_va_block_context_alloc().
+    //
+    // This field is ignored in interrupt paths
+    uvm_va_block_context_arena_t *va_block_context_arena;
+
+    // Push coalescer with an on-going combined push started by the thread, if
+    // any. See uvm_push_coalesce_t.
+    //
+    // This field is ignored in interrupt paths
+    uvm_push_coalesce_t *push_coalesce;
 };
 
 bool uvm_thread_context_wrapper_is_used(void);
@@ -117,6 +137,9 @@ bool uvm_thread_context_add(uvm_thread_context_t *thread_context);
 // Do not invoke this function in a interrupt path.
 void uvm_thread_context_remove(uvm_thread_context_t *thread_context);
 
+// Number of entries in the global thread context table. Used only in testing.
+size_t uvm_thread_context_table_size(void);
+
 // Add or remove thread contexts at the given global thread context table
 // index. Used only in testing.
 //
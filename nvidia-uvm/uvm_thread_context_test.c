@@ -26,6 +26,7 @@
 #include "uvm_kvmalloc.h"
 #include "uvm_test.h"
 
+#include <linux/kthread.h>
 
 static NvU64 timed_udelay(NvU64 delay_us)
 {
@@ -137,3 +138,156 @@ NV_STATUS uvm_test_thread_context_sanity(UVM_TEST_THREAD_CONTEXT_SANITY_PARAMS *
 
     return NV_OK;
 }
+
+typedef struct
+{
+    // Set to release the threads of the current run
+    atomic_t start;
+    wait_queue_head_t start_wq;
+
+    NvU32 iterations;
+} thread_context_scalability_run_t;
+
+typedef struct
+{
+    thread_context_scalability_run_t *run;
+
+    struct task_struct *task;
+
+    // Time spent by the thread in its iterations
+    NvU64 ns;
+
+    struct completion done;
+} thread_context_scalability_thread_t;
+
+static int thread_context_scalability_thread_func(void *arg)
+{
+    thread_context_scalability_thread_t *thread = arg;
+    thread_context_scalability_run_t *run = thread->run;
+    NvU64 start;
+    NvU32 i;
+
+    wait_event_interruptible(run->start_wq, atomic_read(&run->start) || kthread_should_stop());
+
+    if (atomic_read(&run->start)) {
+        // Kernel threads have no thread context, so every entry adds and
+        // removes one.
+        start = NV_GETTIME();
+        for (i = 0; i < run->iterations; i++)
+            UVM_ENTRY_VOID();
+
+        thread->ns = NV_GETTIME() - start;
+    }
+
+    complete(&thread->done);
+
+    // The thread must not exit before kthread_stop() is called on it
+    set_current_state(TASK_INTERRUPTIBLE);
+    while (!kthread_should_stop()) {
+        schedule();
+        set_current_state(TASK_INTERRUPTIBLE);
+    }
+    __set_current_state(TASK_RUNNING);
+
+    return 0;
+}
+
+static NV_STATUS thread_context_scalability_run(thread_context_scalability_thread_t *threads,
+                                                NvU32 num_threads,
+                                                NvU32 iterations,
+                                                NvU64 *ns_per_iteration,
+                                                NvU64 *iterations_per_sec)
+{
+    thread_context_scalability_run_t run;
+    NV_STATUS status = NV_OK;
+    NvU64 start = 0;
+    NvU64 elapsed_ns;
+    NvU64 total_ns = 0;
+    NvU32 num_started;
+    NvU32 i;
+
+    atomic_set(&run.start, 0);
+    init_waitqueue_head(&run.start_wq);
+    run.iterations = iterations;
+
+    for (num_started = 0; num_started < num_threads; num_started++) {
+        thread_context_scalability_thread_t *thread = &threads[num_started];
+
+        thread->run = &run;
+        thread->ns = 0;
+        init_completion(&thread->done);
+
+        thread->task = kthread_run(thread_context_scalability_thread_func, thread, "uvm_tc_test%u", num_started);
+        if (IS_ERR(thread->task)) {
+            status = errno_to_nv_status(PTR_ERR(thread->task));
+            break;
+        }
+    }
+
+    // If not all threads could be started, the started ones are stopped
+    // without running their iterations.
+    if (status == NV_OK) {
+        start = NV_GETTIME();
+        atomic_set(&run.start, 1);
+        wake_up_all(&run.start_wq);
+    }
+
+    for (i = 0; i < num_started; i++)
+        wait_for_completion(&threads[i].done);
+
+    elapsed_ns = NV_GETTIME() - start;
+
+    for (i = 0; i < num_started; i++) {
+        kthread_stop(threads[i].task);
+        total_ns += threads[i].ns;
+    }
+
+    if (status != NV_OK)
+        return status;
+
+    *ns_per_iteration = total_ns / ((NvU64)num_threads * iterations);
+    *iterations_per_sec = ((NvU64)num_threads * iterations * NSEC_PER_SEC) / max(elapsed_ns, 1ULL);
+
+    return NV_OK;
+}
+
+NV_STATUS uvm_test_thread_context_scalability(UVM_TEST_THREAD_CONTEXT_SCALABILITY_PARAMS *params,
+                                              struct file *filp)
+{
+    thread_context_scalability_thread_t *threads;
+    NV_STATUS status = NV_OK;
+    NvU32 num_threads;
+
+    BUILD_BUG_ON(UVM_TEST_THREAD_CONTEXT_SCALABILITY_MAX_THREADS > (1 << (UVM_TEST_THREAD_CONTEXT_SCALABILITY_MAX_RUNS - 1)));
+
+    if (params->max_threads == 0 || params->max_threads > UVM_TEST_THREAD_CONTEXT_SCALABILITY_MAX_THREADS)
+        return NV_ERR_INVALID_ARGUMENT;
+
+    if (params->iterations == 0)
+        return NV_ERR_INVALID_ARGUMENT;
+
+    threads = uvm_kvmalloc_zero(sizeof(*threads) * params->max_threads);
+    if (!threads)
+        return NV_ERR_NO_MEMORY;
+
+    params->num_runs = 0;
+
+    for (num_threads = 1; num_threads <= params->max_threads; num_threads *= 2) {
+        NvU32 run = params->num_runs;
+
+        status = thread_context_scalability_run(threads,
+                                                num_threads,
+                                                params->iterations,
+                                                &params->ns_per_iteration[run],
+                                                &params->iterations_per_sec[run]);
+        if (status != NV_OK)
+            break;
+
+        params->num_threads[run] = num_threads;
+        params->num_runs++;
+    }
+
+    uvm_kvfree(threads);
+
+    return status;
+}
@@ -136,3 +136,49 @@ void uvm_tlb_batch_invalidate(uvm_tlb_batch_t *batch, NvU64 start, NvU64 size, N
     new_entry->size = size;
     new_entry->page_sizes = page_sizes;
 }
+
+static bool tlb_batch_try_extend_last(uvm_tlb_batch_t *batch, NvU64 start, NvU64 size, NvU32 page_sizes)
+{
+    uvm_tlb_batch_range_t *last;
+
+    if (batch->count == 0 || tlb_batch_should_invalidate_all(batch))
+        return false;
+
+    last = &batch->ranges[batch->count - 1];
+    if (last->page_sizes != page_sizes || last->start + last->size != start)
+        return false;
+
+    last->size += size;
+
+    if (!batch->tree->gpu->parent->tlb_batch.va_range_invalidate_supported)
+        batch->total_pages += uvm_div_pow2_64(size, smallest_page_size(page_sizes));
+
+    return true;
+}
+
+void uvm_tlb_batch_merge(uvm_tlb_batch_t *batch, uvm_tlb_batch_t *other)
+{
+    NvU32 i;
+
+    UVM_ASSERT(batch->tree == other->tree);
+
+    if (other->count == 0)
+        return;
+
+    batch->membar = uvm_membar_max(other->membar, batch->membar);
+    batch->biggest_page_size = max(batch->biggest_page_size, other->biggest_page_size);
+
+    // The ranges of a batch falling back to invalidate all are not kept, so the
+    // merged batch has to fall back too.
+    if (tlb_batch_should_invalidate_all(other)) {
+        batch->count = max(batch->count, (NvU32)UVM_TLB_BATCH_MAX_ENTRIES) + 1;
+        return;
+    }
+
+    for (i = 0; i < other->count; ++i) {
+        uvm_tlb_batch_range_t *entry = &other->ranges[i];
+
+        if (!tlb_batch_try_extend_last(batch, entry->start, entry->size, entry->page_sizes))
+            uvm_tlb_batch_invalidate(batch, entry->start, entry->size, entry->page_sizes, UVM_MEMBAR_NONE);
+    }
+}
@@ -94,6 +94,14 @@ void uvm_tlb_batch_invalidate(uvm_tlb_batch_t *batch, NvU64 start, NvU64 size, N
 // batch.
 void uvm_tlb_batch_end(uvm_tlb_batch_t *batch, uvm_push_t *push, uvm_membar_t tlb_membar);
 
+// Merge all the invalidates queued up in the other batch into the batch,
+// without pushing anything. Both batches have to be for the same tree.
+//
+// Ranges contiguous with the last range queued up in the batch and covering the
+// same page sizes are coalesced into it, so that the invalidates of neighboring
+// VA blocks can still be pushed as a single targeted invalidate.
+void uvm_tlb_batch_merge(uvm_tlb_batch_t *batch, uvm_tlb_batch_t *other);
+
 // Helper for invalidating a single range immediately.
 //
 // Internally begins and ends a TLB batch.
@@ -35,6 +35,11 @@ static bool tracker_is_using_static_entries(uvm_tracker_t *tracker)
     return tracker->max_size == ARRAY_SIZE(tracker->static_entries);
 }
 
+static NvU64 tracker_channel_bit(uvm_channel_t *channel)
+{
+    return 1ULL << channel->tracker_bit;
+}
+
 static void free_entries(uvm_tracker_t *tracker)
 {
     if (tracker_is_using_static_entries(tracker))
@@ -92,6 +97,7 @@ NV_STATUS uvm_tracker_overwrite(uvm_tracker_t *dst, uvm_tracker_t *src)
         return status;
 
     dst->size = src->size;
+    dst->channel_mask = src->channel_mask;
     memcpy(uvm_tracker_get_entries(dst),
            uvm_tracker_get_entries(src),
            src->size * sizeof(*uvm_tracker_get_entries(dst)));
@@ -102,11 +108,12 @@ NV_STATUS uvm_tracker_overwrite(uvm_tracker_t *dst, uvm_tracker_t *src)
 NV_STATUS uvm_tracker_reserve(uvm_tracker_t *tracker, NvU32 min_free_entries)
 {
     if (tracker->size + min_free_entries > tracker->max_size) {
-        // Special case the first resize to jump from 1 all the way to 8.
-        // This is based on a guess that if a tracker needs more than 1
-        // entry it likely needs much more.
+        // Special case the first resize to jump from the inline entries to at
+        // least twice as many. This is based on a guess that if a tracker
+        // needs more than the inline entries it likely needs much more.
         // TODO: Bug 1764961: Verify that guess.
-        NvU32 new_max_size = max((NvU32)8, (NvU32)roundup_pow_of_two(tracker->size + min_free_entries));
+        NvU32 new_max_size = max((NvU32)(2 * UVM_TRACKER_INLINE_ENTRIES),
+                                 (NvU32)roundup_pow_of_two(tracker->size + min_free_entries));
         uvm_tracker_entry_t *new_entries;
 
         if (tracker_is_using_static_entries(tracker)) {
@@ -137,11 +144,21 @@ NV_STATUS uvm_tracker_add_push(uvm_tracker_t *tracker, uvm_push_t *push)
 NV_STATUS uvm_tracker_add_entry(uvm_tracker_t *tracker, uvm_tracker_entry_t *new_entry)
 {
     uvm_tracker_entry_t *tracker_entry;
+    NvU64 channel_bit;
 
-    for_each_tracker_entry(tracker_entry, tracker) {
-        if (tracker_entry->channel == new_entry->channel) {
-            tracker_entry->value = max(tracker_entry->value, new_entry->value);
-            return NV_OK;
+    // An entry without a channel is already completed
+    if (!new_entry->channel)
+        return NV_OK;
+
+    channel_bit = tracker_channel_bit(new_entry->channel);
+
+    // Only look for an existing entry if the channel may be tracked already
+    if (tracker->channel_mask & channel_bit) {
+        for_each_tracker_entry(tracker_entry, tracker) {
+            if (tracker_entry->channel == new_entry->channel) {
+                tracker_entry->value = max(tracker_entry->value, new_entry->value);
+                return NV_OK;
+            }
         }
     }
 
@@ -150,6 +167,7 @@ NV_STATUS uvm_tracker_add_entry(uvm_tracker_t *tracker, uvm_tracker_entry_t *new
         return NV_ERR_NO_MEMORY;
 
     *tracker_entry = *new_entry;
+    tracker->channel_mask |= channel_bit;
 
     return NV_OK;
 }
@@ -182,10 +200,16 @@ static NV_STATUS reserve_for_entries_from_tracker(uvm_tracker_t *dst, uvm_tracke
 
     for_each_tracker_entry(src_entry, src) {
         bool found = false;
-        for_each_tracker_entry(dst_entry, dst) {
-            if (dst_entry->channel == src_entry->channel) {
-                found = true;
-                break;
+
+        if (!src_entry->channel)
+            continue;
+
+        if (dst->channel_mask & tracker_channel_bit(src_entry->channel)) {
+            for_each_tracker_entry(dst_entry, dst) {
+                if (dst_entry->channel == src_entry->channel) {
+                    found = true;
+                    break;
+                }
             }
         }
         if (!found)
@@ -283,19 +307,18 @@ static void uvm_tracker_entry_print_pending_pushes(uvm_tracker_entry_t *entry)
     uvm_channel_print_pending_pushes(channel);
 }
 
-static void uvm_tracker_print_pending_pushes(uvm_tracker_t *tracker)
-{
-    uvm_tracker_entry_t *entry;
-    for_each_tracker_entry(entry, tracker)
-        uvm_tracker_entry_print_pending_pushes(entry);
-}
-
 static NV_STATUS wait_for_entry_with_spin(uvm_tracker_entry_t *tracker_entry, uvm_spin_loop_t *spin)
 {
     NV_STATUS status = NV_OK;
+    uvm_channel_wait_t wait;
+
+    if (uvm_tracker_is_entry_completed(tracker_entry))
+        return NV_OK;
+
+    uvm_channel_wait_begin(&wait, tracker_entry->channel, tracker_entry->value, spin);
 
     while (!uvm_tracker_is_entry_completed(tracker_entry) && status == NV_OK) {
-        if (UVM_SPIN_LOOP(spin) == NV_ERR_TIMEOUT_RETRY)
+        if (uvm_channel_wait_iter(&wait) == NV_ERR_TIMEOUT_RETRY)
             uvm_tracker_entry_print_pending_pushes(tracker_entry);
 
         status = uvm_channel_check_errors(tracker_entry->channel);
@@ -303,6 +326,8 @@ static NV_STATUS wait_for_entry_with_spin(uvm_tracker_entry_t *tracker_entry, uv
             status = uvm_global_get_status();
     }
 
+    uvm_channel_wait_end(&wait);
+
     if (status != NV_OK) {
         UVM_ASSERT(status == uvm_global_get_status());
         tracker_entry->channel = NULL;
@@ -315,6 +340,10 @@ static NV_STATUS wait_for_entry_with_spin(uvm_tracker_entry_t *tracker_entry, uv
 NV_STATUS uvm_tracker_wait_for_entry(uvm_tracker_entry_t *tracker_entry)
 {
     uvm_spin_loop_t spin;
+
+    // Waiting on a combined push that is still being built would never finish
+    uvm_push_coalesce_flush_current_thread();
+
     uvm_spin_loop_init(&spin);
     return wait_for_entry_with_spin(tracker_entry, &spin);
 }
@@ -324,12 +353,17 @@ NV_STATUS uvm_tracker_wait(uvm_tracker_t *tracker)
     NV_STATUS status = NV_OK;
     uvm_spin_loop_t spin;
 
+    // Submit the combined push of this thread, if any, as it may be what the
+    // tracker ends up waiting for.
+    uvm_push_coalesce_flush_current_thread();
+
     uvm_spin_loop_init(&spin);
     while (!uvm_tracker_is_completed(tracker) && status == NV_OK) {
-        if (UVM_SPIN_LOOP(&spin) == NV_ERR_TIMEOUT_RETRY)
-            uvm_tracker_print_pending_pushes(tracker);
-
-        status = uvm_tracker_check_errors(tracker);
+        // Wait for the remaining entries one at a time, so that each wait can
+        // be paced by the estimated completion time of its channel's work.
+        status = wait_for_entry_with_spin(uvm_tracker_get_entries(tracker), &spin);
+        if (status == NV_OK)
+            status = uvm_tracker_check_errors(tracker);
     }
 
     if (status != NV_OK) {
@@ -354,6 +388,8 @@ NV_STATUS uvm_tracker_wait_for_other_gpus(uvm_tracker_t *tracker, uvm_gpu_t *gpu
     uvm_tracker_entry_t *entry;
     uvm_spin_loop_t spin;
 
+    uvm_push_coalesce_flush_current_thread();
+
     uvm_spin_loop_init(&spin);
 
     for_each_tracker_entry(entry, tracker) {
@@ -405,23 +441,64 @@ NV_STATUS uvm_tracker_query(uvm_tracker_t *tracker)
     return completed ? NV_OK : NV_WARN_MORE_PROCESSING_REQUIRED;
 }
 
+static bool tracker_entry_is_completed_cached(uvm_tracker_entry_t *tracker_entry)
+{
+    if (!tracker_entry->channel)
+        return true;
+
+    return uvm_gpu_tracking_semaphore_is_value_completed_cached(&tracker_entry->channel->tracking_sem,
+                                                                tracker_entry->value);
+}
+
+static void remove_entry(uvm_tracker_t *tracker, NvU32 index)
+{
+    uvm_tracker_entry_t *entries = uvm_tracker_get_entries(tracker);
+
+    --tracker->size;
+    if (index != tracker->size)
+        entries[index] = entries[tracker->size];
+}
+
 void uvm_tracker_remove_completed(uvm_tracker_t *tracker)
 {
     NvU32 i = 0;
+    bool removed_cached = false;
+    NvU64 channel_mask = 0;
 
     uvm_tracker_entry_t *entries = uvm_tracker_get_entries(tracker);
 
-    // Keep removing completed entries until we run out of entries
+    // First remove all the entries that are completed according to the last
+    // completed values observed on their channels. This doesn't read any GPU
+    // semaphores nor take any locks, and a single barrier orders all the
+    // subsequent accesses of the caller after the completions.
+    while (i < tracker->size) {
+        if (tracker_entry_is_completed_cached(&entries[i])) {
+            remove_entry(tracker, i);
+            removed_cached = true;
+        }
+        else {
+            ++i;
+        }
+    }
+
+    // See uvm_gpu_tracking_semaphore_is_value_completed()
+    if (removed_cached)
+        smp_mb__after_atomic();
+
+    // Then check the remaining entries against the tracking semaphores and
+    // rebuild the channel mask from the entries that are left.
+    i = 0;
     while (i < tracker->size) {
         if (uvm_tracker_is_entry_completed(&entries[i])) {
-            --tracker->size;
-            if (i != tracker->size)
-                entries[i] = entries[tracker->size];
+            remove_entry(tracker, i);
         }
         else {
+            channel_mask |= tracker_channel_bit(entries[i].channel);
             ++i;
         }
     }
+
+    tracker->channel_mask = channel_mask;
 }
 
 bool uvm_tracker_is_completed(uvm_tracker_t *tracker)
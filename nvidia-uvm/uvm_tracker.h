@@ -41,15 +41,24 @@ typedef struct
     NvU64 value;
 } uvm_tracker_entry_t;
 
+// Number of entries a tracker can hold without any memory allocation. Most
+// trackers only ever track work on one or a few channels (e.g. a migration
+// using a copy engine per direction), so a small inline array avoids having to
+// allocate on the common paths.
+#define UVM_TRACKER_INLINE_ENTRIES 4
+
+// Number of bits in the channel mask of a tracker, see uvm_tracker_t
+#define UVM_TRACKER_CHANNEL_MASK_BITS 64
+
 typedef struct
 {
     union
     {
-        // The default static storage can fit a single entry as that's likely
-        // the most common use-case. If the tracker ever needs more space, a
-        // dynamic allocation will be made as part of adding an entry and
-        // dynamic_entries below will be used.
-        uvm_tracker_entry_t static_entries[1];
+        // The default static storage can fit a few entries without allocating.
+        // If the tracker ever needs more space, a dynamic allocation will be
+        // made as part of adding an entry and dynamic_entries below will be
+        // used.
+        uvm_tracker_entry_t static_entries[UVM_TRACKER_INLINE_ENTRIES];
 
         // Pointer to the array with dynamically allocated entries
         uvm_tracker_entry_t *dynamic_entries;
@@ -61,6 +70,12 @@ typedef struct
     // Max number of entries that the entries array can store currently
     NvU32 max_size;
 
+    // Mask of the tracker bits (uvm_channel_t::tracker_bit) of the channels
+    // that may have an entry in the tracker. The mask is a superset: a set bit
+    // only means that the entries need to be scanned for the channel, but a
+    // clear bit guarantees that no entry for the channel is present, which lets
+    // uvm_tracker_add_entry() append new channels without scanning.
+    NvU64 channel_mask;
 } uvm_tracker_t;
 
 // Static initializer for a tracker.
@@ -68,7 +83,7 @@ typedef struct
 // so that uvm_tracker_get_entries() works correctly.
 // Note that the extra braces are necessary to avoid missing braces warning all the way down to:
 // (near initialization for tracker.<anonymous>.static_entries[0]) [-Wmissing-braces]
-#define UVM_TRACKER_INIT() { { { { 0 } } }, 0, ARRAY_SIZE(((uvm_tracker_t *)0)->static_entries) }
+#define UVM_TRACKER_INIT() { { { { 0 } } }, 0, ARRAY_SIZE(((uvm_tracker_t *)0)->static_entries), 0 }
 
 // Initialize a tracker
 // This is guaranteed not to allocate any memory.
@@ -98,6 +113,7 @@ NV_STATUS uvm_tracker_init_from(uvm_tracker_t *dst, uvm_tracker_t *src);
 static void uvm_tracker_clear(uvm_tracker_t *tracker)
 {
     tracker->size = 0;
+    tracker->channel_mask = 0;
 }
 
 // Reserve enough space so min_free_entries can be added to the tracker
@@ -110,7 +126,8 @@ NV_STATUS uvm_tracker_reserve(uvm_tracker_t *tracker, NvU32 min_free_entries);
 NV_STATUS uvm_tracker_add_push(uvm_tracker_t *tracker, uvm_push_t *push);
 
 // Add a uvm_tracker_entry_t to a tracker
-// This may require allocating memory to fit a new entry in the tracker
+// This may require allocating memory to fit a new entry in the tracker.
+// Entries without a channel are considered completed and are not added.
 NV_STATUS uvm_tracker_add_entry(uvm_tracker_t *tracker, uvm_tracker_entry_t *new_entry);
 
 // Overwrite the tracker with a single entry
@@ -197,6 +214,11 @@ NV_STATUS uvm_tracker_query(uvm_tracker_t *tracker);
 
 // Query all entries for completion and remove the completed ones
 //
+// The entries are first checked against the last completed values observed on
+// their channels, which only requires reading memory already in the CPU
+// caches. Only the entries that are still pending after that are checked
+// against the channels' tracking semaphores.
+//
 // This won't change the max size of the tracker.
 void uvm_tracker_remove_completed(uvm_tracker_t *tracker);
 
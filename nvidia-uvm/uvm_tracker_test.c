@@ -414,6 +414,67 @@ done:
     return status;
 }
 
+// Check that a tracker fits UVM_TRACKER_INLINE_ENTRIES entries without
+// allocating, that entries for the same channel are merged and that entries
+// without a channel are never added.
+static NV_STATUS test_tracker_inline_entries(uvm_va_space_t *va_space)
+{
+    uvm_gpu_t *gpu;
+    uvm_tracker_t tracker;
+    uvm_tracker_entry_t entry;
+    uvm_tracker_entry_t *entry_iter;
+    NvU64 channel_mask = 0;
+    NvU32 count = 0;
+    NV_STATUS status = NV_OK;
+
+    uvm_tracker_init(&tracker);
+
+    entry.channel = NULL;
+    entry.value = 1;
+    TEST_NV_CHECK_GOTO(uvm_tracker_add_entry(&tracker, &entry), done);
+    TEST_CHECK_GOTO(tracker.size == 0, done);
+    TEST_CHECK_GOTO(tracker.channel_mask == 0, done);
+
+    for_each_va_space_gpu(gpu, va_space) {
+        uvm_channel_pool_t *pool;
+
+        uvm_for_each_pool(pool, gpu->channel_manager) {
+            uvm_channel_t *channel;
+
+            uvm_for_each_channel_in_pool(channel, pool) {
+                if (count == UVM_TRACKER_INLINE_ENTRIES)
+                    break;
+
+                entry.channel = channel;
+                entry.value = uvm_channel_update_completed_value(channel);
+                TEST_NV_CHECK_GOTO(uvm_tracker_add_entry(&tracker, &entry), done);
+                TEST_NV_CHECK_GOTO(uvm_tracker_add_entry(&tracker, &entry), done);
+                channel_mask |= 1ULL << channel->tracker_bit;
+                ++count;
+            }
+        }
+    }
+
+    TEST_CHECK_GOTO(tracker.size == count, done);
+    TEST_CHECK_GOTO(tracker.max_size == UVM_TRACKER_INLINE_ENTRIES, done);
+    TEST_CHECK_GOTO(tracker.channel_mask == channel_mask, done);
+
+    for_each_tracker_entry(entry_iter, &tracker)
+        TEST_CHECK_GOTO(tracker.channel_mask & (1ULL << entry_iter->channel->tracker_bit), done);
+
+    // All the entries are completed, so removing them has to leave an empty
+    // channel mask behind.
+    uvm_tracker_remove_completed(&tracker);
+    TEST_CHECK_GOTO(tracker.size == 0, done);
+    TEST_CHECK_GOTO(tracker.channel_mask == 0, done);
+
+    TEST_NV_CHECK_GOTO(assert_tracker_is_completed(&tracker), done);
+
+done:
+    uvm_tracker_deinit(&tracker);
+    return status;
+}
+
 NV_STATUS uvm_test_tracker_sanity(UVM_TEST_TRACKER_SANITY_PARAMS *params, struct file *filp)
 {
     NV_STATUS status;
@@ -437,8 +498,112 @@ NV_STATUS uvm_test_tracker_sanity(UVM_TEST_TRACKER_SANITY_PARAMS *params, struct
     if (status != NV_OK)
         goto done;
 
+    status = test_tracker_inline_entries(va_space);
+    if (status != NV_OK)
+        goto done;
+
 done:
     uvm_va_space_up_read_rm(va_space);
 
     return status;
 }
+
+static NV_STATUS test_tracker_benchmark(uvm_va_space_t *va_space, UVM_TEST_TRACKER_BENCHMARK_PARAMS *params)
+{
+    uvm_gpu_t *gpu;
+    uvm_tracker_t even_tracker = UVM_TRACKER_INIT();
+    uvm_tracker_t odd_tracker = UVM_TRACKER_INIT();
+    uvm_tracker_t merged_tracker = UVM_TRACKER_INIT();
+    uvm_tracker_t completed_tracker = UVM_TRACKER_INIT();
+    uvm_tracker_t query_tracker = UVM_TRACKER_INIT();
+    NvU32 count = 0;
+    NvU32 i;
+    NvU64 start_time;
+    NV_STATUS status = NV_OK;
+
+    for_each_va_space_gpu(gpu, va_space) {
+        uvm_channel_pool_t *pool;
+
+        uvm_for_each_pool(pool, gpu->channel_manager) {
+            uvm_channel_t *channel;
+
+            uvm_for_each_channel_in_pool(channel, pool) {
+                uvm_tracker_entry_t entry;
+
+                entry.channel = channel;
+                entry.value = uvm_channel_update_completed_value(channel);
+                TEST_NV_CHECK_GOTO(uvm_tracker_add_entry(&completed_tracker, &entry), done);
+
+                // Use a value far past anything queued on the channel so that
+                // the entry stays pending for the duration of the benchmark.
+                // These entries are never waited on.
+                entry.value += 1ULL << 40;
+                if (count & 1)
+                    TEST_NV_CHECK_GOTO(uvm_tracker_add_entry(&odd_tracker, &entry), done);
+                else
+                    TEST_NV_CHECK_GOTO(uvm_tracker_add_entry(&even_tracker, &entry), done);
+
+                ++count;
+            }
+        }
+    }
+
+    start_time = NV_GETTIME();
+    for (i = 0; i < params->iterations; i++) {
+        TEST_NV_CHECK_GOTO(uvm_tracker_overwrite(&merged_tracker, &even_tracker), done);
+        TEST_NV_CHECK_GOTO(uvm_tracker_add_tracker(&merged_tracker, &odd_tracker), done);
+        TEST_NV_CHECK_GOTO(uvm_tracker_add_tracker(&merged_tracker, &even_tracker), done);
+    }
+    params->merge_ns = NV_GETTIME() - start_time;
+
+    TEST_CHECK_GOTO(merged_tracker.size == count, done);
+    params->num_entries = merged_tracker.size;
+
+    start_time = NV_GETTIME();
+    for (i = 0; i < params->iterations; i++)
+        TEST_CHECK_GOTO(!uvm_tracker_is_completed(&merged_tracker), done);
+    params->pending_query_ns = NV_GETTIME() - start_time;
+
+    // Querying a completed tracker empties it, so it has to be refilled for
+    // every iteration and only the query itself is timed.
+    params->completed_query_ns = 0;
+    for (i = 0; i < params->iterations; i++) {
+        TEST_NV_CHECK_GOTO(uvm_tracker_overwrite(&query_tracker, &completed_tracker), done);
+
+        start_time = NV_GETTIME();
+        TEST_CHECK_GOTO(uvm_tracker_is_completed(&query_tracker), done);
+        params->completed_query_ns += NV_GETTIME() - start_time;
+    }
+
+done:
+    // The pending entries can never complete, so the trackers are cleared
+    // without waiting.
+    uvm_tracker_clear(&merged_tracker);
+    uvm_tracker_clear(&even_tracker);
+    uvm_tracker_clear(&odd_tracker);
+
+    uvm_tracker_deinit(&merged_tracker);
+    uvm_tracker_deinit(&even_tracker);
+    uvm_tracker_deinit(&odd_tracker);
+    uvm_tracker_deinit(&completed_tracker);
+    uvm_tracker_deinit(&query_tracker);
+
+    return status;
+}
+
+NV_STATUS uvm_test_tracker_benchmark(UVM_TEST_TRACKER_BENCHMARK_PARAMS *params, struct file *filp)
+{
+    NV_STATUS status;
+    uvm_va_space_t *va_space = uvm_va_space_get(filp);
+
+    if (params->iterations == 0 || params->iterations > UVM_TEST_TRACKER_BENCHMARK_MAX_ITERATIONS)
+        return NV_ERR_INVALID_ARGUMENT;
+
+    uvm_va_space_down_read_rm(va_space);
+
+    status = test_tracker_benchmark(va_space, params);
+
+    uvm_va_space_up_read_rm(va_space);
+
+    return status;
+}
@@ -38,7 +38,9 @@
 #include "uvm_mem.h"
 #include "uvm_gpu_access_counters.h"
 #include "uvm_va_space_mm.h"
+#include "uvm_test.h"
 #include "uvm_test_ioctl.h"
+#include "uvm_thread_context.h"
 
 typedef enum
 {
@@ -54,6 +56,57 @@ static struct kmem_cache *g_uvm_va_block_gpu_state_cache __read_mostly;
 static struct kmem_cache *g_uvm_page_mask_cache __read_mostly;
 static struct kmem_cache *g_uvm_va_block_context_cache __read_mostly;
 
+// Number of entries of each type in a VA block context arena. Two VA block
+// contexts cover the deepest nesting of allocations by a single thread.
+#define VA_BLOCK_CONTEXT_ARENA_BLOCK_CONTEXTS 2
+#define VA_BLOCK_CONTEXT_ARENA_PAGE_MASKS     2
+
+// Maximum number of arenas kept in the global pool. Arenas returned while the
+// pool is full are freed.
+#define VA_BLOCK_CONTEXT_ARENA_POOL_MAX_FREE  64
+
+struct uvm_va_block_context_arena_struct
+{
+    // Node in the global pool of arenas while not attached to a thread context
+    struct list_head list_node;
+
+    // Bitmaps of the entries in use
+    unsigned long block_contexts_used;
+    unsigned long page_masks_used;
+    bool service_context_used;
+
+    uvm_va_block_context_t block_contexts[VA_BLOCK_CONTEXT_ARENA_BLOCK_CONTEXTS];
+
+    uvm_page_mask_t page_masks[VA_BLOCK_CONTEXT_ARENA_PAGE_MASKS];
+
+    uvm_service_block_context_t service_context;
+};
+
+static struct
+{
+    // Arenas not attached to any thread context
+    struct list_head free_arenas;
+    NvU32 num_free_arenas;
+
+    // Cleared on module unload. Arenas returned afterwards are freed.
+    bool initialized;
+
+    // Protects the fields above. A raw lock is used because arenas are
+    // returned while removing thread contexts, when UVM lock tracking is no
+    // longer available.
+    spinlock_t lock;
+
+    // Number of arenas currently allocated, either attached to a thread
+    // context or in the pool
+    atomic64_t num_arenas;
+
+    // Number of allocations served from an arena, and number of allocations
+    // which fell back to the heap (or, for service block contexts, to the
+    // caller) instead
+    atomic64_t hits;
+    atomic64_t misses;
+} g_va_block_context_arena_pool;
+
 static int uvm_fault_force_sysmem __read_mostly = 0;
 module_param(uvm_fault_force_sysmem, int, S_IRUGO|S_IWUSR);
 MODULE_PARM_DESC(uvm_fault_force_sysmem, "Force (1) using sysmem storage for pages that faulted. Default: 0.");
@@ -78,6 +131,54 @@ MODULE_PARM_DESC(uvm_exp_gpu_cache_sysmem,
                  "Force caching for mappings to system memory. "
                  "This is an experimental parameter that may cause correctness issues if used.");
 
+// Sub-block region locking allows operations that only need a part of a block,
+// and don't change the block state, to run concurrently on non-overlapping
+// big-page regions of the block. See uvm_va_block_lock_region().
+static unsigned uvm_va_block_region_locking __read_mostly = 0;
+module_param(uvm_va_block_region_locking, uint, S_IRUGO);
+MODULE_PARM_DESC(uvm_va_block_region_locking,
+                 "Enable (1) locking big-page regions of VA blocks instead of whole blocks when possible. "
+                 "Default: 0.");
+
+// VA ranges with at least this many populated blocks per teardown thread are
+// torn down in parallel. See uvm_va_block_kill_all().
+#define UVM_VA_BLOCK_TEARDOWN_MIN_BLOCKS 32
+
+// Number of blocks claimed at a time by the threads of a teardown job
+#define UVM_VA_BLOCK_TEARDOWN_BATCH 8
+
+#define UVM_VA_BLOCK_TEARDOWN_MAX_THREADS 16
+
+static unsigned uvm_va_block_teardown_threads __read_mostly = 4;
+module_param(uvm_va_block_teardown_threads, uint, S_IRUGO);
+MODULE_PARM_DESC(uvm_va_block_teardown_threads,
+                 "Number of threads tearing down the VA blocks of large VA ranges in parallel, up to 16. "
+                 "0 tears them down serially. Default: 4.");
+
+typedef struct
+{
+    uvm_va_block_t **blocks;
+    size_t num_blocks;
+
+    // Index of the next block to be claimed
+    atomic_long_t next_block;
+
+    // Number of threads working on the job, including the one which started
+    // it. The last one to finish completes done.
+    atomic_t num_active;
+    struct completion done;
+
+    nv_kthread_q_item_t q_items[UVM_VA_BLOCK_TEARDOWN_MAX_THREADS];
+} uvm_va_block_teardown_job_t;
+
+// Each teardown thread has its own queue, so that the blocks of a job are
+// spread over all of them.
+static struct
+{
+    nv_kthread_q_t qs[UVM_VA_BLOCK_TEARDOWN_MAX_THREADS];
+    unsigned num_qs;
+} g_va_block_teardown;
+
 static void block_deferred_eviction_mappings_entry(void *args);
 
 uvm_va_space_t *uvm_va_block_get_va_space_maybe_dead(uvm_va_block_t *va_block)
@@ -331,20 +432,172 @@ NV_STATUS uvm_va_block_init(void)
     if (!g_uvm_va_block_context_cache)
         return NV_ERR_NO_MEMORY;
 
+    spin_lock_init(&g_va_block_context_arena_pool.lock);
+    INIT_LIST_HEAD(&g_va_block_context_arena_pool.free_arenas);
+    g_va_block_context_arena_pool.initialized = true;
+
+    // Teardown threads are an optimization, so failing to start them only
+    // reduces their number.
+    while (g_va_block_teardown.num_qs < min_t(unsigned, uvm_va_block_teardown_threads, UVM_VA_BLOCK_TEARDOWN_MAX_THREADS)) {
+        if (nv_kthread_q_init(&g_va_block_teardown.qs[g_va_block_teardown.num_qs], "UVM VA block teardown"))
+            break;
+
+        g_va_block_teardown.num_qs++;
+    }
+
     return NV_OK;
 }
 
+static void va_block_context_arena_pool_exit(void)
+{
+    uvm_va_block_context_arena_t *arena, *arena_next;
+    LIST_HEAD(free_arenas);
+
+    spin_lock(&g_va_block_context_arena_pool.lock);
+
+    g_va_block_context_arena_pool.initialized = false;
+    list_splice_init(&g_va_block_context_arena_pool.free_arenas, &free_arenas);
+    g_va_block_context_arena_pool.num_free_arenas = 0;
+
+    spin_unlock(&g_va_block_context_arena_pool.lock);
+
+    list_for_each_entry_safe(arena, arena_next, &free_arenas, list_node) {
+        atomic64_dec(&g_va_block_context_arena_pool.num_arenas);
+        uvm_kvfree(arena);
+    }
+}
+
 void uvm_va_block_exit(void)
 {
+    unsigned i;
+
+    for (i = 0; i < g_va_block_teardown.num_qs; i++)
+        nv_kthread_q_stop(&g_va_block_teardown.qs[i]);
+    g_va_block_teardown.num_qs = 0;
+
+    va_block_context_arena_pool_exit();
+
     kmem_cache_destroy_safe(&g_uvm_va_block_context_cache);
     kmem_cache_destroy_safe(&g_uvm_page_mask_cache);
     kmem_cache_destroy_safe(&g_uvm_va_block_gpu_state_cache);
     kmem_cache_destroy_safe(&g_uvm_va_block_cache);
 }
 
+void uvm_va_block_context_arena_put(uvm_va_block_context_arena_t *arena)
+{
+    bool cached = false;
+
+    if (!arena)
+        return;
+
+    UVM_ASSERT(arena->block_contexts_used == 0);
+    UVM_ASSERT(arena->page_masks_used == 0);
+    UVM_ASSERT(!arena->service_context_used);
+
+    spin_lock(&g_va_block_context_arena_pool.lock);
+
+    if (g_va_block_context_arena_pool.initialized &&
+        g_va_block_context_arena_pool.num_free_arenas < VA_BLOCK_CONTEXT_ARENA_POOL_MAX_FREE) {
+        list_add(&arena->list_node, &g_va_block_context_arena_pool.free_arenas);
+        ++g_va_block_context_arena_pool.num_free_arenas;
+        cached = true;
+    }
+
+    spin_unlock(&g_va_block_context_arena_pool.lock);
+
+    if (!cached) {
+        atomic64_dec(&g_va_block_context_arena_pool.num_arenas);
+        uvm_kvfree(arena);
+    }
+}
+
+// Return the arena attached to the current thread context, or NULL if there is
+// none.
+static uvm_va_block_context_arena_t *va_block_context_arena_peek(void)
+{
+    if (in_interrupt() || !uvm_thread_context_present())
+        return NULL;
+
+    return uvm_thread_context()->va_block_context_arena;
+}
+
+// Like va_block_context_arena_peek() but attach an arena to the current thread
+// context if it doesn't have one yet.
+static uvm_va_block_context_arena_t *va_block_context_arena_get(void)
+{
+    uvm_thread_context_t *thread_context;
+    uvm_va_block_context_arena_t *arena;
+
+    if (in_interrupt() || !uvm_thread_context_present())
+        return NULL;
+
+    thread_context = uvm_thread_context();
+    if (thread_context->va_block_context_arena)
+        return thread_context->va_block_context_arena;
+
+    spin_lock(&g_va_block_context_arena_pool.lock);
+
+    arena = list_first_entry_or_null(&g_va_block_context_arena_pool.free_arenas,
+                                     uvm_va_block_context_arena_t,
+                                     list_node);
+    if (arena) {
+        list_del(&arena->list_node);
+        --g_va_block_context_arena_pool.num_free_arenas;
+    }
+
+    spin_unlock(&g_va_block_context_arena_pool.lock);
+
+    if (!arena) {
+        arena = uvm_kvmalloc(sizeof(*arena));
+        if (!arena)
+            return NULL;
+
+        arena->block_contexts_used = 0;
+        arena->page_masks_used = 0;
+        arena->service_context_used = false;
+        atomic64_inc(&g_va_block_context_arena_pool.num_arenas);
+    }
+
+    thread_context->va_block_context_arena = arena;
+
+    return arena;
+}
+
+// Claim a free entry in the given arena bitmap. Returns the entry index, or
+// count if all entries are in use.
+static size_t va_block_context_arena_claim(unsigned long *used, size_t count)
+{
+    size_t index = find_first_zero_bit(used, count);
+
+    if (index < count) {
+        __set_bit(index, used);
+        atomic64_inc(&g_va_block_context_arena_pool.hits);
+    }
+    else {
+        atomic64_inc(&g_va_block_context_arena_pool.misses);
+    }
+
+    return index;
+}
+
 uvm_va_block_context_t *uvm_va_block_context_alloc(struct mm_struct *mm)
 {
-    uvm_va_block_context_t *block_context = kmem_cache_alloc(g_uvm_va_block_context_cache, NV_UVM_GFP_FLAGS);
+    uvm_va_block_context_t *block_context = NULL;
+    uvm_va_block_context_arena_t *arena = va_block_context_arena_get();
+
+    if (arena) {
+        size_t index = va_block_context_arena_claim(&arena->block_contexts_used,
+                                                    VA_BLOCK_CONTEXT_ARENA_BLOCK_CONTEXTS);
+        if (index < VA_BLOCK_CONTEXT_ARENA_BLOCK_CONTEXTS)
+            block_context = &arena->block_contexts[index];
+    }
+    else {
+        atomic64_inc(&g_va_block_context_arena_pool.misses);
+    }
+
+    if (!block_context)
+        block_context = kmem_cache_alloc(g_uvm_va_block_context_cache, NV_UVM_GFP_FLAGS);
+
     if (block_context)
         uvm_va_block_context_init(block_context, mm);
 
@@ -353,8 +606,84 @@ uvm_va_block_context_t *uvm_va_block_context_alloc(struct mm_struct *mm)
 
 void uvm_va_block_context_free(uvm_va_block_context_t *va_block_context)
 {
-    if (va_block_context)
-        kmem_cache_free(g_uvm_va_block_context_cache, va_block_context);
+    uvm_va_block_context_arena_t *arena;
+
+    if (!va_block_context)
+        return;
+
+    arena = va_block_context_arena_peek();
+    if (arena &&
+        va_block_context >= arena->block_contexts &&
+        va_block_context < arena->block_contexts + VA_BLOCK_CONTEXT_ARENA_BLOCK_CONTEXTS) {
+        size_t index = va_block_context - arena->block_contexts;
+
+        UVM_ASSERT(test_bit(index, &arena->block_contexts_used));
+        __clear_bit(index, &arena->block_contexts_used);
+        return;
+    }
+
+    kmem_cache_free(g_uvm_va_block_context_cache, va_block_context);
+}
+
+// Scratch page mask allocation, following the same rules as
+// uvm_va_block_context_alloc()
+static uvm_page_mask_t *block_page_mask_alloc(void)
+{
+    uvm_va_block_context_arena_t *arena = va_block_context_arena_get();
+
+    if (arena) {
+        size_t index = va_block_context_arena_claim(&arena->page_masks_used, VA_BLOCK_CONTEXT_ARENA_PAGE_MASKS);
+        if (index < VA_BLOCK_CONTEXT_ARENA_PAGE_MASKS)
+            return &arena->page_masks[index];
+    }
+    else {
+        atomic64_inc(&g_va_block_context_arena_pool.misses);
+    }
+
+    return kmem_cache_alloc(g_uvm_page_mask_cache, NV_UVM_GFP_FLAGS);
+}
+
+static void block_page_mask_free(uvm_page_mask_t *mask)
+{
+    uvm_va_block_context_arena_t *arena = va_block_context_arena_peek();
+
+    if (arena && mask >= arena->page_masks && mask < arena->page_masks + VA_BLOCK_CONTEXT_ARENA_PAGE_MASKS) {
+        size_t index = mask - arena->page_masks;
+
+        UVM_ASSERT(test_bit(index, &arena->page_masks_used));
+        __clear_bit(index, &arena->page_masks_used);
+        return;
+    }
+
+    kmem_cache_free(g_uvm_page_mask_cache, mask);
+}
+
+uvm_service_block_context_t *uvm_va_block_service_context_get(void)
+{
+    uvm_va_block_context_arena_t *arena = va_block_context_arena_get();
+
+    if (!arena || arena->service_context_used) {
+        atomic64_inc(&g_va_block_context_arena_pool.misses);
+        return NULL;
+    }
+
+    arena->service_context_used = true;
+    atomic64_inc(&g_va_block_context_arena_pool.hits);
+
+    return &arena->service_context;
+}
+
+bool uvm_va_block_service_context_put(uvm_service_block_context_t *service_context)
+{
+    uvm_va_block_context_arena_t *arena = va_block_context_arena_peek();
+
+    if (!arena || service_context != &arena->service_context)
+        return false;
+
+    UVM_ASSERT(arena->service_context_used);
+    arena->service_context_used = false;
+
+    return true;
 }
 
 // Convert from page_index to chunk_index. The goal is for each system page in
@@ -602,6 +931,13 @@ NV_STATUS uvm_va_block_create(uvm_va_range_t *va_range,
 
     nv_kref_init(&block->kref);
     uvm_mutex_init(&block->lock, UVM_LOCK_ORDER_VA_BLOCK);
+    uvm_spin_lock_init(&block->region_locks.lock, UVM_LOCK_ORDER_LEAF);
+    init_waitqueue_head(&block->region_locks.wait_queue);
+#if UVM_IS_DEBUG()
+    // Region locks are taken instead of the block lock, so they share its
+    // lock order.
+    block->region_locks.lock_order = UVM_LOCK_ORDER_VA_BLOCK;
+#endif
     block->start = start;
     block->end = end;
     block->va_range = va_range;
@@ -617,6 +953,134 @@ error:
     return status;
 }
 
+bool uvm_va_block_region_locking_enabled(void)
+{
+    return uvm_va_block_region_locking != 0;
+}
+
+// Return the region lock bits covering the given page region of the block
+static NvU32 block_region_lock_bits(uvm_va_block_t *va_block, uvm_va_block_region_t region)
+{
+    NvU64 window_start = UVM_VA_BLOCK_ALIGN_DOWN(va_block->start);
+    NvU64 first = uvm_va_block_region_start(va_block, region) - window_start;
+    NvU64 last = uvm_va_block_region_end(va_block, region) - window_start;
+    unsigned first_bit = first / UVM_MIN_BIG_PAGE_SIZE;
+    unsigned last_bit = last / UVM_MIN_BIG_PAGE_SIZE;
+
+    BUILD_BUG_ON(MAX_BIG_PAGES_PER_UVM_VA_BLOCK > 8 * sizeof(NvU32));
+    UVM_ASSERT(region.outer > region.first);
+    UVM_ASSERT(last_bit < MAX_BIG_PAGES_PER_UVM_VA_BLOCK);
+
+    return (NvU32)(((2ULL << last_bit) - 1) & ~((1ULL << first_bit) - 1));
+}
+
+static bool block_region_locks_held(uvm_va_block_t *va_block, NvU32 bits)
+{
+    bool held;
+
+    uvm_spin_lock(&va_block->region_locks.lock);
+    held = (va_block->region_locks.locked & bits) != 0;
+    uvm_spin_unlock(&va_block->region_locks.lock);
+
+    return held;
+}
+
+// Wait for all the region lock holders of the block to leave. The caller must
+// hold the block's mutex.
+static void block_wait_for_region_locks(uvm_va_block_t *va_block)
+{
+    uvm_assert_mutex_locked(&va_block->lock);
+
+    // New region locks are only taken with the block mutex held, so once all
+    // current holders are gone they cannot come back until the mutex is
+    // released. The region lock holders never take the block lock, so waiting
+    // for them while holding it cannot deadlock.
+    wait_event(va_block->region_locks.wait_queue, !block_region_locks_held(va_block, ~(NvU32)0));
+}
+
+static void block_lock_region_bits(uvm_va_block_t *va_block, NvU32 bits)
+{
+    while (1) {
+        bool locked = false;
+
+        // The block lock is only held long enough to take the region lock.
+        // Holding it is what keeps region locks from being taken while the
+        // whole block is locked.
+        uvm_mutex_lock(&va_block->lock);
+
+        uvm_spin_lock(&va_block->region_locks.lock);
+        if (!(va_block->region_locks.locked & bits)) {
+            va_block->region_locks.locked |= bits;
+            locked = true;
+        }
+        uvm_spin_unlock(&va_block->region_locks.lock);
+
+        uvm_mutex_unlock(&va_block->lock);
+
+        if (locked)
+            break;
+
+        wait_event(va_block->region_locks.wait_queue, !block_region_locks_held(va_block, bits));
+    }
+
+    uvm_record_lock(&va_block->region_locks, UVM_LOCK_FLAGS_MODE_SHARED);
+}
+
+static void block_unlock_region_bits(uvm_va_block_t *va_block, NvU32 bits)
+{
+    uvm_spin_lock(&va_block->region_locks.lock);
+    UVM_ASSERT((va_block->region_locks.locked & bits) == bits);
+    va_block->region_locks.locked &= ~bits;
+    uvm_spin_unlock(&va_block->region_locks.lock);
+
+    uvm_record_unlock(&va_block->region_locks, UVM_LOCK_FLAGS_MODE_SHARED);
+
+    wake_up_all(&va_block->region_locks.wait_queue);
+}
+
+void uvm_va_block_lock(uvm_va_block_t *va_block)
+{
+    uvm_mutex_lock(&va_block->lock);
+
+    if (uvm_va_block_region_locking_enabled())
+        block_wait_for_region_locks(va_block);
+}
+
+void uvm_va_block_unlock(uvm_va_block_t *va_block)
+{
+    uvm_mutex_unlock(&va_block->lock);
+}
+
+void uvm_va_block_lock_region(uvm_va_block_t *va_block, uvm_va_block_region_t region)
+{
+    if (!uvm_va_block_region_locking_enabled()) {
+        uvm_va_block_lock(va_block);
+        return;
+    }
+
+    block_lock_region_bits(va_block, block_region_lock_bits(va_block, region));
+}
+
+void uvm_va_block_unlock_region(uvm_va_block_t *va_block, uvm_va_block_region_t region)
+{
+    if (!uvm_va_block_region_locking_enabled()) {
+        uvm_va_block_unlock(va_block);
+        return;
+    }
+
+    block_unlock_region_bits(va_block, block_region_lock_bits(va_block, region));
+}
+
+// Return the first page backing the physical CPU chunk containing page_index.
+// It is the page used to look up the chunk's DMA mappings in the GPU DMA
+// mapping caches.
+static struct page *block_cpu_chunk_first_page(uvm_va_block_t *block, uvm_cpu_chunk_t *chunk, uvm_page_index_t page_index)
+{
+    uvm_va_block_region_t chunk_region = uvm_va_block_chunk_region(block, uvm_cpu_chunk_get_size(chunk), page_index);
+
+    return uvm_cpu_chunk_get_cpu_page(block, chunk, chunk_region.first);
+}
+
 static void block_gpu_unmap_phys_all_cpu_pages(uvm_va_block_t *block, uvm_gpu_t *gpu)
 {
     uvm_cpu_chunk_t *chunk;
@@ -629,7 +1093,10 @@ static void block_gpu_unmap_phys_all_cpu_pages(uvm_va_block_t *block, uvm_gpu_t
         gpu_mapping_addr = uvm_cpu_chunk_get_gpu_mapping_addr(block, page_index, chunk, gpu->id);
         if (gpu_mapping_addr != 0) {
             uvm_pmm_sysmem_mappings_remove_gpu_mapping(&gpu->pmm_sysmem_mappings, gpu_mapping_addr);
-            uvm_gpu_unmap_cpu_pages(gpu, gpu_mapping_addr, uvm_cpu_chunk_get_size(chunk));
+            uvm_pmm_sysmem_dma_cache_unmap(gpu,
+                                           block_cpu_chunk_first_page(block, chunk, page_index),
+                                           gpu_mapping_addr,
+                                           uvm_cpu_chunk_get_size(chunk));
             uvm_cpu_chunk_set_gpu_mapping_addr(block, page_index, chunk, gpu->id, 0);
         }
     }
@@ -650,14 +1117,22 @@ static NV_STATUS block_gpu_map_phys_all_cpu_pages(uvm_va_block_t *block, uvm_gpu
         UVM_ASSERT(chunk);
         UVM_ASSERT_MSG(gpu_mapping_addr == 0, "GPU%u DMA address 0x%llx\n", uvm_id_value(gpu->id), gpu_mapping_addr);
 
-        status = uvm_gpu_map_cpu_pages(gpu,
-                                       uvm_cpu_chunk_get_cpu_page(block, chunk, page_index),
-                                       uvm_cpu_chunk_get_size(chunk),
-                                       &gpu_mapping_addr);
+        status = uvm_pmm_sysmem_dma_cache_map(gpu,
+                                              block_cpu_chunk_first_page(block, chunk, page_index),
+                                              uvm_cpu_chunk_get_size(chunk),
+                                              &gpu_mapping_addr);
         if (status != NV_OK)
             goto error;
 
-        uvm_cpu_chunk_set_gpu_mapping_addr(block, page_index, chunk, gpu->id, gpu_mapping_addr);
+        status = uvm_cpu_chunk_set_gpu_mapping_addr(block, page_index, chunk, gpu->id, gpu_mapping_addr);
+        if (status != NV_OK) {
+            uvm_pmm_sysmem_dma_cache_unmap(gpu,
+                                           block_cpu_chunk_first_page(block, chunk, page_index),
+                                           gpu_mapping_addr,
+                                           uvm_cpu_chunk_get_size(chunk));
+            goto error;
+        }
+
         status = uvm_pmm_sysmem_mappings_add_gpu_mapping(&gpu->pmm_sysmem_mappings,
                                                          uvm_cpu_chunk_get_gpu_mapping_addr(block,
                                                                                             page_index,
@@ -832,7 +1307,10 @@ static void block_unmap_cpu_chunk_on_gpus(uvm_va_block_t *block, uvm_cpu_chunk_t
 
         gpu = block_get_gpu(block, id);
         uvm_pmm_sysmem_mappings_remove_gpu_mapping(&gpu->pmm_sysmem_mappings, gpu_mapping_addr);
-        uvm_gpu_unmap_cpu_pages(gpu, gpu_mapping_addr, uvm_cpu_chunk_get_size(chunk));
+        uvm_pmm_sysmem_dma_cache_unmap(gpu,
+                                       block_cpu_chunk_first_page(block, chunk, page_index),
+                                       gpu_mapping_addr,
+                                       uvm_cpu_chunk_get_size(chunk));
         uvm_cpu_chunk_set_gpu_mapping_addr(block, page_index, chunk, id, 0);
     }
 }
@@ -866,14 +1344,22 @@ static NV_STATUS block_map_cpu_chunk_on_gpus(uvm_va_block_t *block, uvm_page_ind
         UVM_ASSERT_MSG(gpu_mapping_addr == 0, "GPU%u DMA address 0x%llx\n", uvm_id_value(id), gpu_mapping_addr);
 
         gpu = block_get_gpu(block, id);
-        status = uvm_gpu_map_cpu_pages(gpu,
-                                       uvm_cpu_chunk_get_cpu_page(block, chunk, chunk_region.first),
-                                       chunk_size,
-                                       &gpu_mapping_addr);
+        status = uvm_pmm_sysmem_dma_cache_map(gpu,
+                                              uvm_cpu_chunk_get_cpu_page(block, chunk, chunk_region.first),
+                                              chunk_size,
+                                              &gpu_mapping_addr);
         if (status != NV_OK)
             goto error;
 
-        uvm_cpu_chunk_set_gpu_mapping_addr(block, chunk_region.first, chunk, id, gpu_mapping_addr);
+        status = uvm_cpu_chunk_set_gpu_mapping_addr(block, chunk_region.first, chunk, id, gpu_mapping_addr);
+        if (status != NV_OK) {
+            uvm_pmm_sysmem_dma_cache_unmap(gpu,
+                                           uvm_cpu_chunk_get_cpu_page(block, chunk, chunk_region.first),
+                                           gpu_mapping_addr,
+                                           chunk_size);
+            goto error;
+        }
+
         status = uvm_pmm_sysmem_mappings_add_gpu_mapping(&gpu->pmm_sysmem_mappings,
                                                          uvm_cpu_chunk_get_gpu_mapping_addr(block,
                                                                                             chunk_region.first,
@@ -1043,7 +1529,7 @@ static NV_STATUS block_alloc_gpu_chunk(uvm_va_block_t *block,
             // If that fails with no memory, try allocating with eviction and
             // return back to the caller immediately so that the operation can
             // be restarted.
-            uvm_mutex_unlock(&block->lock);
+            uvm_va_block_unlock(block);
 
             status = uvm_pmm_gpu_alloc_user(&gpu->pmm, 1, size, UVM_PMM_ALLOC_FLAGS_EVICT, &gpu_chunk, &retry->tracker);
             if (status == NV_OK) {
@@ -1051,7 +1537,7 @@ static NV_STATUS block_alloc_gpu_chunk(uvm_va_block_t *block,
                 status = NV_ERR_MORE_PROCESSING_REQUIRED;
             }
 
-            uvm_mutex_lock(&block->lock);
+            uvm_va_block_lock(block);
             return status;
         }
         else if (status != NV_OK) {
@@ -1750,7 +2236,7 @@ static NV_STATUS block_zero_new_gpu_chunk(uvm_va_block_t *block,
         return NV_OK;
 
     gpu_state = uvm_va_block_gpu_state_get(block, gpu->id);
-    zero_mask = kmem_cache_alloc(g_uvm_page_mask_cache, NV_UVM_GFP_FLAGS);
+    zero_mask = block_page_mask_alloc();
 
     if (!zero_mask)
         return NV_ERR_NO_MEMORY;
@@ -1834,7 +2320,7 @@ static NV_STATUS block_zero_new_gpu_chunk(uvm_va_block_t *block,
 
 out:
     if (zero_mask)
-        kmem_cache_free(g_uvm_page_mask_cache, zero_mask);
+        block_page_mask_free(zero_mask);
 
     return status;
 }
@@ -2116,14 +2602,20 @@ uvm_gpu_phys_address_t uvm_va_block_gpu_phys_page_address(uvm_va_block_t *va_blo
 
 // Begin a push appropriate for copying data from src_id processor to dst_id processor.
 // One of src_id and dst_id needs to be a GPU.
+//
+// size is the number of bytes to be copied. Large copies are striped across
+// the copy engines suitable for the transfer, so that the copies of
+// consecutive blocks of a large migration can proceed in parallel.
 static NV_STATUS block_copy_begin_push(uvm_va_block_t *va_block,
                                        uvm_processor_id_t dst_id,
                                        uvm_processor_id_t src_id,
+                                       NvU64 size,
                                        uvm_tracker_t *tracker,
                                        uvm_push_t *push)
 {
     uvm_channel_type_t channel_type;
     uvm_gpu_t *gpu;
+    uvm_gpu_t *dst_gpu = NULL;
 
     UVM_ASSERT_MSG(!uvm_id_equal(src_id, dst_id),
                    "Unexpected copy to self, processor %s\n",
@@ -2156,28 +2648,20 @@ static NV_STATUS block_copy_begin_push(uvm_va_block_t *va_block,
                    block_processor_name(va_block, dst_id),
                    block_processor_name(va_block, src_id));
 
-    if (channel_type == UVM_CHANNEL_TYPE_GPU_TO_GPU) {
-        uvm_gpu_t *dst_gpu = block_get_gpu(va_block, dst_id);
-        return uvm_push_begin_acquire_gpu_to_gpu(gpu->channel_manager,
-                                                 dst_gpu,
-                                                 tracker,
-                                                 push,
-                                                 "Copy from %s to %s for block [0x%llx, 0x%llx]",
-                                                 block_processor_name(va_block, src_id),
-                                                 block_processor_name(va_block, dst_id),
-                                                 va_block->start,
-                                                 va_block->end);
-    }
-
-    return uvm_push_begin_acquire(gpu->channel_manager,
-                                  channel_type,
-                                  tracker,
-                                  push,
-                                  "Copy from %s to %s for block [0x%llx, 0x%llx]",
-                                  block_processor_name(va_block, src_id),
-                                  block_processor_name(va_block, dst_id),
-                                  va_block->start,
-                                  va_block->end);
+    if (channel_type == UVM_CHANNEL_TYPE_GPU_TO_GPU)
+        dst_gpu = block_get_gpu(va_block, dst_id);
+
+    return uvm_push_begin_acquire_striped(gpu->channel_manager,
+                                          channel_type,
+                                          dst_gpu,
+                                          size,
+                                          tracker,
+                                          push,
+                                          "Copy from %s to %s for block [0x%llx, 0x%llx]",
+                                          block_processor_name(va_block, src_id),
+                                          block_processor_name(va_block, dst_id),
+                                          va_block->start,
+                                          va_block->end);
 }
 
 // A page is clean iff...
@@ -2336,6 +2820,64 @@ static uvm_va_block_region_t block_phys_contig_region(uvm_va_block_t *block,
     }
 }
 
+// Pending CE copy of a physically-contiguous span, gathered page by page so
+// that contiguous pages are copied with a single memcopy.
+typedef struct
+{
+    uvm_gpu_address_t src;
+    uvm_gpu_address_t dst;
+
+    // Size of the span, 0 if there is nothing pending
+    size_t size;
+
+    // Number of memcopies pushed so far. All but the first one of a push are
+    // pipelined.
+    NvU32 num_copies;
+} block_copy_run_t;
+
+static bool block_copy_run_address_follows(uvm_gpu_address_t base, size_t size, uvm_gpu_address_t address)
+{
+    base.address += size;
+
+    return uvm_gpu_addr_cmp(base, address) == 0;
+}
+
+static void block_copy_run_flush(uvm_push_t *push, block_copy_run_t *run)
+{
+    if (run->size == 0)
+        return;
+
+    if (run->num_copies++ > 0)
+        uvm_push_set_flag(push, UVM_PUSH_FLAG_CE_NEXT_PIPELINED);
+
+    uvm_push_set_flag(push, UVM_PUSH_FLAG_CE_NEXT_MEMBAR_NONE);
+    uvm_push_get_gpu(push)->parent->ce_hal->memcopy(push, run->dst, run->src, run->size);
+
+    run->size = 0;
+}
+
+// Add a copy to the run, pushing the pending copy first if the new one doesn't
+// extend it on both the source and destination sides.
+static void block_copy_run_add(uvm_push_t *push,
+                               block_copy_run_t *run,
+                               uvm_gpu_address_t dst,
+                               uvm_gpu_address_t src,
+                               size_t size)
+{
+    if (run->size != 0 &&
+        block_copy_run_address_follows(run->src, run->size, src) &&
+        block_copy_run_address_follows(run->dst, run->size, dst)) {
+        run->size += size;
+        return;
+    }
+
+    block_copy_run_flush(push, run);
+
+    run->src = src;
+    run->dst = dst;
+    run->size = size;
+}
+
 // Copies pages resident on the src_id processor to the dst_id processor
 //
 // The function adds the pages that were successfully copied to the output
@@ -2360,6 +2902,7 @@ static NV_STATUS block_copy_resident_pages_between(uvm_va_block_t *block,
     uvm_page_mask_t *dst_resident_mask = uvm_va_block_resident_mask_get(block, dst_id);
     uvm_gpu_t *copying_gpu = NULL;
     uvm_push_t push;
+    block_copy_run_t copy_run = {0};
     uvm_page_index_t page_index;
     uvm_page_index_t contig_start_index = region.outer;
     uvm_page_index_t last_index = region.outer;
@@ -2384,13 +2927,8 @@ static NV_STATUS block_copy_resident_pages_between(uvm_va_block_t *block,
     if (uvm_id_equal(dst_id, src_id))
         return NV_OK;
 
-    uvm_page_mask_init_from_region(copy_mask, region, src_resident_mask);
-
-    if (page_mask)
-        uvm_page_mask_and(copy_mask, copy_mask, page_mask);
-
     // If there are not pages to be copied, exit early
-    if (!uvm_page_mask_andnot(copy_mask, copy_mask, dst_resident_mask))
+    if (!uvm_page_mask_region_fused(copy_mask, region, src_resident_mask, NULL, page_mask, dst_resident_mask))
         return NV_OK;
 
     // uvm_range_group_range_iter_first should only be called when the va_space
@@ -2463,7 +3001,12 @@ static NV_STATUS block_copy_resident_pages_between(uvm_va_block_t *block,
             continue;
 
         if (!copying_gpu) {
-            status = block_copy_begin_push(block, dst_id, src_id, &block->tracker, &push);
+            status = block_copy_begin_push(block,
+                                           dst_id,
+                                           src_id,
+                                           uvm_page_mask_region_weight(copy_mask, region) * PAGE_SIZE,
+                                           &block->tracker,
+                                           &push);
             if (status != NV_OK)
                 break;
             copying_gpu = uvm_push_get_gpu(&push);
@@ -2479,9 +3022,6 @@ static NV_STATUS block_copy_resident_pages_between(uvm_va_block_t *block,
             // of contig_cause
             uvm_tools_record_block_migration_begin(block, &push, dst_id, src_id, page_start, cause);
         }
-        else {
-            uvm_push_set_flag(&push, UVM_PUSH_FLAG_CE_NEXT_PIPELINED);
-        }
 
         block_update_page_dirty_state(block, dst_id, src_id, page_index);
 
@@ -2504,18 +3044,7 @@ static NV_STATUS block_copy_resident_pages_between(uvm_va_block_t *block,
             size_t contig_region_size = uvm_va_block_region_size(contig_region);
             UVM_ASSERT(uvm_va_block_region_contains_region(region, contig_region));
 
-            // If both src and dst are physically-contiguous, consolidate copies
-            // of contiguous pages into a single method.
-            if (is_src_phys_contig && is_dst_phys_contig) {
-                uvm_gpu_address_t src_address = contig_src_address;
-                uvm_gpu_address_t dst_address = contig_dst_address;
-
-                src_address.address += contig_start_index * PAGE_SIZE;
-                dst_address.address += contig_start_index * PAGE_SIZE;
-
-                uvm_push_set_flag(&push, UVM_PUSH_FLAG_CE_NEXT_MEMBAR_NONE);
-                copying_gpu->parent->ce_hal->memcopy(&push, dst_address, src_address, contig_region_size);
-            }
+            block_copy_run_flush(&push, &copy_run);
 
             uvm_perf_event_notify_migration(&va_space->perf_events,
                                             &push,
@@ -2537,7 +3066,10 @@ static NV_STATUS block_copy_resident_pages_between(uvm_va_block_t *block,
         if (is_dst_phys_contig)
             UVM_ASSERT(block_phys_copy_contig_check(block, page_index, &contig_dst_address, dst_id, copying_gpu));
 
-        if (!is_src_phys_contig || !is_dst_phys_contig) {
+        // Pages which are physically contiguous on both sides, whether because
+        // the whole block is or because their chunks happen to be adjacent,
+        // are gathered into a single copy.
+        {
             uvm_gpu_address_t src_address;
             uvm_gpu_address_t dst_address;
 
@@ -2557,8 +3089,7 @@ static NV_STATUS block_copy_resident_pages_between(uvm_va_block_t *block,
                 dst_address = block_phys_page_copy_address(block, block_phys_page(dst_id, page_index), copying_gpu);
             }
 
-            uvm_push_set_flag(&push, UVM_PUSH_FLAG_CE_NEXT_MEMBAR_NONE);
-            copying_gpu->parent->ce_hal->memcopy(&push, dst_address, src_address, PAGE_SIZE);
+            block_copy_run_add(&push, &copy_run, dst_address, src_address, PAGE_SIZE);
         }
 
         last_index = page_index;
@@ -2570,16 +3101,7 @@ static NV_STATUS block_copy_resident_pages_between(uvm_va_block_t *block,
         size_t contig_region_size = uvm_va_block_region_size(contig_region);
         UVM_ASSERT(uvm_va_block_region_contains_region(region, contig_region));
 
-        if (is_src_phys_contig && is_dst_phys_contig) {
-            uvm_gpu_address_t src_address = contig_src_address;
-            uvm_gpu_address_t dst_address = contig_dst_address;
-
-            src_address.address += contig_start_index * PAGE_SIZE;
-            dst_address.address += contig_start_index * PAGE_SIZE;
-
-            uvm_push_set_flag(&push, UVM_PUSH_FLAG_CE_NEXT_MEMBAR_NONE);
-            copying_gpu->parent->ce_hal->memcopy(&push, dst_address, src_address, contig_region_size);
-        }
+        block_copy_run_flush(&push, &copy_run);
 
         uvm_perf_event_notify_migration(&va_space->perf_events,
                                         &push,
@@ -2816,10 +3338,7 @@ static NV_STATUS block_copy_resident_pages(uvm_va_block_t *block,
 
     uvm_page_mask_zero(migrated_pages);
 
-    if (page_mask)
-        uvm_page_mask_andnot(copy_page_mask, page_mask, resident_mask);
-    else
-        uvm_page_mask_complement(copy_page_mask, resident_mask);
+    uvm_page_mask_fused(copy_page_mask, page_mask, NULL, NULL, resident_mask);
 
     missing_pages_count = uvm_page_mask_region_weight(copy_page_mask, region);
 
@@ -3167,14 +3686,13 @@ NV_STATUS uvm_va_block_make_resident_read_duplicate(uvm_va_block_t *va_block,
         const uvm_page_mask_t *resident_mask = uvm_va_block_resident_mask_get(va_block, src_id);
         UVM_ASSERT(!uvm_page_mask_empty(resident_mask));
 
-        if (page_mask)
-            uvm_page_mask_andnot(preprocess_page_mask, page_mask, &va_block->read_duplicated_pages);
-        else
-            uvm_page_mask_complement(preprocess_page_mask, &va_block->read_duplicated_pages);
-
         // If there are no pages that need to be unmapped/revoked, skip to the
         // next processor
-        if (!uvm_page_mask_and(preprocess_page_mask, preprocess_page_mask, resident_mask))
+        if (!uvm_page_mask_fused(preprocess_page_mask,
+                                 page_mask,
+                                 NULL,
+                                 resident_mask,
+                                 &va_block->read_duplicated_pages))
             continue;
 
         status = block_prep_read_duplicate_mapping(va_block, va_block_context, src_id, region, preprocess_page_mask);
@@ -3903,7 +4421,7 @@ static bool block_has_remote_mapping_gpu(uvm_va_block_t *block,
     }
 
     // Remote pages are pages which are mapped but not resident locally
-    return uvm_page_mask_andnot(&block_context->scratch_page_mask, mapped_pages, &gpu_state->resident);
+    return !uvm_page_mask_subset(mapped_pages, &gpu_state->resident);
 }
 
 // Writes pte_clear_val to the 4k PTEs covered by clear_page_mask. If
@@ -4065,9 +4583,7 @@ static void block_gpu_pte_big_split_write_4k(uvm_va_block_t *block,
         }
 
         // pages in new_pages_mask under this big page get new_prot
-        uvm_page_mask_zero(&block_context->scratch_page_mask);
-        uvm_page_mask_region_fill(&block_context->scratch_page_mask, big_region);
-        if (uvm_page_mask_and(&block_context->scratch_page_mask, &block_context->scratch_page_mask, new_pages_mask)) {
+        if (uvm_page_mask_region_fused(&block_context->scratch_page_mask, big_region, new_pages_mask, NULL, NULL, NULL)) {
             if (new_prot == UVM_PROT_NONE) {
                 block_gpu_pte_clear_4k(block, gpu, &block_context->scratch_page_mask, 0, pte_batch, NULL);
             }
@@ -4083,9 +4599,7 @@ static void block_gpu_pte_big_split_write_4k(uvm_va_block_t *block,
         }
 
         // All other pages under this big page inherit curr_prot
-        uvm_page_mask_zero(&block_context->scratch_page_mask);
-        uvm_page_mask_region_fill(&block_context->scratch_page_mask, big_region);
-        if (uvm_page_mask_andnot(&block_context->scratch_page_mask, &block_context->scratch_page_mask, new_pages_mask)) {
+        if (uvm_page_mask_region_fused(&block_context->scratch_page_mask, big_region, NULL, NULL, NULL, new_pages_mask)) {
             if (curr_prot == UVM_PROT_NONE) {
                 block_gpu_pte_clear_4k(block, gpu, &block_context->scratch_page_mask, 0, pte_batch, NULL);
             }
@@ -5045,6 +5559,21 @@ static void block_gpu_map_big_and_4k(uvm_va_block_t *block,
     bitmap_copy(gpu_state->big_ptes, new_pte_state->big_ptes, MAX_BIG_PAGES_PER_UVM_VA_BLOCK);
 }
 
+// End the TLB batch of an unmap of {block, gpu}, unless the caller is deferring
+// TLB invalidates. In that case the batch is left to block_unmap_gpu() to queue
+// up in the page tree once the push writing the PTEs is ended.
+static void block_gpu_unmap_tlb_batch_end(uvm_va_block_context_t *block_context,
+                                          uvm_push_t *push,
+                                          uvm_membar_t tlb_membar)
+{
+    if (block_context->mapping.defer_tlb_invalidates) {
+        block_context->mapping.tlb_batch_deferred = true;
+        return;
+    }
+
+    uvm_tlb_batch_end(&block_context->mapping.tlb_batch, push, tlb_membar);
+}
+
 // Unmap all PTEs for {block, gpu}. If the 2M entry is currently a PDE, it is
 // merged into a PTE.
 static void block_gpu_unmap_to_2m(uvm_va_block_t *block,
@@ -5066,7 +5595,7 @@ static void block_gpu_unmap_to_2m(uvm_va_block_t *block,
         block_gpu_pte_clear_2m(block, gpu, pte_batch, tlb_batch);
 
         uvm_pte_batch_end(pte_batch);
-        uvm_tlb_batch_end(tlb_batch, push, tlb_membar);
+        block_gpu_unmap_tlb_batch_end(block_context, push, tlb_membar);
     }
     else {
         // Otherwise we have a mix of big and 4K PTEs which need to be merged
@@ -5200,6 +5729,7 @@ static void block_gpu_unmap_big_and_4k(uvm_va_block_t *block,
     DECLARE_BITMAP(big_ptes_mask, MAX_BIG_PAGES_PER_UVM_VA_BLOCK);
     NvU32 big_page_size = tree->big_page_size;
     NvU64 unmapped_pte_val = tree->hal->unmapped_pte(big_page_size);
+    bool finish_split;
 
     UVM_ASSERT(!gpu_state->pte_is_2m);
 
@@ -5273,6 +5803,9 @@ static void block_gpu_unmap_big_and_4k(uvm_va_block_t *block,
     bitmap_or(big_ptes_mask, big_ptes_mask, big_ptes_split, MAX_BIG_PAGES_PER_UVM_VA_BLOCK);
     block_gpu_pte_clear_big(block, gpu, big_ptes_mask, unmapped_pte_val, pte_batch, tlb_batch);
 
+    finish_split = !bitmap_empty(big_ptes_split, MAX_BIG_PAGES_PER_UVM_VA_BLOCK) ||
+                   block_gpu_needs_to_activate_table(block, gpu);
+
     // Case 2: Merge the new big PTEs and end the batches, now that we've done
     // all of the independent PTE writes we can.
     //
@@ -5291,13 +5824,16 @@ static void block_gpu_unmap_big_and_4k(uvm_va_block_t *block,
     }
     else {
         // End the batches. We have to commit the membars and TLB invalidates
-        // before we finish splitting formerly-big PTEs.
+        // before we finish splitting formerly-big PTEs, so the invalidate can
+        // only be deferred if there's nothing left to do.
         uvm_pte_batch_end(pte_batch);
-        uvm_tlb_batch_end(tlb_batch, push, tlb_membar);
+        if (finish_split)
+            uvm_tlb_batch_end(tlb_batch, push, tlb_membar);
+        else
+            block_gpu_unmap_tlb_batch_end(block_context, push, tlb_membar);
     }
 
-    if (!bitmap_empty(big_ptes_split, MAX_BIG_PAGES_PER_UVM_VA_BLOCK) ||
-        block_gpu_needs_to_activate_table(block, gpu)) {
+    if (finish_split) {
         uvm_pte_batch_begin(push, pte_batch);
         uvm_tlb_batch_begin(tree, tlb_batch);
 
@@ -5551,7 +6087,7 @@ static NV_STATUS block_alloc_pt_range_with_retry(uvm_va_block_t *va_block,
     }
 
     // Unlock the va block and retry with eviction enabled
-    uvm_mutex_unlock(&va_block->lock);
+    uvm_va_block_unlock(va_block);
 
     if (use_alloc_table) {
         // Although we don't hold the block lock here, it's safe to pass
@@ -5573,7 +6109,7 @@ static NV_STATUS block_alloc_pt_range_with_retry(uvm_va_block_t *va_block,
                                         &local_range);
     }
 
-    uvm_mutex_lock(&va_block->lock);
+    uvm_va_block_lock(va_block);
 
     if (status != NV_OK)
         return status;
@@ -5809,6 +6345,8 @@ static NV_STATUS block_unmap_gpu(uvm_va_block_t *block,
     if (status != NV_OK)
         return status;
 
+    block_context->mapping.tlb_batch_deferred = false;
+
     if (new_pte_state->pte_is_2m) {
         // We're either unmapping a whole valid 2M PTE, or we're unmapping all
         // remaining pages in a split 2M PTE.
@@ -5828,6 +6366,13 @@ static NV_STATUS block_unmap_gpu(uvm_va_block_t *block,
 
     uvm_push_end(&push);
 
+    if (block_context->mapping.tlb_batch_deferred) {
+        uvm_page_tree_defer_tlb_invalidate(&uvm_va_block_get_gpu_va_space(block, gpu)->page_tables,
+                                           &block_context->mapping.tlb_batch,
+                                           &push,
+                                           tlb_membar);
+    }
+
     if (!uvm_processor_mask_test(&block->va_range->uvm_lite_gpus, gpu->id)) {
         uvm_processor_mask_t non_uvm_lite_gpus;
         uvm_processor_mask_andnot(&non_uvm_lite_gpus, &block->mapped, &block->va_range->uvm_lite_gpus);
@@ -6073,9 +6618,7 @@ static NV_STATUS block_map_cpu_to(uvm_va_block_t *block,
     // TODO: Bug 1766424: Check if optimizing the unmap_mapping_range calls
     //       within block_map_cpu_page_to by doing them once here is helpful.
 
-    UVM_ASSERT(!uvm_page_mask_and(&block_context->scratch_page_mask,
-                                  map_page_mask,
-                                  &block->cpu.pte_bits[prot_pte_bit]));
+    UVM_ASSERT(!uvm_page_mask_intersects(map_page_mask, &block->cpu.pte_bits[prot_pte_bit]));
 
     // The pages which will actually change are those in the input page mask
     // which are resident on the target.
@@ -6172,9 +6715,7 @@ static NV_STATUS block_map_gpu_to(uvm_va_block_t *va_block,
     if (uvm_processor_mask_test(&va_range->uvm_lite_gpus, gpu->id))
         UVM_ASSERT(uvm_id_equal(resident_id, va_range->preferred_location));
 
-    UVM_ASSERT(!uvm_page_mask_and(&block_context->scratch_page_mask,
-                                  map_page_mask,
-                                  &gpu_state->pte_bits[prot_pte_bit]));
+    UVM_ASSERT(!uvm_page_mask_intersects(map_page_mask, &gpu_state->pte_bits[prot_pte_bit]));
 
     // The pages which will actually change are those in the input page mask
     // which are resident on the target.
@@ -6185,13 +6726,11 @@ static NV_STATUS block_map_gpu_to(uvm_va_block_t *va_block,
 
     // For PTE merge/split computation, compute all resident pages which will
     // have exactly new_prot after performing the mapping.
-    uvm_page_mask_or(&block_context->scratch_page_mask, &gpu_state->pte_bits[prot_pte_bit], pages_to_map);
-    if (prot_pte_bit < UVM_PTE_BITS_GPU_ATOMIC) {
-        uvm_page_mask_andnot(&block_context->scratch_page_mask,
-                             &block_context->scratch_page_mask,
-                             &gpu_state->pte_bits[prot_pte_bit + 1]);
-    }
-    uvm_page_mask_and(&block_context->scratch_page_mask, &block_context->scratch_page_mask, resident_mask);
+    uvm_page_mask_fused(&block_context->scratch_page_mask,
+                        &gpu_state->pte_bits[prot_pte_bit],
+                        pages_to_map,
+                        resident_mask,
+                        prot_pte_bit < UVM_PTE_BITS_GPU_ATOMIC ? &gpu_state->pte_bits[prot_pte_bit + 1] : NULL);
 
     block_gpu_compute_new_pte_state(va_block,
                                     gpu,
@@ -6359,9 +6898,7 @@ NV_STATUS uvm_va_block_map(uvm_va_block_t *va_block,
         pte_mask = &gpu_state->pte_bits[prot_pte_bit];
     }
 
-    uvm_page_mask_init_from_region(running_page_mask, region, map_page_mask);
-
-    if (!uvm_page_mask_andnot(running_page_mask, running_page_mask, pte_mask))
+    if (!uvm_page_mask_region_fused(running_page_mask, region, map_page_mask, NULL, NULL, pte_mask))
         return NV_OK;
 
     // Map per resident location so we can more easily detect physically-
@@ -6605,9 +7142,12 @@ NV_STATUS uvm_va_block_revoke_prot(uvm_va_block_t *va_block,
         if (prot_to_revoke == UVM_PROT_READ_WRITE_ATOMIC)
             return NV_OK;
 
-        uvm_page_mask_init_from_region(running_page_mask, region, revoke_page_mask);
-
-        if (uvm_page_mask_and(running_page_mask, running_page_mask, &va_block->cpu.pte_bits[UVM_PTE_BITS_CPU_WRITE]))
+        if (uvm_page_mask_region_fused(running_page_mask,
+                                       region,
+                                       revoke_page_mask,
+                                       NULL,
+                                       &va_block->cpu.pte_bits[UVM_PTE_BITS_CPU_WRITE],
+                                       NULL))
             return block_revoke_cpu_write(va_block, va_block_context, region, running_page_mask, out_tracker);
 
         return NV_OK;
@@ -6625,9 +7165,12 @@ NV_STATUS uvm_va_block_revoke_prot(uvm_va_block_t *va_block,
     gpu_state = uvm_va_block_gpu_state_get(va_block, gpu->id);
     prot_pte_bit = get_gpu_pte_bit_index(prot_to_revoke);
 
-    uvm_page_mask_init_from_region(running_page_mask, region, revoke_page_mask);
-
-    if (!uvm_page_mask_and(running_page_mask, running_page_mask, &gpu_state->pte_bits[prot_pte_bit]))
+    if (!uvm_page_mask_region_fused(running_page_mask,
+                                    region,
+                                    revoke_page_mask,
+                                    NULL,
+                                    &gpu_state->pte_bits[prot_pte_bit],
+                                    NULL))
         return NV_OK;
 
     // Revoke per resident location so we can more easily detect physically-
@@ -7168,11 +7711,11 @@ static void block_unregister_gpu_locked(uvm_va_block_t *va_block, uvm_gpu_t *gpu
 void uvm_va_block_unregister_gpu(uvm_va_block_t *va_block, uvm_gpu_t *gpu, struct mm_struct *mm)
 {
     // Take the lock internally to not expose the caller to allocation-retry.
-    uvm_mutex_lock(&va_block->lock);
+    uvm_va_block_lock(va_block);
 
     block_unregister_gpu_locked(va_block, gpu, mm);
 
-    uvm_mutex_unlock(&va_block->lock);
+    uvm_va_block_unlock(va_block);
 }
 
 static void block_mark_region_cpu_dirty(uvm_va_block_t *va_block, uvm_va_block_region_t region)
@@ -7185,37 +7728,36 @@ static void block_mark_region_cpu_dirty(uvm_va_block_t *va_block, uvm_va_block_r
         block_mark_cpu_page_dirty(va_block, page_index);
 }
 
-// Tears down everything within the block, but doesn't free the block itself.
-// Note that when uvm_va_block_kill is called, this is called twice: once for
-// the initial kill itself, then again when the block's ref count is eventually
-// destroyed. block->va_range is used to track whether the block has already
-// been killed.
-static void block_kill(uvm_va_block_t *block)
+static void block_kill_notify(uvm_va_block_t *block)
 {
-    uvm_va_space_t *va_space;
+    uvm_va_space_t *va_space = uvm_va_block_get_va_space(block);
     uvm_perf_event_data_t event_data;
+
+    event_data.block_destroy.block = block;
+    uvm_perf_event_notify(&va_space->perf_events, UVM_PERF_EVENT_BLOCK_DESTROY, &event_data);
+}
+
+// The part of block_kill() after the perf event notification. If block_context
+// is NULL, the VA space's block context is used if needed.
+static void block_kill_with_context(uvm_va_block_t *block, uvm_va_block_context_t *block_context)
+{
+    uvm_va_space_t *va_space = uvm_va_block_get_va_space(block);
     uvm_cpu_chunk_t *chunk;
     uvm_gpu_id_t id;
     NV_STATUS status;
     uvm_va_block_region_t region = uvm_va_block_region_from_block(block);
     uvm_page_index_t page_index;
 
-    if (uvm_va_block_is_dead(block))
-        return;
-
-    va_space = uvm_va_block_get_va_space(block);
-    event_data.block_destroy.block = block;
-    uvm_perf_event_notify(&va_space->perf_events, UVM_PERF_EVENT_BLOCK_DESTROY, &event_data);
-
     // Unmap all processors in parallel first. Unmapping the whole block won't
     // cause a page table split, so this should only fail if we have a system-
     // fatal error.
     if (!uvm_processor_mask_empty(&block->mapped)) {
-        uvm_va_block_context_t *block_context = uvm_va_space_block_context(va_space, NULL);
-
         // We could only be killed with mapped GPU state by VA range free or VA
         // space teardown, so it's safe to use the va_space's block_context
         // because both of those have the VA space lock held in write mode.
+        if (!block_context)
+            block_context = uvm_va_space_block_context(va_space, NULL);
+
         status = uvm_va_block_unmap_mask(block, block_context, &block->mapped, region, NULL);
         UVM_ASSERT(status == uvm_global_get_status());
     }
@@ -7259,6 +7801,20 @@ static void block_kill(uvm_va_block_t *block)
 #endif
 }
 
+// Tears down everything within the block, but doesn't free the block itself.
+// Note that when uvm_va_block_kill is called, this is called twice: once for
+// the initial kill itself, then again when the block's ref count is eventually
+// destroyed. block->va_range is used to track whether the block has already
+// been killed.
+static void block_kill(uvm_va_block_t *block)
+{
+    if (uvm_va_block_is_dead(block))
+        return;
+
+    block_kill_notify(block);
+    block_kill_with_context(block, NULL);
+}
+
 // Called when the block's ref count drops to 0
 void uvm_va_block_destroy(nv_kref_t *nv_kref)
 {
@@ -7267,9 +7823,9 @@ void uvm_va_block_destroy(nv_kref_t *nv_kref)
     // Nobody else should have a reference when freeing
     uvm_assert_mutex_unlocked(&block->lock);
 
-    uvm_mutex_lock(&block->lock);
+    uvm_va_block_lock(block);
     block_kill(block);
-    uvm_mutex_unlock(&block->lock);
+    uvm_va_block_unlock(block);
 
     if (uvm_enable_builtin_tests) {
         uvm_va_block_wrapper_t *block_wrapper = container_of(block, uvm_va_block_wrapper_t, block);
@@ -7283,14 +7839,122 @@ void uvm_va_block_destroy(nv_kref_t *nv_kref)
 
 void uvm_va_block_kill(uvm_va_block_t *va_block)
 {
-    uvm_mutex_lock(&va_block->lock);
+    uvm_va_block_lock(va_block);
     block_kill(va_block);
-    uvm_mutex_unlock(&va_block->lock);
+    uvm_va_block_unlock(va_block);
 
     // May call block_kill again
     uvm_va_block_release(va_block);
 }
 
+// Claim blocks of the teardown job in batches and kill them, until none are
+// left
+static void block_teardown_kill_blocks(uvm_va_block_teardown_job_t *job, uvm_va_block_context_t *block_context)
+{
+    while (1) {
+        size_t start = (size_t)atomic_long_add_return(UVM_VA_BLOCK_TEARDOWN_BATCH, &job->next_block) -
+                       UVM_VA_BLOCK_TEARDOWN_BATCH;
+        size_t end = min(start + UVM_VA_BLOCK_TEARDOWN_BATCH, job->num_blocks);
+        size_t i;
+
+        if (start >= job->num_blocks)
+            break;
+
+        for (i = start; i < end; i++) {
+            uvm_va_block_t *block = job->blocks[i];
+
+            uvm_va_block_lock(block);
+            if (!uvm_va_block_is_dead(block))
+                block_kill_with_context(block, block_context);
+            uvm_va_block_unlock(block);
+
+            // May call block_kill again
+            uvm_va_block_release(block);
+        }
+    }
+}
+
+static void block_teardown_worker(uvm_va_block_teardown_job_t *job)
+{
+    uvm_va_block_context_t *block_context = uvm_va_block_context_alloc(NULL);
+
+    // If the allocation fails, the remaining blocks are killed by the other
+    // threads working on the job.
+    if (block_context) {
+        // The blocks are killed on behalf of the thread which started the job
+        // and holds the VA space lock in write mode, which the lock tracking
+        // can't know about.
+        uvm_thread_context_lock_disable_tracking();
+        block_teardown_kill_blocks(job, block_context);
+        uvm_thread_context_lock_enable_tracking();
+
+        uvm_va_block_context_free(block_context);
+    }
+
+    if (atomic_dec_and_test(&job->num_active))
+        complete(&job->done);
+}
+
+static void block_teardown_worker_entry(void *args)
+{
+    UVM_ENTRY_VOID(block_teardown_worker(args));
+}
+
+void uvm_va_block_kill_all(uvm_va_block_t **blocks, size_t num_blocks)
+{
+    uvm_va_block_teardown_job_t *job = NULL;
+    uvm_va_space_t *va_space;
+    unsigned num_workers;
+    size_t i;
+
+    if (num_blocks == 0)
+        return;
+
+    va_space = uvm_va_block_get_va_space(blocks[0]);
+    uvm_assert_rwsem_locked_write(&va_space->lock);
+
+    num_workers = min_t(size_t, g_va_block_teardown.num_qs, num_blocks / UVM_VA_BLOCK_TEARDOWN_MIN_BLOCKS);
+    if (num_workers > 0)
+        job = uvm_kvmalloc(sizeof(*job));
+
+    if (!job) {
+        for (i = 0; i < num_blocks; i++)
+            uvm_va_block_kill(blocks[i]);
+
+        return;
+    }
+
+    // Perf modules don't expect their callbacks to run concurrently under the
+    // VA space lock in write mode, so notify the destruction of all the blocks
+    // up front.
+    for (i = 0; i < num_blocks; i++) {
+        uvm_va_block_lock(blocks[i]);
+        if (!uvm_va_block_is_dead(blocks[i]))
+            block_kill_notify(blocks[i]);
+        uvm_va_block_unlock(blocks[i]);
+    }
+
+    job->blocks = blocks;
+    job->num_blocks = num_blocks;
+    atomic_long_set(&job->next_block, 0);
+
+    // The calling thread works on the job too
+    atomic_set(&job->num_active, num_workers + 1);
+    init_completion(&job->done);
+
+    for (i = 0; i < num_workers; i++) {
+        nv_kthread_q_item_init(&job->q_items[i], block_teardown_worker_entry, job);
+        nv_kthread_q_schedule_q_item(&g_va_block_teardown.qs[i], &job->q_items[i]);
+    }
+
+    block_teardown_kill_blocks(job, NULL);
+
+    if (!atomic_dec_and_test(&job->num_active))
+        wait_for_completion(&job->done);
+
+    uvm_kvfree(job);
+}
+
 static NV_STATUS block_split_presplit_ptes_gpu(uvm_va_block_t *existing, uvm_va_block_t *new, uvm_gpu_t *gpu)
 {
     uvm_va_block_gpu_state_t *existing_gpu_state = uvm_va_block_gpu_state_get(existing, gpu->id);
@@ -7638,6 +8302,52 @@ static void block_merge_cpu_chunks(uvm_va_block_t *existing, uvm_va_block_t *new
 // Pre-allocate everything which doesn't require retry on both existing and new
 // which will be needed to handle a split. If this fails, existing must remain
 // functionally unmodified.
+// Reparenting the sysmem reverse mappings on split may need to split one
+// reverse map extent per mapping owner in the reverse map of each GPU: the CPU
+// for the CPU chunks mapped on the GPU, and each of the GPUs whose chunks are
+// mapped by the GPU as an indirect peer.
+static size_t block_split_num_reverse_map_extents(uvm_va_space_t *va_space)
+{
+    return uvm_processor_mask_get_gpu_count(&va_space->registered_gpus) + 1;
+}
+
+static NV_STATUS block_split_reserve_reverse_map_extents(uvm_va_block_t *existing)
+{
+    NV_STATUS status = NV_OK;
+    uvm_va_space_t *va_space = uvm_va_block_get_va_space(existing);
+    size_t num_extents = block_split_num_reverse_map_extents(va_space);
+    uvm_gpu_t *gpu;
+    uvm_gpu_t *other_gpu;
+
+    for_each_va_space_gpu(gpu, va_space) {
+        status = uvm_pmm_sysmem_mappings_reserve_extents(&gpu->pmm_sysmem_mappings, num_extents);
+        if (status != NV_OK)
+            break;
+    }
+
+    if (status == NV_OK)
+        return NV_OK;
+
+    for_each_va_space_gpu(other_gpu, va_space) {
+        if (other_gpu == gpu)
+            break;
+
+        uvm_pmm_sysmem_mappings_unreserve_extents(&other_gpu->pmm_sysmem_mappings, num_extents);
+    }
+
+    return status;
+}
+
+static void block_split_unreserve_reverse_map_extents(uvm_va_block_t *existing)
+{
+    uvm_va_space_t *va_space = uvm_va_block_get_va_space(existing);
+    size_t num_extents = block_split_num_reverse_map_extents(va_space);
+    uvm_gpu_t *gpu;
+
+    for_each_va_space_gpu(gpu, va_space)
+        uvm_pmm_sysmem_mappings_unreserve_extents(&gpu->pmm_sysmem_mappings, num_extents);
+}
+
 static NV_STATUS block_split_preallocate_no_retry(uvm_va_block_t *existing, uvm_va_block_t *new)
 {
     NV_STATUS status;
@@ -7664,6 +8374,10 @@ static NV_STATUS block_split_preallocate_no_retry(uvm_va_block_t *existing, uvm_
             status = NV_ERR_NO_MEMORY;
             goto error;
         }
+
+        status = uvm_cpu_chunk_gpu_mapping_split_prealloc(existing, new, id);
+        if (status != NV_OK)
+            goto error;
     }
 
     if (existing_va_range->inject_split_error) {
@@ -7672,6 +8386,11 @@ static NV_STATUS block_split_preallocate_no_retry(uvm_va_block_t *existing, uvm_
         goto error;
     }
 
+    // The reservation is dropped by the caller once the split is done
+    status = block_split_reserve_reverse_map_extents(existing);
+    if (status != NV_OK)
+        goto error;
+
     return NV_OK;
 
 error:
@@ -8129,7 +8848,7 @@ NV_STATUS uvm_va_block_split(uvm_va_block_t *existing_va_block,
     // the block lock. When a reverse mapping thread takes this lock after the
     // split has been performed, it will have to re-inspect state and may see
     // that it should use the newly-split block instead.
-    uvm_mutex_lock(&existing_va_block->lock);
+    uvm_va_block_lock(existing_va_block);
 
     for_each_gpu_id(id)
         UVM_ASSERT(block_check_chunks(existing_va_block, id));
@@ -8170,8 +8889,10 @@ NV_STATUS uvm_va_block_split(uvm_va_block_t *existing_va_block,
     // We'll potentially be freeing page tables, so we need to wait for any
     // outstanding work before we start
     status = uvm_tracker_wait(&existing_va_block->tracker);
-    if (status != NV_OK)
+    if (status != NV_OK) {
+        block_split_unreserve_reverse_map_extents(existing_va_block);
         goto out;
+    }
 
     // Update existing's state only once we're past all failure points
 
@@ -8183,6 +8904,8 @@ NV_STATUS uvm_va_block_split(uvm_va_block_t *existing_va_block,
     for_each_gpu_id(id)
         block_split_gpu(existing_va_block, new_block, id);
 
+    block_split_unreserve_reverse_map_extents(existing_va_block);
+
     // Update the size of the existing block first so that
     // block_set_processor_masks can use block_{set,clear}_resident_processor
     // that relies on the size to be correct.
@@ -8218,7 +8941,7 @@ out:
     }
 
     uvm_mutex_unlock_no_tracking(&new_block->lock);
-    uvm_mutex_unlock(&existing_va_block->lock);
+    uvm_va_block_unlock(existing_va_block);
 
     if (status != NV_OK)
         uvm_va_block_release(new_block);
@@ -8894,9 +9617,7 @@ static bool check_access_counters_dont_revoke(uvm_va_block_t *block,
     for_each_id_in_mask(id, revoke_processors) {
         const uvm_page_mask_t *mapped_with_prot = block_map_with_prot_mask_get(block, id, revoke_prot);
 
-        uvm_page_mask_and(&block_context->caller_page_mask, revoke_page_mask, mapped_with_prot);
-
-        UVM_ASSERT(uvm_page_mask_region_weight(&block_context->caller_page_mask, region) == 0);
+        UVM_ASSERT(!uvm_page_mask_region_fused_test(region, revoke_page_mask, NULL, mapped_with_prot, NULL));
     }
 
     return true;
@@ -9552,10 +10273,20 @@ NV_STATUS uvm_va_block_find_create(uvm_va_space_t *va_space,
                                    NvU64 addr,
                                    uvm_va_block_t **out_block)
 {
-    uvm_va_range_t *va_range;
+    return uvm_va_block_find_create_in_range(va_space, uvm_va_range_find(va_space, addr), mm, addr, out_block);
+}
+
+NV_STATUS uvm_va_block_find_create_in_range(uvm_va_space_t *va_space,
+                                            uvm_va_range_t *va_range,
+                                            struct mm_struct *mm,
+                                            NvU64 addr,
+                                            uvm_va_block_t **out_block)
+{
     size_t index;
 
-    va_range = uvm_va_range_find(va_space, addr);
+    uvm_assert_rwsem_locked(&va_space->lock);
+    UVM_ASSERT(va_range == uvm_va_range_find(va_space, addr));
+
     if (!va_range)
         return uvm_hmm_va_block_find_create(va_space, mm, addr, out_block);
 
@@ -9725,9 +10456,9 @@ static void block_deferred_eviction_mappings(void *args)
     uvm_va_block_context_t *block_context = NULL;
     struct mm_struct *mm = NULL;
 
-    uvm_mutex_lock(&va_block->lock);
+    uvm_va_block_lock(va_block);
     va_space = uvm_va_block_get_va_space_maybe_dead(va_block);
-    uvm_mutex_unlock(&va_block->lock);
+    uvm_va_block_unlock(va_block);
 
     if (!va_space) {
         // Block has been killed in the meantime
@@ -9814,6 +10545,34 @@ static void block_deferred_eviction_mappings_entry(void *args)
     UVM_ENTRY_VOID(block_deferred_eviction_mappings(args));
 }
 
+// Push the TLB invalidates deferred in the page trees of all GPUs with page
+// tables for the block, and make the block's tracker depend on them.
+static NV_STATUS block_flush_deferred_tlb_invalidates(uvm_va_block_t *block)
+{
+    uvm_gpu_id_t id;
+
+    for_each_gpu_id(id) {
+        NV_STATUS status;
+        uvm_gpu_t *gpu;
+
+        if (!uvm_va_block_gpu_state_get(block, id))
+            continue;
+
+        // Having page tables guarantees that the GPU VA space can't go away
+        // while the block lock is held. See block_unmap_gpu().
+        gpu = block_get_gpu(block, id);
+        if (!block_gpu_has_page_tables(block, gpu))
+            continue;
+
+        status = uvm_page_tree_flush_deferred_tlb_invalidates(&uvm_va_block_get_gpu_va_space(block, gpu)->page_tables,
+                                                              &block->tracker);
+        if (status != NV_OK)
+            return status;
+    }
+
+    return NV_OK;
+}
+
 NV_STATUS uvm_va_block_evict_chunks(uvm_va_block_t *va_block,
                                     uvm_gpu_t *gpu,
                                     uvm_gpu_chunk_t *root_chunk,
@@ -9877,6 +10636,13 @@ NV_STATUS uvm_va_block_evict_chunks(uvm_va_block_t *va_block,
     if (chunks_to_evict == 0)
         goto out;
 
+    // The unmaps of a VA range operation running concurrently might have left
+    // TLB invalidates of this block deferred. They have to be pushed before
+    // any of the evicted memory can be reused.
+    status = block_flush_deferred_tlb_invalidates(va_block);
+    if (status != NV_OK)
+        goto out;
+
     // Only move pages resident on the GPU
     uvm_page_mask_and(pages_to_evict, pages_to_evict, uvm_va_block_resident_mask_get(va_block, gpu->id));
 
@@ -10075,7 +10841,7 @@ NV_STATUS uvm_test_va_block_inject_error(UVM_TEST_VA_BLOCK_INJECT_ERROR_PARAMS *
     va_block_test = uvm_va_block_get_test(va_block);
     UVM_ASSERT(va_block_test);
 
-    uvm_mutex_lock(&va_block->lock);
+    uvm_va_block_lock(va_block);
 
     if (params->page_table_allocation_retry_force_count)
         va_block_test->page_table_allocation_retry_force_count = params->page_table_allocation_retry_force_count;
@@ -10095,7 +10861,7 @@ NV_STATUS uvm_test_va_block_inject_error(UVM_TEST_VA_BLOCK_INJECT_ERROR_PARAMS *
     if (params->populate_error)
         va_block_test->inject_populate_error = params->populate_error;
 
-    uvm_mutex_unlock(&va_block->lock);
+    uvm_va_block_unlock(va_block);
 
 out:
     uvm_va_space_up_read(va_space);
@@ -10168,7 +10934,7 @@ NV_STATUS uvm_test_change_pte_mapping(UVM_TEST_CHANGE_PTE_MAPPING_PARAMS *params
     if (status != NV_OK)
         goto out;
 
-    uvm_mutex_lock(&block->lock);
+    uvm_va_block_lock(block);
 
     region = uvm_va_block_region_from_start_size(block, params->va, PAGE_SIZE);
     curr_prot = block_page_prot(block, id, region.first);
@@ -10219,7 +10985,7 @@ out_block:
     if (status == NV_OK)
         status = uvm_tracker_init_from(&local_tracker, &block->tracker);
 
-    uvm_mutex_unlock(&block->lock);
+    uvm_va_block_unlock(block);
 
     if (status == NV_OK)
         status = uvm_tracker_wait_deinit(&local_tracker);
@@ -10255,6 +11021,294 @@ out:
     return status;
 }
 
+// How long region lock tests wait before deciding that a locker is blocked,
+// and at most for a locker that must not be blocked to get its lock.
+#define REGION_LOCKS_TEST_BLOCKED_MS 20
+#define REGION_LOCKS_TEST_TIMEOUT_MS 10000
+
+typedef struct
+{
+    uvm_va_block_t *va_block;
+
+    // Region lock bits to take, or 0 to take the whole block lock
+    NvU32 bits;
+
+    // Set once the lock has been acquired. The locker releases it right away.
+    atomic_t locked;
+
+    nv_kthread_q_item_t q_item;
+} region_locks_test_locker_t;
+
+static void region_locks_test_locker(void *args)
+{
+    region_locks_test_locker_t *locker = (region_locks_test_locker_t *)args;
+    uvm_va_block_t *va_block = locker->va_block;
+
+    if (locker->bits == 0) {
+        uvm_mutex_lock(&va_block->lock);
+        block_wait_for_region_locks(va_block);
+        atomic_set(&locker->locked, 1);
+        uvm_mutex_unlock(&va_block->lock);
+    }
+    else {
+        block_lock_region_bits(va_block, locker->bits);
+        atomic_set(&locker->locked, 1);
+        block_unlock_region_bits(va_block, locker->bits);
+    }
+}
+
+static void region_locks_test_locker_entry(void *args)
+{
+    UVM_ENTRY_VOID(region_locks_test_locker(args));
+}
+
+static void region_locks_test_locker_start(nv_kthread_q_t *q,
+                                           region_locks_test_locker_t *locker,
+                                           uvm_va_block_t *va_block,
+                                           NvU32 bits)
+{
+    locker->va_block = va_block;
+    locker->bits = bits;
+    atomic_set(&locker->locked, 0);
+    nv_kthread_q_item_init(&locker->q_item, region_locks_test_locker_entry, locker);
+    nv_kthread_q_schedule_q_item(q, &locker->q_item);
+}
+
+// Wait up to timeout_ms for the locker to acquire its lock
+static bool region_locks_test_locker_wait(region_locks_test_locker_t *locker, unsigned timeout_ms)
+{
+    unsigned waited_ms;
+
+    for (waited_ms = 0; waited_ms < timeout_ms && !atomic_read(&locker->locked); ++waited_ms)
+        msleep(1);
+
+    return atomic_read(&locker->locked) != 0;
+}
+
+// Check the region lock bits of all the page regions of the block against the
+// UVM_MIN_BIG_PAGE_SIZE-aligned regions of the VA space that their pages fall
+// in.
+static NV_STATUS test_region_lock_bits(uvm_va_block_t *va_block)
+{
+    NvU64 window_start = UVM_VA_BLOCK_ALIGN_DOWN(va_block->start);
+    uvm_page_index_t num_pages = uvm_va_block_num_cpu_pages(va_block);
+    uvm_page_index_t first, outer;
+
+    for (first = 0; first < num_pages; ++first) {
+        NvU32 expected = 0;
+
+        for (outer = first + 1; outer <= num_pages; ++outer) {
+            NvU64 addr = uvm_va_block_cpu_page_address(va_block, outer - 1);
+
+            expected |= 1U << ((addr - window_start) / UVM_MIN_BIG_PAGE_SIZE);
+            TEST_CHECK_RET(block_region_lock_bits(va_block, uvm_va_block_region(first, outer)) == expected);
+        }
+    }
+
+    return NV_OK;
+}
+
+// Hold region_bits and check whether a locker of locker_bits, or of the whole
+// block if 0, gets its lock while the region is held.
+static NV_STATUS test_region_lock_held(nv_kthread_q_t *q,
+                                       uvm_va_block_t *va_block,
+                                       NvU32 region_bits,
+                                       NvU32 locker_bits,
+                                       bool expect_blocked)
+{
+    region_locks_test_locker_t locker;
+    bool locked;
+
+    block_lock_region_bits(va_block, region_bits);
+
+    region_locks_test_locker_start(q, &locker, va_block, locker_bits);
+
+    if (expect_blocked)
+        locked = region_locks_test_locker_wait(&locker, REGION_LOCKS_TEST_BLOCKED_MS);
+    else
+        locked = region_locks_test_locker_wait(&locker, REGION_LOCKS_TEST_TIMEOUT_MS);
+
+    block_unlock_region_bits(va_block, region_bits);
+
+    nv_kthread_q_flush(q);
+
+    TEST_CHECK_RET(locked != expect_blocked);
+    TEST_CHECK_RET(atomic_read(&locker.locked));
+
+    return NV_OK;
+}
+
+// Hold the whole block lock and check that a locker of region_bits only gets
+// its lock once the block lock is released.
+static NV_STATUS test_block_lock_held(nv_kthread_q_t *q, uvm_va_block_t *va_block, NvU32 region_bits)
+{
+    region_locks_test_locker_t locker;
+    bool locked;
+
+    uvm_mutex_lock(&va_block->lock);
+    block_wait_for_region_locks(va_block);
+
+    region_locks_test_locker_start(q, &locker, va_block, region_bits);
+    locked = region_locks_test_locker_wait(&locker, REGION_LOCKS_TEST_BLOCKED_MS);
+
+    uvm_mutex_unlock(&va_block->lock);
+
+    nv_kthread_q_flush(q);
+
+    TEST_CHECK_RET(!locked);
+    TEST_CHECK_RET(atomic_read(&locker.locked));
+
+    return NV_OK;
+}
+
+static NV_STATUS test_region_locks(uvm_va_block_t *va_block)
+{
+    NV_STATUS status = NV_OK;
+    nv_kthread_q_t q;
+    uvm_page_index_t num_pages = uvm_va_block_num_cpu_pages(va_block);
+    uvm_page_index_t split;
+    NvU32 first_bits;
+    NvU32 all_bits;
+
+    TEST_NV_CHECK_RET(test_region_lock_bits(va_block));
+
+    if (nv_kthread_q_init(&q, "uvm_region_locks_test") != 0)
+        return NV_ERR_NO_MEMORY;
+
+    // Split the block at the first big page boundary, if there is one
+    first_bits = block_region_lock_bits(va_block, uvm_va_block_region(0, 1));
+    for (split = 1; split < num_pages; ++split) {
+        if (block_region_lock_bits(va_block, uvm_va_block_region(split, split + 1)) != first_bits)
+            break;
+    }
+
+    first_bits = block_region_lock_bits(va_block, uvm_va_block_region(0, split));
+    all_bits = block_region_lock_bits(va_block, uvm_va_block_region_from_block(va_block));
+
+    // Overlapping regions exclude each other
+    TEST_NV_CHECK_GOTO(test_region_lock_held(&q, va_block, first_bits, first_bits, true), out);
+    TEST_NV_CHECK_GOTO(test_region_lock_held(&q, va_block, first_bits, all_bits, true), out);
+
+    // Holders of disjoint regions run concurrently
+    if (split < num_pages) {
+        NvU32 rest_bits = block_region_lock_bits(va_block, uvm_va_block_region(split, num_pages));
+
+        TEST_CHECK_GOTO((first_bits & rest_bits) == 0, out);
+        TEST_NV_CHECK_GOTO(test_region_lock_held(&q, va_block, first_bits, rest_bits, false), out);
+        TEST_NV_CHECK_GOTO(test_region_lock_held(&q, va_block, rest_bits, first_bits, false), out);
+    }
+
+    // Region locks and the whole block lock exclude each other
+    TEST_NV_CHECK_GOTO(test_region_lock_held(&q, va_block, first_bits, 0, true), out);
+    TEST_NV_CHECK_GOTO(test_block_lock_held(&q, va_block, first_bits), out);
+    TEST_NV_CHECK_GOTO(test_block_lock_held(&q, va_block, all_bits), out);
+
+out:
+    nv_kthread_q_stop(&q);
+
+    return status;
+}
+
+NV_STATUS uvm_test_va_block_region_locks(UVM_TEST_VA_BLOCK_REGION_LOCKS_PARAMS *params, struct file *filp)
+{
+    uvm_va_space_t *va_space = uvm_va_space_get(filp);
+    struct mm_struct *mm;
+    uvm_va_block_t *va_block;
+    NV_STATUS status;
+
+    mm = uvm_va_space_mm_retain_lock(va_space);
+    uvm_va_space_down_read(va_space);
+
+    status = uvm_va_block_find_create(va_space, mm, params->lookup_address, &va_block);
+    if (status == NV_OK)
+        status = test_region_locks(va_block);
+
+    uvm_va_space_up_read(va_space);
+    uvm_va_space_mm_release_unlock(va_space, mm);
+
+    return status;
+}
+
+NV_STATUS uvm_test_va_block_context_arena_info(UVM_TEST_VA_BLOCK_CONTEXT_ARENA_INFO_PARAMS *params,
+                                               struct file *filp)
+{
+    spin_lock(&g_va_block_context_arena_pool.lock);
+    params->num_free_arenas = g_va_block_context_arena_pool.num_free_arenas;
+    spin_unlock(&g_va_block_context_arena_pool.lock);
+
+    params->num_arenas = atomic64_read(&g_va_block_context_arena_pool.num_arenas);
+    params->hits = atomic64_read(&g_va_block_context_arena_pool.hits);
+    params->misses = atomic64_read(&g_va_block_context_arena_pool.misses);
+
+    return NV_OK;
+}
+
+NV_STATUS uvm_test_va_block_metadata_info(UVM_TEST_VA_BLOCK_METADATA_INFO_PARAMS *params, struct file *filp)
+{
+    uvm_va_space_t *va_space = uvm_va_space_get(filp);
+    uvm_va_range_t *va_range;
+    uvm_va_block_t *va_block;
+    uvm_gpu_t *gpu;
+    NvU64 end;
+    NV_STATUS status = NV_OK;
+
+    if (params->length == 0 || params->lookup_address + params->length - 1 < params->lookup_address)
+        return NV_ERR_INVALID_ARGUMENT;
+
+    end = params->lookup_address + params->length - 1;
+
+    params->num_blocks = 0;
+    params->num_gpu_states = 0;
+    params->num_full_dma_tables = 0;
+    params->gpu_state_bytes = 0;
+    params->chunks_bytes = 0;
+    params->dma_addrs_bytes = 0;
+
+    uvm_va_space_down_read(va_space);
+
+    gpu = uvm_va_space_get_gpu_by_uuid(va_space, &params->gpu_uuid);
+    if (!gpu) {
+        status = NV_ERR_INVALID_DEVICE;
+        goto out;
+    }
+
+    uvm_for_each_va_range_in(va_range, va_space, params->lookup_address, end) {
+        if (va_range->type != UVM_VA_RANGE_TYPE_MANAGED)
+            continue;
+
+        for_each_va_block_in_va_range(va_range, va_block) {
+            uvm_va_block_gpu_state_t *gpu_state;
+
+            if (va_block->end < params->lookup_address || va_block->start > end)
+                continue;
+
+            ++params->num_blocks;
+
+            uvm_va_block_lock(va_block);
+
+            gpu_state = uvm_va_block_gpu_state_get(va_block, gpu->id);
+            if (gpu_state) {
+                size_t dma_addrs_size = uvm_cpu_dma_addrs_allocated_size(&gpu_state->cpu_chunks_dma_addrs,
+                                                                         uvm_va_block_num_cpu_pages(va_block));
+
+                ++params->num_gpu_states;
+                if (dma_addrs_size)
+                    ++params->num_full_dma_tables;
+
+                params->gpu_state_bytes += sizeof(*gpu_state);
+                params->chunks_bytes += block_num_gpu_chunks(va_block, gpu) * sizeof(gpu_state->chunks[0]);
+                params->dma_addrs_bytes += dma_addrs_size;
+            }
+
+            uvm_va_block_unlock(va_block);
+        }
+    }
+
+out:
+    uvm_va_space_up_read(va_space);
+    return status;
+}
+
 NV_STATUS uvm_test_va_residency_info(UVM_TEST_VA_RESIDENCY_INFO_PARAMS *params, struct file *filp)
 {
     NV_STATUS status = NV_OK;
@@ -10289,7 +11343,7 @@ NV_STATUS uvm_test_va_residency_info(UVM_TEST_VA_RESIDENCY_INFO_PARAMS *params,
         goto out;
     }
 
-    uvm_mutex_lock(&block->lock);
+    uvm_va_block_lock(block);
 
     page_index = uvm_va_block_cpu_page_index(block, addr);
     uvm_va_block_page_resident_processors(block, page_index, &resident_on_mask);
@@ -10407,7 +11461,7 @@ out:
     if (block) {
         if (!params->is_async && status == NV_OK)
             status = uvm_tracker_wait(&block->tracker);
-        uvm_mutex_unlock(&block->lock);
+        uvm_va_block_unlock(block);
         while (release_block_count--)
             uvm_va_block_release(block);
     }
@@ -38,6 +38,7 @@
 #include "uvm_perf_thrashing.h"
 #include "uvm_perf_utils.h"
 #include "uvm_va_block_types.h"
+#include "uvm_pmm_sysmem.h"
 #include "uvm_mmu.h"
 #include "nv-kthread-q.h"
 
@@ -107,7 +108,9 @@ typedef struct
     // Pages that have been evicted to sysmem
     uvm_page_mask_t evicted;
 
-    NvU64 *cpu_chunks_dma_addrs;
+    // DMA addresses of the CPU pages of the block mapped on this GPU. See
+    // uvm_cpu_chunk_set_gpu_mapping_addr().
+    uvm_cpu_dma_addrs_t cpu_chunks_dma_addrs;
 
     // Array of naturally-aligned chunks. Each chunk has the largest possible
     // size which can fit within the block, so they are not uniform size.
@@ -225,6 +228,25 @@ typedef struct
 
 } uvm_va_block_gpu_state_t;
 
+// Sub-block region locks of a VA block. See uvm_va_block_lock_region().
+typedef struct
+{
+    // Protects locked
+    uvm_spinlock_t lock;
+
+    // Bit i is set while the i-th UVM_MIN_BIG_PAGE_SIZE region of the 2MB VA
+    // window containing the block is locked.
+    NvU32 locked;
+
+    // Threads waiting for locked regions to be unlocked, either to lock an
+    // overlapping region or to take the block lock.
+    wait_queue_head_t wait_queue;
+
+#if UVM_IS_DEBUG()
+    uvm_lock_order_t lock_order;
+#endif
+} uvm_va_block_region_locks_t;
+
 // TODO: Bug 1766180: Worst-case we could have one of these per system page.
 //       Options:
 //       1) Rely on the OOM killer to prevent the user from trying to do that
@@ -244,8 +266,16 @@ struct uvm_va_block_struct
     nv_kref_t kref;
 
     // Lock protecting the block. See the comment at the top of uvm.c.
+    //
+    // Use uvm_va_block_lock() and uvm_va_block_unlock() to take and release
+    // the lock, so that holders of region locks are drained.
     uvm_mutex_t lock;
 
+    // Locks on big-page regions of the block, held instead of the block lock
+    // by operations which only need a part of the block. See
+    // uvm_va_block_lock_region().
+    uvm_va_block_region_locks_t region_locks;
+
     // Parent VA range. UVM managed blocks have this set. HMM blocks will have
     // va_range set to NULL and hmm.va_space set instead. Dead blocks that are
     // waiting for the last ref count to be removed have va_range and
@@ -552,6 +582,41 @@ static inline void uvm_va_block_release(uvm_va_block_t *va_block)
     }
 }
 
+// Take and release the VA block lock. Besides the block's mutex, the lock
+// waits for any region locks on the block to be released, so the holder has
+// exclusive access to the whole block. New region locks cannot be taken while
+// the block lock is held.
+void uvm_va_block_lock(uvm_va_block_t *va_block);
+void uvm_va_block_unlock(uvm_va_block_t *va_block);
+
+// Whether sub-block region locking is enabled, which is controlled by the
+// uvm_va_block_region_locking module parameter.
+bool uvm_va_block_region_locking_enabled(void);
+
+// Lock the part of the block covering the given page region. The lock is taken
+// on all the UVM_MIN_BIG_PAGE_SIZE-aligned regions of the VA space that
+// overlap the page region, so threads locking non-overlapping big-page
+// regions of the same block can run concurrently. Region locks exclude the
+// block lock.
+//
+// A region lock only allows reading the block state and updating state owned
+// by the caller, and must not be used for anything that changes the block
+// state: residency, mappings, chunk allocation, PTE sizes, splits... Those
+// require the block lock.
+//
+// The block lock must not be taken while holding a region lock of the same
+// block, and only one region of a block can be locked by a thread at a time.
+//
+// If region locking is disabled, this takes the block lock instead.
+//
+// LOCKING: The caller must hold the VA space lock. The VA block lock must not
+//          be held.
+void uvm_va_block_lock_region(uvm_va_block_t *va_block, uvm_va_block_region_t region);
+
+// Release a region lock taken with uvm_va_block_lock_region(). The region must
+// be the same one that was locked.
+void uvm_va_block_unlock_region(uvm_va_block_t *va_block, uvm_va_block_region_t region);
+
 // Same as uvm_va_block_release but the caller may be holding the VA block lock.
 // The caller must ensure that the refcount will not get to zero in this call.
 static inline void uvm_va_block_release_no_destroy(uvm_va_block_t *va_block)
@@ -595,12 +660,34 @@ uvm_va_space_t *uvm_va_block_get_va_space_maybe_dead(uvm_va_block_t *va_block);
 // is held in write mode.
 uvm_va_space_t *uvm_va_block_get_va_space(uvm_va_block_t *va_block);
 
-// Dynamic cache-based allocation for uvm_va_block_context_t.
+// Dynamic allocation for uvm_va_block_context_t.
+//
+// Contexts are taken from the VA block context arena of the current thread
+// when possible. The arena is attached to the thread context on first use and
+// goes back to a global pool when the thread context is removed, so once the
+// pool has grown to the number of threads concurrently operating on VA blocks
+// there are no more heap allocations. The allocation falls back to a
+// kmem_cache in interrupt paths, without a thread context, or when all of the
+// arena's contexts are in use by the thread.
 //
 // See uvm_va_block_context_init() for a description of the mm parameter.
 uvm_va_block_context_t *uvm_va_block_context_alloc(struct mm_struct *mm);
 void uvm_va_block_context_free(uvm_va_block_context_t *va_block_context);
 
+// Take the service block context of the current thread's VA block context
+// arena. Returns NULL if it is not available, in which case the caller has to
+// get one elsewhere.
+uvm_service_block_context_t *uvm_va_block_service_context_get(void);
+
+// Return a service block context to the current thread's arena. Returns false,
+// without doing anything, if the context was not obtained from
+// uvm_va_block_service_context_get().
+bool uvm_va_block_service_context_put(uvm_service_block_context_t *service_context);
+
+// Return an arena to the global pool. All of its entries must have been freed.
+// Called when the owning thread context is removed. arena may be NULL.
+void uvm_va_block_context_arena_put(uvm_va_block_context_arena_t *arena);
+
 // Initialization of an already-allocated uvm_va_block_context_t.
 //
 // mm is used to initialize the value of va_block_context->mm. NULL is allowed.
@@ -617,6 +704,7 @@ static void uvm_va_block_context_init(uvm_va_block_context_t *va_block_context,
         uvm_assert_mmap_lock_locked(mm);
 
     va_block_context->mm = mm;
+    va_block_context->mapping.defer_tlb_invalidates = false;
 }
 
 // TODO: Bug 1766480: Using only page masks instead of a combination of regions
@@ -1019,6 +1107,19 @@ void uvm_va_block_unregister_gpu(uvm_va_block_t *va_block, uvm_gpu_t *gpu, struc
 // This performs a uvm_va_block_release.
 void uvm_va_block_kill(uvm_va_block_t *va_block);
 
+// Kill all the blocks in the array, which must belong to the same VA space,
+// as if by uvm_va_block_kill().
+//
+// Killing a block unmaps it, frees its page tables and memory and waits for
+// the GPU work doing so, which adds up when tearing down large VA ranges. If
+// there are enough blocks, they are killed in parallel by the VA block
+// teardown threads (see the uvm_va_block_teardown_threads module parameter)
+// and the calling thread, which returns once all of them are done.
+//
+// LOCKING: The caller must hold the VA space lock in write mode, and no VA
+//          block lock.
+void uvm_va_block_kill_all(uvm_va_block_t **blocks, size_t num_blocks);
+
 // Exactly the same split semantics as uvm_va_range_split, including error
 // handling. See that function's comments for details.
 //
@@ -1160,6 +1261,15 @@ NV_STATUS uvm_va_block_find_create(uvm_va_space_t *va_space,
                                    NvU64 addr,
                                    uvm_va_block_t **out_block);
 
+// Same as uvm_va_block_find_create except that va_range has already been
+// looked up by the caller, for example with uvm_va_range_find_batch(). It is
+// NULL if addr is not covered by a va_range.
+NV_STATUS uvm_va_block_find_create_in_range(uvm_va_space_t *va_space,
+                                            uvm_va_range_t *va_range,
+                                            struct mm_struct *mm,
+                                            NvU64 addr,
+                                            uvm_va_block_t **out_block);
+
 // Look up a chunk backing a specific address within the VA block. Returns NULL if none.
 uvm_gpu_chunk_t *uvm_va_block_lookup_gpu_chunk(uvm_va_block_t *va_block, uvm_gpu_t *gpu, NvU64 address);
 
@@ -1232,6 +1342,7 @@ NV_STATUS uvm_va_block_evict_chunks(uvm_va_block_t *va_block,
 NV_STATUS uvm_test_va_block_inject_error(UVM_TEST_VA_BLOCK_INJECT_ERROR_PARAMS *params, struct file *filp);
 NV_STATUS uvm_test_change_pte_mapping(UVM_TEST_CHANGE_PTE_MAPPING_PARAMS *params, struct file *filp);
 NV_STATUS uvm_test_va_block_info(UVM_TEST_VA_BLOCK_INFO_PARAMS *params, struct file *filp);
+NV_STATUS uvm_test_va_block_region_locks(UVM_TEST_VA_BLOCK_REGION_LOCKS_PARAMS *params, struct file *filp);
 NV_STATUS uvm_test_va_residency_info(UVM_TEST_VA_RESIDENCY_INFO_PARAMS *params, struct file *filp);
 
 // Compute the offset in system pages of addr from the start of va_block.
@@ -1472,17 +1583,129 @@ static bool uvm_page_mask_subset(const uvm_page_mask_t *subset, const uvm_page_m
     return bitmap_subset(subset->bitmap, mask->bitmap, PAGES_PER_UVM_VA_BLOCK);
 }
 
+// Fused page mask operations
+//
+// Each of the two-operand helpers above makes a full pass over its masks, so
+// chaining them to evaluate an expression over several masks (residency,
+// mappings, read duplication...) walks the page masks once per operation. The
+// helpers below evaluate the whole expression in a single word-wide pass
+// instead. The region variants only read the words that overlap the region, and
+// just clear the rest of the output mask.
+//
+// NULL input masks are ignored, i.e. they behave as a full mask in the AND
+// terms and as an empty mask in the OR and AND NOT terms. The output mask may
+// alias any of the input masks.
+
+// mask_out = region & (mask_in | or_mask) & and_mask & ~andnot_mask
+//
+// Returns whether mask_out is not empty.
+static bool uvm_page_mask_region_fused(uvm_page_mask_t *mask_out,
+                                       uvm_va_block_region_t region,
+                                       const uvm_page_mask_t *mask_in,
+                                       const uvm_page_mask_t *or_mask,
+                                       const uvm_page_mask_t *and_mask,
+                                       const uvm_page_mask_t *andnot_mask)
+{
+    const size_t first_word = BIT_WORD(region.first);
+    const size_t outer_word = BITS_TO_LONGS(region.outer);
+    unsigned long not_empty = 0;
+    size_t i;
+
+    UVM_ASSERT(region.first <= region.outer);
+    UVM_ASSERT(region.outer <= PAGES_PER_UVM_VA_BLOCK);
+
+    for (i = 0; i < first_word; ++i)
+        mask_out->bitmap[i] = 0;
+
+    for (i = first_word; i < outer_word; ++i) {
+        unsigned long word = mask_in ? mask_in->bitmap[i] : ~0UL;
+
+        if (or_mask)
+            word |= or_mask->bitmap[i];
+        if (and_mask)
+            word &= and_mask->bitmap[i];
+        if (andnot_mask)
+            word &= ~andnot_mask->bitmap[i];
+
+        if (i == first_word)
+            word &= BITMAP_FIRST_WORD_MASK(region.first);
+        if (i == outer_word - 1)
+            word &= BITMAP_LAST_WORD_MASK(region.outer);
+
+        mask_out->bitmap[i] = word;
+        not_empty |= word;
+    }
+
+    for (i = outer_word; i < BITS_TO_LONGS(PAGES_PER_UVM_VA_BLOCK); ++i)
+        mask_out->bitmap[i] = 0;
+
+    return not_empty != 0;
+}
+
+// mask_out = (mask_in | or_mask) & and_mask & ~andnot_mask
+//
+// Returns whether mask_out is not empty.
+static bool uvm_page_mask_fused(uvm_page_mask_t *mask_out,
+                                const uvm_page_mask_t *mask_in,
+                                const uvm_page_mask_t *or_mask,
+                                const uvm_page_mask_t *and_mask,
+                                const uvm_page_mask_t *andnot_mask)
+{
+    return uvm_page_mask_region_fused(mask_out,
+                                      uvm_va_block_region(0, PAGES_PER_UVM_VA_BLOCK),
+                                      mask_in,
+                                      or_mask,
+                                      and_mask,
+                                      andnot_mask);
+}
+
+// Returns whether region & (mask_in | or_mask) & and_mask & ~andnot_mask is
+// not empty, without computing it. The evaluation stops at the first word with
+// a page set.
+static bool uvm_page_mask_region_fused_test(uvm_va_block_region_t region,
+                                            const uvm_page_mask_t *mask_in,
+                                            const uvm_page_mask_t *or_mask,
+                                            const uvm_page_mask_t *and_mask,
+                                            const uvm_page_mask_t *andnot_mask)
+{
+    const size_t first_word = BIT_WORD(region.first);
+    const size_t outer_word = BITS_TO_LONGS(region.outer);
+    size_t i;
+
+    UVM_ASSERT(region.first <= region.outer);
+    UVM_ASSERT(region.outer <= PAGES_PER_UVM_VA_BLOCK);
+
+    for (i = first_word; i < outer_word; ++i) {
+        unsigned long word = mask_in ? mask_in->bitmap[i] : ~0UL;
+
+        if (or_mask)
+            word |= or_mask->bitmap[i];
+        if (and_mask)
+            word &= and_mask->bitmap[i];
+        if (andnot_mask)
+            word &= ~andnot_mask->bitmap[i];
+
+        if (i == first_word)
+            word &= BITMAP_FIRST_WORD_MASK(region.first);
+        if (i == outer_word - 1)
+            word &= BITMAP_LAST_WORD_MASK(region.outer);
+
+        if (word)
+            return true;
+    }
+
+    return false;
+}
+
 static bool uvm_page_mask_init_from_region(uvm_page_mask_t *mask_out,
                                            uvm_va_block_region_t region,
                                            const uvm_page_mask_t *mask_in)
 {
-    uvm_page_mask_zero(mask_out);
-    uvm_page_mask_region_fill(mask_out, region);
-
-    if (mask_in)
-        return uvm_page_mask_and(mask_out, mask_out, mask_in);
+    bool not_empty = uvm_page_mask_region_fused(mask_out, region, mask_in, NULL, NULL, NULL);
 
-    return true;
+    // Without an input mask the whole region is filled, which is reported as
+    // success even if the region is empty
+    return not_empty || !mask_in;
 }
 
 static void uvm_page_mask_shift_right(uvm_page_mask_t *mask_out, const uvm_page_mask_t *mask_in, unsigned shift)
@@ -1883,13 +2106,13 @@ uvm_prot_t uvm_va_block_page_compute_highest_permission(uvm_va_block_t *va_block
                                                                     \
     uvm_va_block_retry_init(__retry);                               \
                                                                     \
-    uvm_mutex_lock(&__block->lock);                                 \
+    uvm_va_block_lock(__block);                                     \
                                                                     \
     do {                                                            \
         status = (call);                                            \
     } while (status == NV_ERR_MORE_PROCESSING_REQUIRED);            \
                                                                     \
-    uvm_mutex_unlock(&__block->lock);                               \
+    uvm_va_block_unlock(__block);                                   \
                                                                     \
     uvm_va_block_retry_deinit(__retry, __block);                    \
                                                                     \
@@ -25,6 +25,8 @@
 #include "uvm_linux.h"
 #include "uvm_test.h"
 #include "uvm_test_ioctl.h"
+#include "uvm_test_rng.h"
+#include "uvm_kvmalloc.h"
 #include "uvm_va_block.h"
 #include "uvm_va_space.h"
 #include "uvm_mmu.h"
@@ -95,12 +97,315 @@ static NV_STATUS test_chunk_index(uvm_gpu_t *gpu)
     return NV_OK;
 }
 
+// Operands of the fused page mask tests and benchmark
+typedef struct
+{
+    uvm_page_mask_t in;
+    uvm_page_mask_t or_mask;
+    uvm_page_mask_t and_mask;
+    uvm_page_mask_t andnot_mask;
+    uvm_page_mask_t expected;
+    uvm_page_mask_t result;
+    uvm_page_mask_t scratch;
+} page_mask_operands_t;
+
+#define PAGE_MASK_TEST_ITERATIONS 2000
+#define PAGE_MASK_BENCHMARK_REGIONS 64
+
+static bool page_mask_equal(const uvm_page_mask_t *mask1, const uvm_page_mask_t *mask2)
+{
+    return bitmap_equal(mask1->bitmap, mask2->bitmap, PAGES_PER_UVM_VA_BLOCK) != 0;
+}
+
+static uvm_va_block_region_t page_mask_random_region(uvm_test_rng_t *rng)
+{
+    NvU32 first = uvm_test_rng_range_32(rng, 0, PAGES_PER_UVM_VA_BLOCK);
+    NvU32 outer = uvm_test_rng_range_32(rng, first, PAGES_PER_UVM_VA_BLOCK);
+
+    return uvm_va_block_region(first, outer);
+}
+
+// Reference evaluation of the fused expression with the single operation
+// helpers:
+// expected = region & (in | or_mask) & and_mask & ~andnot_mask
+static bool page_mask_chained(uvm_page_mask_t *expected,
+                              uvm_page_mask_t *scratch,
+                              uvm_va_block_region_t region,
+                              const uvm_page_mask_t *in,
+                              const uvm_page_mask_t *or_mask,
+                              const uvm_page_mask_t *and_mask,
+                              const uvm_page_mask_t *andnot_mask)
+{
+    uvm_page_mask_zero(expected);
+    uvm_page_mask_region_fill(expected, region);
+
+    // Without an input mask, (in | or_mask) is a full mask
+    if (in) {
+        if (or_mask) {
+            uvm_page_mask_or(scratch, in, or_mask);
+            uvm_page_mask_and(expected, expected, scratch);
+        }
+        else {
+            uvm_page_mask_and(expected, expected, in);
+        }
+    }
+
+    if (and_mask)
+        uvm_page_mask_and(expected, expected, and_mask);
+
+    if (andnot_mask)
+        uvm_page_mask_andnot(expected, expected, andnot_mask);
+
+    return !uvm_page_mask_empty(expected);
+}
+
+static NV_STATUS test_page_mask_fused(void)
+{
+    page_mask_operands_t *ops;
+    uvm_test_rng_t rng;
+    NV_STATUS status = NV_OK;
+    unsigned i;
+
+    ops = uvm_kvmalloc(sizeof(*ops));
+    if (!ops)
+        return NV_ERR_NO_MEMORY;
+
+    uvm_test_rng_init(&rng, 0);
+
+    for (i = 0; i < PAGE_MASK_TEST_ITERATIONS; ++i) {
+        uvm_va_block_region_t region = page_mask_random_region(&rng);
+        NvU32 operands = uvm_test_rng_32(&rng);
+        const uvm_page_mask_t *in = (operands & 1) ? &ops->in : NULL;
+        const uvm_page_mask_t *or_mask = (operands & 2) ? &ops->or_mask : NULL;
+        const uvm_page_mask_t *and_mask = (operands & 4) ? &ops->and_mask : NULL;
+        const uvm_page_mask_t *andnot_mask = (operands & 8) ? &ops->andnot_mask : NULL;
+        bool expected_not_empty;
+
+        uvm_test_rng_memset(&rng, &ops->in, sizeof(ops->in));
+        uvm_test_rng_memset(&rng, &ops->or_mask, sizeof(ops->or_mask));
+        uvm_test_rng_memset(&rng, &ops->and_mask, sizeof(ops->and_mask));
+        uvm_test_rng_memset(&rng, &ops->andnot_mask, sizeof(ops->andnot_mask));
+
+        // Sparse masks make empty results likely, which exercises the return
+        // values and the early exit
+        if (operands & 16)
+            uvm_page_mask_and(&ops->in, &ops->in, &ops->or_mask);
+
+        // Garbage in the output mask must be overwritten
+        uvm_test_rng_memset(&rng, &ops->result, sizeof(ops->result));
+
+        expected_not_empty = page_mask_chained(&ops->expected,
+                                               &ops->scratch,
+                                               region,
+                                               in,
+                                               or_mask,
+                                               and_mask,
+                                               andnot_mask);
+
+        TEST_CHECK_GOTO(uvm_page_mask_region_fused(&ops->result, region, in, or_mask, and_mask, andnot_mask) ==
+                        expected_not_empty, done);
+        TEST_CHECK_GOTO(page_mask_equal(&ops->result, &ops->expected), done);
+        TEST_CHECK_GOTO(uvm_page_mask_region_fused_test(region, in, or_mask, and_mask, andnot_mask) ==
+                        expected_not_empty, done);
+
+        // Full region
+        expected_not_empty = page_mask_chained(&ops->expected,
+                                               &ops->scratch,
+                                               uvm_va_block_region(0, PAGES_PER_UVM_VA_BLOCK),
+                                               in,
+                                               or_mask,
+                                               and_mask,
+                                               andnot_mask);
+        TEST_CHECK_GOTO(uvm_page_mask_fused(&ops->result, in, or_mask, and_mask, andnot_mask) == expected_not_empty, done);
+        TEST_CHECK_GOTO(page_mask_equal(&ops->result, &ops->expected), done);
+
+        // The output may alias an input
+        if (and_mask) {
+            TEST_CHECK_GOTO(uvm_page_mask_fused(&ops->and_mask, in, or_mask, and_mask, andnot_mask) ==
+                            expected_not_empty, done);
+            TEST_CHECK_GOTO(page_mask_equal(&ops->and_mask, &ops->expected), done);
+        }
+
+        // init_from_region is a fused operation with a single operand
+        expected_not_empty = page_mask_chained(&ops->expected, &ops->scratch, region, in, NULL, NULL, NULL);
+        TEST_CHECK_GOTO(uvm_page_mask_init_from_region(&ops->result, region, in) == (expected_not_empty || !in), done);
+        TEST_CHECK_GOTO(page_mask_equal(&ops->result, &ops->expected), done);
+    }
+
+done:
+    uvm_kvfree(ops);
+    return status;
+}
+
+NV_STATUS uvm_test_page_mask_benchmark(UVM_TEST_PAGE_MASK_BENCHMARK_PARAMS *params, struct file *filp)
+{
+    page_mask_operands_t *ops;
+    uvm_va_block_region_t *regions;
+    uvm_test_rng_t rng;
+    NvU64 start;
+    NvU64 chained_pages = 0;
+    NvU64 fused_pages = 0;
+    NV_STATUS status = NV_OK;
+    NvU32 i;
+
+    if (params->iterations == 0)
+        return NV_ERR_INVALID_ARGUMENT;
+
+    ops = uvm_kvmalloc(sizeof(*ops));
+    regions = uvm_kvmalloc(sizeof(*regions) * PAGE_MASK_BENCHMARK_REGIONS);
+    if (!ops || !regions) {
+        status = NV_ERR_NO_MEMORY;
+        goto done;
+    }
+
+    uvm_test_rng_init(&rng, params->seed);
+
+    uvm_test_rng_memset(&rng, &ops->in, sizeof(ops->in));
+    uvm_test_rng_memset(&rng, &ops->or_mask, sizeof(ops->or_mask));
+    uvm_test_rng_memset(&rng, &ops->and_mask, sizeof(ops->and_mask));
+    uvm_test_rng_memset(&rng, &ops->andnot_mask, sizeof(ops->andnot_mask));
+
+    for (i = 0; i < PAGE_MASK_BENCHMARK_REGIONS; ++i)
+        regions[i] = page_mask_random_region(&rng);
+
+    // The page counts of the results are accumulated and compared at the end,
+    // which also keeps the compiler from discarding any of the evaluations.
+
+    // UvmTestPageMaskExprRegionAndAndnot
+    start = NV_GETTIME();
+    for (i = 0; i < params->iterations; ++i) {
+        uvm_va_block_region_t region = regions[i % PAGE_MASK_BENCHMARK_REGIONS];
+
+        uvm_page_mask_init_from_region(&ops->expected, region, &ops->in);
+        uvm_page_mask_and(&ops->expected, &ops->expected, &ops->and_mask);
+        uvm_page_mask_andnot(&ops->expected, &ops->expected, &ops->andnot_mask);
+        chained_pages += uvm_page_mask_weight(&ops->expected);
+    }
+    params->chained_ns[UvmTestPageMaskExprRegionAndAndnot] = NV_GETTIME() - start;
+
+    start = NV_GETTIME();
+    for (i = 0; i < params->iterations; ++i) {
+        uvm_va_block_region_t region = regions[i % PAGE_MASK_BENCHMARK_REGIONS];
+
+        uvm_page_mask_region_fused(&ops->result, region, &ops->in, NULL, &ops->and_mask, &ops->andnot_mask);
+        fused_pages += uvm_page_mask_weight(&ops->result);
+    }
+    params->fused_ns[UvmTestPageMaskExprRegionAndAndnot] = NV_GETTIME() - start;
+
+    // UvmTestPageMaskExprOrAndAndnot
+    start = NV_GETTIME();
+    for (i = 0; i < params->iterations; ++i) {
+        uvm_page_mask_or(&ops->expected, &ops->in, &ops->or_mask);
+        uvm_page_mask_and(&ops->expected, &ops->expected, &ops->and_mask);
+        uvm_page_mask_andnot(&ops->expected, &ops->expected, &ops->andnot_mask);
+        chained_pages += uvm_page_mask_weight(&ops->expected);
+    }
+    params->chained_ns[UvmTestPageMaskExprOrAndAndnot] = NV_GETTIME() - start;
+
+    start = NV_GETTIME();
+    for (i = 0; i < params->iterations; ++i) {
+        uvm_page_mask_fused(&ops->result, &ops->in, &ops->or_mask, &ops->and_mask, &ops->andnot_mask);
+        fused_pages += uvm_page_mask_weight(&ops->result);
+    }
+    params->fused_ns[UvmTestPageMaskExprOrAndAndnot] = NV_GETTIME() - start;
+
+    // UvmTestPageMaskExprRegionTest
+    start = NV_GETTIME();
+    for (i = 0; i < params->iterations; ++i) {
+        uvm_va_block_region_t region = regions[i % PAGE_MASK_BENCHMARK_REGIONS];
+
+        uvm_page_mask_init_from_region(&ops->expected, region, &ops->in);
+        chained_pages += uvm_page_mask_andnot(&ops->expected, &ops->expected, &ops->andnot_mask);
+    }
+    params->chained_ns[UvmTestPageMaskExprRegionTest] = NV_GETTIME() - start;
+
+    start = NV_GETTIME();
+    for (i = 0; i < params->iterations; ++i) {
+        uvm_va_block_region_t region = regions[i % PAGE_MASK_BENCHMARK_REGIONS];
+
+        fused_pages += uvm_page_mask_region_fused_test(region, &ops->in, NULL, NULL, &ops->andnot_mask);
+    }
+    params->fused_ns[UvmTestPageMaskExprRegionTest] = NV_GETTIME() - start;
+
+    if (chained_pages != fused_pages) {
+        UVM_TEST_PRINT("Fused page mask results differ: %llu pages chained, %llu pages fused\n",
+                       chained_pages,
+                       fused_pages);
+        status = NV_ERR_INVALID_STATE;
+    }
+
+done:
+    uvm_kvfree(regions);
+    uvm_kvfree(ops);
+    return status;
+}
+
+static NV_STATUS test_va_block_context_arena(void)
+{
+    UVM_TEST_VA_BLOCK_CONTEXT_ARENA_INFO_PARAMS before, after;
+    uvm_va_block_context_t *block_contexts[4] = {0};
+    uvm_va_block_context_t *block_context;
+    uvm_service_block_context_t *service_context;
+    NV_STATUS status = NV_OK;
+    size_t i;
+
+    // The first allocation attaches an arena to the thread context
+    block_context = uvm_va_block_context_alloc(NULL);
+    TEST_CHECK_RET(block_context);
+    uvm_va_block_context_free(block_context);
+
+    TEST_NV_CHECK_RET(uvm_test_va_block_context_arena_info(&before, NULL));
+
+    // Back-to-back allocations reuse the same context of the arena
+    for (i = 0; i < 100; i++) {
+        uvm_va_block_context_t *other = uvm_va_block_context_alloc(NULL);
+
+        TEST_CHECK_RET(other == block_context);
+        uvm_va_block_context_free(other);
+    }
+
+    TEST_NV_CHECK_RET(uvm_test_va_block_context_arena_info(&after, NULL));
+
+    // Other threads may update the counters concurrently, so only a lower
+    // bound can be checked
+    TEST_CHECK_RET(after.hits - before.hits >= 100);
+
+    // Nested allocations get distinct contexts, falling back to the heap once
+    // the arena is exhausted
+    for (i = 0; i < ARRAY_SIZE(block_contexts); i++) {
+        size_t j;
+
+        block_contexts[i] = uvm_va_block_context_alloc(NULL);
+        TEST_CHECK_GOTO(block_contexts[i], done);
+
+        for (j = 0; j < i; j++)
+            TEST_CHECK_GOTO(block_contexts[i] != block_contexts[j], done);
+    }
+
+    // The arena has a single service context
+    service_context = uvm_va_block_service_context_get();
+    TEST_CHECK_GOTO(service_context, done);
+    TEST_CHECK_GOTO(!uvm_va_block_service_context_get(), done);
+    TEST_CHECK_GOTO(uvm_va_block_service_context_put(service_context), done);
+    TEST_CHECK_GOTO(uvm_va_block_service_context_get() == service_context, done);
+    TEST_CHECK_GOTO(uvm_va_block_service_context_put(service_context), done);
+
+done:
+    for (i = ARRAY_SIZE(block_contexts); i > 0; i--)
+        uvm_va_block_context_free(block_contexts[i - 1]);
+
+    return status;
+}
+
 NV_STATUS uvm_test_va_block(UVM_TEST_VA_BLOCK_PARAMS *params, struct file *filp)
 {
     uvm_va_space_t *va_space = uvm_va_space_get(filp);
     uvm_gpu_t *gpu;
     NV_STATUS status = NV_OK;
 
+    TEST_NV_CHECK_RET(test_page_mask_fused());
+    TEST_NV_CHECK_RET(test_va_block_context_arena());
+
     uvm_va_space_down_read(va_space);
 
     for_each_va_space_gpu(gpu, va_space)
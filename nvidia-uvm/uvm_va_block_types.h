@@ -232,6 +232,18 @@ typedef struct
         uvm_pte_batch_t pte_batch;
         uvm_tlb_batch_t tlb_batch;
 
+        // Set by callers unmapping many blocks in a row to queue up the TLB
+        // invalidates of the unmaps in the GPU page trees instead of pushing
+        // one per block. The caller has to flush them with
+        // uvm_page_tree_flush_deferred_tlb_invalidates() and make the trackers
+        // of the unmapped blocks depend on the flush before dropping the VA
+        // space lock. Cleared by uvm_va_block_context_init().
+        bool defer_tlb_invalidates;
+
+        // Whether the unmap in progress left tlb_batch to be deferred once its
+        // push is ended
+        bool tlb_batch_deferred;
+
         // Event that triggered the call to the mapping function
         UvmEventMapRemoteCause cause;
     } mapping;
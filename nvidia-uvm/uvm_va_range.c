@@ -379,19 +379,45 @@ error:
     return status;
 }
 
-static void uvm_va_range_destroy_managed(uvm_va_range_t *va_range)
+// Unmap and drop our ref count on each block
+static void va_range_kill_blocks(uvm_va_range_t *va_range)
 {
     uvm_va_block_t *block;
     uvm_va_block_t *block_tmp;
+    uvm_va_block_t **blocks;
+    size_t num_blocks = 0;
+
+    for_each_va_block_in_va_range(va_range, block)
+        num_blocks++;
+
+    // Gather the blocks so they can be killed in parallel. If that fails,
+    // kill them one by one.
+    blocks = num_blocks > 1 ? uvm_kvmalloc(num_blocks * sizeof(blocks[0])) : NULL;
+    if (!blocks) {
+        for_each_va_block_in_va_range_safe(va_range, block, block_tmp)
+            uvm_va_block_kill(block);
+
+        return;
+    }
+
+    num_blocks = 0;
+    for_each_va_block_in_va_range(va_range, block)
+        blocks[num_blocks++] = block;
+
+    uvm_va_block_kill_all(blocks, num_blocks);
+
+    uvm_kvfree(blocks);
+}
+
+static void uvm_va_range_destroy_managed(uvm_va_range_t *va_range)
+{
     uvm_perf_event_data_t event_data;
     NV_STATUS status;
 
     UVM_ASSERT(va_range->type == UVM_VA_RANGE_TYPE_MANAGED);
 
     if (va_range->blocks) {
-        // Unmap and drop our ref count on each block
-        for_each_va_block_in_va_range_safe(va_range, block, block_tmp)
-            uvm_va_block_kill(block);
+        va_range_kill_blocks(va_range);
 
         uvm_kvfree(va_range->blocks);
     }
@@ -644,9 +670,9 @@ static void range_remove_gpu_va_space_managed(uvm_va_range_t *va_range,
                                    uvm_va_space_can_read_duplicate(va_space, gpu_va_space->gpu);
 
     for_each_va_block_in_va_range(va_range, va_block) {
-        uvm_mutex_lock(&va_block->lock);
+        uvm_va_block_lock(va_block);
         uvm_va_block_remove_gpu_va_space(va_block, gpu_va_space, mm);
-        uvm_mutex_unlock(&va_block->lock);
+        uvm_va_block_unlock(va_block);
 
         if (should_enable_read_duplicate)
             uvm_va_block_set_read_duplication(va_block, uvm_va_space_block_context(va_space, mm));
@@ -712,9 +738,9 @@ static NV_STATUS uvm_va_range_enable_peer_managed(uvm_va_range_t *va_range, uvm_
     for_each_va_block_in_va_range(va_range, va_block) {
         // TODO: Bug 1767224: Refactor the uvm_va_block_set_accessed_by logic
         //       into uvm_va_block_enable_peer.
-        uvm_mutex_lock(&va_block->lock);
+        uvm_va_block_lock(va_block);
         status = uvm_va_block_enable_peer(va_block, gpu0, gpu1);
-        uvm_mutex_unlock(&va_block->lock);
+        uvm_va_block_unlock(va_block);
 
         if (status != NV_OK)
             return status;
@@ -806,12 +832,12 @@ static void uvm_va_range_disable_peer_managed(uvm_va_range_t *va_range, uvm_gpu_
     }
 
     for_each_va_block_in_va_range(va_range, va_block) {
-        uvm_mutex_lock(&va_block->lock);
+        uvm_va_block_lock(va_block);
         if (uvm_lite_mode)
             uvm_va_block_unmap_preferred_location_uvm_lite(va_block, uvm_lite_gpu_to_unmap);
         else
             uvm_va_block_disable_peer(va_block, gpu0, gpu1);
-        uvm_mutex_unlock(&va_block->lock);
+        uvm_va_block_unlock(va_block);
     }
 
     if (uvm_lite_mode && !uvm_range_group_all_migratable(va_range->va_space, va_range->node.start, va_range->node.end)) {
@@ -1031,10 +1057,10 @@ static NV_STATUS uvm_va_range_split_blocks(uvm_va_range_t *existing, uvm_va_rang
 
         // As soon as we make this assignment and drop the lock, the reverse
         // mapping code can start looking at new, so new must be ready to go.
-        uvm_mutex_lock(&block->lock);
+        uvm_va_block_lock(block);
         UVM_ASSERT(block->va_range == existing);
         block->va_range = new;
-        uvm_mutex_unlock(&block->lock);
+        uvm_va_block_unlock(block);
 
         // No memory barrier is needed since we're holding the va_space lock in
         // write mode, so no other thread can access the blocks array.
@@ -1101,17 +1127,19 @@ error:
 
 }
 
-static inline uvm_va_range_t *uvm_va_range_container(uvm_range_tree_node_t *node)
+uvm_va_range_t *uvm_va_range_find(uvm_va_space_t *va_space, NvU64 addr)
 {
-    if (!node)
-        return NULL;
-    return container_of(node, uvm_va_range_t, node);
+    uvm_assert_rwsem_locked(&va_space->lock);
+    return uvm_va_range_container(uvm_range_tree_find(&va_space->va_range_tree, addr));
 }
 
-uvm_va_range_t *uvm_va_range_find(uvm_va_space_t *va_space, NvU64 addr)
+void uvm_va_range_find_batch(uvm_va_space_t *va_space,
+                             const NvU64 *addrs,
+                             size_t count,
+                             uvm_range_tree_node_t **nodes)
 {
     uvm_assert_rwsem_locked(&va_space->lock);
-    return uvm_va_range_container(uvm_range_tree_find(&va_space->va_range_tree, addr));
+    uvm_range_tree_find_batch(&va_space->va_range_tree, addrs, count, nodes);
 }
 
 uvm_va_range_t *uvm_va_space_iter_first(uvm_va_space_t *va_space, NvU64 start, NvU64 end)
@@ -1228,27 +1256,74 @@ static NV_STATUS range_unmap_mask(uvm_va_range_t *va_range,
     uvm_va_space_t *va_space = va_range->va_space;
     uvm_va_block_context_t *block_context = uvm_va_space_block_context(va_space, NULL);
     uvm_va_block_t *block;
+    uvm_gpu_t *gpu;
+    uvm_tracker_t flush_tracker = UVM_TRACKER_INIT();
+    NV_STATUS status = NV_OK;
+    NV_STATUS flush_status;
 
     UVM_ASSERT_MSG(va_range->type == UVM_VA_RANGE_TYPE_MANAGED, "type 0x%x\n", va_range->type);
 
     if (uvm_processor_mask_empty(mask))
         return NV_OK;
 
+    // Queue up the TLB invalidates of all the blocks in the page trees and
+    // push them once per GPU below, instead of once per block and GPU. Holding
+    // the VA space lock in write mode keeps everything but eviction from
+    // touching the blocks until then, and eviction flushes the deferred
+    // invalidates itself.
+    block_context->mapping.defer_tlb_invalidates = uvm_va_range_num_blocks(va_range) > 1;
+
     for_each_va_block_in_va_range(va_range, block) {
-        NV_STATUS status;
         uvm_va_block_region_t region = uvm_va_block_region_from_block(block);
 
-        uvm_mutex_lock(&block->lock);
+        uvm_va_block_lock(block);
         status = uvm_va_block_unmap_mask(block, block_context, mask, region, NULL);
         if (out_tracker)
             uvm_tracker_add_tracker_safe(out_tracker, &block->tracker);
 
-        uvm_mutex_unlock(&block->lock);
+        uvm_va_block_unlock(block);
         if (status != NV_OK)
-            return status;
+            break;
     }
 
-    return NV_OK;
+    if (!block_context->mapping.defer_tlb_invalidates)
+        return status;
+
+    block_context->mapping.defer_tlb_invalidates = false;
+
+    // Flush even on failure, as some of the blocks might have been unmapped
+    for_each_va_space_gpu_in_mask(gpu, va_space, mask) {
+        uvm_gpu_va_space_t *gpu_va_space = uvm_gpu_va_space_get(va_space, gpu);
+
+        if (!gpu_va_space)
+            continue;
+
+        flush_status = uvm_page_tree_flush_deferred_tlb_invalidates(&gpu_va_space->page_tables, &flush_tracker);
+        if (status == NV_OK)
+            status = flush_status;
+    }
+
+    // Make any later operation on the blocks depend on the flush
+    if (!uvm_tracker_is_empty(&flush_tracker)) {
+        for_each_va_block_in_va_range(va_range, block) {
+            uvm_va_block_lock(block);
+            flush_status = uvm_tracker_add_tracker_safe(&block->tracker, &flush_tracker);
+            uvm_va_block_unlock(block);
+
+            if (status == NV_OK)
+                status = flush_status;
+        }
+
+        if (out_tracker) {
+            flush_status = uvm_tracker_add_tracker_safe(out_tracker, &flush_tracker);
+            if (status == NV_OK)
+                status = flush_status;
+        }
+    }
+
+    uvm_tracker_deinit(&flush_tracker);
+
+    return status;
 }
 
 static NV_STATUS range_unmap(uvm_va_range_t *va_range, uvm_processor_id_t processor, uvm_tracker_t *out_tracker)
@@ -1276,7 +1351,7 @@ static NV_STATUS range_map_uvm_lite_gpus(uvm_va_range_t *va_range, uvm_tracker_t
 
     for_each_va_block_in_va_range(va_range, va_block) {
         // UVM-Lite GPUs always map with RWA
-        uvm_mutex_lock(&va_block->lock);
+        uvm_va_block_lock(va_block);
         status = UVM_VA_BLOCK_RETRY_LOCKED(va_block, NULL,
                 uvm_va_block_map_mask(va_block,
                                       va_block_context,
@@ -1288,7 +1363,7 @@ static NV_STATUS range_map_uvm_lite_gpus(uvm_va_range_t *va_range, uvm_tracker_t
         if (status == NV_OK && out_tracker)
             status = uvm_tracker_add_tracker(out_tracker, &va_block->tracker);
 
-        uvm_mutex_unlock(&va_block->lock);
+        uvm_va_block_unlock(va_block);
         if (status != NV_OK)
             break;
     }
@@ -1442,7 +1517,7 @@ NV_STATUS uvm_va_range_set_preferred_location(uvm_va_range_t *va_range,
 
         // Also, mark CPU pages as dirty and remove remote mappings from the new
         // preferred location
-        uvm_mutex_lock(&va_block->lock);
+        uvm_va_block_lock(va_block);
         status = UVM_VA_BLOCK_RETRY_LOCKED(va_block,
                                            NULL,
                                            uvm_va_block_set_preferred_location_locked(va_block, va_block_context));
@@ -1450,7 +1525,7 @@ NV_STATUS uvm_va_range_set_preferred_location(uvm_va_range_t *va_range,
         if (out_tracker)
             uvm_tracker_add_tracker_safe(out_tracker, &va_block->tracker);
 
-        uvm_mutex_unlock(&va_block->lock);
+        uvm_va_block_unlock(va_block);
 
         if (status != NV_OK)
             return status;
@@ -546,6 +546,21 @@ NV_STATUS uvm_va_range_split(uvm_va_range_t *existing_va_range,
 // Returns the va_range containing addr, if any
 uvm_va_range_t *uvm_va_range_find(uvm_va_space_t *va_space, NvU64 addr);
 
+// Look up the va_ranges containing count addresses, sorted in ascending order,
+// at once. nodes[i] is set to the range tree node of the va_range containing
+// addrs[i], or NULL if there is none. See uvm_range_tree_find_batch().
+void uvm_va_range_find_batch(uvm_va_space_t *va_space,
+                             const NvU64 *addrs,
+                             size_t count,
+                             uvm_range_tree_node_t **nodes);
+
+static uvm_va_range_t *uvm_va_range_container(uvm_range_tree_node_t *node)
+{
+    if (!node)
+        return NULL;
+    return container_of(node, uvm_va_range_t, node);
+}
+
 static uvm_ext_gpu_map_t *uvm_ext_gpu_map_container(uvm_range_tree_node_t *node)
 {
     if (!node)
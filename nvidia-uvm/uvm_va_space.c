@@ -180,6 +180,14 @@ NV_STATUS uvm_va_space_create(struct inode *inode, struct file *filp)
     uvm_range_tree_init(&va_space->va_range_tree);
     uvm_rwlock_irqsave_init(&va_space->ats.rwlock, UVM_LOCK_ORDER_LEAF);
 
+    // VA ranges are looked up on every fault and API call, so keep the tree
+    // indexed.
+    status = uvm_range_tree_enable_index(&va_space->va_range_tree);
+    if (status != NV_OK) {
+        uvm_kvfree(va_space);
+        return status;
+    }
+
     // By default all struct files on the same inode share the same
     // address_space structure (the inode's) across all processes. This means
     // unmap_mapping_range would unmap virtual mappings across all processes on
@@ -270,6 +278,7 @@ fail:
     uvm_perf_destroy_va_space_events(&va_space->perf_events);
     uvm_va_space_up_write(va_space);
 
+    uvm_range_tree_deinit(&va_space->va_range_tree);
     uvm_kvfree(va_space);
 
     return status;
@@ -455,6 +464,8 @@ void uvm_va_space_destroy(uvm_va_space_t *va_space)
         uvm_va_range_destroy(va_range, &deferred_free_list);
     }
 
+    uvm_range_tree_deinit(&va_space->va_range_tree);
+
     uvm_hmm_va_space_destroy(va_space);
 
     uvm_range_group_radix_tree_destroy(va_space);
@@ -1953,7 +1964,7 @@ NV_STATUS uvm_test_va_space_add_dummy_thread_contexts(UVM_TEST_VA_SPACE_ADD_DUMM
 {
     size_t i;
     uvm_va_space_t *va_space;
-    size_t total_dummy_thread_contexts = params->num_dummy_thread_contexts * UVM_THREAD_CONTEXT_TABLE_SIZE;
+    size_t total_dummy_thread_contexts = params->num_dummy_thread_contexts * uvm_thread_context_table_size();
     NV_STATUS status = NV_OK;
 
     if (params->num_dummy_thread_contexts == 0)
@@ -1993,7 +2004,7 @@ NV_STATUS uvm_test_va_space_add_dummy_thread_contexts(UVM_TEST_VA_SPACE_ADD_DUMM
         // The context pointer is used to fill the task.
         thread_context->task = (struct task_struct *) thread_context;
 
-        uvm_thread_context_add_at(thread_context, i % UVM_THREAD_CONTEXT_TABLE_SIZE);
+        uvm_thread_context_add_at(thread_context, i % uvm_thread_context_table_size());
     }
 
 out:
@@ -2020,7 +2031,7 @@ static void va_space_remove_dummy_thread_contexts(uvm_va_space_t *va_space)
     for (i = 0; i < va_space->test.num_dummy_thread_context_wrappers; i++) {
         uvm_thread_context_t *thread_context = &va_space->test.dummy_thread_context_wrappers[i].context;
 
-        uvm_thread_context_remove_at(thread_context, i % UVM_THREAD_CONTEXT_TABLE_SIZE);
+        uvm_thread_context_remove_at(thread_context, i % uvm_thread_context_table_size());
     }
 
     uvm_kvfree(va_space->test.dummy_thread_context_wrappers);
@@ -198,7 +198,15 @@ struct uvm_va_space_struct
     // UVM_LOCK_ORDER_VA_SPACE_READ_ACQUIRE_WRITE_RELEASE_LOCK in uvm_lock.h.
     uvm_mutex_t read_acquire_write_release_lock;
 
-    // Tree of uvm_va_range_t's
+    // Tree of uvm_va_range_t's. Protected by lock: lookups require it in read
+    // mode and changes in write mode.
+    //
+    // The tree is not RCU-readable on purpose. Fault servicing needs the lock
+    // in read mode for the rest of its work anyway, since the registered GPUs,
+    // the GPU VA spaces and the range policies are protected by it. Ranges are
+    // also split and destroyed in place, along with their VA blocks, while the
+    // lock is held in write mode. A lock-free lookup would therefore not let
+    // faults make progress while a writer holds the lock.
     uvm_range_tree_t va_range_tree;
 
     // Kernel mapping structure passed to unmap_mapping range to unmap CPU PTEs